@@ -1,6 +1,6 @@
 TEMPLATE = subdirs
 
-SUBDIRS = src tests
+SUBDIRS = src tests benchmarks
 
 OTHER_FILES += \
     FORMAT.txt \
@@ -0,0 +1,8 @@
+!include(./bakery_link.pri) {
+    error( "Could not include ./bakery_link.pri!" )
+}
+
+TEMPLATE = lib
+CONFIG += plugin
+DEFINES += BAKERY_PLUGIN_LIBRARY
+DESTDIR = $$PWD/dist/plugins
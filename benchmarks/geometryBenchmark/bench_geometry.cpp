@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <helpers.hpp>
+#include <plugins.h>
+#include <shape.h>
+#include <sheet.h>
+
+#include <QString>
+#include <QtTest>
+#include <QtCore/qmath.h>
+
+// Convenience
+#define V(x) BakeryHelpers::qrealPrecise(x)
+
+Q_DECLARE_METATYPE(Shape)
+Q_DECLARE_METATYPE(Sheet)
+Q_DECLARE_METATYPE(PluginInput)
+Q_DECLARE_METATYPE(PluginOutput)
+
+/*!
+ * \brief Returns a closed polygon with vertices on a circle. Every second vertex is moved inwards if star is true.
+ * \param vertices Number of vertices.
+ * \param x X coordinate of the center.
+ * \param y Y coordinate of the center.
+ * \param radius Radius.
+ * \param star If true, the polygon is a non-convex star.
+ * \return Polygon.
+ */
+static Shape polygon(qint32 vertices, qreal x, qreal y, qreal radius, bool star = false)
+{
+    Shape shape;
+    shape.setUpdateMetrics(false);
+    for (qint32 i_vertex = 0; i_vertex < vertices; ++i_vertex)
+    {
+        qreal r = star && i_vertex % 2 == 1 ? radius / 2 : radius;
+        qreal angle = 2 * M_PI * i_vertex / vertices;
+        shape << QPoint(V(x + r * qCos(angle)), V(y + r * qSin(angle)));
+    }
+    shape.ensureClosed();
+    shape.setUpdateMetrics(true);
+    return shape;
+}
+
+/*!
+ * \brief Returns a sheet with shapes placed in a grid with one cell per shape and one free cell in the last row.
+ * \param shapes Number of shapes.
+ * \param vertices Number of vertices of each shape.
+ * \return Valid sheet.
+ */
+static Sheet grid(qint32 shapes, qint32 vertices)
+{
+    qint32 columns = qCeil(qSqrt(shapes + 1));
+    qint32 rows = (shapes + columns) / columns;
+    Sheet sheet(V(columns), V(rows));
+    for (qint32 i_shape = 0; i_shape < shapes; ++i_shape)
+    {
+        Shape shape = polygon(vertices, i_shape % columns + 0.5, i_shape / columns + 0.5, 0.45);
+        shape.setName(QString("Shape %1").arg(i_shape));
+        sheet << shape;
+    }
+    return sheet;
+}
+
+/*!
+ * \brief Micro-benchmarks of the geometry and sheet hot paths.
+ *
+ * Each case is parameterized by the number of vertices or shapes, so the results of a run with -csv can be plotted as scaling curves.
+ */
+class GeometryBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    GeometryBenchmark();
+
+private Q_SLOTS:
+    void intersects_data();
+    void intersects();
+    void updateMetrics_data();
+    void updateMetrics();
+    void rotated_data();
+    void rotated();
+    void convexHull_data();
+    void convexHull();
+    void mayPlace_data();
+    void mayPlace();
+    void isValid_data();
+    void isValid();
+    void pluginInputSerialization_data();
+    void pluginInputSerialization();
+    void pluginOutputSerialization_data();
+    void pluginOutputSerialization();
+};
+
+GeometryBenchmark::GeometryBenchmark() {}
+
+void GeometryBenchmark::intersects_data()
+{
+    QTest::addColumn<Shape>("shape");
+    QTest::addColumn<Shape>("other");
+
+    QList<qint32> vertices;
+    vertices << 8 << 64 << 512;
+    foreach (qint32 n, vertices)
+    {
+        Shape shape = polygon(n, 1, 1, 1);
+        QTest::newRow(qPrintable(QString("Disjoint, %1 vertices").arg(n))) << shape << polygon(n, 4, 1, 1);
+        QTest::newRow(qPrintable(QString("Touching, %1 vertices").arg(n))) << shape << polygon(n, 3, 1, 1);
+        QTest::newRow(qPrintable(QString("Overlapping, %1 vertices").arg(n))) << shape << polygon(n, 2, 1, 1);
+        QTest::newRow(qPrintable(QString("Nested, %1 vertices").arg(n))) << shape << polygon(n, 1, 1, 0.5);
+    }
+}
+
+void GeometryBenchmark::intersects()
+{
+    QFETCH(Shape, shape);
+    QFETCH(Shape, other);
+
+    QBENCHMARK
+    {
+        shape.intersects(other);
+    }
+}
+
+void GeometryBenchmark::updateMetrics_data()
+{
+    QTest::addColumn<QPolygon>("points");
+
+    QList<qint32> vertices;
+    vertices << 8 << 64 << 512 << 1024;
+    foreach (qint32 n, vertices)
+    {
+        QTest::newRow(qPrintable(QString("%1 vertices").arg(n))) << QPolygon(polygon(n, 1, 1, 1, true));
+    }
+}
+
+void GeometryBenchmark::updateMetrics()
+{
+    QFETCH(QPolygon, points);
+
+    // The constructor computes all metrics
+    QBENCHMARK
+    {
+        Shape shape(points);
+    }
+}
+
+void GeometryBenchmark::rotated_data()
+{
+    QTest::addColumn<Shape>("shape");
+
+    QList<qint32> vertices;
+    vertices << 8 << 64 << 512 << 1024;
+    foreach (qint32 n, vertices)
+    {
+        QTest::newRow(qPrintable(QString("%1 vertices").arg(n))) << polygon(n, 1, 1, 1, true);
+    }
+}
+
+void GeometryBenchmark::rotated()
+{
+    QFETCH(Shape, shape);
+
+    QBENCHMARK
+    {
+        shape.rotated(shape.centroid(), 0.5);
+    }
+}
+
+void GeometryBenchmark::convexHull_data()
+{
+    QTest::addColumn<Shape>("shape");
+
+    QList<qint32> vertices;
+    vertices << 8 << 64 << 512;
+    foreach (qint32 n, vertices)
+    {
+        QTest::newRow(qPrintable(QString("%1 vertices").arg(n))) << polygon(n, 1, 1, 1, true);
+    }
+}
+
+void GeometryBenchmark::convexHull()
+{
+    QFETCH(Shape, shape);
+
+    QBENCHMARK
+    {
+        shape.convexHull();
+    }
+}
+
+void GeometryBenchmark::mayPlace_data()
+{
+    QTest::addColumn<Sheet>("sheet");
+    QTest::addColumn<Shape>("shape");
+
+    QList<qint32> shapes;
+    shapes << 10 << 100 << 1000;
+    QList<qint32> vertices;
+    vertices << 8 << 64;
+    foreach (qint32 n, shapes)
+    {
+        foreach (qint32 m, vertices)
+        {
+            // The free cell is the one after the last shape
+            qint32 columns = qCeil(qSqrt(n + 1));
+            Shape shape = polygon(m, n % columns + 0.5, n / columns + 0.5, 0.45);
+            QTest::newRow(qPrintable(QString("%1 shapes, %2 vertices").arg(n).arg(m))) << grid(n, m) << shape;
+        }
+    }
+}
+
+void GeometryBenchmark::mayPlace()
+{
+    QFETCH(Sheet, sheet);
+    QFETCH(Shape, shape);
+
+    QVERIFY(sheet.mayPlace(shape));
+    QBENCHMARK
+    {
+        sheet.mayPlace(shape);
+    }
+}
+
+void GeometryBenchmark::isValid_data()
+{
+    QTest::addColumn<Sheet>("sheet");
+
+    QList<qint32> shapes;
+    shapes << 10 << 100 << 1000;
+    QList<qint32> vertices;
+    vertices << 8 << 64;
+    foreach (qint32 n, shapes)
+    {
+        foreach (qint32 m, vertices)
+        {
+            QTest::newRow(qPrintable(QString("%1 shapes, %2 vertices").arg(n).arg(m))) << grid(n, m);
+        }
+    }
+}
+
+void GeometryBenchmark::isValid()
+{
+    QFETCH(Sheet, sheet);
+
+    QVERIFY(sheet.isValid());
+    QBENCHMARK
+    {
+        sheet.isValid();
+    }
+}
+
+void GeometryBenchmark::pluginInputSerialization_data()
+{
+    QTest::addColumn<PluginInput>("input");
+
+    QList<qint32> shapes;
+    shapes << 10 << 100 << 1000;
+    QList<qint32> vertices;
+    vertices << 8 << 64;
+    foreach (qint32 n, shapes)
+    {
+        foreach (qint32 m, vertices)
+        {
+            PluginInput input;
+            input.sheetWidth = V(10);
+            input.sheetHeight = V(10);
+            for (qint32 i_shape = 0; i_shape < n; ++i_shape)
+            {
+                Shape shape = polygon(m, 1, 1, 1, true);
+                shape.setName(QString("Shape %1").arg(i_shape));
+                input << shape;
+            }
+            QTest::newRow(qPrintable(QString("%1 shapes, %2 vertices").arg(n).arg(m))) << input;
+        }
+    }
+}
+
+void GeometryBenchmark::pluginInputSerialization()
+{
+    QFETCH(PluginInput, input);
+
+    PluginInput read;
+    QBENCHMARK
+    {
+        QString buffer;
+        QTextStream out(&buffer, QIODevice::WriteOnly);
+        out << input;
+        out.flush();
+        QTextStream in(&buffer, QIODevice::ReadOnly);
+        read = PluginInput();
+        in >> read;
+    }
+    QVERIFY(read == input);
+}
+
+void GeometryBenchmark::pluginOutputSerialization_data()
+{
+    QTest::addColumn<PluginOutput>("output");
+
+    QList<qint32> shapes;
+    shapes << 10 << 100 << 1000;
+    QList<qint32> vertices;
+    vertices << 8 << 64;
+    foreach (qint32 n, shapes)
+    {
+        foreach (qint32 m, vertices)
+        {
+            PluginOutput output;
+            output.sheets << grid(n, m);
+            QTest::newRow(qPrintable(QString("%1 shapes, %2 vertices").arg(n).arg(m))) << output;
+        }
+    }
+}
+
+void GeometryBenchmark::pluginOutputSerialization()
+{
+    QFETCH(PluginOutput, output);
+
+    PluginOutput read;
+    QBENCHMARK
+    {
+        QString buffer;
+        QTextStream out(&buffer, QIODevice::WriteOnly);
+        out << output;
+        out.flush();
+        QTextStream in(&buffer, QIODevice::ReadOnly);
+        read = PluginOutput();
+        in >> read;
+    }
+    QVERIFY(read == output);
+}
+
+QTEST_MAIN(GeometryBenchmark)
+
+#include "bench_geometry.moc"
@@ -0,0 +1,17 @@
+!include(../../bakery_dist.pri) {
+    error( "Could not include ../../bakery.pri!" )
+}
+
+!include(../../bakery_link.pri) {
+    error( "Could not include ../bakery_link.pri!" )
+}
+
+QT += testlib
+
+TARGET = bench_geometry
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += bench_geometry.cpp
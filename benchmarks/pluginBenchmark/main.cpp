@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../../src/lib/bakery.h"
+#include "pluginbenchmark.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <QTextStream>
+
+#define VERSION "1.0.0"
+
+/*!
+ * \brief Returns the input files of a benchmark.
+ * \param path Directory containing input files or a file listing one input file per line. Empty lines and lines starting with '#' are
+ * ignored, relative paths are relative to the list file.
+ * \param ok Will be set to true if no errors occur.
+ * \return Paths to input files.
+ */
+static QStringList inputFiles(QString path, bool *ok)
+{
+    QStringList files;
+    QFileInfo info(path);
+    if (info.isDir())
+    {
+        QDir directory(path);
+        foreach (QString fileName, directory.entryList(QDir::Files | QDir::Readable, QDir::Name))
+        {
+            files << directory.filePath(fileName);
+        }
+        *ok = true;
+        return files;
+    }
+
+    QFile listFile(path);
+    if (!listFile.open(QFile::ReadOnly | QFile::Text))
+    {
+        BAKERY_CRITICAL(QString("Failed to open input list '%1'").arg(path));
+        *ok = false;
+        return files;
+    }
+    QTextStream stream(&listFile);
+    while (!stream.atEnd())
+    {
+        QString line = stream.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+        files << info.dir().filePath(line);
+    }
+    *ok = true;
+    return files;
+}
+
+// Benchmark main function
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName("bakery-benchmark");
+    QCoreApplication::setApplicationVersion(VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Bakery plugin benchmark");
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    parser.addPositionalArgument("inputs", "Directory of input files or a file listing one input file per line, e.g. input/random.");
+
+    QCommandLineOption timeLimitOption(QStringList() << "t"
+                                                     << "time-limit",
+                                       "Time limit of each run, 0 for none. Default: 10", "seconds", "10");
+    parser.addOption(timeLimitOption);
+
+    QCommandLineOption countOption(QStringList() << "n"
+                                                 << "count",
+                                   "Use the first <count> input files in name order, 0 for all. Default: 10", "count", "10");
+    parser.addOption(countOption);
+
+    QCommandLineOption pluginsOption(QStringList() << "p"
+                                                   << "plugins",
+                                     "Benchmark plugins with names matching the regular expression. Default: all", "regex", "");
+    parser.addOption(pluginsOption);
+
+    QCommandLineOption outputOption(QStringList() << "o"
+                                                  << "output",
+                                    "Save the results as JSON to <file>. Default: standard output", "file", "");
+    parser.addOption(outputOption);
+
+    QCommandLineOption baselineOption(QStringList() << "b"
+                                                    << "baseline",
+                                      "Compare the results against a stored result file and fail on regressions.", "file", "");
+    parser.addOption(baselineOption);
+
+    QCommandLineOption toleranceOption(QStringList() << "tolerance",
+                                       "Allowed deterioration against the baseline in percent. Default: 10", "percent", "10");
+    parser.addOption(toleranceOption);
+
+    QCommandLineOption inProcessOption(QStringList() << "in-process", "Run plugins available as library in-process instead of as process.");
+    parser.addOption(inProcessOption);
+
+    QCommandLineOption singleOption(QStringList() << "single",
+                                    "Internal: run only <plugin> on a single input and print the result as JSON.", "plugin", "");
+    parser.addOption(singleOption);
+
+    parser.process(application);
+    QStringList positional = parser.positionalArguments();
+    if (positional.size() != 1)
+    {
+        parser.showHelp(EXIT_FAILURE);
+    }
+
+    bool ok;
+    int timeLimit = parser.value(timeLimitOption).toInt(&ok);
+    if (!ok || timeLimit < 0)
+    {
+        BAKERY_CRITICAL(QString("Invalid value for time limit ('%1')").arg(parser.value(timeLimitOption)));
+        return EXIT_FAILURE;
+    }
+
+    Bakery bakery;
+    bakery.setInProcessEnabled(parser.isSet(inProcessOption));
+    PluginBenchmark benchmark(&bakery);
+    benchmark.setTimeLimit(timeLimit);
+
+    // Single run in a process of its own
+    if (parser.isSet(singleOption))
+    {
+        QJsonObject result = benchmark.measure(parser.value(singleOption), positional.first(), &ok);
+        if (!ok)
+        {
+            return EXIT_FAILURE;
+        }
+        QFile output;
+        output.open(stdout, QIODevice::WriteOnly);
+        output.write(QJsonDocument(result).toJson(QJsonDocument::Compact));
+        return EXIT_SUCCESS;
+    }
+
+    // Inputs
+    int count = parser.value(countOption).toInt(&ok);
+    if (!ok || count < 0)
+    {
+        BAKERY_CRITICAL(QString("Invalid value for number of input files ('%1')").arg(parser.value(countOption)));
+        return EXIT_FAILURE;
+    }
+    QStringList inputs = inputFiles(positional.first(), &ok);
+    if (!ok)
+    {
+        return EXIT_FAILURE;
+    }
+    if (count > 0)
+    {
+        inputs = inputs.mid(0, count);
+    }
+    if (inputs.isEmpty())
+    {
+        BAKERY_CRITICAL(QString("No input files in '%1'").arg(positional.first()));
+        return EXIT_FAILURE;
+    }
+
+    // Plugins
+    QRegularExpression pluginsExpression(parser.value(pluginsOption));
+    if (!pluginsExpression.isValid())
+    {
+        BAKERY_CRITICAL(QString("Regular expression '%1' is invalid").arg(parser.value(pluginsOption)));
+        return EXIT_FAILURE;
+    }
+    QStringList plugins;
+    foreach (QString pluginName, bakery.getAllPlugins())
+    {
+        if (pluginsExpression.match(pluginName).hasMatch())
+        {
+            plugins << pluginName;
+        }
+    }
+    plugins.sort();
+    if (plugins.isEmpty())
+    {
+        BAKERY_CRITICAL("There are no plugins available/selected");
+        return EXIT_FAILURE;
+    }
+
+    QStringList extraArguments;
+    if (parser.isSet(inProcessOption))
+    {
+        extraArguments << "--in-process";
+    }
+    QJsonObject results = benchmark.run(plugins, inputs, extraArguments);
+
+    // Results
+    QFile output;
+    if (parser.value(outputOption).isEmpty())
+    {
+        output.open(stdout, QIODevice::WriteOnly);
+    }
+    else
+    {
+        output.setFileName(parser.value(outputOption));
+        if (!output.open(QFile::WriteOnly | QFile::Truncate))
+        {
+            BAKERY_CRITICAL(QString("Failed to open output file '%1' for writing").arg(output.fileName()));
+            return EXIT_FAILURE;
+        }
+    }
+    output.write(QJsonDocument(results).toJson());
+    output.close();
+
+    // Comparison
+    if (parser.isSet(baselineOption))
+    {
+        qreal tolerance = parser.value(toleranceOption).toDouble(&ok);
+        if (!ok || tolerance < 0)
+        {
+            BAKERY_CRITICAL(QString("Invalid value for tolerance ('%1')").arg(parser.value(toleranceOption)));
+            return EXIT_FAILURE;
+        }
+        QFile baselineFile(parser.value(baselineOption));
+        if (!baselineFile.open(QFile::ReadOnly))
+        {
+            BAKERY_CRITICAL(QString("Failed to open baseline '%1'").arg(baselineFile.fileName()));
+            return EXIT_FAILURE;
+        }
+        QJsonDocument baseline = QJsonDocument::fromJson(baselineFile.readAll());
+        if (!baseline.isObject())
+        {
+            BAKERY_CRITICAL(QString("Baseline '%1' is not a result file").arg(baselineFile.fileName()));
+            return EXIT_FAILURE;
+        }
+
+        QTextStream report(stderr, QIODevice::WriteOnly);
+        qint32 regressions = PluginBenchmark::compare(results, baseline.object(), tolerance / 100, report);
+        report << QString("%1 regression(s) against '%2'\n").arg(regressions).arg(baselineFile.fileName());
+        report.flush();
+        if (regressions > 0)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
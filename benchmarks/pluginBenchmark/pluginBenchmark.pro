@@ -0,0 +1,20 @@
+!include(../../bakery_dist.pri) {
+    error( "Could not include ../../bakery.pri!" )
+}
+
+!include(../../bakery_link.pri) {
+    error( "Could not include ../bakery_link.pri!" )
+}
+
+QT += core
+
+TARGET = bakery-benchmark
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += main.cpp \
+    pluginbenchmark.cpp
+
+HEADERS += pluginbenchmark.h
@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pluginbenchmark.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QJsonDocument>
+#include <QProcess>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+/*!
+ * \brief Convenience method to set the value of a bool pointer to value if not NULL.
+ * \param b bool pointer.
+ * \param value Target value.
+ */
+static void setBool(bool *b, bool value)
+{
+    if (b != NULL)
+    {
+        *b = value;
+    }
+}
+
+/*!
+ * \brief Returns the CPU time used so far.
+ * \param self If true, the time of the process itself, otherwise the time of its terminated children.
+ * \return CPU time in milliseconds, -1 if not available.
+ */
+static qint64 cpuTime(bool self)
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if (getrusage(self ? RUSAGE_SELF : RUSAGE_CHILDREN, &usage) != 0)
+    {
+        return -1;
+    }
+    return (qint64(usage.ru_utime.tv_sec) + qint64(usage.ru_stime.tv_sec)) * 1000 +
+           (qint64(usage.ru_utime.tv_usec) + qint64(usage.ru_stime.tv_usec)) / 1000;
+#else
+    Q_UNUSED(self)
+    return -1;
+#endif
+}
+
+/*!
+ * \brief Returns the peak resident set size so far.
+ * \param self If true, the size of the process itself, otherwise the largest size of its terminated children.
+ * \return Peak resident set size in kilobytes, -1 if not available.
+ */
+static qint64 peakRss(bool self)
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if (getrusage(self ? RUSAGE_SELF : RUSAGE_CHILDREN, &usage) != 0)
+    {
+        return -1;
+    }
+#ifdef Q_OS_MAC
+    return qint64(usage.ru_maxrss) / 1024;
+#else
+    return qint64(usage.ru_maxrss);
+#endif
+#else
+    Q_UNUSED(self)
+    return -1;
+#endif
+}
+
+/*!
+ * \brief Writes a regression if a value got worse by more than the tolerance.
+ * \param report Stream the regression is written to.
+ * \param run Name of the run.
+ * \param metric Name of the value.
+ * \param baseline Value of the baseline. Values less than zero are not compared.
+ * \param current Current value. Values less than zero are not compared.
+ * \param tolerance Allowed relative increase.
+ * \param noise Absolute increase which is always allowed.
+ * \return true if the value regressed.
+ */
+static bool increased(QTextStream &report, QString run, QString metric, qreal baseline, qreal current, qreal tolerance, qreal noise)
+{
+    if (baseline < 0 || current < 0 || current <= baseline * (1 + tolerance) || current - baseline <= noise)
+    {
+        return false;
+    }
+    report << QString("%1: %2 increased from %3 to %4\n").arg(run).arg(metric).arg(baseline).arg(current);
+    return true;
+}
+
+PluginBenchmark::PluginBenchmark(Bakery *bakery, QObject *parent)
+    : QObject(parent), _bakery(bakery), _timeLimit(10), _input(), _timer(), _firstValidOutput(-1)
+{
+}
+
+void PluginBenchmark::setTimeLimit(qint32 seconds) { _timeLimit = qMax(seconds, 0); }
+
+QJsonObject PluginBenchmark::run(QStringList plugins, QStringList inputFiles, QStringList extraArguments)
+{
+    // A crashed or hanging benchmark process only loses its own run
+    int timeout = _timeLimit == 0 ? -1 : (_timeLimit + 60) * 1000;
+    QJsonArray results;
+    foreach (QString inputFile, inputFiles)
+    {
+        foreach (QString plugin, plugins)
+        {
+            BAKERY_DEBUG(QString("Running '%1' on '%2'").arg(plugin).arg(inputFile));
+            QStringList arguments;
+            arguments << "--single" << plugin << "--time-limit" << QString::number(_timeLimit) << extraArguments << inputFile;
+
+            QProcess process;
+            process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+            process.start(QCoreApplication::applicationFilePath(), arguments);
+            if (!process.waitForFinished(timeout) || process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0)
+            {
+                BAKERY_CRITICAL(QString("Benchmark of '%1' on '%2' failed").arg(plugin).arg(inputFile));
+                process.kill();
+                process.waitForFinished();
+                continue;
+            }
+
+            QJsonParseError error;
+            QJsonDocument document = QJsonDocument::fromJson(process.readAllStandardOutput(), &error);
+            if (error.error != QJsonParseError::NoError || !document.isObject())
+            {
+                BAKERY_CRITICAL(QString("Benchmark of '%1' on '%2' returned an invalid result: %3")
+                                    .arg(plugin)
+                                    .arg(inputFile)
+                                    .arg(error.errorString()));
+                continue;
+            }
+            results.append(document.object());
+        }
+    }
+
+    QJsonObject benchmark;
+    benchmark["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    benchmark["timeLimit"] = _timeLimit;
+    benchmark["results"] = results;
+    benchmark["plugins"] = summarize(results);
+    return benchmark;
+}
+
+QJsonObject PluginBenchmark::measure(QString plugin, QString inputFile, bool *ok)
+{
+    QJsonObject result;
+    if (!_bakery->isPluginLoaded(plugin))
+    {
+        BAKERY_CRITICAL(QString("Plugin '%1' is not loaded").arg(plugin));
+        setBool(ok, false);
+        return result;
+    }
+
+    QFile file(inputFile);
+    if (!file.open(QFile::ReadOnly))
+    {
+        BAKERY_CRITICAL(QString("Failed to open input file '%1'").arg(inputFile));
+        setBool(ok, false);
+        return result;
+    }
+    bool loaded;
+    _input = Bakery::loadFromDevice(&file, &loaded);
+    file.close();
+    if (!loaded)
+    {
+        BAKERY_CRITICAL(QString("Failed to load plugin input from file '%1'").arg(inputFile));
+        setBool(ok, false);
+        return result;
+    }
+
+    _bakery->setAllPluginsEnabled(false);
+    _bakery->setPluginEnabled(plugin, true);
+    _bakery->setTimeLimit(_timeLimit * 1000);
+
+    // Resource usage of the children is only updated once they are terminated, so it is taken before and after the run
+    qint64 cpuBefore = cpuTime(false) + cpuTime(true);
+    _firstValidOutput = -1;
+    connect(_bakery, SIGNAL(pluginOutputUpdated(QString, PluginOutput)), this, SLOT(outputUpdated(QString, PluginOutput)));
+    QFutureWatcher<QHash<QString, PluginOutput>> watcher;
+    QEventLoop loop;
+    connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+    _timer.start();
+    watcher.setFuture(_bakery->computeAllOutputsAsync(_input));
+    if (!watcher.isFinished())
+    {
+        loop.exec();
+    }
+    qint64 wallTime = _timer.elapsed();
+    disconnect(_bakery, SIGNAL(pluginOutputUpdated(QString, PluginOutput)), this, SLOT(outputUpdated(QString, PluginOutput)));
+    qint64 cpuAfter = cpuTime(false) + cpuTime(true);
+
+    // Plugins running in-process count for the benchmark process itself
+    QHash<QString, PluginOutput> outputs = watcher.result();
+    PluginOutput output = outputs.value(plugin);
+    result["plugin"] = plugin;
+    result["input"] = QFileInfo(inputFile).fileName();
+    result["wallTime"] = wallTime;
+    result["cpuTime"] = cpuBefore < 0 || cpuAfter < 0 ? -1 : cpuAfter - cpuBefore;
+    result["peakRss"] = _bakery->isInProcessEnabled() ? peakRss(true) : peakRss(false);
+    result["firstValidOutput"] = _firstValidOutput;
+    result["valid"] = outputs.contains(plugin);
+    result["score"] = BakeryPlugins::outputScore(output);
+    result["sheets"] = output.sheets.size();
+    setBool(ok, true);
+    return result;
+}
+
+qint32 PluginBenchmark::compare(const QJsonObject &results, const QJsonObject &baseline, qreal tolerance, QTextStream &report)
+{
+    QHash<QString, QJsonObject> baselineRuns;
+    foreach (const QJsonValue &value, baseline["results"].toArray())
+    {
+        QJsonObject run = value.toObject();
+        baselineRuns[QString("%1 on %2").arg(run["plugin"].toString(), run["input"].toString())] = run;
+    }
+
+    qint32 regressions = 0;
+    foreach (const QJsonValue &value, results["results"].toArray())
+    {
+        QJsonObject current = value.toObject();
+        QString name = QString("%1 on %2").arg(current["plugin"].toString(), current["input"].toString());
+        if (!baselineRuns.contains(name))
+        {
+            BAKERY_WARNING(QString("No baseline for %1").arg(name));
+            continue;
+        }
+        QJsonObject base = baselineRuns[name];
+
+        // Quality
+        if (base["valid"].toBool() && !current["valid"].toBool())
+        {
+            report << QString("%1: no valid output\n").arg(name);
+            ++regressions;
+            continue;
+        }
+        if (!current["valid"].toBool())
+        {
+            continue;
+        }
+        if (current["sheets"].toInt() > base["sheets"].toInt())
+        {
+            report << QString("%1: sheets increased from %2 to %3\n")
+                          .arg(name)
+                          .arg(base["sheets"].toInt())
+                          .arg(current["sheets"].toInt());
+            ++regressions;
+        }
+        if (current["score"].toDouble() < base["score"].toDouble() * (1 - tolerance))
+        {
+            report << QString("%1: score decreased from %2 to %3\n")
+                          .arg(name)
+                          .arg(base["score"].toDouble())
+                          .arg(current["score"].toDouble());
+            ++regressions;
+        }
+
+        // Resources
+        if (base["firstValidOutput"].toDouble() >= 0 && current["firstValidOutput"].toDouble() < 0)
+        {
+            report << QString("%1: no valid output before the end\n").arg(name);
+            ++regressions;
+        }
+        const char *times[] = {"wallTime", "cpuTime", "firstValidOutput"};
+        for (qint32 i_time = 0; i_time < 3; ++i_time)
+        {
+            regressions += increased(report, name, times[i_time], base[times[i_time]].toDouble(), current[times[i_time]].toDouble(),
+                                     tolerance, 10) ? 1 : 0;
+        }
+        regressions +=
+            increased(report, name, "peakRss", base["peakRss"].toDouble(), current["peakRss"].toDouble(), tolerance, 1024) ? 1 : 0;
+    }
+    report.flush();
+    return regressions;
+}
+
+QJsonObject PluginBenchmark::summarize(const QJsonArray &results)
+{
+    QJsonObject plugins;
+    foreach (const QJsonValue &value, results)
+    {
+        QJsonObject run = value.toObject();
+        QString plugin = run["plugin"].toString();
+        QJsonObject summary = plugins[plugin].toObject();
+        summary["runs"] = summary["runs"].toInt() + 1;
+        summary["wallTime"] = summary["wallTime"].toDouble() + run["wallTime"].toDouble();
+        summary["cpuTime"] = summary["cpuTime"].toDouble() + run["cpuTime"].toDouble();
+        summary["peakRss"] = qMax(summary["peakRss"].toDouble(), run["peakRss"].toDouble());
+        summary["valid"] = summary["valid"].toInt() + (run["valid"].toBool() ? 1 : 0);
+        if (run["valid"].toBool())
+        {
+            summary["score"] = summary["score"].toDouble() + run["score"].toDouble();
+            summary["sheets"] = summary["sheets"].toInt() + run["sheets"].toInt();
+        }
+        plugins[plugin] = summary;
+    }
+    return plugins;
+}
+
+void PluginBenchmark::outputUpdated(QString pluginName, PluginOutput pluginOutput)
+{
+    Q_UNUSED(pluginName)
+    if (_firstValidOutput < 0 && Bakery::isOutputValidForInput(_input, pluginOutput))
+    {
+        _firstValidOutput = _timer.elapsed();
+    }
+}
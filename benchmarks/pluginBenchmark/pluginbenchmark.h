@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PLUGINBENCHMARK_H
+#define PLUGINBENCHMARK_H
+
+#include "../../src/lib/bakery.h"
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+/*!
+ * \brief Measures plugins on a set of input files.
+ *
+ * Each plugin is run on each input in a separate process of the benchmark itself (see measure()), so CPU time and peak resident set size
+ * of the plugin can be taken from the resource usage of the terminated children without being mixed up with other runs. The results are
+ * JSON objects which can be saved as a baseline and compared against later runs.
+ */
+class PluginBenchmark : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief Constructor.
+     * \param bakery Bakery running the plugins. Has to outlive the PluginBenchmark.
+     * \param parent QObject parent.
+     */
+    explicit PluginBenchmark(Bakery *bakery, QObject *parent = 0);
+
+    /*!
+     * \brief Sets the time limit of each run.
+     * \param seconds Time limit in seconds.
+     */
+    void setTimeLimit(qint32 seconds);
+
+    /*!
+     * \brief Runs every plugin on every input, each in its own benchmark process. This method is blocking.
+     * \param plugins Names of the plugins.
+     * \param inputFiles Paths to input files.
+     * \param extraArguments Arguments passed to each benchmark process, e.g. to run plugins in-process.
+     * \return Results as JSON object, see measure() for the single results.
+     */
+    QJsonObject run(QStringList plugins, QStringList inputFiles, QStringList extraArguments = QStringList());
+
+    /*!
+     * \brief Runs a single plugin on a single input. This method is blocking.
+     *
+     * The result contains the plugin name, the input file name, wall time and CPU time in milliseconds, peak resident set size in
+     * kilobytes, time to the first valid output in milliseconds (-1 if there was none), the score and the number of sheets of the final
+     * output and whether the final output is valid. CPU time and peak resident set size are -1 if they are not available on the platform.
+     * \param plugin Name of the plugin. All other plugins are disabled.
+     * \param inputFile Path to input file.
+     * \param ok Will be set to true if no errors occur. Will be ignored if set to NULL.
+     * \return Result as JSON object.
+     */
+    QJsonObject measure(QString plugin, QString inputFile, bool *ok = NULL);
+
+    /*!
+     * \brief Compares results against a baseline and writes a line for every regression.
+     *
+     * Runs are matched by plugin and input file name. A run regresses if its output is no longer valid, uses more sheets, has a score which
+     * is worse by more than the tolerance or needs more time or memory than the tolerance allows. Differences below 10 milliseconds and
+     * 1 megabyte are ignored as noise.
+     * \param results Current results.
+     * \param baseline Stored results.
+     * \param tolerance Allowed relative deterioration, e.g. 0.1 for 10%.
+     * \param report Stream the regressions are written to.
+     * \return Number of regressions.
+     */
+    static qint32 compare(const QJsonObject &results, const QJsonObject &baseline, qreal tolerance, QTextStream &report);
+
+private:
+    /*!
+     * \brief Bakery running the plugins.
+     */
+    Bakery *_bakery;
+
+    /*!
+     * \brief Time limit of each run in seconds.
+     */
+    qint32 _timeLimit;
+
+    /*!
+     * \brief Input of the running measurement.
+     */
+    PluginInput _input;
+
+    /*!
+     * \brief Started when the running measurement starts.
+     */
+    QElapsedTimer _timer;
+
+    /*!
+     * \brief Time to the first valid output of the running measurement in milliseconds, -1 if there was none.
+     */
+    qint64 _firstValidOutput;
+
+    /*!
+     * \brief Sums up the results of each plugin. Times, scores and sheets are totals, the peak resident set size is the maximum.
+     * \param results Results of all runs.
+     * \return Summary of each plugin by name.
+     */
+    static QJsonObject summarize(const QJsonArray &results);
+
+private slots:
+    /*!
+     * \brief Records the time of the first valid output.
+     * \param pluginName Name of plugin.
+     * \param pluginOutput New output.
+     */
+    void outputUpdated(QString pluginName, PluginOutput pluginOutput);
+};
+
+#endif // PLUGINBENCHMARK_H
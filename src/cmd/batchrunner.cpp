@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "batchrunner.h"
+#include "../lib/helpers.hpp"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QTextStream>
+#include <QThread>
+
+BatchRunner::BatchRunner(Bakery *bakery, QStringList inputFiles, QObject *parent)
+    : QObject(parent), _bakery(bakery), _results(), _running(), _next(0), _outputDirectory("./output"), _resultsFileName("results.txt"),
+      _svgOutput(false), _svgAutoFormatting(true), _svgImportParameters(), _allOutputs(false), _jobs(qMax(QThread::idealThreadCount(), 1)),
+      _loop()
+{
+    // Inputs with the same base name get the number of the input appended
+    QSet<QString> directoryNames;
+    for (qint32 i_input = 0; i_input < inputFiles.size(); ++i_input)
+    {
+        Result result;
+        result.inputFile = inputFiles[i_input];
+        result.directoryName = QFileInfo(result.inputFile).completeBaseName();
+        if (result.directoryName.isEmpty() || directoryNames.contains(result.directoryName))
+        {
+            result.directoryName += QString("_%1").arg(i_input);
+        }
+        directoryNames.insert(result.directoryName);
+        result.score = 0;
+        result.sheets = 0;
+        result.lowerBound = 0;
+        result.wallTime = 0;
+        result.solved = false;
+        _results << result;
+    }
+}
+
+QStringList BatchRunner::inputFiles(QString path, bool *ok)
+{
+    QStringList files;
+    QFileInfo info(path);
+    if (info.isDir())
+    {
+        QDir directory(path);
+        foreach (QString fileName, directory.entryList(QDir::Files | QDir::Readable, QDir::Name))
+        {
+            files << directory.filePath(fileName);
+        }
+        BakeryHelpers::setBool(ok, true);
+        return files;
+    }
+
+    QFile listFile(path);
+    if (!listFile.open(QFile::ReadOnly | QFile::Text))
+    {
+        BAKERY_CRITICAL(QString("Failed to open input list '%1'").arg(path));
+        BakeryHelpers::setBool(ok, false);
+        return files;
+    }
+    QTextStream stream(&listFile);
+    while (!stream.atEnd())
+    {
+        QString line = stream.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+        files << info.dir().filePath(line);
+    }
+    BakeryHelpers::setBool(ok, true);
+    return files;
+}
+
+PluginInput BatchRunner::loadInput(QString path, const SVGImportParameters &parameters, bool *ok)
+{
+    QFile inputFile(path);
+    if (!inputFile.open(QFile::ReadOnly))
+    {
+        BAKERY_CRITICAL(QString("Failed to open input file '%1'").arg(path));
+        BakeryHelpers::setBool(ok, false);
+        return PluginInput();
+    }
+    if (QFileInfo(path).suffix().compare("svg", Qt::CaseInsensitive) == 0)
+    {
+        return Bakery::loadFromSVG(&inputFile, ok, parameters);
+    }
+    return Bakery::loadFromDevice(&inputFile, ok);
+}
+
+void BatchRunner::setOutputDirectory(QString path) { _outputDirectory = path; }
+
+void BatchRunner::setResultsFileName(QString fileName) { _resultsFileName = fileName; }
+
+void BatchRunner::setSvgOutput(bool svgOutput) { _svgOutput = svgOutput; }
+
+void BatchRunner::setSvgAutoFormatting(bool autoFormatting) { _svgAutoFormatting = autoFormatting; }
+
+void BatchRunner::setSVGImportParameters(const SVGImportParameters &parameters) { _svgImportParameters = parameters; }
+
+void BatchRunner::setAllOutputs(bool allOutputs) { _allOutputs = allOutputs; }
+
+void BatchRunner::setJobs(qint32 jobs) { _jobs = qMax(jobs, 1); }
+
+bool BatchRunner::run()
+{
+    startJobs();
+    if (!_running.isEmpty())
+    {
+        _loop.exec();
+    }
+
+    bool result = true;
+    foreach (const Result &inputResult, _results)
+    {
+        result &= inputResult.solved;
+    }
+    return result;
+}
+
+bool BatchRunner::writeSummary(QIODevice *device) const
+{
+    QTextStream stream(device);
+    stream << "input\tplugin\tscore\tsheets\tbound\twall_ms\n";
+    foreach (const Result &result, _results)
+    {
+        stream << result.inputFile << "\t" << (result.solved ? result.bestPlugin : QString("-")) << "\t"
+               << QString::number(result.score, 'f', 2) << "\t" << result.sheets << "\t" << result.lowerBound << "\t"
+               << result.wallTime << "\n";
+    }
+    stream.flush();
+    return stream.status() == QTextStream::Ok;
+}
+
+void BatchRunner::startJobs()
+{
+    while (_running.size() < _jobs && _next < _results.size())
+    {
+        qint32 index = _next++;
+        Job job;
+        job.index = index;
+        job.timer.start();
+
+        bool ok;
+        PluginInput input = loadInput(_results[index].inputFile, _svgImportParameters, &ok);
+        if (!ok)
+        {
+            BAKERY_CRITICAL(QString("Failed to load plugin input from file '%1'").arg(_results[index].inputFile));
+            continue;
+        }
+
+        // The watcher reports through the event loop, so a job finishing right away does not start the next one recursively
+        job.bakery = _bakery->createJob(this);
+        QFutureWatcher<QHash<QString, PluginOutput>> *watcher = new QFutureWatcher<QHash<QString, PluginOutput>>(this);
+        connect(watcher, SIGNAL(finished()), this, SLOT(jobFinished()));
+        _running[watcher] = job;
+        watcher->setFuture(job.bakery->computeAllOutputsAsync(input));
+    }
+}
+
+void BatchRunner::saveOutputs(Result &result, QHash<QString, PluginOutput> outputs)
+{
+    if (outputs.isEmpty())
+    {
+        BAKERY_WARNING(QString("No plugin found a valid solution for '%1'").arg(result.inputFile));
+        return;
+    }
+
+    QStringList pluginNames = outputs.keys();
+    QList<PluginOutput> candidates;
+    foreach (QString pluginName, pluginNames)
+    {
+        candidates << outputs[pluginName];
+    }
+    result.bestPlugin = pluginNames[ScoredOutput::best(candidates, _bakery->objective())];
+    PluginOutput best = outputs[result.bestPlugin];
+    result.score = BakeryPlugins::outputScore(best);
+    result.sheets = best.sheets.size();
+
+    QString directory = QDir(_outputDirectory).absoluteFilePath(result.directoryName);
+    if (_allOutputs)
+    {
+        foreach (QString pluginName, outputs.keys())
+        {
+            if (!Bakery::saveToDirectory(outputs[pluginName], QDir(directory).absoluteFilePath(pluginName), _resultsFileName, _svgOutput,
+                                         _svgAutoFormatting))
+            {
+                BAKERY_CRITICAL(QString("Failed to save output of plugin '%1' for '%2'").arg(pluginName, result.inputFile));
+                return;
+            }
+        }
+    }
+    else if (!Bakery::saveToDirectory(best, directory, _resultsFileName, _svgOutput, _svgAutoFormatting))
+    {
+        BAKERY_CRITICAL(QString("Failed to save output for '%1'").arg(result.inputFile));
+        return;
+    }
+    result.solved = true;
+}
+
+void BatchRunner::jobFinished()
+{
+    QFutureWatcher<QHash<QString, PluginOutput>> *watcher = static_cast<QFutureWatcher<QHash<QString, PluginOutput>> *>(sender());
+    if (!_running.contains(watcher))
+    {
+        return;
+    }
+    Job job = _running.take(watcher);
+    Result &result = _results[job.index];
+    result.wallTime = job.timer.elapsed();
+    result.lowerBound = job.bakery->lowerBound();
+    saveOutputs(result, watcher->result());
+    BAKERY_DEBUG(QString("Finished '%1' in %2 ms").arg(result.inputFile).arg(result.wallTime));
+
+    watcher->deleteLater();
+    job.bakery->deleteLater();
+
+    startJobs();
+    if (_running.isEmpty())
+    {
+        _loop.quit();
+    }
+}
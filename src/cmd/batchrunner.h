@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include "../lib/bakery.h"
+
+#include <QObject>
+#include <QEventLoop>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+/*!
+ * \brief Solves several input files with a shared Bakery.
+ *
+ * Each input is run by a job created with Bakery::createJob(QObject *), so plugins are only loaded once and all jobs share the worker
+ * pool and the scheduler of the Bakery. The results of each input are saved to a subdirectory of the output directory named after the
+ * input file.
+ */
+class BatchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief Constructor.
+     * \param bakery Bakery used to create jobs. Has to outlive the BatchRunner.
+     * \param inputFiles Paths to input files.
+     * \param parent QObject parent.
+     */
+    BatchRunner(Bakery *bakery, QStringList inputFiles, QObject *parent = 0);
+
+    /*!
+     * \brief Returns the input files of a batch.
+     * \param path Directory containing input files or a file listing one input file per line. Empty lines and lines starting with '#'
+     * are ignored, relative paths are relative to the list file.
+     * \param ok Will be set to true if no errors occur. Will be ignored if set to NULL.
+     * \return Paths to input files.
+     */
+    static QStringList inputFiles(QString path, bool *ok = 0);
+
+    /*!
+     * \brief Loads an input file. Files ending with ".svg" are parsed as SVG (see Bakery::loadFromSVG()), all other files as text input.
+     * \param path Path to input file.
+     * \param parameters Parameters for the approximation of curves in SVG files.
+     * \param ok Will be set to true if no errors occur. Will be ignored if set to NULL.
+     * \return Loaded input.
+     */
+    static PluginInput loadInput(QString path, const SVGImportParameters &parameters, bool *ok = 0);
+
+    /*!
+     * \brief Sets the directory in which the results are saved.
+     * \param path Path to directory.
+     */
+    void setOutputDirectory(QString path);
+
+    /*!
+     * \brief Sets the name of the results file of each input.
+     * \param fileName File name.
+     */
+    void setResultsFileName(QString fileName);
+
+    /*!
+     * \brief Sets whether SVG files are saved.
+     * \param svgOutput If true, SVG files are saved.
+     */
+    void setSvgOutput(bool svgOutput);
+
+    /*!
+     * \brief Sets whether SVG files are indented.
+     * \param autoFormatting If true, SVG files are indented (default).
+     */
+    void setSvgAutoFormatting(bool autoFormatting);
+
+    /*!
+     * \brief Sets the parameters for the approximation of curves in SVG input files.
+     * \param parameters Parameters.
+     */
+    void setSVGImportParameters(const SVGImportParameters &parameters);
+
+    /*!
+     * \brief Sets whether the outputs of all plugins are saved instead of the best output only.
+     * \param allOutputs If true, all outputs are saved to one subdirectory per plugin.
+     */
+    void setAllOutputs(bool allOutputs);
+
+    /*!
+     * \brief Sets the number of inputs solved at the same time.
+     * \param jobs Number of inputs.
+     */
+    void setJobs(qint32 jobs);
+
+    /*!
+     * \brief Solves all inputs. This method is blocking.
+     * \return true if a valid output was found and saved for each input.
+     */
+    bool run();
+
+    /*!
+     * \brief Writes a tab separated summary with one line per input (input, best plugin, score, sheets, lower bound of sheets, wall time
+     * in milliseconds).
+     * \param device Device to write to.
+     * \return true if successful.
+     */
+    bool writeSummary(QIODevice *device) const;
+
+private:
+    /*!
+     * \brief Result of a single input.
+     */
+    struct Result
+    {
+        /*!
+         * \brief Path to the input file.
+         */
+        QString inputFile;
+
+        /*!
+         * \brief Subdirectory of the output directory for this input.
+         */
+        QString directoryName;
+
+        /*!
+         * \brief Name of the plugin with the best output. Empty if no valid output was found.
+         */
+        QString bestPlugin;
+
+        /*!
+         * \brief Score of the best output (see BakeryPlugins::outputScore(const PluginOutput &)).
+         */
+        qreal score;
+
+        /*!
+         * \brief Number of sheets of the best output.
+         */
+        qint32 sheets;
+
+        /*!
+         * \brief Lower bound of sheets of the input (see BakeryBounds::lowerBound(const PluginInput &)).
+         */
+        qint32 lowerBound;
+
+        /*!
+         * \brief Time from loading the input until all plugins were finished in milliseconds.
+         */
+        qint64 wallTime;
+
+        /*!
+         * \brief True if a valid output was found and saved.
+         */
+        bool solved;
+    };
+
+    /*!
+     * \brief Input which is currently solved.
+     */
+    struct Job
+    {
+        /*!
+         * \brief Index in _results.
+         */
+        qint32 index;
+
+        /*!
+         * \brief Bakery running the plugins.
+         */
+        Bakery *bakery;
+
+        /*!
+         * \brief Started when the input is loaded.
+         */
+        QElapsedTimer timer;
+    };
+
+    /*!
+     * \brief Used to create jobs.
+     */
+    Bakery *_bakery;
+
+    /*!
+     * \brief Results of all inputs in the order of the input files.
+     */
+    QList<Result> _results;
+
+    /*!
+     * \brief Running jobs by the watcher of their outputs.
+     */
+    QHash<QFutureWatcher<QHash<QString, PluginOutput>> *, Job> _running;
+
+    /*!
+     * \brief Index of the next input to start.
+     */
+    qint32 _next;
+
+    /*!
+     * \brief Output directory.
+     */
+    QString _outputDirectory;
+
+    /*!
+     * \brief Name of the results file.
+     */
+    QString _resultsFileName;
+
+    /*!
+     * \brief If true, SVG files are saved.
+     */
+    bool _svgOutput;
+
+    /*!
+     * \brief If true, SVG files are indented.
+     */
+    bool _svgAutoFormatting;
+
+    /*!
+     * \brief Parameters for the approximation of curves in SVG input files.
+     */
+    SVGImportParameters _svgImportParameters;
+
+    /*!
+     * \brief If true, the outputs of all plugins are saved.
+     */
+    bool _allOutputs;
+
+    /*!
+     * \brief Number of inputs solved at the same time.
+     */
+    qint32 _jobs;
+
+    /*!
+     * \brief Runs until all jobs are finished.
+     */
+    QEventLoop _loop;
+
+    /*!
+     * \brief Starts jobs until the maximum number of jobs is reached or all inputs are started.
+     */
+    void startJobs();
+
+    /*!
+     * \brief Saves the outputs of an input and fills its result.
+     * \param result Result of the input.
+     * \param outputs Valid outputs of all plugins.
+     */
+    void saveOutputs(Result &result, QHash<QString, PluginOutput> outputs);
+
+private slots:
+    /*!
+     * \brief Is called when all plugins of a job are finished.
+     */
+    void jobFinished();
+};
+
+#endif // BATCHRUNNER_H
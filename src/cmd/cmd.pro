@@ -14,4 +14,7 @@ CONFIG -= app_bundle
 
 TEMPLATE = app
 
-SOURCES += main.cpp
+SOURCES += main.cpp \
+    batchrunner.cpp
+
+HEADERS += batchrunner.h
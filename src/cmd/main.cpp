@@ -18,14 +18,50 @@
  */
 
 #include "../lib/bakery.h"
+#include "../lib/counters.h"
+#include "../lib/trace.h"
+#include "batchrunner.h"
 
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QCommandLineOption>
 #include <QRegularExpression>
+#include <QTextStream>
+#include <QThread>
 
 #define VERSION "1.0.0"
 
+// Prints counters as "<source> <name> <value>" lines. Known counters come first in their declaration order.
+static void printCounters(QTextStream &stream, QString source, QHash<QString, quint64> counters)
+{
+    for (qint32 i_counter = 0; i_counter < BakeryCounters::CounterCount; ++i_counter)
+    {
+        QString name = BakeryCounters::name(BakeryCounters::Counter(i_counter));
+        if (counters.contains(name))
+        {
+            stream << source << " " << name << " " << counters.take(name) << "\n";
+        }
+    }
+    QStringList names(counters.keys());
+    names.sort();
+    foreach (QString name, names)
+    {
+        stream << source << " " << name << " " << counters[name] << "\n";
+    }
+}
+
+// Writes the recorded trace as Chrome trace event file
+static bool writeTrace(QString path)
+{
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate) || !BakeryTrace::writeChromeTrace(&file))
+    {
+        BAKERY_CRITICAL(QString("Failed to write trace '%1'").arg(path));
+        return false;
+    }
+    return true;
+}
+
 // Command-line interface main function
 int main(int argc, char *argv[])
 {
@@ -38,7 +74,8 @@ int main(int argc, char *argv[])
     parser.addHelpOption();
     parser.addVersionOption();
 
-    parser.addPositionalArgument("input", "Input file path.");
+    parser.addPositionalArgument("input", "Input file path (text or SVG). In batch mode a directory or a file listing one input file per "
+                                          "line.");
 
     QCommandLineOption outputDirectoryPathOption(QStringList() << "o"
                                                                << "output-directory-path",
@@ -70,15 +107,130 @@ int main(int argc, char *argv[])
                                        "Save SVG files to output directory.");
     parser.addOption(svgOutputOption);
 
+    QCommandLineOption compactSvgOption(QStringList() << "compact-svg", "Save SVG files without indentation.");
+    parser.addOption(compactSvgOption);
+
     QCommandLineOption generateRandomOption(QStringList() << "generate-random",
                                             "Saves <count> randomly generated input files to output directory.", "count", "");
     parser.addOption(generateRandomOption);
 
+    QCommandLineOption randomProfileOption(QStringList() << "random-profile",
+                                           QString("Profile of random input files: %1. Default: default")
+                                               .arg(Bakery::randomProfiles().join(", ")),
+                                           "profile", "default");
+    parser.addOption(randomProfileOption);
+
+    QCommandLineOption randomPolygonsOption(QStringList() << "random-polygons",
+                                            "Polygons of random input files: rejection, star or jigsaw. Default: from profile",
+                                            "method", "");
+    parser.addOption(randomPolygonsOption);
+
     QCommandLineOption disabledPluginsOption(QStringList() << "d"
                                                            << "disabled-plugins",
                                              "Plugins with names matching the regular expression will be disabled.", "regex", "");
     parser.addOption(disabledPluginsOption);
 
+    QCommandLineOption inProcessOption(QStringList() << "in-process", "Run plugins available as library in-process instead of as process.");
+    parser.addOption(inProcessOption);
+
+    QCommandLineOption sharedMemoryOption(QStringList() << "shared-memory",
+                                          "Transfer input and outputs of plugin processes through shared memory.");
+    parser.addOption(sharedMemoryOption);
+
+    QCommandLineOption noPluginCacheOption(QStringList() << "no-plugin-cache",
+                                           "Probe all plugins instead of using cached plugin metadata.");
+    parser.addOption(noPluginCacheOption);
+
+    QCommandLineOption maxConcurrentOption(QStringList() << "max-concurrent",
+                                           "Run at most <count> plugins at the same time, 0 for no limit. Default: 0", "count", "0");
+    parser.addOption(maxConcurrentOption);
+
+    QCommandLineOption pluginThreadsOption(QStringList() << "plugin-threads",
+                                           "Number of threads each plugin may use, 0 for no limit. Default: 0", "count", "0");
+    parser.addOption(pluginThreadsOption);
+
+    QCommandLineOption cpuAffinityOption(QStringList() << "cpu-affinity", "Pin each plugin to its own CPUs (Linux only).");
+    parser.addOption(cpuAffinityOption);
+
+    QCommandLineOption resultCacheOption(QStringList() << "result-cache",
+                                         "Reuse outputs of earlier runs of the same plugin on an equal input with the same time limit.");
+    parser.addOption(resultCacheOption);
+
+    QCommandLineOption resultCacheDirectoryOption(QStringList() << "result-cache-directory", "Directory of the result cache.", "path");
+    parser.addOption(resultCacheDirectoryOption);
+
+    QCommandLineOption resultCacheSizeOption(QStringList() << "result-cache-size",
+                                             "Maximum size of the result cache, 0 for no limit. Default: 256", "MiB", "256");
+    parser.addOption(resultCacheSizeOption);
+
+    QCommandLineOption improveCachedResultsOption(QStringList() << "improve-cached-results",
+                                                  "Run plugins with cached outputs if they might find a better output.");
+    parser.addOption(improveCachedResultsOption);
+
+    QCommandLineOption objectiveOption(QStringList() << "objective",
+                                       QString("Objective to choose the best output by (%1). Default: utilization")
+                                           .arg(ScoredOutput::objectiveNames().join(", ")),
+                                       "objective", "utilization");
+    parser.addOption(objectiveOption);
+
+    QCommandLineOption simplifyOption(QStringList() << "simplify",
+                                      "Let plugins pack simplified shapes which contain the original shapes and differ by at most "
+                                      "<tolerance>. Outputs contain the original shapes. Default: 0 (disabled)",
+                                      "tolerance", "0");
+    parser.addOption(simplifyOption);
+
+    QCommandLineOption svgToleranceOption(QStringList() << "svg-tolerance",
+                                          "Replace curves of SVG inputs by polygons which contain them and differ by at most <tolerance> "
+                                          "SVG units. Default: 0 (curves are flattened like QPainterPath does)",
+                                          "tolerance", "0");
+    parser.addOption(svgToleranceOption);
+
+    QCommandLineOption svgMaxVerticesOption(QStringList() << "svg-max-vertices",
+                                            "Replace curves of SVG inputs by polygons which contain them and have at most <vertices> "
+                                            "vertices. Default: 0 (no limit)",
+                                            "vertices", "0");
+    parser.addOption(svgMaxVerticesOption);
+
+    QCommandLineOption portfolioOption(QStringList() << "portfolio",
+                                       "Terminate plugins early whose score stalls behind other plugins and pause the weakest plugins if "
+                                       "there are more plugins than CPUs.");
+    parser.addOption(portfolioOption);
+
+    QCommandLineOption earlyStopOption(QStringList() << "early-stop",
+                                       "Stop all plugins as soon as an output reaches the lower bound of sheets (only for the "
+                                       "'utilization' objective).");
+    parser.addOption(earlyStopOption);
+
+    QCommandLineOption killInvalidOption(QStringList() << "kill-invalid-plugins",
+                                         "Kill plugins as soon as they send an invalid output instead of keeping them running.");
+    parser.addOption(killInvalidOption);
+
+    QCommandLineOption boundSlackOption(QStringList() << "bound-slack",
+                                        "With --early-stop, stop plugins once an output uses at most <sheets> sheets more than the lower "
+                                        "bound. Default: 0",
+                                        "sheets", "0");
+    parser.addOption(boundSlackOption);
+
+    QCommandLineOption batchOption(QStringList() << "batch",
+                                   "Solve all inputs of a directory or input list. Results are saved to one subdirectory per input and "
+                                   "summarised in summary.txt.");
+    parser.addOption(batchOption);
+
+    QCommandLineOption jobsOption(QStringList() << "jobs",
+                                  "Number of inputs solved at the same time in batch mode. Default: number of CPUs", "count", "0");
+    parser.addOption(jobsOption);
+
+    QCommandLineOption countersOption(QStringList() << "counters",
+                                      "Print performance counters of each plugin and of bakery-cmd itself. In-process plugins count into "
+                                      "the counters of bakery-cmd.");
+    parser.addOption(countersOption);
+
+    QCommandLineOption traceOption(QStringList() << "trace",
+                                   "Record a timeline of plugin runs and protocol traffic, including spans of the plugins, and save it as "
+                                   "Chrome trace (chrome://tracing, Perfetto) to <file>.",
+                                   "file");
+    parser.addOption(traceOption);
+
     QCommandLineOption versionOption(QStringList() << "license", "Print license information and exit.");
     parser.addOption(versionOption);
 
@@ -141,26 +293,64 @@ int main(int argc, char *argv[])
             }
         }
 
-        RandomPluginInputParameters parameters;
-
-        for (int i = 0; i < randomCount; ++i)
+        RandomPluginInputParameters parameters = Bakery::randomProfile(parser.value(randomProfileOption), &ok);
+        if (!ok)
         {
-            QFile outputFile(QDir(outputDirectoryPath).absoluteFilePath(QString("random%1.txt").arg(i, 5, 10, QChar('0'))));
-            if (!outputFile.open(QFile::WriteOnly | QFile::Truncate))
+            BAKERY_CRITICAL(QString("Unknown random profile '%1'").arg(parser.value(randomProfileOption)));
+            return EXIT_FAILURE;
+        }
+        if (parser.isSet(randomPolygonsOption))
+        {
+            QString polygonMethod = parser.value(randomPolygonsOption);
+            if (polygonMethod == "rejection")
             {
-                BAKERY_CRITICAL(QString("Failed to open output file '%1'' for writing").arg(outputFile.fileName()));
-                exit(1);
+                parameters.polygonMethod = RandomPluginInputParameters::RejectionSampling;
+            }
+            else if (polygonMethod == "star")
+            {
+                parameters.polygonMethod = RandomPluginInputParameters::StarShaped;
+            }
+            else if (polygonMethod == "jigsaw")
+            {
+                parameters.polygonMethod = RandomPluginInputParameters::Jigsaw;
+            }
+            else
+            {
+                BAKERY_CRITICAL(QString("Unknown polygon method '%1'").arg(polygonMethod));
+                return EXIT_FAILURE;
             }
+        }
 
-            parameters.seed = i;
+        // Seeds are independent and generated in parallel, a batch per round keeps the memory bounded
+        int batchSize = qMax(QThread::idealThreadCount(), 1) * 4;
+        for (int i_batch = 0; i_batch < randomCount; i_batch += batchSize)
+        {
+            QList<qint32> seeds;
+            for (int i = i_batch; i < qMin(i_batch + batchSize, randomCount); ++i)
+            {
+                seeds << i;
+            }
 
-            PluginInput randomInput = Bakery::randomInput(parameters);
-            Bakery::saveToDevice(randomInput, &outputFile);
+            QList<PluginInput> randomInputs = Bakery::randomInputs(parameters, seeds);
+            for (int i = 0; i < seeds.size(); ++i)
+            {
+                QFile outputFile(QDir(outputDirectoryPath).absoluteFilePath(QString("random%1.txt").arg(seeds[i], 5, 10, QChar('0'))));
+                if (!outputFile.open(QFile::WriteOnly | QFile::Truncate))
+                {
+                    BAKERY_CRITICAL(QString("Failed to open output file '%1'' for writing").arg(outputFile.fileName()));
+                    exit(1);
+                }
+                Bakery::saveToDevice(randomInputs[i], &outputFile);
+            }
         }
         exit(0);
     }
 
     // Instantiate bakery
+    if (parser.isSet(noPluginCacheOption))
+    {
+        Bakery::setMetadataCacheFile(QString());
+    }
     Bakery bakery;
 
     // Available plugins
@@ -206,23 +396,7 @@ int main(int argc, char *argv[])
         parser.showHelp();
         return EXIT_FAILURE;
     }
-
-    // Input file
-    QString inputFilePath = positional[0];
     bool ok;
-    QFile inputFile(inputFilePath);
-    if (!inputFile.open(QFile::ReadOnly))
-    {
-        BAKERY_CRITICAL(QString("Failed to open input file '%1'").arg(inputFilePath));
-        return EXIT_FAILURE;
-    }
-    PluginInput input = Bakery::loadFromDevice(&inputFile, &ok);
-    inputFile.close();
-    if (!ok)
-    {
-        BAKERY_CRITICAL(QString("Failed to load plugin input from file '%1'").arg(inputFilePath));
-        return EXIT_FAILURE;
-    }
 
     // Time limit
     int timeLimit = 0;
@@ -231,26 +405,194 @@ int main(int argc, char *argv[])
         timeLimit = parser.value(timeLimitOption).toInt(&ok);
         if (!ok)
         {
-            BAKERY_CRITICAL(QString("Invalid value for time limit ('%1')").arg(inputFilePath));
+            BAKERY_CRITICAL(QString("Invalid value for time limit ('%1')").arg(parser.value(timeLimitOption)));
             return EXIT_FAILURE;
         }
         if (timeLimit < 0)
         {
-            BAKERY_CRITICAL(QString("Time limit is less than 0").arg(inputFilePath));
+            BAKERY_CRITICAL(QString("Time limit is less than 0 ('%1')").arg(timeLimit));
             return EXIT_FAILURE;
         }
         BAKERY_DEBUG(QString("Imposing time limit of %1 seconds").arg(timeLimit));
     }
     bakery.setTimeLimit(timeLimit * 1000);
+    bakery.setInProcessEnabled(parser.isSet(inProcessOption));
+    bakery.setSharedMemoryEnabled(parser.isSet(sharedMemoryOption));
 
+    // Scheduling
+    int maxConcurrent = parser.value(maxConcurrentOption).toInt(&ok);
+    if (!ok || maxConcurrent < 0)
+    {
+        BAKERY_CRITICAL(QString("Invalid value for maximum number of concurrent plugins ('%1')").arg(parser.value(maxConcurrentOption)));
+        return EXIT_FAILURE;
+    }
+    int pluginThreads = parser.value(pluginThreadsOption).toInt(&ok);
+    if (!ok || pluginThreads < 0)
+    {
+        BAKERY_CRITICAL(QString("Invalid value for plugin threads ('%1')").arg(parser.value(pluginThreadsOption)));
+        return EXIT_FAILURE;
+    }
+    bakery.scheduler()->setMaximumConcurrent(maxConcurrent);
+    bakery.scheduler()->setThreadsPerPlugin(pluginThreads);
+    bakery.scheduler()->setCpuAffinityEnabled(parser.isSet(cpuAffinityOption));
+    bakery.setPortfolioEnabled(parser.isSet(portfolioOption));
+
+    // Lower bound
+    int boundSlack = parser.value(boundSlackOption).toInt(&ok);
+    if (!ok || boundSlack < 0)
+    {
+        BAKERY_CRITICAL(QString("Invalid value for bound slack ('%1')").arg(parser.value(boundSlackOption)));
+        return EXIT_FAILURE;
+    }
+    bakery.setStopAtLowerBoundEnabled(parser.isSet(earlyStopOption));
+    bakery.setLowerBoundSlack(boundSlack);
+    bakery.setKillInvalidPluginsEnabled(parser.isSet(killInvalidOption));
+
+    // Objective
+    ScoredOutput::Objective objective = ScoredOutput::objectiveFromName(parser.value(objectiveOption), &ok);
+    if (!ok)
+    {
+        BAKERY_CRITICAL(QString("Invalid objective ('%1')").arg(parser.value(objectiveOption)));
+        return EXIT_FAILURE;
+    }
+    bakery.setObjective(objective);
+
+    // Simplification
+    qreal simplificationTolerance = parser.value(simplifyOption).toDouble(&ok);
+    if (!ok || simplificationTolerance < 0.0)
+    {
+        BAKERY_CRITICAL(QString("Invalid simplification tolerance ('%1')").arg(parser.value(simplifyOption)));
+        return EXIT_FAILURE;
+    }
+    bakery.setSimplificationTolerance(simplificationTolerance);
+
+    // SVG import
+    SVGImportParameters svgImportParameters;
+    svgImportParameters.tolerance = parser.value(svgToleranceOption).toDouble(&ok);
+    if (!ok || svgImportParameters.tolerance < 0.0)
+    {
+        BAKERY_CRITICAL(QString("Invalid SVG tolerance ('%1')").arg(parser.value(svgToleranceOption)));
+        return EXIT_FAILURE;
+    }
+    svgImportParameters.maximumVertices = parser.value(svgMaxVerticesOption).toInt(&ok);
+    if (!ok || svgImportParameters.maximumVertices < 0)
+    {
+        BAKERY_CRITICAL(QString("Invalid maximum number of SVG vertices ('%1')").arg(parser.value(svgMaxVerticesOption)));
+        return EXIT_FAILURE;
+    }
+
+    // Result cache
+    qint64 resultCacheSize = parser.value(resultCacheSizeOption).toLongLong(&ok);
+    if (!ok || resultCacheSize < 0)
+    {
+        BAKERY_CRITICAL(QString("Invalid value for result cache size ('%1')").arg(parser.value(resultCacheSizeOption)));
+        return EXIT_FAILURE;
+    }
+    bakery.setResultCacheEnabled(parser.isSet(resultCacheOption) || parser.isSet(improveCachedResultsOption));
+    bakery.setCachedResultImprovementEnabled(parser.isSet(improveCachedResultsOption));
+    bakery.setCountersEnabled(parser.isSet(countersOption));
+    BakeryCounters::setEnabled(parser.isSet(countersOption));
+    BakeryTrace::setEnabled(parser.isSet(traceOption));
+    if (bakery.isResultCacheEnabled())
+    {
+        if (parser.isSet(resultCacheDirectoryOption))
+        {
+            bakery.resultCache()->setDirectory(parser.value(resultCacheDirectoryOption));
+        }
+        bakery.resultCache()->setMaximumSize(resultCacheSize * 1024 * 1024);
+    }
+
+    // Batch mode
+    if (parser.isSet(batchOption))
+    {
+        int jobs = parser.value(jobsOption).toInt(&ok);
+        if (!ok || jobs < 0)
+        {
+            BAKERY_CRITICAL(QString("Invalid value for number of jobs ('%1')").arg(parser.value(jobsOption)));
+            return EXIT_FAILURE;
+        }
+        jobs = jobs == 0 ? qMax(QThread::idealThreadCount(), 1) : jobs;
+        QStringList inputFiles = BatchRunner::inputFiles(positional[0], &ok);
+        if (!ok)
+        {
+            return EXIT_FAILURE;
+        }
+        if (inputFiles.isEmpty())
+        {
+            BAKERY_CRITICAL(QString("No input files found in '%1'").arg(positional[0]));
+            return EXIT_FAILURE;
+        }
+
+        // All jobs share the plugin processes and the plugins of all jobs share the cores
+        if (maxConcurrent == 0)
+        {
+            bakery.scheduler()->setMaximumConcurrent(qMax(QThread::idealThreadCount(), 1));
+        }
+        bakery.setWorkerPoolEnabled(true);
+        bakery.processPool()->setPoolSize(jobs);
+
+        BatchRunner batch(&bakery, inputFiles);
+        batch.setOutputDirectory(parser.value(outputDirectoryPathOption));
+        batch.setResultsFileName(parser.value(resultsFileNameOption));
+        batch.setSvgOutput(parser.isSet(svgOutputOption));
+        batch.setSvgAutoFormatting(!parser.isSet(compactSvgOption));
+        batch.setSVGImportParameters(svgImportParameters);
+        batch.setAllOutputs(parser.isSet(allOutputsOption));
+        batch.setJobs(jobs);
+        bool solved = batch.run();
+        if (parser.isSet(traceOption) && !writeTrace(parser.value(traceOption)))
+        {
+            return EXIT_FAILURE;
+        }
+
+        QFile summaryFile(QDir(parser.value(outputDirectoryPathOption)).absoluteFilePath("summary.txt"));
+        if (!QDir().mkpath(parser.value(outputDirectoryPathOption)) || !summaryFile.open(QFile::WriteOnly | QFile::Truncate) ||
+            !batch.writeSummary(&summaryFile))
+        {
+            BAKERY_CRITICAL(QString("Failed to write summary '%1'").arg(summaryFile.fileName()));
+            return EXIT_FAILURE;
+        }
+        QFile standardOutput;
+        standardOutput.open(stdout, QFile::WriteOnly);
+        batch.writeSummary(&standardOutput);
+        return solved ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Input file
+    QString inputFilePath = positional[0];
+    PluginInput input = BatchRunner::loadInput(inputFilePath, svgImportParameters, &ok);
+    if (!ok)
+    {
+        BAKERY_CRITICAL(QString("Failed to load plugin input from file '%1'").arg(inputFilePath));
+        return EXIT_FAILURE;
+    }
     // Get all outputs
     bool svgOutput = parser.isSet(svgOutputOption);
+    bool svgAutoFormatting = !parser.isSet(compactSvgOption);
     QHash<QString, PluginOutput> outputs = bakery.computeAllOutputs(input, true, &ok);
     if (!ok)
     {
         BAKERY_CRITICAL("Failed to get plugin outputs");
         return EXIT_FAILURE;
     }
+    if (parser.isSet(countersOption))
+    {
+        QFile standardOutput;
+        standardOutput.open(stdout, QFile::WriteOnly);
+        QTextStream stream(&standardOutput);
+        QHash<QString, QHash<QString, quint64>> pluginCounters = bakery.pluginCounters();
+        QStringList pluginNames(pluginCounters.keys());
+        pluginNames.sort();
+        foreach (QString pluginName, pluginNames)
+        {
+            printCounters(stream, pluginName, pluginCounters[pluginName]);
+        }
+        printCounters(stream, "bakery-cmd", BakeryCounters::values());
+    }
+    if (parser.isSet(traceOption) && !writeTrace(parser.value(traceOption)))
+    {
+        return EXIT_FAILURE;
+    }
     if (outputs.isEmpty())
     {
         BAKERY_WARNING(QString("No plugin found a valid solution (time limit: %1)")
@@ -261,6 +603,9 @@ int main(int argc, char *argv[])
     {
         QStringList valid(outputs.keys());
         BAKERY_DEBUG(QString("Valid solutions found by: %1").arg(valid.join(", ")));
+        BAKERY_DEBUG(QString("Best solution uses %1 sheet(s), lower bound is %2 sheet(s)")
+                         .arg(Bakery::findBestOutput(outputs, bakery.objective()).sheets.size())
+                         .arg(bakery.lowerBound()));
     }
 
     // Save all outputs/best output
@@ -273,7 +618,7 @@ int main(int argc, char *argv[])
         {
             QString pluginName = outputs.keys()[i];
             if (!Bakery::saveToDirectory(outputs.values()[i], QString(QDir(outputDirectoryPath).absoluteFilePath(pluginName)),
-                                         resultsFileName, svgOutput))
+                                         resultsFileName, svgOutput, svgAutoFormatting))
             {
                 BAKERY_CRITICAL(QString("Failed to save output of plugin '%1'").arg(pluginName));
                 return EXIT_FAILURE;
@@ -283,10 +628,10 @@ int main(int argc, char *argv[])
     else
     {
         // Best output only
-        PluginOutput output = Bakery::findBestOutput(outputs);
+        PluginOutput output = Bakery::findBestOutput(outputs, bakery.objective());
         QString outputDirectoryPath = parser.value(outputDirectoryPathOption);
         QString resultsFileName = parser.value(resultsFileNameOption);
-        if (!Bakery::saveToDirectory(output, outputDirectoryPath, resultsFileName, svgOutput))
+        if (!Bakery::saveToDirectory(output, outputDirectoryPath, resultsFileName, svgOutput, svgAutoFormatting))
         {
             BAKERY_CRITICAL("Failed to save output");
             return EXIT_FAILURE;
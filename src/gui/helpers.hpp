@@ -49,13 +49,14 @@ inline PluginInput loadFromFile(QString path, bool *ok)
  * \brief Loads a PluginInput from a SVG input file at the given path.
  * \param path File path.
  * \param ok true if successful.
+ * \param parameters Parameters for the approximation of curves.
  * \return PluginInput.
  */
-inline PluginInput loadFromSVG(QString path, bool *ok)
+inline PluginInput loadFromSVG(QString path, bool *ok, const SVGImportParameters &parameters = SVGImportParameters())
 {
     QFile inputFile(path);
     inputFile.open(QFile::ReadOnly);
-    PluginInput input = Bakery::loadFromSVG(&inputFile, ok);
+    PluginInput input = Bakery::loadFromSVG(&inputFile, ok, parameters);
     inputFile.close();
     if (!*ok)
     {
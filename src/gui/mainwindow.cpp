@@ -116,7 +116,7 @@ void MainWindow::_allPluginsFinished(QHash<QString, PluginOutput> pluginOutputs)
     }
     else
     {
-        _bestOutput = Bakery::findBestOutput(_validOutputs);
+        _bestOutput = Bakery::findBestOutput(_validOutputs, _bakery.objective());
         QStringList valid(_validOutputs.keys());
         log(tr("All plugins finished. Valid solutions found by: %1.").arg(valid.join(", ")));
     }
@@ -128,7 +128,7 @@ void MainWindow::updateActions()
     bool valid = !_validOutputs.isEmpty();
     _ui->actionFileQuit->setEnabled(!_working);
     _ui->actionTaskNew->setEnabled(!_working);
-    _ui->actionTaskRepeatLast->setEnabled(!_working && !_lastInput.shapes.empty());
+    _ui->actionTaskRepeatLast->setEnabled(!_working && !_lastInput.stock().isEmpty());
     _ui->actionTaskSaveOutput->setEnabled(!_working && valid);
     _ui->actionTaskTerminateAllPlugins->setEnabled(_working && !_terminatingHard);
     _ui->actionViewZoomIn->setEnabled(_scale <= _maxScale - _scaleDelta);
@@ -170,10 +170,10 @@ void MainWindow::startTask(PluginInput input)
     std::random_device rnd;
     std::uniform_int_distribution<qint32> distribution(0, 255);
 
-    Shape::Unique unique = Shape::reduceToUnique(input.shapes);
-    foreach (QString name, unique.names)
+    const ShapeStock &stock = input.stock();
+    for (qint32 i_type = 0; i_type < stock.types(); ++i_type)
     {
-        _shapeColors[name] = QColor(distribution(rnd), distribution(rnd), distribution(rnd));
+        _shapeColors[stock.prototype(i_type).name()] = QColor(distribution(rnd), distribution(rnd), distribution(rnd));
     }
     _pluginOutputItems.clear();
     _ui->outputsListWidget->clear();
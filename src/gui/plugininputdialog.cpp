@@ -168,7 +168,7 @@ void PluginInputDialog::validate()
         setValid(false, tr("No shapes."));
         return;
     }
-    _input->shapes = _shapesListModel.expand();
+    _input->setStock(_shapesListModel.stock());
 
     setValid(true, tr("Task is valid."));
 }
@@ -235,20 +235,17 @@ void ShapesListModel::update(const PluginInput &input)
     _items.clear();
     endResetModel();
 
-    foreach (Shape shape, input.shapes)
+    const ShapeStock &stock = input.stock();
+    for (qint32 i_type = 0; i_type < stock.types(); ++i_type)
     {
-        int index = indexOf(shape.name());
-        if (index == -1)
+        if (stock.count(i_type) == 0)
         {
-            ShapesListItem item;
-            item.shape = shape;
-            item.amount = 1;
-            _items << item;
-        }
-        else
-        {
-            ++_items[index].amount;
+            continue;
         }
+        ShapesListItem item;
+        item.shape = stock.prototype(i_type);
+        item.amount = stock.count(i_type);
+        _items << item;
     }
     emit dataChanged(index(0, 0), index(0, _items.size() - 1));
 }
@@ -282,17 +279,14 @@ void ShapesListModel::clear()
     emit dataChanged(index(0, 0), index(0, rows));
 }
 
-QList<Shape> ShapesListModel::expand() const
+ShapeStock ShapesListModel::stock() const
 {
-    QList<Shape> shapes;
+    ShapeStock stock;
     for (int i = 0; i < _items.size(); ++i)
     {
-        for (int j = 0; j < _items[i].amount; j++)
-        {
-            shapes << _items[i].shape;
-        }
+        stock.add(_items[i].shape, _items[i].amount);
     }
-    return shapes;
+    return stock;
 }
 
 QList<QString> ShapesListModel::names() const
@@ -129,10 +129,10 @@ public:
     void clear();
 
     /*!
-     * \brief Returns a list of shapes list model shapes where each Shape's frequency is equal to its amount.
-     * \return Expanded model.
+     * \brief Returns the shapes of the model as stock where each Shape's number of pieces is equal to its amount.
+     * \return Stock of shapes.
      */
-    QList<Shape> expand() const;
+    ShapeStock stock() const;
 
     /*!
      * \brief Returns a list of unique Shapes names according to Shapes list model.
@@ -26,6 +26,8 @@
 #include <QXmlStreamWriter>
 #include <QXmlStreamReader>
 #include <QBuffer>
+#include <QFile>
+#include <QTextCodec>
 #include <QPainterPath>
 #include <QColor>
 #include <QSet>
@@ -33,38 +35,730 @@
 #include <QEventLoop>
 #include <QTimer>
 #include <random>
+#include <limits>
+#include <cstring>
 #include <QTime>
+#include <QElapsedTimer>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QtConcurrent/QtConcurrentMap>
 
 /*!
- * \brief Convenience method to set the value of a bool pointer to value if not NULL.
- * \param b bool pointer.
- * \param value Target value.
+ * \brief Returns if no output can score better than one reaching the lower bound on the number of sheets.
+ *
+ * This only holds if the score of a complete output depends on nothing but its number of sheets.
+ *
+ * \param objective Objective used to compare outputs.
+ * \return true if reaching the lower bound means the output is optimal.
+ */
+static bool lowerBoundIsOptimal(ScoredOutput::Objective objective) { return objective == ScoredOutput::AverageUtilization; }
+
+/*!
+ * \brief File name of the plugin metadata cache. Is set to the default location on first use.
+ */
+static QString metadataCacheFileName;
+
+/*!
+ * \brief true if metadataCacheFileName has been initialised.
+ */
+static bool metadataCacheFileNameSet = false;
+
+/*!
+ * \brief Returns if a byte is whitespace as understood by QTextStream.
+ * \param c Byte.
+ * \return true if whitespace.
+ */
+static inline bool isInputSpace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+/*!
+ * \brief Reads the next whitespace separated token like QTextStream >> QString.
+ * \param pos Current position. Is moved behind the token.
+ * \param end End of data.
+ * \param token Is set to the token. Empty if the end of the data has been reached.
+ * \return false if the token contains non-ASCII characters which need to be decoded.
+ */
+static bool nextInputToken(const char *&pos, const char *end, QByteArray &token)
+{
+    while (pos < end && isInputSpace(*pos))
+    {
+        ++pos;
+    }
+    const char *begin = pos;
+    while (pos < end && !isInputSpace(*pos))
+    {
+        if (uchar(*pos) >= 0x80)
+        {
+            return false;
+        }
+        ++pos;
+    }
+    token = QByteArray::fromRawData(begin, qint32(pos - begin));
+    return true;
+}
+
+/*!
+ * \brief Converts a token to an integer. Gives the same results as QString::toInt(bool *).
+ * \param token Token.
+ * \param ok Is set to false if the token is not an integer.
+ * \return Integer.
  */
-static void setBool(bool *b, bool value)
+static qint32 inputTokenToInt(const QByteArray &token, bool *ok)
 {
-    if (b != NULL)
+    const char *pos = token.constData();
+    const char *end = pos + token.size();
+    bool negative = pos < end && *pos == '-';
+    if (negative)
+    {
+        ++pos;
+    }
+    if (pos == end || end - pos > 10)
+    {
+        return token.toInt(ok);
+    }
+    qint64 value = 0;
+    for (; pos < end; ++pos)
+    {
+        if (*pos < '0' || *pos > '9')
+        {
+            return token.toInt(ok);
+        }
+        value = value * 10 + (*pos - '0');
+    }
+    value = negative ? -value : value;
+    if (value < std::numeric_limits<qint32>::min() || value > std::numeric_limits<qint32>::max())
     {
-        *b = value;
+        BakeryHelpers::setBool(ok, false);
+        return 0;
     }
+    BakeryHelpers::setBool(ok, true);
+    return qint32(value);
 }
 
+/*!
+ * \brief Converts a token to a double. Gives the same results as QString::toDouble(bool *).
+ *
+ * Plain decimal numbers with up to 15 significant digits and small exponents are converted with a single correctly rounded floating point
+ * operation. All other tokens are converted by Qt.
+ *
+ * \param token Token.
+ * \param ok Is set to false if the token is not a number.
+ * \return Number.
+ */
+static double inputTokenToDouble(const QByteArray &token, bool *ok)
+{
+    static const double powersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    const char *pos = token.constData();
+    const char *end = pos + token.size();
+    bool negative = pos < end && *pos == '-';
+    if (negative)
+    {
+        ++pos;
+    }
+
+    quint64 mantissa = 0;
+    qint32 digits = 0;
+    qint32 significantDigits = 0;
+    qint32 exponent = 0;
+    for (; pos < end && *pos >= '0' && *pos <= '9'; ++pos, ++digits)
+    {
+        mantissa = mantissa * 10 + (*pos - '0');
+        significantDigits += mantissa != 0 ? 1 : 0;
+    }
+    if (digits == 0 || significantDigits > 15)
+    {
+        return token.toDouble(ok);
+    }
+    if (pos < end && *pos == '.')
+    {
+        ++pos;
+        qint32 fractionDigits = 0;
+        for (; pos < end && *pos >= '0' && *pos <= '9'; ++pos, ++fractionDigits)
+        {
+            mantissa = mantissa * 10 + (*pos - '0');
+            significantDigits += mantissa != 0 ? 1 : 0;
+        }
+        if (fractionDigits == 0 || significantDigits > 15)
+        {
+            return token.toDouble(ok);
+        }
+        exponent -= fractionDigits;
+    }
+    if (pos < end && (*pos == 'e' || *pos == 'E'))
+    {
+        ++pos;
+        bool negativeExponent = pos < end && *pos == '-';
+        if (pos < end && (*pos == '-' || *pos == '+'))
+        {
+            ++pos;
+        }
+        qint32 exponentDigits = 0;
+        qint32 explicitExponent = 0;
+        for (; pos < end && *pos >= '0' && *pos <= '9' && exponentDigits < 4; ++pos, ++exponentDigits)
+        {
+            explicitExponent = explicitExponent * 10 + (*pos - '0');
+        }
+        if (exponentDigits == 0)
+        {
+            return token.toDouble(ok);
+        }
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+    if (pos != end || exponent < -22 || exponent > 22)
+    {
+        return token.toDouble(ok);
+    }
+
+    // Both operands are exact, so the result is rounded exactly once
+    double value = double(mantissa);
+    value = exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+    BakeryHelpers::setBool(ok, true);
+    return negative ? -value : value;
+}
+
+/*!
+ * \brief Parses an input file from memory. Accepts the same files and reports the same errors as the QTextStream based parser in
+ * Bakery::loadFromDevice(QIODevice *, bool *).
+ * \param data Data.
+ * \param size Size of data.
+ * \param input Is set to the parsed input.
+ * \param error Is set to the error message if parsing fails.
+ * \param duplicateName Is set to the name of a shape if it is found twice.
+ * \return false if the data contains non-ASCII characters outside of names and has to be parsed by the QTextStream based parser.
+ */
+static bool parseInputData(const char *data, qint64 size, PluginInput &input, const char *&error, QString &duplicateName)
+{
+    const char *pos = data;
+    const char *end = data + size;
+    QByteArray token;
+    bool conversionOk;
+    error = NULL;
+
+    // Load sheet info
+    if (!nextInputToken(pos, end, token))
+    {
+        return false;
+    }
+    double w = inputTokenToDouble(token, &conversionOk);
+    if (!conversionOk)
+    {
+        error = "Could not convert width";
+        return true;
+    }
+    input.sheetWidth = BakeryHelpers::qrealPrecise(w);
+
+    if (!nextInputToken(pos, end, token))
+    {
+        return false;
+    }
+    double h = inputTokenToDouble(token, &conversionOk);
+    if (!conversionOk)
+    {
+        error = "Could not convert height";
+        return true;
+    }
+    input.sheetHeight = BakeryHelpers::qrealPrecise(h);
+
+    // Load number of shapes
+    if (!nextInputToken(pos, end, token))
+    {
+        return false;
+    }
+    qint32 numTypeShapes = inputTokenToInt(token, &conversionOk);
+    if (!conversionOk)
+    {
+        error = "Could not convert number of shape types";
+        return true;
+    }
+    if (numTypeShapes < 0)
+    {
+        error = "Negative number of type of shapes";
+        return true;
+    }
+
+    QSet<QString> namesSet;
+    QTextCodec *codec = QTextCodec::codecForLocale();
+    for (qint32 i_shapes = 0; i_shapes < numTypeShapes; ++i_shapes)
+    {
+        // Names are the rest of the line, like QTextStream::readLine()
+        QString shapeName;
+        do
+        {
+            if (pos >= end)
+            {
+                error = "Could not find name";
+                return true;
+            }
+            const char *lineEnd = static_cast<const char *>(memchr(pos, '\n', size_t(end - pos)));
+            const char *next = lineEnd != NULL ? lineEnd + 1 : end;
+            lineEnd = lineEnd != NULL ? lineEnd : end;
+            if (lineEnd > pos && *(lineEnd - 1) == '\r')
+            {
+                --lineEnd;
+            }
+            shapeName = codec->toUnicode(pos, qint32(lineEnd - pos));
+            pos = next;
+        } while (shapeName == "");
+
+        if (namesSet.contains(shapeName))
+        {
+            duplicateName = shapeName;
+            return true;
+        }
+        namesSet << shapeName;
+
+        if (!nextInputToken(pos, end, token))
+        {
+            return false;
+        }
+        qint32 numShapes = inputTokenToInt(token, &conversionOk);
+        if (!conversionOk)
+        {
+            error = "Could not convert number of shapes";
+            return true;
+        }
+        if (numShapes < 0)
+        {
+            error = "Negative number of shapes";
+            return true;
+        }
+
+        if (!nextInputToken(pos, end, token))
+        {
+            return false;
+        }
+        qint32 numPoints = inputTokenToInt(token, &conversionOk);
+        if (!conversionOk)
+        {
+            error = "Could not convert number of points";
+            return true;
+        }
+        if (numPoints < 0)
+        {
+            error = "Negative number of points";
+            return true;
+        }
+
+        // The prototype is built once, all pieces share its geometry
+        Shape shape(shapeName);
+        shape.setUpdateMetrics(false);
+        for (qint32 i_points = 0; i_points < numPoints; ++i_points)
+        {
+            if (!nextInputToken(pos, end, token))
+            {
+                return false;
+            }
+            double x = inputTokenToDouble(token, &conversionOk);
+            if (!conversionOk)
+            {
+                error = "Could not convert x";
+                return true;
+            }
+
+            if (!nextInputToken(pos, end, token))
+            {
+                return false;
+            }
+            double y = inputTokenToDouble(token, &conversionOk);
+            if (!conversionOk)
+            {
+                error = "Could not convert y";
+                return true;
+            }
+
+            shape << BakeryHelpers::qPointPrecise(QPointF(x, y));
+        }
+        shape.ensureClosed();
+        shape.setUpdateMetrics(true);
+
+        input.addShape(shape, numShapes);
+    }
+    return true;
+}
+
+/*!
+ * \brief Writes single sheets of an output to SVG files. Used by Bakery::saveAsSVG() to write all sheets in parallel.
+ */
+struct SVGSheetWriter
+{
+    /*!
+     * \brief Result type required by QtConcurrent.
+     */
+    typedef bool result_type;
+
+    /*!
+     * \brief Output containing the sheets.
+     */
+    const PluginOutput *output;
+
+    /*!
+     * \brief Target directory.
+     */
+    QDir outputDir;
+
+    /*!
+     * \brief Prefix of files.
+     */
+    QString filePrefix;
+
+    /*!
+     * \brief Style attribute of each shape name.
+     */
+    QHash<QString, QString> styles;
+
+    /*!
+     * \brief If true, the XML is indented.
+     */
+    bool autoFormatting;
+
+    /*!
+     * \brief Writes a sheet to its file.
+     * \param i_sheet Index of the sheet.
+     * \return true if successful.
+     */
+    bool operator()(qint32 i_sheet) const
+    {
+        QFile file(outputDir.absoluteFilePath(QString("%2-%3.svg").arg(filePrefix).arg(i_sheet + 1)));
+        if (!file.open(QIODevice::WriteOnly))
+        {
+            BAKERY_CRITICAL("Could not open file");
+            return false;
+        }
+
+        qreal scale = 100.0;
+        qreal width = BakeryHelpers::qrealRounded(output->sheets[0].width());
+        qreal height = BakeryHelpers::qrealRounded(output->sheets[0].height());
+
+        // The document is built in memory and written at once
+        QByteArray document;
+        QXmlStreamWriter writer(&document);
+        writer.setAutoFormatting(autoFormatting);
+        writer.writeStartDocument();
+        writer.writeDTD(
+            "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 20010904//EN\" \"http://www.w3.org/TR/2001/REC-SVG-20010904/DTD/svg10.dtd\">");
+        writer.writeStartElement("svg");
+        writer.writeAttribute("xmlns", "http://www.w3.org/2000/svg");
+        writer.writeAttribute("xmlns:xlink", "http://www.w3.org/1999/xlink");
+        writer.writeAttribute("width", QString("%1").arg(width * scale));
+        writer.writeAttribute("height", QString("%1").arg(height * scale));
+        writer.writeAttribute("viewBox", QString("0 0 %1 %2").arg(width).arg(height));
+
+        // Write shapes, the buffer for the coordinates keeps its capacity
+        Sheet sheet = output->sheets[i_sheet];
+        QByteArray points;
+        points.reserve(4096);
+        foreach (const Shape &shape, sheet.shapes())
+        {
+            points.resize(0);
+            foreach (const QPoint &p, shape)
+            {
+                if (!points.isEmpty())
+                {
+                    points.append(' ');
+                }
+                BakeryHelpers::appendPrecise(points, p.x());
+                points.append(',');
+                BakeryHelpers::appendPrecise(points, p.y());
+            }
+            writer.writeStartElement("polygon");
+            writer.writeAttribute("points", QString::fromLatin1(points));
+            writer.writeAttribute("style", styles.value(shape.name()));
+            writer.writeEndElement(); // polygon
+        }
+
+        writer.writeEndElement(); // svg
+        writer.writeEndDocument();
+
+        if (file.write(document) != document.size())
+        {
+            BAKERY_CRITICAL("Could not write file");
+            return false;
+        }
+        return true;
+    }
+};
+
+/*!
+ * \brief Returns if two edges violate simplicity with the same test as Shape::updateMetrics().
+ * \param edge Edge which comes first in the polygon.
+ * \param other Edge which comes later in the polygon.
+ * \return true if the edges cross or touch anywhere except at a shared end point.
+ */
+static bool edgesCross(const QLineF &edge, const QLineF &other)
+{
+    QPointF p;
+    if (edge.intersect(other, &p) != QLineF::BoundedIntersection)
+    {
+        return false;
+    }
+    return !((p == edge.p1() && p == other.p2()) || (p == edge.p2() && p == other.p1()));
+}
+
+/*!
+ * \brief Appends a point to a simple open polygon if the polygon stays simple.
+ *
+ * Only the two new edges are tested against the existing edges, which gives the same result as Shape::isSimple() on the whole polygon
+ * without recomputing all metrics.
+ * \param shape Simple open polygon which does not update its metrics.
+ * \param edges Edges of the polygon without the closing edge. Is updated if the point is appended.
+ * \param point New point.
+ * \return true if the point was appended.
+ */
+static bool appendIfSimple(Shape &shape, QList<QLineF> &edges, const QPoint &point)
+{
+    QPointF first = BakeryHelpers::qPointRounded(shape.first());
+    QPointF last = BakeryHelpers::qPointRounded(shape.last());
+    QPointF p = BakeryHelpers::qPointRounded(point);
+    QLineF edge(last, p);
+
+    // A polygon returning to its first point has no closing edge
+    bool closed = shape.size() >= 2 && point == shape.first();
+    QLineF closing(p, first);
+    if (!closed && edgesCross(edge, closing))
+    {
+        return false;
+    }
+    foreach (const QLineF &existing, edges)
+    {
+        if (edgesCross(existing, edge) || (!closed && edgesCross(existing, closing)))
+        {
+            return false;
+        }
+    }
+
+    shape << point;
+    edges << edge;
+    return true;
+}
+
+/*!
+ * \brief Generates a star-shaped polygon inside the unit square.
+ *
+ * The vertices are placed at increasing angles around the center, with less than 180 degrees between consecutive vertices, so the
+ * polygon is simple by construction. The radius follows a closed random walk whose slope is bounded by the minimum angle, so most
+ * polygons satisfy the angle constraint even with many vertices.
+ * \param rnd Random number generator.
+ * \param points Number of vertices.
+ * \param minAngle Minimum edge angle in degrees.
+ * \return Closed polygon.
+ */
+static Shape starShapedPolygon(std::mt19937 &rnd, qint32 points, qreal minAngle)
+{
+    std::uniform_real_distribution<qreal> jitter_distribution(-0.2, 0.2);
+    std::uniform_real_distribution<qreal> walk_distribution(-1.0, 1.0);
+    const qreal minRadius = 0.3;
+    qreal step = 2 * M_PI / points;
+
+    // Angles are jittered around a regular subdivision
+    QVector<qreal> angles(points);
+    for (qint32 i_point = 0; i_point < points; ++i_point)
+    {
+        angles[i_point] = (i_point + jitter_distribution(rnd)) * step;
+    }
+
+    // Edges may deviate from the tangent by at most half of the angle budget left by the turn around the center
+    qreal turn = qRadiansToDegrees(step) * 1.4;
+    qreal slope = qTan(qDegreesToRadians(qMax(0.0, (180.0 - minAngle - turn) / 2.0 * 0.9)));
+
+    // Closed random walk of the logarithmic radius
+    QVector<qreal> gaps(points);
+    QVector<qreal> increments(points);
+    qreal sum = 0.0;
+    for (qint32 i_point = 0; i_point < points; ++i_point)
+    {
+        gaps[i_point] = i_point + 1 < points ? angles[i_point + 1] - angles[i_point] : angles[0] + 2 * M_PI - angles[i_point];
+        increments[i_point] = walk_distribution(rnd) * slope / 2.0 * gaps[i_point];
+        sum += increments[i_point];
+    }
+    QVector<qreal> radii(points);
+    qreal radius = 0.0;
+    qreal minimum = 0.0;
+    qreal maximum = 0.0;
+    for (qint32 i_point = 0; i_point < points; ++i_point)
+    {
+        radii[i_point] = radius;
+        minimum = qMin(minimum, radius);
+        maximum = qMax(maximum, radius);
+        radius += increments[i_point] - sum * gaps[i_point] / (2 * M_PI);
+    }
+
+    // Compressing the range only lowers the slopes
+    qreal compression = 1.0;
+    if (maximum - minimum > -qLn(minRadius))
+    {
+        compression = -qLn(minRadius) / (maximum - minimum);
+    }
+
+    Shape shape;
+    shape.setUpdateMetrics(false);
+    shape.reserve(points + 1);
+    for (qint32 i_point = 0; i_point < points; ++i_point)
+    {
+        qreal r = 0.5 * qExp((radii[i_point] - maximum) * compression);
+        shape << BakeryHelpers::qPointPrecise(QPointF(0.5 + r * qCos(angles[i_point]), 0.5 + r * qSin(angles[i_point])));
+    }
+    shape.ensureClosed();
+    shape.setUpdateMetrics(true);
+    return shape;
+}
+
+/*!
+ * \brief Generates a jigsaw-like polygon inside the unit square.
+ *
+ * Each side of a square is flat or has a dovetail tab pointing outwards or inwards. Tabs and blanks are small enough that they can not
+ * touch each other, so the polygon is simple by construction.
+ * \param rnd Random number generator.
+ * \return Closed polygon.
+ */
+static Shape jigsawPolygon(std::mt19937 &rnd)
+{
+    std::uniform_int_distribution<qint32> side_distribution(-1, 1);
+    std::uniform_real_distribution<qreal> position_distribution(0.45, 0.55);
+    std::uniform_real_distribution<qreal> depth_distribution(0.1, 0.18);
+    const QPointF corners[] = {QPointF(0.2, 0.2), QPointF(0.8, 0.2), QPointF(0.8, 0.8), QPointF(0.2, 0.8)};
+
+    Shape shape;
+    shape.setUpdateMetrics(false);
+    for (qint32 i_side = 0; i_side < 4; ++i_side)
+    {
+        QPointF start = corners[i_side];
+        QPointF direction = corners[(i_side + 1) % 4] - start;
+        QPointF normal = QPointF(direction.y(), -direction.x()) / 0.6;
+        shape << BakeryHelpers::qPointPrecise(start);
+
+        // Narrow neck on the side, wide head at the tip
+        qint32 side = side_distribution(rnd);
+        if (side != 0)
+        {
+            qreal position = position_distribution(rnd);
+            QPointF tip = normal * (side * depth_distribution(rnd));
+            shape << BakeryHelpers::qPointPrecise(start + direction * (position - 0.07));
+            shape << BakeryHelpers::qPointPrecise(start + direction * (position - 0.13) + tip);
+            shape << BakeryHelpers::qPointPrecise(start + direction * (position + 0.13) + tip);
+            shape << BakeryHelpers::qPointPrecise(start + direction * (position + 0.07));
+        }
+    }
+    shape.ensureClosed();
+    shape.setUpdateMetrics(true);
+    return shape;
+}
+
+/*!
+ * \brief Generates random inputs for single seeds. Used by Bakery::randomInputs() to generate all inputs in parallel.
+ */
+struct RandomInputGenerator
+{
+    /*!
+     * \brief Result type required by QtConcurrent.
+     */
+    typedef PluginInput result_type;
+
+    /*!
+     * \brief Parameters for the generation process. The seed is replaced.
+     */
+    RandomPluginInputParameters parameters;
+
+    /*!
+     * \brief Generates the input of a seed.
+     * \param seed Seed.
+     * \return Generated PluginInput.
+     */
+    PluginInput operator()(qint32 seed) const
+    {
+        RandomPluginInputParameters seedParameters = parameters;
+        seedParameters.seed = seed;
+        return Bakery::randomInput(seedParameters);
+    }
+};
+
 // Static methods
 
+void Bakery::setMetadataCacheFile(QString fileName)
+{
+    metadataCacheFileName = fileName;
+    metadataCacheFileNameSet = true;
+}
+
+QString Bakery::metadataCacheFile()
+{
+    if (!metadataCacheFileNameSet)
+    {
+        QString location = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+        if (!location.isEmpty() && QDir().mkpath(location))
+        {
+            metadataCacheFileName = QDir(location).absoluteFilePath("plugin_metadata.ini");
+        }
+        metadataCacheFileNameSet = true;
+    }
+    return metadataCacheFileName;
+}
+
 PluginInput Bakery::loadFromDevice(QIODevice *device, bool *ok)
 {
     if (device == NULL)
     {
         BAKERY_WARNING("Device is NULL");
-        setBool(ok, false);
+        BakeryHelpers::setBool(ok, false);
         return PluginInput();
     }
     if (!device->isOpen())
     {
         BAKERY_WARNING("Device not open");
-        setBool(ok, false);
+        BakeryHelpers::setBool(ok, false);
         return PluginInput();
     }
 
+    // Files are mapped, other devices are read completely. Inputs the fast parser can not handle are parsed by the text stream below.
+    QFile *file = qobject_cast<QFile *>(device);
+    uchar *mapped = NULL;
+    if (file != NULL && !file->isSequential() && file->size() > file->pos())
+    {
+        mapped = file->map(file->pos(), file->size() - file->pos());
+    }
+    QByteArray data;
+    QBuffer dataDevice(&data);
+    if (mapped == NULL)
+    {
+        data = device->readAll();
+        dataDevice.open(QIODevice::ReadOnly);
+        device = &dataDevice;
+    }
+    {
+        PluginInput input;
+        const char *error;
+        QString duplicateName;
+        bool parsed = mapped != NULL ? parseInputData(reinterpret_cast<const char *>(mapped), file->size() - file->pos(), input, error,
+                                                      duplicateName)
+                                     : parseInputData(data.constData(), data.size(), input, error, duplicateName);
+        if (mapped != NULL)
+        {
+            file->unmap(mapped);
+        }
+        if (parsed)
+        {
+            if (!duplicateName.isEmpty())
+            {
+                BAKERY_CRITICAL("Unique name" << duplicateName << "found twice");
+                BakeryHelpers::setBool(ok, false);
+                return PluginInput();
+            }
+            if (error != NULL)
+            {
+                BAKERY_CRITICAL(error);
+                BakeryHelpers::setBool(ok, false);
+                return PluginInput();
+            }
+            BakeryHelpers::setBool(ok, true);
+            return input;
+        }
+    }
+
     QSet<QString> namesSet;
     QString s;
     QTextStream stream(device);
@@ -79,7 +773,7 @@ PluginInput Bakery::loadFromDevice(QIODevice *device, bool *ok)
     if (!conversionOk || stream.status() != QTextStream::Ok)
     {
         BAKERY_CRITICAL("Could not convert width");
-        setBool(ok, false);
+        BakeryHelpers::setBool(ok, false);
         return PluginInput();
     }
     input.sheetWidth = BakeryHelpers::qrealPrecise(w);
@@ -89,7 +783,7 @@ PluginInput Bakery::loadFromDevice(QIODevice *device, bool *ok)
     if (!conversionOk || stream.status() != QTextStream::Ok)
     {
         BAKERY_CRITICAL("Could not convert height");
-        setBool(ok, false);
+        BakeryHelpers::setBool(ok, false);
         return PluginInput();
     }
     input.sheetHeight = BakeryHelpers::qrealPrecise(h);
@@ -100,26 +794,24 @@ PluginInput Bakery::loadFromDevice(QIODevice *device, bool *ok)
     if (!conversionOk || stream.status() != QTextStream::Ok)
     {
         BAKERY_CRITICAL("Could not convert number of shape types");
-        setBool(ok, false);
+        BakeryHelpers::setBool(ok, false);
         return PluginInput();
     }
 
     if (numTypeShapes < 0)
     {
         BAKERY_CRITICAL("Negative number of type of shapes");
-        setBool(ok, false);
+        BakeryHelpers::setBool(ok, false);
         return PluginInput();
     }
 
-    QList<Shape> shapes;
-
     // Load shapes
     for (qint32 i_shapes = 0; i_shapes < numTypeShapes; ++i_shapes)
     {
         if (stream.status() != QTextStream::Ok)
         {
             BAKERY_CRITICAL("Could not load shape");
-            setBool(ok, false);
+            BakeryHelpers::setBool(ok, false);
             return PluginInput();
         }
 
@@ -134,7 +826,7 @@ PluginInput Bakery::loadFromDevice(QIODevice *device, bool *ok)
             if (stream.atEnd())
             {
                 BAKERY_CRITICAL("Could not find name");
-                setBool(ok, false);
+                BakeryHelpers::setBool(ok, false);
                 return PluginInput();
             }
             shapeName = stream.readLine();
@@ -143,7 +835,7 @@ PluginInput Bakery::loadFromDevice(QIODevice *device, bool *ok)
         if (namesSet.contains(shapeName))
         {
             BAKERY_CRITICAL("Unique name" << shapeName << "found twice");
-            setBool(ok, false);
+            BakeryHelpers::setBool(ok, false);
             return PluginInput();
         }
 
@@ -157,13 +849,13 @@ PluginInput Bakery::loadFromDevice(QIODevice *device, bool *ok)
         if (!conversionOk || stream.status() != QTextStream::Ok)
         {
             BAKERY_CRITICAL("Could not convert number of shapes");
-            setBool(ok, false);
+            BakeryHelpers::setBool(ok, false);
             return PluginInput();
         }
         if (numShapes < 0)
         {
             BAKERY_CRITICAL("Negative number of shapes");
-            setBool(ok, false);
+            BakeryHelpers::setBool(ok, false);
             return PluginInput();
         }
 
@@ -172,13 +864,13 @@ PluginInput Bakery::loadFromDevice(QIODevice *device, bool *ok)
         if (!conversionOk || stream.status() != QTextStream::Ok)
         {
             BAKERY_CRITICAL("Could not convert number of points");
-            setBool(ok, false);
+            BakeryHelpers::setBool(ok, false);
             return PluginInput();
         }
         if (numPoints < 0)
         {
             BAKERY_CRITICAL("Negative number of points");
-            setBool(ok, false);
+            BakeryHelpers::setBool(ok, false);
             return PluginInput();
         }
 
@@ -189,7 +881,7 @@ PluginInput Bakery::loadFromDevice(QIODevice *device, bool *ok)
             if (!conversionOk || stream.status() != QTextStream::Ok)
             {
                 BAKERY_CRITICAL("Could not convert x");
-                setBool(ok, false);
+                BakeryHelpers::setBool(ok, false);
                 return PluginInput();
             }
 
@@ -198,7 +890,7 @@ PluginInput Bakery::loadFromDevice(QIODevice *device, bool *ok)
             if (!conversionOk || stream.status() != QTextStream::Ok)
             {
                 BAKERY_CRITICAL("Could not convert y");
-                setBool(ok, false);
+                BakeryHelpers::setBool(ok, false);
                 return PluginInput();
             }
 
@@ -208,33 +900,29 @@ PluginInput Bakery::loadFromDevice(QIODevice *device, bool *ok)
         shape.ensureClosed();
         shape.setUpdateMetrics(true);
 
-        for (qint32 i_numShapes = 0; i_numShapes < numShapes; ++i_numShapes)
-        {
-            shapes.append(shape);
-        }
+        input.addShape(shape, numShapes);
     }
 
-    input.shapes = shapes;
-    setBool(ok, true);
+    BakeryHelpers::setBool(ok, true);
     return input;
 }
 
-PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
+PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok, const SVGImportParameters &parameters)
 {
     if (device == NULL)
     {
         BAKERY_WARNING("Device is NULL");
-        setBool(ok, false);
+        BakeryHelpers::setBool(ok, false);
         return PluginInput();
     }
     if (!device->isOpen())
     {
         BAKERY_WARNING("Device not open");
-        setBool(ok, false);
+        BakeryHelpers::setBool(ok, false);
         return PluginInput();
     }
 
-    setBool(ok, true);
+    BakeryHelpers::setBool(ok, true);
 
     QXmlStreamReader reader(device);
     PluginInput input;
@@ -288,7 +976,7 @@ PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
                 if (widthRect < 0.0 || heightRect < 0.0)
                 {
                     BAKERY_CRITICAL("Width / height is not allowed to be negative");
-                    setBool(ok, false);
+                    BakeryHelpers::setBool(ok, false);
                 }
 
                 if (attributes.hasAttribute("rx") || attributes.hasAttribute("ry"))
@@ -310,19 +998,28 @@ PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
                 }
 
                 Shape shape(Shape(QString("rect-%1").arg(counter++)));
-                QPainterPath path;
-                path.addRoundedRect(x, y, heightRect, widthRect, rx, ry);
-                foreach (QPointF point, path.toFillPolygon())
+                QPolygonF polygon;
+                if (parameters.isConservative())
+                {
+                    polygon = BakerySVGImport::roundedRect(QRectF(x, y, widthRect, heightRect), rx, ry, parameters);
+                }
+                else
+                {
+                    QPainterPath path;
+                    path.addRoundedRect(x, y, widthRect, heightRect, rx, ry);
+                    polygon = path.toFillPolygon();
+                }
+                foreach (QPointF point, polygon)
                 {
                     shape << BakeryHelpers::qPointPrecise(point);
                 }
                 shape.ensureClosed();
-                input.shapes << shape;
+                input << shape;
             }
             else if (reader.name() == "circle" || reader.name() == "ellipse")
             {
                 qreal cx = attributes.hasAttribute("cx") ? attributes.value("cx").toDouble() : 0.0;
-                qreal cy = attributes.hasAttribute("cx") ? attributes.value("cx").toDouble() : 0.0;
+                qreal cy = attributes.hasAttribute("cy") ? attributes.value("cy").toDouble() : 0.0;
                 qreal rWidth;
                 qreal rHeight;
 
@@ -331,7 +1028,7 @@ PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
                     if (!attributes.hasAttribute("r") || attributes.value("r").toDouble() <= 0)
                     {
                         BAKERY_CRITICAL("Radius must be a positive number");
-                        setBool(ok, false);
+                        BakeryHelpers::setBool(ok, false);
                         continue;
                     }
 
@@ -343,21 +1040,30 @@ PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
                         || attributes.value("ry").toDouble() <= 0)
                     {
                         BAKERY_CRITICAL("Radius (rx/ry) must be a positive number");
-                        setBool(ok, false);
+                        BakeryHelpers::setBool(ok, false);
                         continue;
                     }
                     rWidth = attributes.value("rx").toDouble();
                     rHeight = attributes.value("ry").toDouble();
                 }
                 Shape shape(Shape(QString("elippse-%1").arg(counter++)));
-                QPainterPath p;
-                p.addEllipse(cx, cy, rWidth, rHeight);
-                foreach (QPointF point, p.toFillPolygon())
+                QPolygonF polygon;
+                if (parameters.isConservative())
+                {
+                    polygon = BakerySVGImport::ellipse(QPointF(cx, cy), rWidth, rHeight, parameters);
+                }
+                else
+                {
+                    QPainterPath p;
+                    p.addEllipse(QPointF(cx, cy), rWidth, rHeight);
+                    polygon = p.toFillPolygon();
+                }
+                foreach (QPointF point, polygon)
                 {
                     shape << BakeryHelpers::qPointPrecise(point);
                 }
                 shape.ensureClosed();
-                input.shapes << shape;
+                input << shape;
             }
             else if (reader.name() == "polygon")
             {
@@ -380,7 +1086,7 @@ PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
                         if (l.size() == 0)
                         {
                             BAKERY_CRITICAL("Error while parsing points");
-                            setBool(ok, false);
+                            BakeryHelpers::setBool(ok, false);
                             parseSuccessful = false;
                             break;
                         }
@@ -389,7 +1095,7 @@ PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
                         if (!parseSuccessful)
                         {
                             BAKERY_CRITICAL("Error while parsing points");
-                            setBool(ok, false);
+                            BakeryHelpers::setBool(ok, false);
                             parseSuccessful = false;
                             break;
                         }
@@ -400,7 +1106,7 @@ PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
                             if (!parseSuccessful)
                             {
                                 BAKERY_CRITICAL("Error while parsing points");
-                                setBool(ok, false);
+                                BakeryHelpers::setBool(ok, false);
                                 parseSuccessful = false;
                                 break;
                             }
@@ -411,7 +1117,7 @@ PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
                             if (stream.atEnd())
                             {
                                 BAKERY_CRITICAL("Error while parsing points: Missing coordinate");
-                                setBool(ok, false);
+                                BakeryHelpers::setBool(ok, false);
                                 parseSuccessful = false;
                                 break;
                             }
@@ -419,7 +1125,7 @@ PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
                             if (l.size() == 0)
                             {
                                 BAKERY_CRITICAL("Error while parsing points");
-                                setBool(ok, false);
+                                BakeryHelpers::setBool(ok, false);
                                 parseSuccessful = false;
                                 break;
                             }
@@ -428,7 +1134,7 @@ PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
                             if (!parseSuccessful)
                             {
                                 BAKERY_CRITICAL("Error while parsing points");
-                                setBool(ok, false);
+                                BakeryHelpers::setBool(ok, false);
                                 parseSuccessful = false;
                                 break;
                             }
@@ -440,15 +1146,45 @@ PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
                     shape.ensureClosed();
                     if (parseSuccessful)
                     {
-                        input.shapes << shape;
+                        input << shape;
                     }
                 }
                 else
                 {
                     BAKERY_CRITICAL("Polygon is missing points attribute");
-                    setBool(ok, false);
+                    BakeryHelpers::setBool(ok, false);
                 }
             }
+            else if (reader.name() == "path")
+            {
+                if (!attributes.hasAttribute("d"))
+                {
+                    BAKERY_CRITICAL("Path is missing d attribute");
+                    BakeryHelpers::setBool(ok, false);
+                    continue;
+                }
+
+                bool parseSuccessful;
+                QPolygonF polygon = BakerySVGImport::path(attributes.value("d").toString(), parameters, &parseSuccessful);
+                if (!parseSuccessful)
+                {
+                    BAKERY_CRITICAL("Error while parsing path data");
+                    BakeryHelpers::setBool(ok, false);
+                    continue;
+                }
+                if (polygon.isEmpty())
+                {
+                    continue;
+                }
+
+                Shape shape(QString("path-%1").arg(counter++));
+                foreach (QPointF point, polygon)
+                {
+                    shape << BakeryHelpers::qPointPrecise(point);
+                }
+                shape.ensureClosed();
+                input << shape;
+            }
             else
             {
                 BAKERY_DEBUG("Unknown element" << reader.name());
@@ -466,7 +1202,7 @@ PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
 
         case QXmlStreamReader::Invalid:
             BAKERY_WARNING("Invalid SVG file:" << reader.errorString());
-            setBool(ok, false);
+            BakeryHelpers::setBool(ok, false);
             return PluginInput();
             break;
 
@@ -475,10 +1211,10 @@ PluginInput Bakery::loadFromSVG(QIODevice *device, bool *ok)
         }
     }
 
-    if (input.shapes.size() == 0)
+    if (input.shapeCount() == 0)
     {
         BAKERY_WARNING("No shapes found");
-        setBool(ok, false);
+        BakeryHelpers::setBool(ok, false);
         return PluginInput();
     }
 
@@ -536,28 +1272,41 @@ PluginInput Bakery::randomInput(RandomPluginInputParameters parameters)
     /* random distributions based on height or width */
     std::uniform_real_distribution<qreal> scale_x_distribution(1, sheetWidth);
     std::uniform_real_distribution<qreal> scale_y_distribution(1, sheetHeight);
+    std::uniform_real_distribution<qreal> aspect_distribution(qLn(qMax(parameters.minAspectRatio, 1e-6)),
+                                                              qLn(qMax(parameters.maxAspectRatio, 1e-6)));
 
     do
     {
-        input.shapes.clear();
+        input.setStock(ShapeStock());
         area = 0;
         qint32 shapes = shape_distribution(rnd);
         while (shapes > 0)
         {
             Shape shape;
-            shape << QPoint(0, 0);
             qint32 points = points_distribution(rnd);
-            while (shape.size() < points)
+            if (parameters.polygonMethod == RandomPluginInputParameters::StarShaped)
+            {
+                shape = starShapedPolygon(rnd, points, parameters.minAngle);
+            }
+            else if (parameters.polygonMethod == RandomPluginInputParameters::Jigsaw)
+            {
+                shape = jigsawPolygon(rnd);
+            }
+            else
             {
-                qint32 x = distribution(rnd);
-                qint32 y = distribution(rnd);
-                shape << QPoint(x, y);
-                if (!shape.isSimple())
+                // Metrics are only computed once the polygon is complete
+                QList<QLineF> edges;
+                shape.setUpdateMetrics(false);
+                shape << QPoint(0, 0);
+                while (shape.size() < points)
                 {
-                    shape.removeLast();
+                    qint32 x = distribution(rnd);
+                    qint32 y = distribution(rnd);
+                    appendIfSimple(shape, edges, QPoint(x, y));
                 }
+                shape.ensureClosed();
+                shape.setUpdateMetrics(true);
             }
-            shape.ensureClosed();
 
             bool valid = true;
             qint32 size = shape.edges().size();
@@ -580,11 +1329,22 @@ PluginInput Bakery::randomInput(RandomPluginInputParameters parameters)
             shape.setName(QString("Shape %1").arg(shapes + 1));
             qreal scaleX = scale_x_distribution(rnd) / scale_distribution(rnd);
             qreal scaleY = scale_y_distribution(rnd) / scale_distribution(rnd);
+            if (parameters.maxAspectRatio > 0)
+            {
+                // The height follows from the width, both shrink if the shape is higher than the sheet
+                qreal aspectRatio = qExp(aspect_distribution(rnd));
+                scaleY = scaleX / aspectRatio;
+                if (scaleY > sheetHeight)
+                {
+                    scaleX *= sheetHeight / scaleY;
+                    scaleY = sheetHeight;
+                }
+            }
             shape.scale(scaleX, scaleY);
             qint32 amount = amount_distribution(rnd);
             for (qint32 i = 0; i < amount; ++i)
             {
-                input.shapes << shape;
+                input << shape;
                 area += shape.area();
             }
             --shapes;
@@ -594,6 +1354,108 @@ PluginInput Bakery::randomInput(RandomPluginInputParameters parameters)
     return input;
 }
 
+QStringList Bakery::randomProfiles()
+{
+    return QStringList() << "default"
+                         << "many-pieces"
+                         << "high-vertex"
+                         << "extreme-aspect"
+                         << "many-types"
+                         << "jigsaw";
+}
+
+RandomPluginInputParameters Bakery::randomProfile(QString name, bool *ok)
+{
+    BakeryHelpers::setBool(ok, true);
+    RandomPluginInputParameters parameters;
+    if (name == "many-pieces")
+    {
+        // 10000 to 18000 small shapes on two sheets
+        parameters.minSheetWidth = 8;
+        parameters.maxSheetWidth = 10;
+        parameters.minSheetHeight = 8;
+        parameters.maxSheetHeight = 10;
+        parameters.minShapes = 5;
+        parameters.maxShapes = 6;
+        parameters.minAmount = 2000;
+        parameters.maxAmount = 3000;
+        parameters.minScale = 20;
+        parameters.maxScale = 30;
+        parameters.minSheets = 2;
+        parameters.maxSheets = 2;
+        parameters.polygonMethod = RandomPluginInputParameters::StarShaped;
+    }
+    else if (name == "high-vertex")
+    {
+        parameters.minPoints = 200;
+        parameters.maxPoints = 400;
+        parameters.polygonMethod = RandomPluginInputParameters::StarShaped;
+    }
+    else if (name == "extreme-aspect")
+    {
+        // Long strips on long sheets
+        parameters.minSheetWidth = 20;
+        parameters.maxSheetWidth = 40;
+        parameters.minSheetHeight = 2;
+        parameters.maxSheetHeight = 4;
+        parameters.minShapes = 4;
+        parameters.maxShapes = 8;
+        parameters.minAmount = 20;
+        parameters.maxAmount = 40;
+        parameters.minScale = 1;
+        parameters.maxScale = 2;
+        parameters.minAspectRatio = 10;
+        parameters.maxAspectRatio = 50;
+        parameters.minSheets = 2;
+        parameters.maxSheets = 2;
+        parameters.polygonMethod = RandomPluginInputParameters::StarShaped;
+    }
+    else if (name == "many-types")
+    {
+        parameters.minSheetWidth = 5;
+        parameters.maxSheetWidth = 10;
+        parameters.minSheetHeight = 5;
+        parameters.maxSheetHeight = 10;
+        parameters.minShapes = 200;
+        parameters.maxShapes = 400;
+        parameters.minAmount = 1;
+        parameters.maxAmount = 3;
+        parameters.minScale = 2;
+        parameters.maxScale = 4;
+        parameters.minSheets = 3;
+        parameters.maxSheets = 3;
+    }
+    else if (name == "jigsaw")
+    {
+        parameters.minSheetWidth = 5;
+        parameters.maxSheetWidth = 10;
+        parameters.minSheetHeight = 5;
+        parameters.maxSheetHeight = 10;
+        parameters.minShapes = 4;
+        parameters.maxShapes = 8;
+        parameters.minAmount = 20;
+        parameters.maxAmount = 40;
+        parameters.minScale = 1.5;
+        parameters.maxScale = 3;
+        parameters.minSheets = 3;
+        parameters.maxSheets = 3;
+        parameters.polygonMethod = RandomPluginInputParameters::Jigsaw;
+    }
+    else if (name != "default")
+    {
+        BAKERY_WARNING(QString("Unknown random profile '%1'").arg(name));
+        BakeryHelpers::setBool(ok, false);
+    }
+    return parameters;
+}
+
+QList<PluginInput> Bakery::randomInputs(RandomPluginInputParameters parameters, QList<qint32> seeds)
+{
+    RandomInputGenerator generator;
+    generator.parameters = parameters;
+    return QtConcurrent::blockingMapped<QList<PluginInput>>(seeds, generator);
+}
+
 bool Bakery::saveToDevice(PluginInput input, QIODevice *device)
 {
     if (device == NULL)
@@ -609,17 +1471,18 @@ bool Bakery::saveToDevice(PluginInput input, QIODevice *device)
     QTextStream stream(device);
 
     // Sheet meta
-    Shape::Unique unique = Shape::reduceToUnique(input.shapes);
+    const ShapeStock &stock = input.stock();
     stream << BakeryHelpers::qrealRounded(input.sheetWidth) << "\n";
     stream << BakeryHelpers::qrealRounded(input.sheetHeight) << "\n";
-    stream << unique.shapes.size() << "\n";
+    stream << stock.types() << "\n";
 
     // Shapes
-    foreach (Shape shape, unique.shapes)
+    for (qint32 i_type = 0; i_type < stock.types(); ++i_type)
     {
         // Name, number of copies and number of coordinates
+        Shape shape = stock.prototype(i_type);
         shape.ensureClosed(false);
-        stream << shape.name() << "\n" << unique.amounts[shape.name()] << "\n" << shape.size() << "\n";
+        stream << shape.name() << "\n" << stock.count(i_type) << "\n" << shape.size() << "\n";
         // Coordinates
         foreach (QPoint point, shape)
         {
@@ -643,16 +1506,19 @@ bool Bakery::saveToDevice(PluginOutput output, QIODevice *device)
         return false;
     }
 
-    QTextStream stream(device);
-
     // Utilitization and number of sheets
     qreal utilitization = 0.0;
     qint32 numSheets = 0;
+    qint64 numPoints = 0;
 
     foreach (Sheet sheet, output.sheets)
     {
         utilitization += sheet.utilitization();
         ++numSheets;
+        foreach (const Shape &s, sheet.shapes())
+        {
+            numPoints += s.size() + 1;
+        }
     }
 
     if (numSheets == 0)
@@ -664,35 +1530,47 @@ bool Bakery::saveToDevice(PluginOutput output, QIODevice *device)
     utilitization /= numSheets;
     utilitization *= 100;
 
-    stream << (qint32)utilitization << "\n" << numSheets << "\n";
+    // The whole output is formatted into a single buffer, names are encoded like QTextStream does
+    QTextCodec *codec = QTextCodec::codecForLocale();
+    QByteArray buffer;
+    buffer.reserve(qMin(numPoints * 24 + numSheets * 8 + 32, qint64(std::numeric_limits<qint32>::max() / 2)));
+    buffer.append(QByteArray::number((qint32)utilitization)).append('\n');
+    buffer.append(QByteArray::number(numSheets)).append('\n');
 
     // Write sheets
     for (qint32 i = 0; i < output.sheets.size(); ++i)
     {
         // Sheet number
-        stream << (i + 1) << "\n";
+        buffer.append(QByteArray::number(i + 1)).append('\n');
 
         // Shapes
-        foreach (Shape s, output.sheets[i].shapes())
+        foreach (const Shape &s, output.sheets[i].shapes())
         {
             // Name
-            stream << s.name() << "\n";
+            buffer.append(codec->fromUnicode(s.name())).append('\n');
 
             // Points
             // The last point is not saved because it is equal to the first one if the shape is closed (should be)
-            for (qint32 i = 0; i < s.size(); ++i)
+            qint32 size = s.isClosed() ? s.size() - 1 : s.size();
+            for (qint32 i_point = 0; i_point < size; ++i_point)
             {
-                if (i != (s.size() - 1) || !s.isClosed())
-                {
-                    stream << BakeryHelpers::qrealRounded(s[i].x()) << " " << BakeryHelpers::qrealRounded(s[i].y()) << "\n";
-                }
+                BakeryHelpers::appendPrecise(buffer, s[i_point].x());
+                buffer.append(' ');
+                BakeryHelpers::appendPrecise(buffer, s[i_point].y());
+                buffer.append('\n');
             }
         }
     }
+
+    if (device->write(buffer) != buffer.size())
+    {
+        BAKERY_CRITICAL("Could not write to device");
+        return false;
+    }
     return true;
 }
 
-bool Bakery::saveAsSVG(PluginOutput output, QDir outputDir, QString filePrefix)
+bool Bakery::saveAsSVG(PluginOutput output, QDir outputDir, QString filePrefix, bool autoFormatting)
 {
     if (output.sheets.size() == 0)
     {
@@ -711,60 +1589,33 @@ bool Bakery::saveAsSVG(PluginOutput output, QDir outputDir, QString filePrefix)
         }
     }
 
+    // Colors are chosen up front (qrand() is not thread-safe), so each shape type has the same color on all sheets
+    SVGSheetWriter writer;
+    writer.output = &output;
+    writer.outputDir = outputDir;
+    writer.filePrefix = filePrefix;
+    writer.autoFormatting = autoFormatting;
+    QList<qint32> sheets;
     for (qint32 i_sheets = 0; i_sheets < output.sheets.size(); ++i_sheets)
     {
-        QFile file(outputDir.absoluteFilePath(QString("%2-%3.svg").arg(filePrefix).arg(i_sheets + 1)));
-        if (!file.open(QIODevice::WriteOnly))
+        sheets << i_sheets;
+        foreach (const Shape &shape, output.sheets[i_sheets].shapes())
         {
-            BAKERY_CRITICAL("Could not open file");
-            return false;
-        }
-
-        qreal scale = 100.0;
-        qreal width = BakeryHelpers::qrealRounded(output.sheets[0].width());
-        qreal height = BakeryHelpers::qrealRounded(output.sheets[0].height());
-
-        QXmlStreamWriter writer(&file);
-        writer.setAutoFormatting(true);
-        writer.writeStartDocument();
-        writer.writeDTD(
-            "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 20010904//EN\" \"http://www.w3.org/TR/2001/REC-SVG-20010904/DTD/svg10.dtd\">");
-        writer.writeStartElement("svg");
-        writer.writeAttribute("xmlns", "http://www.w3.org/2000/svg");
-        writer.writeAttribute("xmlns:xlink", "http://www.w3.org/1999/xlink");
-        writer.writeAttribute("width", QString("%1").arg(width * scale));
-        writer.writeAttribute("height", QString("%1").arg(height * scale));
-        writer.writeAttribute("viewBox", QString("0 0 %1 %2").arg(width).arg(height));
-
-        // Write shapes
-        QMap<QString, QColor> colors;
-        foreach (Shape shape, output.sheets[i_sheets].shapes())
-        {
-            if (!colors.contains(shape.name()))
+            if (!writer.styles.contains(shape.name()))
             {
-                colors[shape.name()] = QColor(qrand() % 255, qrand() % 255, qrand() % 255);
+                QColor color(qrand() % 255, qrand() % 255, qrand() % 255);
+                writer.styles[shape.name()] = QString("fill:%1;stroke:#000;stroke-width:0.01").arg(color.name());
             }
-            QString polygonPoints;
-            foreach (QPointF p, shape)
-            {
-                polygonPoints.append(QString("%1,%2 ").arg(BakeryHelpers::qrealRounded(p.x())).arg(BakeryHelpers::qrealRounded(p.y())));
-            }
-            writer.writeStartElement("polygon");
-            writer.writeAttribute("points", polygonPoints);
-            QString style = QString("fill:%1;stroke:#000;stroke-width:0.01").arg(colors[shape.name()].name());
-            writer.writeAttribute("style", style);
-            writer.writeEndElement(); // polygon
         }
-
-        writer.writeEndElement(); // svg
-        writer.writeEndDocument();
     }
-    return true;
+
+    QList<bool> results = QtConcurrent::blockingMapped<QList<bool>>(sheets, writer);
+    return !results.contains(false);
 }
 
 bool Bakery::isOutputValidForInput(const PluginInput &input, const PluginOutput &output)
 {
-    QList<Shape> inputList = input.shapes;
+    ShapeStock remaining = input.stock();
     foreach (Sheet s, output.sheets)
     {
         // Test valid sheet
@@ -782,25 +1633,16 @@ bool Bakery::isOutputValidForInput(const PluginInput &input, const PluginOutput
         foreach (Shape shape, s.shapes())
         {
             // Test shapes
-            bool found = false;
-            for (QList<Shape>::Iterator i = inputList.begin(); !found && i != inputList.end(); ++i)
-            {
-                if (shape.name() == i->name())
-                {
-                    found = true;
-                    inputList.erase(i);
-                }
-            }
-            if (!found)
+            if (!remaining.take(shape.name()))
             {
                 return false;
             }
         }
     }
-    return inputList.isEmpty();
+    return remaining.isEmpty();
 }
 
-PluginOutput Bakery::findBestOutput(QHash<QString, PluginOutput> &outputs)
+PluginOutput Bakery::findBestOutput(QHash<QString, PluginOutput> &outputs, ScoredOutput::Objective objective)
 {
     if (outputs.isEmpty())
     {
@@ -809,126 +1651,366 @@ PluginOutput Bakery::findBestOutput(QHash<QString, PluginOutput> &outputs)
     }
 
     QList<PluginOutput> candidates(outputs.values());
-    if (candidates.size() > 1)
+    return candidates[ScoredOutput::best(candidates, objective)];
+}
+
+bool Bakery::saveToDirectory(PluginOutput &output, QString outputDirectoryPath, QString resultsFileName, bool svgOutput,
+                             bool svgAutoFormatting)
+{
+    // Create output directory
+    if (!QDir(outputDirectoryPath).exists())
+    {
+        if (!QDir().mkpath(outputDirectoryPath))
+        {
+            BAKERY_CRITICAL(QString("Failed to create output directory \"%1\"").arg(outputDirectoryPath));
+            return false;
+        }
+    }
+
+    // Save text file
+    QString resultsFilePath = QDir(outputDirectoryPath).absoluteFilePath(resultsFileName);
+    QFile resultsFile(resultsFilePath);
+    if (!resultsFile.open(QFile::WriteOnly | QFile::Truncate))
     {
-        std::sort(candidates.begin(), candidates.end());
+        BAKERY_CRITICAL(QString("Failed to save text file to \"%1\"").arg(resultsFilePath));
+        return false;
     }
-    return candidates.last();
+    saveToDevice(output, &resultsFile);
+    resultsFile.close();
+
+    // Save SVGs
+    if (svgOutput)
+    {
+        if (!saveAsSVG(output, outputDirectoryPath, QString("bakery"), svgAutoFormatting))
+        {
+            BAKERY_CRITICAL(QString("Failed to save SVG files to directory \"%1\"").arg(outputDirectoryPath));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Constructor
+
+Bakery::Bakery(QObject *parent, QDir pluginDir) : QObject(parent), _processPool(new PluginProcessPool(this)),
+      _scheduler(new PluginScheduler(this)), _resultCache(new ResultCache(this)), _portfolio(new PluginPortfolio(this)), _lowerBound(0),
+      _lowerBoundPlugin(), _validators(), _originalInput(), _inputSegment(NULL), _stockInputSegment(NULL),
+      _pluginCounters()
+{
+    connect(_scheduler, SIGNAL(runnerReady(AbstractPluginRunner *)), this, SLOT(_runnerReady(AbstractPluginRunner *)));
+    connect(_portfolio, SIGNAL(pauseRequested(QString)), this, SLOT(_portfolioPause(QString)));
+    connect(_portfolio, SIGNAL(resumeRequested(QString)), this, SLOT(_portfolioResume(QString)));
+    connect(_portfolio, SIGNAL(terminateRequested(QString)), this, SLOT(_portfolioTerminate(QString)));
+
+    // Set time limit
+    _settings["runProperties/timelimit"] = 0;
+    _settings["runProperties/inProcess"] = false;
+    _settings["runProperties/workerPool"] = false;
+    _settings["runProperties/sharedMemory"] = false;
+    _settings["runProperties/resultCache"] = false;
+    _settings["runProperties/improveCachedResults"] = false;
+    _settings["runProperties/portfolio"] = false;
+    _settings["runProperties/stopAtLowerBound"] = false;
+    _settings["runProperties/lowerBoundSlack"] = 0;
+    _settings["runProperties/killInvalidPlugins"] = false;
+    _settings["runProperties/objective"] = qint32(ScoredOutput::AverageUtilization);
+    _settings["runProperties/simplificationTolerance"] = 0.0;
+    _settings["runProperties/counters"] = false;
+
+    loadPluginsFromDirectory(pluginDir);
 }
 
-bool Bakery::saveToDirectory(PluginOutput &output, QString outputDirectoryPath, QString resultsFileName, bool svgOutput)
-{
-    // Create output directory
-    if (!QDir(outputDirectoryPath).exists())
+Bakery::Bakery(const Bakery *prototype, QObject *parent)
+    : QObject(parent), _pluginsMetadata(prototype->_pluginsMetadata), _pluginsPaths(prototype->_pluginsPaths),
+      _pluginsFactories(prototype->_pluginsFactories), _pluginsLibraryPaths(prototype->_pluginsLibraryPaths),
+      _processPool(prototype->_processPool), _scheduler(prototype->_scheduler), _resultCache(prototype->_resultCache), _resultCacheKeys(),
+      _cachedOutputs(), _portfolio(new PluginPortfolio(this)), _lowerBound(0), _lowerBoundPlugin(), _validators(), _originalInput(),
+      _inputSegment(NULL), _stockInputSegment(NULL), _pluginsRunners(), _validOutputs(), _pluginCounters(), _settings(prototype->_settings)
+{
+    // Each job has a portfolio of its own
+    _portfolio->setCores(prototype->_portfolio->cores());
+    _portfolio->setStallTime(prototype->_portfolio->stallTime());
+    connect(_scheduler, SIGNAL(runnerReady(AbstractPluginRunner *)), this, SLOT(_runnerReady(AbstractPluginRunner *)));
+    connect(_portfolio, SIGNAL(pauseRequested(QString)), this, SLOT(_portfolioPause(QString)));
+    connect(_portfolio, SIGNAL(resumeRequested(QString)), this, SLOT(_portfolioResume(QString)));
+    connect(_portfolio, SIGNAL(terminateRequested(QString)), this, SLOT(_portfolioTerminate(QString)));
+}
+
+Bakery *Bakery::createJob(QObject *parent) const { return new Bakery(this, parent); }
+
+// Deconstructor
+
+Bakery::~Bakery()
+{
+    // Queued runners are removed first, so releasing running ones does not start them
+    QList<AbstractPluginRunner *> runners = _pluginsRunners.values();
+    _pluginsRunners.clear();
+    foreach (AbstractPluginRunner *runner, runners)
+    {
+        _scheduler->dequeue(runner);
+    }
+    foreach (AbstractPluginRunner *runner, runners)
+    {
+        _scheduler->release(runner);
+    }
+    qDeleteAll(runners);
+    delete _inputSegment;
+    delete _stockInputSegment;
+}
+
+/*!
+ * \brief Returns the time left until a time limit is reached.
+ * \param timer Timer started at the beginning of the time limit.
+ * \param limit Time limit in milliseconds.
+ * \return Remaining time in milliseconds, at least 0.
+ */
+static int remainingTime(const QElapsedTimer &timer, qint64 limit) { return int(qMax(limit - timer.elapsed(), Q_INT64_C(0))); }
+
+bool Bakery::loadPlugin(QString path) { return loadPlugins(QStringList() << path) == 1; }
+
+qint32 Bakery::loadPlugins(QStringList paths)
+{
+    QList<PluginMetadata> metadata;
+    QList<bool> valid;
+    QList<QProcess *> processes;
+
+    // Look up metadata cache
+    QString cacheFileName = metadataCacheFile();
+    QSettings *cache = cacheFileName.isEmpty() ? NULL : new QSettings(cacheFileName, QSettings::IniFormat);
+    foreach (QString path, paths)
+    {
+        PluginMetadata meta;
+        bool cached = cache != NULL && readMetadataCache(cache, path, meta);
+        metadata.append(meta);
+        valid.append(cached);
+        processes.append(NULL);
+    }
+
+    // Start all remaining plugin candidates at once so slow candidates do not add up
+    for (qint32 i = 0; i < paths.size(); ++i)
+    {
+        if (valid[i])
+        {
+            continue;
+        }
+        QProcess *process = new QProcess();
+        process->setReadChannel(QProcess::StandardOutput);
+        process->start(paths[i], QProcess::ReadWrite);
+        processes[i] = process;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    for (qint32 i = 0; i < paths.size(); ++i)
+    {
+        if (processes[i] == NULL)
+        {
+            continue;
+        }
+        if (!processes[i]->waitForStarted(remainingTime(timer, 5000)))
+        {
+            BAKERY_CRITICAL(QString("Plugin candidate '%1' failed to start in time").arg(paths[i]));
+            delete processes[i];
+            processes[i] = NULL;
+            continue;
+        }
+
+        // Send command
+        processes[i]->write("give_metadata \n");
+    }
+
+    // Wait for responses
+    timer.restart();
+    for (qint32 i = 0; i < paths.size(); ++i)
+    {
+        QProcess *process = processes[i];
+        if (process == NULL)
+        {
+            continue;
+        }
+        QString path = paths[i];
+        process->waitForBytesWritten(remainingTime(timer, 2000));
+        while (!process->canReadLine() && process->state() == QProcess::Running &&
+               process->waitForReadyRead(remainingTime(timer, 2000)))
+        {
+        }
+
+        if (process->bytesAvailable() == 0)
+        {
+            if (process->state() != QProcess::Running)
+            {
+                if (process->exitStatus() != QProcess::NormalExit)
+                {
+                    BAKERY_CRITICAL(QString("Failed to capture metadata from plugin candidate '%1'").arg(path));
+                }
+                else
+                {
+                    BAKERY_CRITICAL(QString("Plugin candidate '%1' crashed when asked to give metadata").arg(path));
+                }
+            }
+            else
+            {
+                BAKERY_CRITICAL(QString("Plugin candidate '%1' failed to give metadata in time").arg(path));
+                process->kill();
+            }
+            continue;
+        }
+
+        // Parse response
+        if (!process->canReadLine())
+        {
+            BAKERY_CRITICAL(QString("Plugin candidate '%1' violated protocol (missing new line character)").arg(path));
+        }
+        QByteArray buffer = process->readLine();
+        QTextStream stream(buffer);
+        stream >> metadata[i];
+        if (stream.status() != QTextStream::Ok)
+        {
+            BAKERY_CRITICAL(QString("Plugin candidate '%1' provided invalid metadata").arg(path));
+            continue;
+        }
+        valid[i] = true;
+        if (cache != NULL)
+        {
+            writeMetadataCache(cache, path, metadata[i]);
+        }
+    }
+
+    // Wait for processes to finish
+    timer.restart();
+    for (qint32 i = 0; i < paths.size(); ++i)
+    {
+        QProcess *process = processes[i];
+        if (process == NULL)
+        {
+            continue;
+        }
+        if (process->state() != QProcess::NotRunning && !process->waitForFinished(remainingTime(timer, 2000)))
+        {
+            if (valid[i])
+            {
+                BAKERY_CRITICAL(
+                    QString("Plugin candidate '%1' violated protocol (failed to terminate after sending metadata)").arg(paths[i]));
+            }
+            process->kill();
+            process->waitForFinished(100);
+        }
+        delete process;
+    }
+    delete cache;
+
+    // Register plugins in the given order
+    qint32 loaded = 0;
+    for (qint32 i = 0; i < paths.size(); ++i)
     {
-        if (!QDir().mkpath(outputDirectoryPath))
+        if (valid[i] && registerPlugin(paths[i], metadata[i]))
         {
-            BAKERY_CRITICAL(QString("Failed to create output directory \"%1\"").arg(outputDirectoryPath));
-            return false;
+            ++loaded;
         }
     }
+    return loaded;
+}
 
-    // Save text file
-    QString resultsFilePath = QDir(outputDirectoryPath).absoluteFilePath(resultsFileName);
-    QFile resultsFile(resultsFilePath);
-    if (!resultsFile.open(QFile::WriteOnly | QFile::Truncate))
+bool Bakery::registerPlugin(QString path, PluginMetadata meta)
+{
+    // Ensure uniqueness of provided name. The plugin may already be loaded as library.
+    if (_pluginsPaths.contains(meta.uniqueName) ||
+        (_pluginsMetadata.contains(meta.uniqueName) && _pluginsMetadata[meta.uniqueName] != meta))
     {
-        BAKERY_CRITICAL(QString("Failed to save text file to \"%1\"").arg(resultsFilePath));
+        BAKERY_CRITICAL(QString("Plugin candidate '%1' provided name that is already in use ('%2')").arg(path, meta.uniqueName));
         return false;
     }
-    saveToDevice(output, &resultsFile);
-    resultsFile.close();
 
-    // Save SVGs
-    if (svgOutput)
+    // Store plugin information
+    QString key = QString("pluginsEnabled/%1").arg(meta.uniqueName);
+    if (!_settings.contains(key))
     {
-        if (!saveAsSVG(output, outputDirectoryPath))
-        {
-            BAKERY_CRITICAL(QString("Failed to save SVG files to directory \"%1\"").arg(outputDirectoryPath));
-            return false;
-        }
+        _settings[key] = true;
     }
+    _pluginsMetadata[meta.uniqueName] = meta;
+    _pluginsPaths[meta.uniqueName] = path;
 
     return true;
 }
 
-// Constructor
-
-Bakery::Bakery(QObject *parent, QDir pluginDir) : QObject(parent)
+/*!
+ * \brief Returns the group of a plugin in the metadata cache.
+ * \param path Path to plugin executable.
+ * \return Group name.
+ */
+static QString metadataCacheGroup(QString path)
 {
-    // Set time limit
-    _settings["runProperties/timelimit"] = 0;
-
-    loadPluginsFromDirectory(pluginDir);
+    return QString(QCryptographicHash::hash(QFileInfo(path).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toHex());
 }
 
-// Deconstructor
-
-Bakery::~Bakery() { qDeleteAll(_pluginsRunners); }
-
-bool Bakery::loadPlugin(QString path)
+bool Bakery::readMetadataCache(QSettings *cache, QString path, PluginMetadata &meta)
 {
-    // Start process
-    QProcess process;
-    process.setReadChannel(QProcess::StandardOutput);
-    process.start(path, QProcess::ReadWrite);
-    if (!process.waitForStarted(5000))
+    QFileInfo fileInfo(path);
+    cache->beginGroup(metadataCacheGroup(path));
+
+    // Entries without capabilities were written by older versions, so the plugin is probed again
+    bool hit = fileInfo.exists() && cache->value("path").toString() == fileInfo.absoluteFilePath() &&
+               cache->value("size").toLongLong() == fileInfo.size() &&
+               cache->value("modified").toLongLong() == fileInfo.lastModified().toMSecsSinceEpoch() && cache->contains("capabilities");
+    if (hit)
     {
-        BAKERY_CRITICAL(QString("Plugin candidate '%1' failed to start in time").arg(path));
-        return false;
+        meta.uniqueName = cache->value("name").toString();
+        meta.type = cache->value("type").toString();
+        meta.author = cache->value("author").toString();
+        meta.license = cache->value("license").toString();
+        meta.capabilities = cache->value("capabilities").toStringList();
     }
+    cache->endGroup();
+    return hit;
+}
 
-    // Send command
-    process.write("give_metadata \n");
-    process.waitForBytesWritten();
+void Bakery::writeMetadataCache(QSettings *cache, QString path, const PluginMetadata &meta)
+{
+    QFileInfo fileInfo(path);
+    cache->beginGroup(metadataCacheGroup(path));
+    cache->setValue("path", fileInfo.absoluteFilePath());
+    cache->setValue("size", fileInfo.size());
+    cache->setValue("modified", fileInfo.lastModified().toMSecsSinceEpoch());
+    cache->setValue("name", meta.uniqueName);
+    cache->setValue("type", meta.type);
+    cache->setValue("author", meta.author);
+    cache->setValue("license", meta.license);
+    cache->setValue("capabilities", meta.capabilities);
+    cache->endGroup();
+}
 
-    // Wait for response
-    if (!process.waitForReadyRead(2000))
+bool Bakery::loadPluginLibrary(QString path)
+{
+    // Load library
+    QPluginLoader *loader = new QPluginLoader(path, this);
+    PluginFactory *factory = qobject_cast<PluginFactory *>(loader->instance());
+    if (factory == NULL)
     {
-        if (process.state() != QProcess::Running)
-        {
-            if (process.exitStatus() != QProcess::NormalExit)
-            {
-                BAKERY_CRITICAL(QString("Failed to capture metadata from plugin candidate '%1'").arg(path));
-            }
-            else
-            {
-                BAKERY_CRITICAL(QString("Plugin candidate '%1' crashed when asked to give metadata").arg(path));
-            }
-        }
-        else
-        {
-            BAKERY_CRITICAL(QString("Plugin candidate '%1' failed to give metadata in time").arg(path));
-            process.kill();
-        }
+        BAKERY_CRITICAL(QString("Plugin library candidate '%1' could not be loaded: %2").arg(path, loader->errorString()));
+        loader->unload();
+        delete loader;
         return false;
     }
 
-    // Parse response
-    if (!process.canReadLine())
-    {
-        BAKERY_CRITICAL(QString("Plugin candidate '%1' violated protocol (missing new line character)").arg(path));
-    }
-    QByteArray buffer = process.readLine();
-    QTextStream stream(buffer);
+    // Query metadata
     PluginMetadata meta;
-    stream >> meta;
-    if (stream.status() != QTextStream::Ok)
+    PluginLibraryRunner runner(QString(), factory);
+    if (!runner.queryMetadata(meta))
     {
-        BAKERY_CRITICAL(QString("Plugin candidate '%1' provided invalid metadata").arg(path));
+        BAKERY_CRITICAL(QString("Failed to capture metadata from plugin library candidate '%1'").arg(path));
+        loader->unload();
+        delete loader;
         return false;
     }
 
-    // Wait for process to finish
-    if (!process.waitForFinished(2000))
+    // Ensure uniqueness of provided name. The plugin may already be loaded as executable.
+    if (_pluginsFactories.contains(meta.uniqueName) ||
+        (_pluginsMetadata.contains(meta.uniqueName) && _pluginsMetadata[meta.uniqueName] != meta))
     {
-        BAKERY_CRITICAL(QString("Plugin candidate '%1' violated protocol (failed to terminate after sending metadata)").arg(path));
-    }
-
-    // Ensure uniqueness of provided name
-    if (_pluginsMetadata.contains(meta.uniqueName))
-    {
-        BAKERY_CRITICAL(QString("Plugin candidate '%1' provided name that is already in use ('%2')").arg(path, meta.uniqueName));
+        BAKERY_CRITICAL(QString("Plugin library candidate '%1' provided name that is already in use ('%2')").arg(path, meta.uniqueName));
+        loader->unload();
+        delete loader;
         return false;
     }
 
@@ -939,7 +2021,8 @@ bool Bakery::loadPlugin(QString path)
         _settings[key] = true;
     }
     _pluginsMetadata[meta.uniqueName] = meta;
-    _pluginsPaths[meta.uniqueName] = path;
+    _pluginsFactories[meta.uniqueName] = factory;
+    _pluginsLibraryPaths[meta.uniqueName] = path;
 
     return true;
 }
@@ -949,6 +2032,7 @@ bool Bakery::loadPlugin(QString path)
 bool Bakery::loadPluginsFromDirectory(QDir directory)
 {
     bool foundPlugin = false;
+    QStringList candidates;
 
     // Query plugins
     BAKERY_DEBUG(QString("Querying directory '%1' for plugins").arg(directory.absolutePath()));
@@ -960,19 +2044,36 @@ bool Bakery::loadPluginsFromDirectory(QDir directory)
         {
             continue;
         }
-        if (!fileInfo.isExecutable())
+        if (QLibrary::isLibrary(path))
         {
-            BAKERY_DEBUG(QString("Plugin candidate '%1' is not executable").arg(path));
+            if (!loadPluginLibrary(path))
+            {
+                BAKERY_DEBUG(QString("Plugin library candidate '%1' could not be loaded").arg(path));
+            }
+            else
+            {
+                foundPlugin = true;
+            }
             continue;
         }
-        if (!loadPlugin(path))
+        if (!fileInfo.isExecutable())
         {
-            BAKERY_DEBUG(QString("Plugin candidate '%1' could not be loaded").arg(path));
+            BAKERY_DEBUG(QString("Plugin candidate '%1' is not executable").arg(path));
+            continue;
         }
-        else
+        candidates << path;
+    }
+
+    // Probe executables concurrently
+    if (!candidates.isEmpty())
+    {
+        qint32 loaded = loadPlugins(candidates);
+        if (loaded != candidates.size())
         {
-            foundPlugin = true;
+            BAKERY_DEBUG(
+                QString("%1 of %2 plugin candidate(s) could not be loaded").arg(candidates.size() - loaded).arg(candidates.size()));
         }
+        foundPlugin |= loaded > 0;
     }
     if (!foundPlugin)
     {
@@ -987,52 +2088,216 @@ bool Bakery::loadPluginsFromDirectory(QDir directory)
 
 bool Bakery::isPluginLoaded(QString pluginName) const { return _pluginsMetadata.contains(pluginName); }
 
+QString Bakery::pluginLibraryPath(QString pluginName) const
+{
+    return _pluginsFactories.contains(pluginName) ? _pluginsLibraryPaths.value(pluginName) : QString();
+}
+
+/*!
+ * \brief Estimates the capacity of a shared memory segment for the outputs of a plugin.
+ *
+ * Outputs contain every piece with its own coordinates, so the size of each serialized prototype is multiplied by its number of pieces.
+ * Room is left for coordinates of rotated shapes and the sheets.
+ *
+ * \param input Plugin input.
+ * \return Capacity in bytes.
+ */
+static qint32 outputSegmentCapacity(const PluginInput &input)
+{
+    const ShapeStock &stock = input.stock();
+    qint64 bytes = 0;
+    for (qint32 i_type = 0; i_type < stock.types(); ++i_type)
+    {
+        QString data;
+        QTextStream stream(&data);
+        stream << stock.prototype(i_type);
+        stream.flush();
+        bytes += qint64(data.size()) * stock.count(i_type);
+    }
+    return qint32(qMin(2 * bytes + 64 * 1024, qint64(std::numeric_limits<qint32>::max())));
+}
+
 QHash<QString, PluginOutput> Bakery::computeAllOutputs(PluginInput input, bool synchronous, bool *ok)
 {
     _validOutputs.clear();
+    _pluginCounters.clear();
+    _resultCacheKeys.clear();
+    _cachedOutputs.clear();
+    _lowerBound = BakeryBounds::lowerBound(input);
+    _lowerBoundPlugin.clear();
+    _validators.clear();
+    _originalInput = PluginInput();
+    delete _inputSegment;
+    _inputSegment = NULL;
+    delete _stockInputSegment;
+    _stockInputSegment = NULL;
     if (_pluginsMetadata.size() == 0)
     {
         BAKERY_CRITICAL("No plugins loaded");
         if (synchronous)
         {
-            setBool(ok, false);
+            BakeryHelpers::setBool(ok, false);
         }
         return _validOutputs;
     }
 
-    // Run plugins
+    bool resultCache = _settings["runProperties/resultCache"].toBool();
+    bool improveCachedResults = _settings["runProperties/improveCachedResults"].toBool();
+    qint32 timeLimit = _settings["runProperties/timelimit"].toInt();
+    QByteArray inputHash = resultCache ? ResultCache::inputHash(input) : QByteArray();
+    QStringList cachedPlugins;
+    qint32 outputCapacity = -1;
+
+    // Plugins pack the simplified shapes, while the lower bound and the result cache refer to the original input
+    PluginInput pluginInput = input;
+    qreal simplificationTolerance = _settings["runProperties/simplificationTolerance"].toDouble();
+    if (simplificationTolerance > 0.0)
+    {
+        _originalInput = input;
+        pluginInput = BakerySimplifier::simplify(input, simplificationTolerance);
+    }
+
+    // Create runners
     foreach (QString pluginName, getEnabledPlugins())
     {
-        PluginRunner *runner = new PluginRunner(pluginName, _pluginsPaths[pluginName], input);
+        AbstractPluginRunner *runner;
+        bool inProcess = _settings["runProperties/inProcess"].toBool() || !_pluginsPaths.contains(pluginName);
+        bool library = _pluginsFactories.contains(pluginName) && inProcess;
+
+        // Cached outputs are used directly unless the plugin might find a better output
+        if (resultCache)
+        {
+            QString pluginPath = library ? _pluginsLibraryPaths[pluginName] : _pluginsPaths[pluginName];
+            QString key = _resultCache->key(inputHash, pluginName, pluginPath, timeLimit, objective(), simplificationTolerance);
+            PluginOutput cached;
+            if (_resultCache->lookup(key, input, cached))
+            {
+                if (!improveCachedResults || (lowerBoundIsOptimal(objective()) && cached.sheets.size() <= _lowerBound))
+                {
+                    _validOutputs[pluginName] = cached;
+                    cachedPlugins << pluginName;
+                    continue;
+                }
+                _cachedOutputs[pluginName] = cached;
+            }
+            _resultCacheKeys[pluginName] = key;
+        }
+
+        if (library)
+        {
+            runner = new PluginLibraryRunner(pluginName, _pluginsFactories[pluginName], pluginInput);
+        }
+        else
+        {
+            PluginRunner *processRunner = new PluginRunner(pluginName, _pluginsPaths[pluginName], pluginInput);
+            if (_settings["runProperties/workerPool"].toBool())
+            {
+                processRunner->setProcessPool(_processPool);
+            }
+
+            // Older plugins only read inputs listing every piece
+            bool shapeStock = _pluginsMetadata[pluginName].capabilities.contains("shapestock");
+            processRunner->setShapeStockEnabled(shapeStock);
+            QSharedMemory *inputSegment = NULL;
+            if (_settings["runProperties/sharedMemory"].toBool())
+            {
+                inputSegment = createInputSegment(pluginInput, shapeStock);
+            }
+            if (inputSegment != NULL)
+            {
+                if (outputCapacity == -1)
+                {
+                    outputCapacity = outputSegmentCapacity(pluginInput);
+                }
+                processRunner->setSharedMemory(inputSegment->key(), outputCapacity);
+            }
+            runner = processRunner;
+        }
+        runner->setCountersEnabled(_settings["runProperties/counters"].toBool());
         connect(runner, SIGNAL(outputUpdated(QString, PluginOutput)), this, SLOT(_pluginOutputUpdated(QString, PluginOutput)));
         connect(runner, SIGNAL(finished(int, QString, PluginInput, PluginOutput)), this,
                 SLOT(_pluginFinished(int, QString, PluginInput, PluginOutput)));
         _pluginsRunners[pluginName] = runner;
+        _validators[pluginName] = OutputValidator(pluginInput, objective());
+    }
+
+    foreach (QString pluginName, cachedPlugins)
+    {
+        BAKERY_DEBUG(QString("Using cached output of plugin '%1'").arg(pluginName));
         emit pluginStarting(pluginName);
-        runner->run();
-        if (_settings["runProperties/timelimit"].toInt() != 0)
+        emit pluginOutputUpdated(pluginName, _validOutputs[pluginName]);
+        emit pluginFinished(0, pluginName, _validOutputs[pluginName], true);
+    }
+    if (_pluginsRunners.isEmpty())
+    {
+        emit allPluginsFinished(_validOutputs);
+    }
+    else if (_settings["runProperties/portfolio"].toBool())
+    {
+        _portfolio->start(timeLimit);
+        foreach (QString pluginName, cachedPlugins)
         {
-            runner->terminate(_settings["runProperties/timelimit"].toInt());
+            _portfolio->pluginStarted(pluginName, false);
+            _portfolio->pluginOutputUpdated(pluginName, ScoredOutput(_validOutputs[pluginName], objective()));
+            _portfolio->pluginFinished(pluginName);
         }
     }
 
+    // Run plugins - all runners are known before the first one starts, so a failing plugin can not finish the job early
+    foreach (AbstractPluginRunner *runner, _pluginsRunners.values())
+    {
+        _scheduler->enqueue(runner);
+    }
+
     if (synchronous)
     {
-        while (!_pluginsRunners.isEmpty())
+        // Plugins which fail to start finish right away, so all of them might be finished already
+        if (!_pluginsRunners.isEmpty())
         {
-            QCoreApplication::processEvents();
-            QThread::msleep(100);
+            QEventLoop loop;
+            connect(this, SIGNAL(allPluginsFinished(QHash<QString, PluginOutput>)), &loop, SLOT(quit()));
+            loop.exec();
         }
-        setBool(ok, true);
+        BakeryHelpers::setBool(ok, true);
     }
 
     return _validOutputs;
 }
 
+QFuture<QHash<QString, PluginOutput>> Bakery::computeAllOutputsAsync(PluginInput input)
+{
+    QFutureInterface<QHash<QString, PluginOutput>> interface;
+    interface.reportStarted();
+    QFuture<QHash<QString, PluginOutput>> future = interface.future();
+
+    // Connected before the plugins are started because all of them might finish right away
+    QSharedPointer<QMetaObject::Connection> connection(new QMetaObject::Connection());
+    *connection = connect(this, &Bakery::allPluginsFinished, [interface, connection](QHash<QString, PluginOutput> outputs) mutable {
+        QObject::disconnect(*connection);
+        interface.reportResult(outputs);
+        interface.reportFinished();
+    });
+
+    computeAllOutputs(input, false);
+    if (_pluginsRunners.isEmpty() && !interface.isFinished())
+    {
+        disconnect(*connection);
+        interface.reportResult(_validOutputs);
+        interface.reportFinished();
+        return future;
+    }
+
+    QFutureWatcher<QHash<QString, PluginOutput>> *watcher = new QFutureWatcher<QHash<QString, PluginOutput>>(this);
+    connect(watcher, &QFutureWatcherBase::canceled, this, [this]() { killAllPlugins(); });
+    connect(watcher, SIGNAL(finished()), watcher, SLOT(deleteLater()));
+    watcher->setFuture(future);
+    return future;
+}
+
 PluginOutput Bakery::computeBestOutput(PluginInput input, bool *ok)
 {
     QHash<QString, PluginOutput> outputs = computeAllOutputs(input, true, ok);
-    return ok ? findBestOutput(outputs) : PluginOutput();
+    return ok ? findBestOutput(outputs, objective()) : PluginOutput();
 }
 
 PluginOutput Bakery::computeBestOutput(QIODevice *device, bool *ok)
@@ -1049,17 +2314,33 @@ PluginOutput Bakery::computeBestOutput(QIODevice *device, bool *ok)
 
 bool Bakery::terminatePlugin(QString pluginName, int msec)
 {
-    _pluginsRunners.value(pluginName)->terminate(msec);
+    if (!_pluginsRunners.contains(pluginName))
+    {
+        BAKERY_WARNING(QString("Trying to terminate plugin '%1' which is not running").arg(pluginName));
+        return false;
+    }
+    AbstractPluginRunner *runner = _pluginsRunners.value(pluginName);
     emit pluginTerminating(pluginName, msec);
+
+    // Plugins which have not been started yet finish without output
+    if (_scheduler->dequeue(runner))
+    {
+        _pluginFinished(-1, pluginName, runner->pluginInput(), PluginOutput());
+        return true;
+    }
+    runner->terminate(msec);
     return true;
 }
 
 bool Bakery::terminateAllPlugins(int msec)
 {
     bool result = true;
-    for (qint32 i = 0; i < _pluginsRunners.size(); ++i)
+    foreach (QString pluginName, _pluginsRunners.keys())
     {
-        result &= terminatePlugin(_pluginsRunners.keys()[i], msec);
+        if (_pluginsRunners.contains(pluginName))
+        {
+            result &= terminatePlugin(pluginName, msec);
+        }
     }
     return result;
 }
@@ -1140,7 +2421,144 @@ void Bakery::setTimeLimit(qint32 timeLimit) { _settings["runProperties/timelimit
 
 qint32 Bakery::getTimeLimit() { return _settings["runProperties/timelimit"].toInt(); }
 
-void Bakery::_pluginOutputUpdated(QString pluginName, PluginOutput pluginOutput) { emit pluginOutputUpdated(pluginName, pluginOutput); }
+void Bakery::setInProcessEnabled(bool enabled) { _settings["runProperties/inProcess"] = enabled; }
+
+bool Bakery::isInProcessEnabled() const { return _settings["runProperties/inProcess"].toBool(); }
+
+void Bakery::setWorkerPoolEnabled(bool enabled)
+{
+    _settings["runProperties/workerPool"] = enabled;
+
+    // Jobs share the pool of their prototype, whose other jobs may still reuse the idle workers
+    if (!enabled && _processPool->parent() == this)
+    {
+        _processPool->clear();
+    }
+}
+
+bool Bakery::isWorkerPoolEnabled() const { return _settings["runProperties/workerPool"].toBool(); }
+
+PluginProcessPool *Bakery::processPool() { return _processPool; }
+
+PluginScheduler *Bakery::scheduler() { return _scheduler; }
+
+void Bakery::setResultCacheEnabled(bool enabled) { _settings["runProperties/resultCache"] = enabled; }
+
+bool Bakery::isResultCacheEnabled() const { return _settings["runProperties/resultCache"].toBool(); }
+
+void Bakery::setCachedResultImprovementEnabled(bool enabled) { _settings["runProperties/improveCachedResults"] = enabled; }
+
+bool Bakery::isCachedResultImprovementEnabled() const { return _settings["runProperties/improveCachedResults"].toBool(); }
+
+void Bakery::setCountersEnabled(bool enabled) { _settings["runProperties/counters"] = enabled; }
+
+bool Bakery::isCountersEnabled() const { return _settings["runProperties/counters"].toBool(); }
+
+QHash<QString, QHash<QString, quint64>> Bakery::pluginCounters() const { return _pluginCounters; }
+
+ResultCache *Bakery::resultCache() { return _resultCache; }
+
+void Bakery::setPortfolioEnabled(bool enabled) { _settings["runProperties/portfolio"] = enabled; }
+
+bool Bakery::isPortfolioEnabled() const { return _settings["runProperties/portfolio"].toBool(); }
+
+PluginPortfolio *Bakery::portfolio() { return _portfolio; }
+
+void Bakery::setStopAtLowerBoundEnabled(bool enabled) { _settings["runProperties/stopAtLowerBound"] = enabled; }
+
+bool Bakery::isStopAtLowerBoundEnabled() const { return _settings["runProperties/stopAtLowerBound"].toBool(); }
+
+void Bakery::setLowerBoundSlack(qint32 sheets) { _settings["runProperties/lowerBoundSlack"] = qMax(sheets, 0); }
+
+qint32 Bakery::lowerBoundSlack() const { return _settings["runProperties/lowerBoundSlack"].toInt(); }
+
+qint32 Bakery::lowerBound() const { return _lowerBound; }
+
+void Bakery::setKillInvalidPluginsEnabled(bool enabled) { _settings["runProperties/killInvalidPlugins"] = enabled; }
+
+bool Bakery::isKillInvalidPluginsEnabled() const { return _settings["runProperties/killInvalidPlugins"].toBool(); }
+
+void Bakery::setObjective(ScoredOutput::Objective objective) { _settings["runProperties/objective"] = qint32(objective); }
+
+ScoredOutput::Objective Bakery::objective() const { return ScoredOutput::Objective(_settings["runProperties/objective"].toInt()); }
+
+void Bakery::setSimplificationTolerance(qreal tolerance) { _settings["runProperties/simplificationTolerance"] = qMax(tolerance, 0.0); }
+
+qreal Bakery::simplificationTolerance() const { return _settings["runProperties/simplificationTolerance"].toDouble(); }
+
+void Bakery::setSharedMemoryEnabled(bool enabled) { _settings["runProperties/sharedMemory"] = enabled; }
+
+bool Bakery::isSharedMemoryEnabled() const { return _settings["runProperties/sharedMemory"].toBool(); }
+
+QSharedMemory *Bakery::createInputSegment(const PluginInput &input, bool shapeStock)
+{
+    QSharedMemory *&segment = shapeStock ? _stockInputSegment : _inputSegment;
+    if (segment != NULL)
+    {
+        return segment;
+    }
+
+    QString data;
+    QTextStream stream(&data);
+    BakeryPlugins::writePluginInput(stream, input, shapeStock);
+    stream.flush();
+    QByteArray bytes = data.toLatin1();
+
+    segment = new QSharedMemory(BakeryPlugins::uniqueSharedMemoryKey());
+    if (!segment->create(bytes.size() + qint32(sizeof(qint64))) || !BakeryPlugins::writeSharedMemory(segment, bytes))
+    {
+        BAKERY_WARNING(QString("Could not create input segment (%1), using standard input instead").arg(segment->errorString()));
+        delete segment;
+        segment = NULL;
+    }
+    return segment;
+}
+
+void Bakery::_pluginOutputUpdated(QString pluginName, PluginOutput pluginOutput)
+{
+    // Only the shapes changed since the last update are checked
+    bool valid = true;
+    bool complete = false;
+    QString error;
+    if (_validators.contains(pluginName))
+    {
+        BakeryTrace::Span span("validate output", "bakery");
+        span.setArgument("plugin", pluginName);
+        OutputValidator &validator = _validators[pluginName];
+        valid = validator.update(pluginOutput);
+        complete = valid && validator.isComplete();
+        error = validator.error();
+        span.setArgument("valid", valid);
+    }
+
+    // Only complete outputs have a meaningful score
+    if (complete && _settings["runProperties/portfolio"].toBool())
+    {
+        _portfolio->pluginOutputUpdated(pluginName, ScoredOutput(pluginOutput, objective()));
+    }
+    emit pluginOutputUpdated(pluginName, pluginOutput);
+
+    if (!valid)
+    {
+        BAKERY_CRITICAL(QString("Plugin '%1' sent an invalid output: %2").arg(pluginName).arg(error));
+        emit pluginOutputInvalid(pluginName, error);
+        if (_settings["runProperties/killInvalidPlugins"].toBool())
+        {
+            killPlugin(pluginName);
+        }
+        return;
+    }
+
+    // Nobody can do better than the lower bound if the score only depends on the number of sheets
+    if (complete && _settings["runProperties/stopAtLowerBound"].toBool() && _lowerBoundPlugin.isEmpty() &&
+        lowerBoundIsOptimal(objective()) && pluginOutput.sheets.size() <= _lowerBound + _settings["runProperties/lowerBoundSlack"].toInt())
+    {
+        BAKERY_DEBUG(QString("Plugin '%1' reached the lower bound of %2 sheet(s)").arg(pluginName).arg(_lowerBound));
+        _lowerBoundPlugin = pluginName;
+        emit lowerBoundReached(pluginName, pluginOutput.sheets.size());
+        terminateAllPlugins(500);
+    }
+}
 
 void Bakery::_pluginFinished(int exitCode, QString pluginName, PluginInput pluginInput, PluginOutput pluginOutput)
 {
@@ -1149,16 +2567,144 @@ void Bakery::_pluginFinished(int exitCode, QString pluginName, PluginInput plugi
         BAKERY_CRITICAL(QString("Plugin '%1' reported having finished but was not running").arg(pluginName));
     }
 
-    bool valid = isOutputValidForInput(pluginInput, pluginOutput);
+    // Updates have been validated while they arrived, so usually only the unchanged final output is compared against the last update.
+    // The best valid output is used, even if the plugin was killed or got worse afterwards.
+    BakeryTrace::Span span("validate final output", "bakery");
+    span.setArgument("plugin", pluginName);
+    bool valid;
+    if (_validators.contains(pluginName))
+    {
+        OutputValidator validator = _validators.take(pluginName);
+        if (!validator.update(pluginOutput))
+        {
+            BAKERY_WARNING(QString("Final output of plugin '%1' is invalid: %2").arg(pluginName).arg(validator.error()));
+        }
+        valid = validator.hasCompleteOutput();
+        if (valid)
+        {
+            pluginOutput = validator.bestOutput();
+        }
+    }
+    else
+    {
+        valid = isOutputValidForInput(pluginInput, pluginOutput);
+    }
+    if (valid && !_originalInput.stock().isEmpty())
+    {
+        PluginOutput restored = BakerySimplifier::restore(pluginOutput, _originalInput, pluginInput);
+        if (isOutputValidForInput(_originalInput, restored))
+        {
+            pluginOutput = restored;
+        }
+        else
+        {
+            BAKERY_WARNING(QString("Restored output of plugin '%1' is invalid, keeping the simplified shapes").arg(pluginName));
+        }
+    }
+    span.setArgument("valid", valid);
+    span.end();
+
+    // A cached output which has not been improved is kept
+    if (_cachedOutputs.contains(pluginName) &&
+        (!valid || !(ScoredOutput(_cachedOutputs[pluginName], objective()) < ScoredOutput(pluginOutput, objective()))))
+    {
+        pluginOutput = _cachedOutputs[pluginName];
+        valid = true;
+    }
+    else if (valid && _resultCacheKeys.contains(pluginName))
+    {
+        _resultCache->store(_resultCacheKeys[pluginName], pluginOutput);
+    }
     if (valid)
     {
         _validOutputs[pluginName] = pluginOutput;
     }
+    if (_pluginsRunners.contains(pluginName) && !_pluginsRunners[pluginName]->counters().isEmpty())
+    {
+        _pluginCounters[pluginName] = _pluginsRunners[pluginName]->counters();
+    }
+    _portfolio->pluginFinished(pluginName);
     emit pluginFinished(exitCode, pluginName, pluginOutput, valid);
 
-    _pluginsRunners.remove(pluginName);
+    AbstractPluginRunner *runner = _pluginsRunners.take(pluginName);
+    if (runner != NULL)
+    {
+        disconnect(runner, 0, this, 0);
+        runner->deleteLater();
+    }
     if (_pluginsRunners.isEmpty())
     {
+        delete _inputSegment;
+        _inputSegment = NULL;
+        delete _stockInputSegment;
+        _stockInputSegment = NULL;
+        _portfolio->stop();
+        BakeryTrace::instant("all plugins finished", "bakery");
         emit allPluginsFinished(_validOutputs);
     }
+
+    // Releasing the slot may start the next plugin, which might finish right away if it fails
+    _scheduler->release(runner);
+}
+
+void Bakery::_runnerReady(AbstractPluginRunner *runner)
+{
+    QString pluginName = runner->pluginName();
+    if (_pluginsRunners.value(pluginName) != runner)
+    {
+        return;
+    }
+    emit pluginStarting(pluginName);
+    if (_cachedOutputs.contains(pluginName))
+    {
+        emit pluginOutputUpdated(pluginName, _cachedOutputs[pluginName]);
+    }
+
+    // Plugins are asked to finish a bit before they get killed, so their last output is not lost
+    qint32 timeLimit = _settings["runProperties/timelimit"].toInt();
+    runner->setDeadline(timeLimit != 0 ? PluginDeadline::now() + timeLimit - qMin(timeLimit / 10, 500) : 0);
+    if (!runner->run())
+    {
+        BAKERY_CRITICAL(QString("Plugin '%1' could not be started").arg(pluginName));
+        _pluginFinished(-1, pluginName, runner->pluginInput(), PluginOutput());
+        return;
+    }
+    if (timeLimit != 0)
+    {
+        runner->terminate(timeLimit);
+    }
+    if (_settings["runProperties/portfolio"].toBool())
+    {
+        _portfolio->pluginStarted(pluginName, runner->isPausable());
+        if (_cachedOutputs.contains(pluginName))
+        {
+            _portfolio->pluginOutputUpdated(pluginName, ScoredOutput(_cachedOutputs[pluginName], objective()));
+        }
+    }
+}
+
+void Bakery::_portfolioPause(QString pluginName)
+{
+    if (_pluginsRunners.contains(pluginName) && _pluginsRunners[pluginName]->pause())
+    {
+        BAKERY_DEBUG(QString("Pausing plugin '%1'").arg(pluginName));
+    }
+}
+
+void Bakery::_portfolioResume(QString pluginName)
+{
+    if (_pluginsRunners.contains(pluginName) && _pluginsRunners[pluginName]->resume())
+    {
+        BAKERY_DEBUG(QString("Resuming plugin '%1'").arg(pluginName));
+    }
+}
+
+void Bakery::_portfolioTerminate(QString pluginName)
+{
+    if (_pluginsRunners.contains(pluginName))
+    {
+        // The plugin gets a moment to report its last output
+        BAKERY_DEBUG(QString("Terminating plugin '%1' early").arg(pluginName));
+        terminatePlugin(pluginName, 500);
+    }
 }
@@ -22,6 +22,15 @@
 
 #include "global.h"
 #include "plugins.h"
+#include "pluginpool.h"
+#include "pluginscheduler.h"
+#include "resultcache.h"
+#include "pluginportfolio.h"
+#include "bounds.h"
+#include "validator.h"
+#include "scoredoutput.h"
+#include "simplifier.h"
+#include "svgimport.h"
 #include "sheet.h"
 #include "shape.h"
 
@@ -33,6 +42,9 @@
 #include <QHash>
 #include <QMap>
 #include <QProcess>
+#include <QSettings>
+#include <QStringList>
+#include <QFuture>
 
 /*!
  * \brief Main interface for libbakery. Handles plugin input/output.
@@ -44,6 +56,10 @@ class BAKERYSHARED_EXPORT Bakery : public QObject
 public:
     /*!
      * \brief Parses an input file and returns a corresponding PluginInput.
+     *
+     * Files are memory mapped and other devices are read completely before parsing. Inputs containing non-ASCII characters outside of
+     * shape names are parsed with a QTextStream instead.
+     *
      * \param device Input device.
      * \param ok Will be set to true if no errors occur. Will be ignored if set to NULL.
      * \return Corresponding PluginInput.
@@ -58,16 +74,21 @@ public:
      *  - circle
      *  - ellipse
      *  - polygon
+     *  - path
      *
+     * Curves are flattened according to parameters. With the default parameters circles, ellipses and rounded rects are flattened by
+     * QPainterPath. Otherwise each curved shape is replaced by a polygon containing it which respects the vertex budget (see
+     * SVGImportParameters and BakerySVGImport).
      *
-     * Please note: The SVG path element is not supported because it can create multi-polygons which can not be represented in the defaut
-     * input / output format.
+     * Paths are always approximated conservatively. Since a path can describe multiple polygons which can not be represented in the
+     * default input / output format, holes are filled and the convex hull of disjoint parts is used.
      *
      * \param device Input device.
      * \param ok Will be set to true if no errors occur. Will be ignored if set to NULL.
+     * \param parameters Parameters for the approximation of curves.
      * \return Corresponding PluginInput.
      */
-    static PluginInput loadFromSVG(QIODevice *device, bool *ok = NULL);
+    static PluginInput loadFromSVG(QIODevice *device, bool *ok = NULL, const SVGImportParameters &parameters = SVGImportParameters());
 
     /*!
      * \brief Generates a random PluginInput.
@@ -76,6 +97,35 @@ public:
      */
     static PluginInput randomInput(RandomPluginInputParameters parameters);
 
+    /*!
+     * \brief Generates random PluginInputs for several seeds in parallel.
+     *
+     * Each input is the same as the one generated by randomInput() with the corresponding seed.
+     * \param parameters Parameters for the generation process. The seed is ignored.
+     * \param seeds Seeds of the inputs.
+     * \return Generated PluginInputs in the order of the seeds.
+     */
+    static QList<PluginInput> randomInputs(RandomPluginInputParameters parameters, QList<qint32> seeds);
+
+    /*!
+     * \brief Returns the names of all profiles for random generation.
+     * \return Names of the profiles.
+     * \sa randomProfile()
+     */
+    static QStringList randomProfiles();
+
+    /*!
+     * \brief Returns the parameters of a named profile for random generation.
+     *
+     * The profiles describe workloads for benchmarking, e.g. "many-pieces" with more than 10000 shapes or "high-vertex" with more than
+     * 200 vertices per shape. The seed of the returned parameters is -1 and should be set for reproducible inputs.
+     * \param name Name of the profile.
+     * \param ok Will be set to true if the profile exists. Will be ignored if set to NULL.
+     * \return Parameters of the profile, default parameters if the profile does not exist.
+     * \sa randomProfiles()
+     */
+    static RandomPluginInputParameters randomProfile(QString name, bool *ok = NULL);
+
     /*!
      * \brief Saves a single PluginInput to a device.
      * \param input PluginInput to save.
@@ -101,22 +151,25 @@ public:
      * \param outputDirectoryPath Target directory.
      * \param resultsFileName Target file name.
      * \param svgOutput If true additional SVG output will be saved.
+     * \param svgAutoFormatting If true the SVG files are indented, see saveAsSVG().
      * \return true if successful.
      */
-    static bool saveToDirectory(PluginOutput &output, QString outputDirectoryPath, QString resultsFileName, bool svgOutput);
+    static bool saveToDirectory(PluginOutput &output, QString outputDirectoryPath, QString resultsFileName, bool svgOutput,
+                                bool svgAutoFormatting = true);
 
     /*!
      * \brief Saves a single PluginOutput to files in SVG format.
      *
      * Each shape is saved as a SVG polygon element. The width / height of the sheet is saved in the corresponding SVG attribute. Each sheet
-     * is saved in a different file.
+     * is saved in a different file. The files are written in parallel (QtConcurrent).
      *
      * \param output PluginOutput to save.
      * \param outputDir Target directory.
      * \param filePrefix Prefix of files.
+     * \param autoFormatting If true the XML is indented. Files are smaller and written faster without indentation.
      * \return true if successful.
      */
-    static bool saveAsSVG(PluginOutput output, QDir outputDir, QString filePrefix = QString("bakery"));
+    static bool saveAsSVG(PluginOutput output, QDir outputDir, QString filePrefix = QString("bakery"), bool autoFormatting = true);
 
     /*!
      * \brief Checks if the output could be a valid result of a given input.
@@ -136,12 +189,31 @@ public:
     /*!
      * \brief Finds the best outputs out of a Hash of PluginOutputs.
      *
-     * It is not checked whether the outputs are valid.
+     * It is not checked whether the outputs are valid. Each output is scored once.
      *
      * \param outputs Hash of PluginOutputs.
+     * \param objective Objective to rank the outputs by.
      * \return Best PluginOutput.
      */
-    static PluginOutput findBestOutput(QHash<QString, PluginOutput> &outputs);
+    static PluginOutput findBestOutput(QHash<QString, PluginOutput> &outputs,
+                                       ScoredOutput::Objective objective = ScoredOutput::AverageUtilization);
+
+    /*!
+     * \brief Sets the file in which plugin metadata is cached.
+     *
+     * Plugin executables whose path, size and modification time match a cache entry are not started when they are loaded. By default
+     * the cache is stored in QStandardPaths::CacheLocation. The cache file has to be set before plugins are loaded, e.g. before a Bakery
+     * object is created.
+     *
+     * \param fileName File name of the cache. If empty the cache is disabled.
+     */
+    static void setMetadataCacheFile(QString fileName);
+
+    /*!
+     * \brief Returns the file in which plugin metadata is cached.
+     * \return File name of the cache or an empty string if the cache is disabled.
+     */
+    static QString metadataCacheFile();
 
     /*!
      * \brief Bakery Construnctor
@@ -155,6 +227,17 @@ public:
      */
     ~Bakery();
 
+    /*!
+     * \brief Creates a Bakery for running a job in parallel to this one.
+     *
+     * The new Bakery shares the loaded plugins, the worker pool and the scheduler of this object and starts with a copy of its settings.
+     * This object has to outlive the new one. Plugins are not loaded again.
+     *
+     * \param parent QObject parent.
+     * \return New Bakery.
+     */
+    Bakery *createJob(QObject *parent = 0) const;
+
     /*!
      * \brief Loads a single plugin.
      * \param path Path to plugin executeable.
@@ -162,11 +245,33 @@ public:
      */
     bool loadPlugin(QString path);
 
+    /*!
+     * \brief Loads several plugins at once.
+     *
+     * Plugins found in the metadata cache are not started. All other plugin candidates are started and probed concurrently.
+     *
+     * \param paths Paths to plugin executables.
+     * \return Number of loaded plugins.
+     */
+    qint32 loadPlugins(QStringList paths);
+
+    /*!
+     * \brief Loads a single in-process plugin.
+     *
+     * The library has to export a PluginFactory. A plugin may be available both as executable and as library if both provide the same
+     * metadata.
+     *
+     * \param path Path to plugin library.
+     * \return true if successful.
+     */
+    bool loadPluginLibrary(QString path);
+
     /*!
      * \brief Tries to load plugins from a directory.
      *
-     * A file is considered a plugin candidate if QFileInfo::isExecutable() returns true. This function does not search for plugins
-     * recursively.
+     * A file is considered a plugin library candidate if QLibrary::isLibrary() returns true. Otherwise it is considered a plugin candidate
+     * if QFileInfo::isExecutable() returns true. Plugin executables are probed concurrently (see loadPlugins(QStringList)). This function
+     * does not search for plugins recursively.
      *
      * \param directory Directory from which to load plugins.
      * \return true if at least one plugin could be loaded.
@@ -180,15 +285,36 @@ public:
      */
     bool isPluginLoaded(QString pluginName) const;
 
+    /*!
+     * \brief Returns the path of the shared library of a plugin. Plugins with a library are run by a PluginLibraryRunner if in-process
+     * mode is enabled.
+     * \param pluginName Name of the plugin.
+     * \return Library path or an empty string if no library of the plugin is loaded.
+     */
+    QString pluginLibraryPath(QString pluginName) const;
+
     /*!
      * \brief Runs all enabled plugins on the given PluginInput and returns a hash of all outputs.
      * \param input PluginInput.
-     * \param synchronous If set to true this method is blocking.
+     * \param synchronous If set to true this method is blocking. Events are processed in a local event loop until all plugins are
+     * finished.
      * \param ok Will be set to true if no errors occur. Will be ignored if set to NULL.
      * \return Hash with results. Will be empty in non-blocking mode.
      */
     QHash<QString, PluginOutput> computeAllOutputs(PluginInput input, bool synchronous, bool *ok = 0);
 
+    /*!
+     * \brief Runs all enabled plugins on the given PluginInput without blocking.
+     *
+     * The future is finished when all plugins are finished. Its result is the hash of all valid outputs, which is empty if no plugin could
+     * be run. Canceling the future kills all plugins. Results are reported from the thread of this object, so an event loop has to run
+     * in that thread. Only one computation may run at the same time.
+     *
+     * \param input PluginInput.
+     * \return Future for the hash with results.
+     */
+    QFuture<QHash<QString, PluginOutput>> computeAllOutputsAsync(PluginInput input);
+
     /*!
      * \brief Runs all plugins on the given PluginInput and returns the best output.
      *
@@ -314,7 +440,275 @@ public:
      */
     qint32 getTimeLimit();
 
+    /*!
+     * \brief Enables / disables in-process execution of plugins.
+     *
+     * If enabled, plugins which are available as library are run in-process on worker threads. This avoids the cost of starting a process
+     * and serializing input and output, but a crashing plugin takes down the whole application. Plugins which are only available as
+     * executable are always run in a separate process, plugins which are only available as library are always run in-process.
+     *
+     * \param enabled If set to true in-process execution is enabled.
+     */
+    void setInProcessEnabled(bool enabled = true);
+
+    /*!
+     * \brief Returns if in-process execution of plugins is enabled.
+     * \return true if enabled.
+     */
+    bool isInProcessEnabled() const;
+
+    /*!
+     * \brief Enables / disables the worker pool.
+     *
+     * If enabled, plugin executables are kept running after a job and reused for the next job. The pool can be configured through
+     * processPool(). Disabling the pool retires its idle workers, except in a Bakery created by createJob(QObject *), which shares the
+     * pool and only stops using it.
+     *
+     * \param enabled If set to true the worker pool is enabled.
+     */
+    void setWorkerPoolEnabled(bool enabled = true);
+
+    /*!
+     * \brief Returns if the worker pool is enabled.
+     * \return true if enabled.
+     */
+    bool isWorkerPoolEnabled() const;
+
+    /*!
+     * \brief Returns the pool of persistent plugin processes.
+     * \return Process pool.
+     */
+    PluginProcessPool *processPool();
+
+    /*!
+     * \brief Enables / disables the shared memory transport.
+     *
+     * If enabled, the serialized input is placed once in a shared memory segment which all plugin processes read. Plugins place their
+     * outputs in a segment of their own. Only small control messages are sent through the standard channels.
+     *
+     * \param enabled If set to true the shared memory transport is enabled.
+     */
+    void setSharedMemoryEnabled(bool enabled = true);
+
+    /*!
+     * \brief Returns if the shared memory transport is enabled.
+     * \return true if enabled.
+     */
+    bool isSharedMemoryEnabled() const;
+
+    /*!
+     * \brief Returns the scheduler which decides when plugins are started.
+     *
+     * By default all plugins are started at once. If the number of concurrent plugins is limited, the remaining plugins are queued and
+     * the time limit of a queued plugin starts when the plugin is started.
+     *
+     * \return Plugin scheduler.
+     */
+    PluginScheduler *scheduler();
+
+    /*!
+     * \brief Enables / disables the result cache.
+     *
+     * If enabled, the output of each plugin is stored in resultCache() once the plugin is finished. If the same plugin binary is run again
+     * on an equal input with the same time limit, the cached output is used instead of running the plugin.
+     *
+     * \param enabled If set to true the result cache is enabled.
+     */
+    void setResultCacheEnabled(bool enabled = true);
+
+    /*!
+     * \brief Returns if the result cache is enabled.
+     * \return true if enabled.
+     */
+    bool isResultCacheEnabled() const;
+
+    /*!
+     * \brief Enables / disables improving cached results.
+     *
+     * If enabled, plugins with a cached output are run anyway unless the cached output already uses as few sheets as the lower bound
+     * allows and the objective is ScoredOutput::AverageUtilization. The cached output is reported as first output and kept unless the
+     * plugin finds a better one within the time limit.
+     *
+     * \param enabled If set to true cached results are improved.
+     */
+    void setCachedResultImprovementEnabled(bool enabled = true);
+
+    /*!
+     * \brief Returns if cached results are improved.
+     * \return true if enabled.
+     */
+    bool isCachedResultImprovementEnabled() const;
+
+    /*!
+     * \brief Enables / disables performance counters of plugins.
+     *
+     * If enabled, plugins running in an own process are asked to report their counters (see counters.h) when they finish. Plugins running
+     * in process count into the counters of the calling process instead.
+     *
+     * \param enabled If set to true plugins report their counters.
+     */
+    void setCountersEnabled(bool enabled = true);
+
+    /*!
+     * \brief Returns if plugins report their performance counters.
+     * \return true if enabled.
+     */
+    bool isCountersEnabled() const;
+
+    /*!
+     * \brief Returns the performance counters reported by the plugins of the last computation.
+     * \return Counter values by name for each plugin which reported counters.
+     */
+    QHash<QString, QHash<QString, quint64>> pluginCounters() const;
+
+    /*!
+     * \brief Returns the result cache.
+     * \return Result cache.
+     */
+    ResultCache *resultCache();
+
+    /*!
+     * \brief Enables / disables the portfolio mode.
+     *
+     * In portfolio mode plugins whose score stalls while they trail other plugins are terminated early and, if there are more running
+     * plugins than cores, the plugins with the lowest scores are paused. The policy can be configured through portfolio().
+     *
+     * \param enabled If set to true the portfolio mode is enabled.
+     */
+    void setPortfolioEnabled(bool enabled = true);
+
+    /*!
+     * \brief Returns if the portfolio mode is enabled.
+     * \return true if enabled.
+     */
+    bool isPortfolioEnabled() const;
+
+    /*!
+     * \brief Returns the portfolio of the current job. It also holds the score trajectories of the plugins.
+     * \return Plugin portfolio.
+     */
+    PluginPortfolio *portfolio();
+
+    /*!
+     * \brief Enables / disables stopping at the lower bound.
+     *
+     * If enabled, all plugins are terminated as soon as a valid output uses no more sheets than the lower bound of the input (see
+     * BakeryBounds::lowerBound(const PluginInput &)) plus the accepted slack. This is only done for ScoredOutput::AverageUtilization, since
+     * other objectives can still prefer a different output with the same number of sheets. Disabled by default.
+     *
+     * \param enabled If set to true plugins are stopped at the lower bound.
+     */
+    void setStopAtLowerBoundEnabled(bool enabled = true);
+
+    /*!
+     * \brief Returns if plugins are stopped at the lower bound.
+     * \return true if enabled.
+     */
+    bool isStopAtLowerBoundEnabled() const;
+
+    /*!
+     * \brief Sets the number of sheets above the lower bound at which plugins are stopped.
+     * \param sheets Number of sheets. Default: 0.
+     */
+    void setLowerBoundSlack(qint32 sheets);
+
+    /*!
+     * \brief Returns the number of sheets above the lower bound at which plugins are stopped.
+     * \return Number of sheets.
+     */
+    qint32 lowerBoundSlack() const;
+
+    /*!
+     * \brief Returns the lower bound of the input of the current or last job.
+     * \return Number of sheets.
+     */
+    qint32 lowerBound() const;
+
+    /*!
+     * \brief Sets if plugins are killed as soon as they send an invalid output.
+     *
+     * Outputs are validated incrementally while they arrive (see OutputValidator). The best valid output a plugin sent before is kept
+     * either way. Disabled by default.
+     *
+     * \param enabled If set to true plugins sending invalid outputs are killed.
+     */
+    void setKillInvalidPluginsEnabled(bool enabled = true);
+
+    /*!
+     * \brief Returns if plugins are killed as soon as they send an invalid output.
+     * \return true if enabled.
+     */
+    bool isKillInvalidPluginsEnabled() const;
+
+    /*!
+     * \brief Sets the objective outputs are ranked by, e.g. when choosing the best output or keeping the best output of a plugin.
+     * \param objective Objective. Default: ScoredOutput::AverageUtilization.
+     */
+    void setObjective(ScoredOutput::Objective objective);
+
+    /*!
+     * \brief Returns the objective outputs are ranked by.
+     * \return Objective.
+     */
+    ScoredOutput::Objective objective() const;
+
+    /*!
+     * \brief Sets the tolerance used to simplify input shapes before they are passed to plugins.
+     *
+     * Plugins pack shapes simplified by BakerySimplifier, which contain the original shapes. The original geometry is restored in the final
+     * outputs, while updates sent during the run contain the simplified shapes.
+     *
+     * \param tolerance Maximum distance between original and simplified outline. 0 disables the simplification (default).
+     */
+    void setSimplificationTolerance(qreal tolerance);
+
+    /*!
+     * \brief Returns the tolerance used to simplify input shapes.
+     * \return Tolerance. 0 if disabled.
+     */
+    qreal simplificationTolerance() const;
+
 private:
+    /*!
+     * \brief Constructor used by createJob(QObject *).
+     * \param prototype Bakery sharing plugins, worker pool and scheduler.
+     * \param parent QObject parent.
+     */
+    Bakery(const Bakery *prototype, QObject *parent);
+
+    /*!
+     * \brief Stores information about a plugin executable.
+     * \param path Path to plugin executable.
+     * \param meta Metadata of plugin.
+     * \return true if the name of the plugin is not in use.
+     */
+    bool registerPlugin(QString path, PluginMetadata meta);
+
+    /*!
+     * \brief Looks up the metadata of a plugin executable in the metadata cache.
+     * \param cache Metadata cache.
+     * \param path Path to plugin executable.
+     * \param meta Will be set to the cached metadata.
+     * \return true if the cache contains an entry matching the current size and modification time of the plugin.
+     */
+    static bool readMetadataCache(QSettings *cache, QString path, PluginMetadata &meta);
+
+    /*!
+     * \brief Stores the metadata of a plugin executable in the metadata cache.
+     * \param cache Metadata cache.
+     * \param path Path to plugin executable.
+     * \param meta Metadata of plugin.
+     */
+    static void writeMetadataCache(QSettings *cache, QString path, const PluginMetadata &meta);
+
+    /*!
+     * \brief Places the serialized input in _inputSegment or _stockInputSegment if not done yet.
+     * \param input PluginInput.
+     * \param shapeStock If true, the input is encoded as shape stock.
+     * \return Segment or NULL if it could not be created.
+     */
+    QSharedMemory *createInputSegment(const PluginInput &input, bool shapeStock);
+
     /*!
      * \brief Hash containing the metadata for all loaded plugins.
      */
@@ -325,12 +719,85 @@ private:
      */
     QHash<QString, QString> _pluginsPaths;
 
+    /*!
+     * \brief Hash containing the factories of all plugins loaded as library.
+     *
+     * Factories are owned by their QPluginLoader.
+     */
+    QHash<QString, PluginFactory *> _pluginsFactories;
+
+    /*!
+     * \brief Hash containing the location on the file system of all plugins loaded as library.
+     */
+    QHash<QString, QString> _pluginsLibraryPaths;
+
+    /*!
+     * \brief Pool of persistent plugin processes. Only used if the worker pool is enabled.
+     */
+    PluginProcessPool *_processPool;
+
+    /*!
+     * \brief Scheduler of plugin runners.
+     */
+    PluginScheduler *_scheduler;
+
+    /*!
+     * \brief Cache of plugin outputs. Only used if the result cache is enabled.
+     */
+    ResultCache *_resultCache;
+
+    /*!
+     * \brief Result cache keys of the plugins of the current job.
+     */
+    QHash<QString, QString> _resultCacheKeys;
+
+    /*!
+     * \brief Cached outputs of plugins which are run to improve them.
+     */
+    QHash<QString, PluginOutput> _cachedOutputs;
+
+    /*!
+     * \brief Portfolio of the current job. Only used if the portfolio mode is enabled.
+     */
+    PluginPortfolio *_portfolio;
+
+    /*!
+     * \brief Lower bound of the input of the current job.
+     */
+    qint32 _lowerBound;
+
+    /*!
+     * \brief Name of the plugin which reached the lower bound in the current job. Empty if the bound has not been reached.
+     */
+    QString _lowerBoundPlugin;
+
+    /*!
+     * \brief Validators of the outputs of all running plugins of the current job.
+     */
+    QHash<QString, OutputValidator> _validators;
+
+    /*!
+     * \brief Original input of the current job if its shapes are simplified. Contains no shapes otherwise.
+     */
+    PluginInput _originalInput;
+
+    /*!
+     * \brief Shared memory segment containing the serialized input of the current job. NULL if shared memory is not used.
+     */
+    QSharedMemory *_inputSegment;
+
+    /*!
+     * \brief Shared memory segment containing the input of the current job encoded as shape stock. NULL if no plugin reads this
+     * encoding through shared memory.
+     */
+    QSharedMemory *_stockInputSegment;
+
     /*!
      * \brief Hash containing all PluginRunners.
      *
      * Runners need to be cached in class because of non blocking mode.
      */
-    QHash<QString, PluginRunner *> _pluginsRunners;
+    QHash<QString, AbstractPluginRunner *> _pluginsRunners;
 
     /*!
      * \brief Hash containing the last valid output of a plugin.
@@ -339,10 +806,15 @@ private:
      */
     QHash<QString, PluginOutput> _validOutputs;
 
+    /*!
+     * \brief Hash containing the performance counters reported by each plugin.
+     */
+    QHash<QString, QHash<QString, quint64>> _pluginCounters;
+
     /*!
      * \brief Hash containing current settings.
      *
-     * Right now the only setting is the status of the plugins (enabled/disabled). Additional settings may be saved later.
+     * Contains the status of the plugins (enabled/disabled) and the run properties.
      */
     QHash<QString, QVariant> _settings;
 
@@ -363,6 +835,30 @@ private slots:
      */
     void _pluginFinished(int exitCode, QString pluginName, PluginInput pluginInput, PluginOutput pluginOutput);
 
+    /*!
+     * \brief Slot which is called when the scheduler allows a runner to start. Runners of other Bakery instances are ignored.
+     * \param runner Runner.
+     */
+    void _runnerReady(AbstractPluginRunner *runner);
+
+    /*!
+     * \brief Slot which is called when the portfolio asks to pause a plugin.
+     * \param pluginName Name of plugin.
+     */
+    void _portfolioPause(QString pluginName);
+
+    /*!
+     * \brief Slot which is called when the portfolio asks to resume a plugin.
+     * \param pluginName Name of plugin.
+     */
+    void _portfolioResume(QString pluginName);
+
+    /*!
+     * \brief Slot which is called when the portfolio asks to terminate a plugin.
+     * \param pluginName Name of plugin.
+     */
+    void _portfolioTerminate(QString pluginName);
+
 signals:
     /*!
      * \brief Signal emitted when a plugin is started.
@@ -370,6 +866,13 @@ signals:
      */
     void pluginStarting(QString uniqueName);
 
+    /*!
+     * \brief Signal emitted when a plugin finds an output reaching the lower bound. All plugins are terminated afterwards.
+     * \param uniqueName Name of plugin.
+     * \param sheets Number of sheets of the output.
+     */
+    void lowerBoundReached(QString uniqueName, qint32 sheets);
+
     /*!
      * \brief Signal emitted when a plugin sends a new output.
      * \param uniqueName Name of plugin.
@@ -377,6 +880,13 @@ signals:
      */
     void pluginOutputUpdated(QString uniqueName, PluginOutput pluginOutput);
 
+    /*!
+     * \brief Signal emitted when a plugin sends an invalid output.
+     * \param uniqueName Name of plugin.
+     * \param error Reason the output is invalid.
+     */
+    void pluginOutputInvalid(QString uniqueName, QString error);
+
     /*!
      * \brief Signal emitted when a plugin will be terminated.
      * \param uniqueName Name of plugin.
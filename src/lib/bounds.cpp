@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "bounds.h"
+
+#include <QtCore/qmath.h>
+#include <algorithm>
+#include <functional>
+
+qint32 BakeryBounds::areaBound(const PluginInput &input)
+{
+    qint64 sheetArea = qint64(input.sheetWidth) * input.sheetHeight;
+    const ShapeStock &stock = input.stock();
+    if (sheetArea <= 0 || stock.isEmpty())
+    {
+        return 0;
+    }
+    qint64 shapesArea = 0;
+    for (qint32 i_type = 0; i_type < stock.types(); ++i_type)
+    {
+        shapesArea += stock.prototype(i_type).area() * stock.count(i_type);
+    }
+    return qint32((shapesArea + sheetArea - 1) / sheetArea);
+}
+
+/*!
+ * \brief Returns the largest distance between two points of a shape. It does not change if the shape is rotated.
+ * \param shape Shape.
+ * \return Diameter.
+ */
+static qreal diameter(const Shape &shape)
+{
+    qreal diameter = 0;
+    for (qint32 i_first = 0; i_first < shape.size(); ++i_first)
+    {
+        for (qint32 i_second = i_first + 1; i_second < shape.size(); ++i_second)
+        {
+            QPoint difference = shape[i_first] - shape[i_second];
+            diameter = qMax(diameter, qSqrt(qreal(difference.x()) * difference.x() + qreal(difference.y()) * difference.y()));
+        }
+    }
+    return diameter;
+}
+
+qint32 BakeryBounds::largeItemBound(const PluginInput &input)
+{
+    qint64 sheetArea = qint64(input.sheetWidth) * input.sheetHeight;
+    const ShapeStock &stock = input.stock();
+    if (sheetArea <= 0 || stock.isEmpty())
+    {
+        return 0;
+    }
+
+    // Shapes which do not fit at all can not share a sheet with anything that fits
+    qreal diagonal = qSqrt(qreal(input.sheetWidth) * input.sheetWidth + qreal(input.sheetHeight) * input.sheetHeight);
+    qint32 oversized = 0;
+    QList<qint64> areas;
+    for (qint32 i_type = 0; i_type < stock.types(); ++i_type)
+    {
+        const Shape &shape = stock.prototype(i_type);
+        if (shape.area() > sheetArea || diameter(shape) > diagonal)
+        {
+            oversized += stock.count(i_type);
+            continue;
+        }
+        for (qint32 i_piece = 0; i_piece < stock.count(i_type); ++i_piece)
+        {
+            areas << shape.area();
+        }
+    }
+    if (areas.isEmpty())
+    {
+        return oversized;
+    }
+
+    // The largest shapes are pairwise incompatible as long as the two smallest of them do not fit together
+    std::sort(areas.begin(), areas.end(), std::greater<qint64>());
+    qint32 count = 1;
+    while (count < areas.size() && areas[count - 1] + areas[count] > sheetArea)
+    {
+        ++count;
+    }
+    return oversized + count;
+}
+
+qint32 BakeryBounds::lowerBound(const PluginInput &input) { return qMax(areaBound(input), largeItemBound(input)); }
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAKERY_BOUNDS_H
+#define BAKERY_BOUNDS_H
+
+#include "global.h"
+#include "plugins.h"
+
+/*!
+ * \brief Lower bounds on the number of sheets needed for an input.
+ *
+ * Plugins may rotate shapes by arbitrary angles, so all bounds only rely on properties which do not depend on the orientation of a shape.
+ * Under ScoredOutput::AverageUtilization the score of a complete output only depends on its number of sheets, so no output can score
+ * better than one reaching the lower bound. Other objectives also rank outputs with the same number of sheets, there the bound only
+ * limits the number of sheets.
+ */
+namespace BakeryBounds
+{
+/*!
+ * \brief Returns the number of sheets needed to hold the total area of all shapes.
+ * \param input PluginInput.
+ * \return Number of sheets. 0 if the input contains no shapes or the sheet has no area.
+ */
+BAKERYSHARED_EXPORT qint32 areaBound(const PluginInput &input);
+
+/*!
+ * \brief Returns the size of the largest set of shapes of which no two fit on the same sheet.
+ *
+ * Two shapes can not share a sheet if their areas add up to more than the area of the sheet. Additionally each shape which does not fit
+ * on any sheet (its diameter exceeds the diagonal of the sheet or its area the area of the sheet) needs a sheet of its own.
+ *
+ * \param input PluginInput.
+ * \return Number of sheets. 0 if the input contains no shapes or the sheet has no area.
+ */
+BAKERYSHARED_EXPORT qint32 largeItemBound(const PluginInput &input);
+
+/*!
+ * \brief Returns the best lower bound, i.e. the maximum of all bounds.
+ * \param input PluginInput.
+ * \return Number of sheets.
+ */
+BAKERYSHARED_EXPORT qint32 lowerBound(const PluginInput &input);
+}
+
+#endif // BAKERY_BOUNDS_H
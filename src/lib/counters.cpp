@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "counters.h"
+
+#include <QAtomicInteger>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QTextStream>
+
+QAtomicInt BakeryCounters::enabledFlag(0);
+
+/*!
+ * \brief Counters of a single thread. Only the owning thread writes, other threads may read at any time.
+ */
+struct ThreadCounters
+{
+    /*!
+     * \brief Values of all counters.
+     */
+    QAtomicInteger<quint64> values[BakeryCounters::CounterCount];
+
+    /*!
+     * \brief Constructor. Registers the block so values() can find it.
+     */
+    ThreadCounters();
+
+    /*!
+     * \brief Destructor. Moves the values to the counters of finished threads.
+     */
+    ~ThreadCounters();
+};
+
+/*!
+ * \brief Protects threadCounters and finishedCounters.
+ */
+static QMutex countersMutex;
+
+/*!
+ * \brief Counter blocks of all running threads which have counted something.
+ */
+static QList<ThreadCounters *> threadCounters;
+
+/*!
+ * \brief Sum of the counters of all finished threads.
+ */
+static quint64 finishedCounters[BakeryCounters::CounterCount] = {0};
+
+ThreadCounters::ThreadCounters()
+{
+    QMutexLocker locker(&countersMutex);
+    threadCounters << this;
+}
+
+ThreadCounters::~ThreadCounters()
+{
+    QMutexLocker locker(&countersMutex);
+    threadCounters.removeOne(this);
+    for (qint32 i_counter = 0; i_counter < BakeryCounters::CounterCount; ++i_counter)
+    {
+        finishedCounters[i_counter] += values[i_counter].load();
+    }
+}
+
+/*!
+ * \brief Counters of the current thread. Created when a thread counts for the first time.
+ */
+static thread_local ThreadCounters currentCounters;
+
+void BakeryCounters::add(Counter counter, quint64 n)
+{
+    // Only this thread writes, so no atomic read-modify-write is needed
+    QAtomicInteger<quint64> &value = currentCounters.values[counter];
+    value.store(value.load() + n);
+}
+
+void BakeryCounters::setEnabled(bool enabled) { enabledFlag.store(enabled ? 1 : 0); }
+
+bool BakeryCounters::isEnabled() { return enabledFlag.load() != 0; }
+
+void BakeryCounters::reset()
+{
+    QMutexLocker locker(&countersMutex);
+    foreach (ThreadCounters *counters, threadCounters)
+    {
+        for (qint32 i_counter = 0; i_counter < CounterCount; ++i_counter)
+        {
+            counters->values[i_counter].store(0);
+        }
+    }
+    for (qint32 i_counter = 0; i_counter < CounterCount; ++i_counter)
+    {
+        finishedCounters[i_counter] = 0;
+    }
+}
+
+QString BakeryCounters::name(Counter counter)
+{
+    switch (counter)
+    {
+    case ShapeIntersects:
+        return "shape_intersects";
+    case BoundingBoxRejects:
+        return "bounding_box_rejects";
+    case ExactTests:
+        return "exact_tests";
+    case SheetMayPlace:
+        return "sheet_may_place";
+    case ShapeCopies:
+        return "shape_copies";
+    case UpdateMetrics:
+        return "update_metrics";
+    case BytesSerialized:
+        return "bytes_serialized";
+    default:
+        return QString();
+    }
+}
+
+QHash<QString, quint64> BakeryCounters::values()
+{
+    quint64 sums[CounterCount];
+    {
+        QMutexLocker locker(&countersMutex);
+        for (qint32 i_counter = 0; i_counter < CounterCount; ++i_counter)
+        {
+            sums[i_counter] = finishedCounters[i_counter];
+        }
+        foreach (ThreadCounters *counters, threadCounters)
+        {
+            for (qint32 i_counter = 0; i_counter < CounterCount; ++i_counter)
+            {
+                sums[i_counter] += counters->values[i_counter].load();
+            }
+        }
+    }
+
+    QHash<QString, quint64> result;
+    for (qint32 i_counter = 0; i_counter < CounterCount; ++i_counter)
+    {
+        result[name(Counter(i_counter))] = sums[i_counter];
+    }
+    return result;
+}
+
+QString BakeryCounters::serialize(const QHash<QString, quint64> &counters)
+{
+    QString data;
+    QTextStream stream(&data);
+    stream << "counters_begin " << counters.size() << " ";
+    for (QHash<QString, quint64>::ConstIterator i_counter = counters.constBegin(); i_counter != counters.constEnd(); ++i_counter)
+    {
+        stream << i_counter.key() << " " << i_counter.value() << " ";
+    }
+    stream << "counters_end ";
+    stream.flush();
+    return data;
+}
+
+QHash<QString, quint64> BakeryCounters::deserialize(const QByteArray &data, bool *ok)
+{
+    QHash<QString, quint64> counters;
+    if (ok != NULL)
+    {
+        *ok = false;
+    }
+
+    QList<QByteArray> tokens = data.simplified().split(' ');
+    bool valid;
+    qint32 size = tokens.size() >= 2 ? tokens[1].toInt(&valid) : -1;
+    if (tokens.size() < 2 || tokens.first() != "counters_begin" || !valid || size < 0 || tokens.size() != 2 * size + 3 ||
+        tokens.last() != "counters_end")
+    {
+        BAKERY_WARNING("Invalid counters");
+        return QHash<QString, quint64>();
+    }
+    for (qint32 i_counter = 0; i_counter < size; ++i_counter)
+    {
+        quint64 value = tokens[3 + 2 * i_counter].toULongLong(&valid);
+        if (!valid)
+        {
+            BAKERY_WARNING("Invalid counter value");
+            return QHash<QString, quint64>();
+        }
+        counters[QString::fromLatin1(tokens[2 + 2 * i_counter])] = value;
+    }
+
+    if (ok != NULL)
+    {
+        *ok = true;
+    }
+    return counters;
+}
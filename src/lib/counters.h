@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAKERY_COUNTERS_H
+#define BAKERY_COUNTERS_H
+
+#include "global.h"
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QString>
+
+/*!
+ * \brief Performance counters of the geometry and protocol hot paths.
+ *
+ * Counters are disabled by default. Then counting only costs a relaxed load of a flag. When enabled, every thread counts in a block of
+ * its own, so counting never contends. values() sums up the blocks of all threads, including threads which have already finished.
+ *
+ * Plugin processes count while the host has sent the command "enable_counters" and report the counters of a job after its final output
+ * (see FORMAT.txt).
+ */
+namespace BakeryCounters
+{
+/*!
+ * \brief Counted events.
+ */
+enum Counter
+{
+    /*!
+     * \brief Calls of Shape::intersects().
+     */
+    ShapeIntersects,
+
+    /*!
+     * \brief Calls of Shape::intersects() which were decided by the bounding rectangles.
+     */
+    BoundingBoxRejects,
+
+    /*!
+     * \brief Calls of Shape::intersects() which needed an exact polygon intersection.
+     */
+    ExactTests,
+
+    /*!
+     * \brief Calls of Sheet::mayPlace().
+     */
+    SheetMayPlace,
+
+    /*!
+     * \brief Copies of shapes.
+     */
+    ShapeCopies,
+
+    /*!
+     * \brief Computations of shape metrics.
+     */
+    UpdateMetrics,
+
+    /*!
+     * \brief Bytes written to the plugin protocol channels.
+     */
+    BytesSerialized,
+
+    /*!
+     * \brief Number of counters.
+     */
+    CounterCount
+};
+
+/*!
+ * \brief Flag checked by increment(). Use setEnabled() to change it.
+ */
+extern BAKERYSHARED_EXPORT QAtomicInt enabledFlag;
+
+/*!
+ * \brief Adds to a counter of the current thread regardless of the flag. Used by increment().
+ * \param counter Counter.
+ * \param n Amount.
+ */
+BAKERYSHARED_EXPORT void add(Counter counter, quint64 n);
+
+/*!
+ * \brief Adds to a counter of the current thread if counters are enabled.
+ * \param counter Counter.
+ * \param n Amount.
+ */
+inline void increment(Counter counter, quint64 n = 1)
+{
+    if (Q_UNLIKELY(enabledFlag.load() != 0))
+    {
+        add(counter, n);
+    }
+}
+
+/*!
+ * \brief Enables or disables counting in all threads. The counters keep their values.
+ * \param enabled If true, counting is enabled.
+ */
+BAKERYSHARED_EXPORT void setEnabled(bool enabled);
+
+/*!
+ * \brief Returns whether counting is enabled.
+ * \return true if enabled.
+ */
+BAKERYSHARED_EXPORT bool isEnabled();
+
+/*!
+ * \brief Sets all counters of all threads to zero.
+ */
+BAKERYSHARED_EXPORT void reset();
+
+/*!
+ * \brief Returns the name of a counter as used in the plugin protocol, e.g. "shape_intersects".
+ * \param counter Counter.
+ * \return Name.
+ */
+BAKERYSHARED_EXPORT QString name(Counter counter);
+
+/*!
+ * \brief Returns the sum of all threads of each counter by name.
+ * \return Values by name.
+ */
+BAKERYSHARED_EXPORT QHash<QString, quint64> values();
+
+/*!
+ * \brief Serializes counters as "counters_begin [num] ([name] [value])^num counters_end".
+ * \param counters Values by name. Names must not contain whitespace.
+ * \return Serialized counters.
+ */
+BAKERYSHARED_EXPORT QString serialize(const QHash<QString, quint64> &counters);
+
+/*!
+ * \brief Reads counters written by serialize().
+ * \param data Serialized counters.
+ * \param ok Will be set to true if no errors occur. Will be ignored if set to NULL.
+ * \return Values by name.
+ */
+BAKERYSHARED_EXPORT QHash<QString, quint64> deserialize(const QByteArray &data, bool *ok = NULL);
+}
+
+#endif // BAKERY_COUNTERS_H
@@ -23,6 +23,7 @@
 #include "global.h"
 
 #include "qmath.h"
+#include <QByteArray>
 #include <QVector>
 #include <QPoint>
 #include <QPointF>
@@ -59,6 +60,64 @@ inline qreal qrealRounded(qint32 i) { return ((qreal)i / BAKERY_PRECISION); }
  */
 inline qreal qrealRoundedLong(qint64 i) { return ((qreal)i / BAKERY_PRECISION); }
 
+/*!
+ * \brief Writes the real representation of an integer (see BAKERY_PRECISION) in fixed-point notation without trailing zeros.
+ *
+ * Unlike QString::number() or QTextStream the value is exact and no memory is allocated.
+ *
+ * \param i Integer.
+ * \param buffer Target buffer. Needs room for at least 32 characters.
+ * \return Number of characters written.
+ */
+inline qint32 formatPrecise(qint64 i, char *buffer)
+{
+    char *current = buffer;
+    quint64 magnitude = quint64(i);
+    if (i < 0)
+    {
+        *current++ = '-';
+        magnitude = ~magnitude + 1;
+    }
+    const quint64 precision = quint64(BAKERY_PRECISION);
+    quint64 integer = magnitude / precision;
+    quint64 fraction = magnitude % precision;
+
+    // Digits of the integer part are generated in reverse order
+    char digits[20];
+    qint32 count = 0;
+    do
+    {
+        digits[count++] = char('0' + integer % 10);
+        integer /= 10;
+    } while (integer > 0);
+    while (count > 0)
+    {
+        *current++ = digits[--count];
+    }
+
+    if (fraction > 0)
+    {
+        *current++ = '.';
+        for (quint64 scale = precision / 10; fraction > 0; scale /= 10)
+        {
+            *current++ = char('0' + fraction / scale);
+            fraction %= scale;
+        }
+    }
+    return qint32(current - buffer);
+}
+
+/*!
+ * \brief Appends the real representation of an integer (see BAKERY_PRECISION) to a buffer. See formatPrecise().
+ * \param buffer Target buffer.
+ * \param i Integer.
+ */
+inline void appendPrecise(QByteArray &buffer, qint64 i)
+{
+    char digits[32];
+    buffer.append(digits, formatPrecise(i, digits));
+}
+
 /*!
  * \brief Same as QPoint(qrealPrecise(p.x()), qrealPrecise(p.y())).
  * \param p Point.
@@ -247,6 +306,19 @@ inline int vectorOrientation(QPoint p, QPoint q, QPoint r)
     }
     return (v > 0) ? 1 : 2;
 }
+
+/*!
+ * \brief Convenience method to set the value of a bool pointer to value if not NULL.
+ * \param b bool pointer.
+ * \param value Target value.
+ */
+inline void setBool(bool *b, bool value)
+{
+    if (b != NULL)
+    {
+        *b = value;
+    }
+}
 }
 
 #endif // BAKERY_HELPERS_H
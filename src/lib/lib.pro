@@ -5,6 +5,8 @@
 TARGET = bakery
 TEMPLATE = lib
 
+QT += concurrent
+
 DEFINES += BAKERY_LIBRARY
 
 VERSION = 1.0.0
@@ -12,11 +14,35 @@ VERSION = 1.0.0
 SOURCES += bakery.cpp \
     shape.cpp \
     sheet.cpp \
-    plugins.cpp
+    plugins.cpp \
+    pluginpool.cpp \
+    pluginscheduler.cpp \
+    resultcache.cpp \
+    pluginportfolio.cpp \
+    bounds.cpp \
+    validator.cpp \
+    scoredoutput.cpp \
+    shapestock.cpp \
+    svgimport.cpp \
+    simplifier.cpp \
+    counters.cpp \
+    trace.cpp
 
 HEADERS += bakery.h \
     shape.h \
     sheet.h \
     plugins.h \
     global.h \
-    helpers.hpp
+    helpers.hpp \
+    pluginpool.h \
+    pluginscheduler.h \
+    resultcache.h \
+    pluginportfolio.h \
+    bounds.h \
+    validator.h \
+    scoredoutput.h \
+    shapestock.h \
+    svgimport.h \
+    simplifier.h \
+    counters.h \
+    trace.h
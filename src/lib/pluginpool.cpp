@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pluginpool.h"
+
+#include <QFile>
+#include <QTimer>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+PluginProcessPool::PluginProcessPool(QObject *parent)
+    : QObject(parent), _idleWorkers(), _jobs(), _baseMemory(), _poolSizes(), _poolSize(1), _maximumJobs(100), _maximumMemory(0),
+      _maximumMemoryGrowth(0)
+{
+}
+
+PluginProcessPool::~PluginProcessPool() { clear(); }
+
+QProcess *PluginProcessPool::acquire(QString pluginName, QString pluginPath)
+{
+    // Reuse idle worker
+    QList<QProcess *> &idle = _idleWorkers[pluginName];
+    while (!idle.isEmpty())
+    {
+        QProcess *process = idle.takeLast();
+        if (process->state() == QProcess::Running)
+        {
+            return process;
+        }
+        _jobs.remove(process);
+        _baseMemory.remove(process);
+        process->deleteLater();
+    }
+
+    // Start new worker
+    QProcess *process = new QProcess(this);
+    process->setReadChannel(QProcess::StandardOutput);
+    process->start(pluginPath);
+    if (!process->waitForStarted(5000))
+    {
+        BAKERY_CRITICAL(QString("Plugin process '%1' failed to start").arg(pluginPath));
+        delete process;
+        return NULL;
+    }
+    process->write("persistent \n");
+    _jobs[process] = 0;
+    return process;
+}
+
+void PluginProcessPool::release(QString pluginName, QProcess *process)
+{
+    if (process == NULL)
+    {
+        return;
+    }
+
+    qint32 jobs = _jobs.value(process, 0) + 1;
+    _jobs[process] = jobs;
+
+    if (process->state() != QProcess::Running)
+    {
+        _jobs.remove(process);
+        _baseMemory.remove(process);
+        process->deleteLater();
+        return;
+    }
+    if (_maximumJobs != 0 && jobs >= _maximumJobs)
+    {
+        BAKERY_DEBUG(QString("Retiring worker of plugin '%1' after %2 jobs").arg(pluginName).arg(jobs));
+        retire(process);
+        return;
+    }
+    if (_maximumMemory != 0 || _maximumMemoryGrowth != 0)
+    {
+        // The first job sets the baseline, later growth is most likely leaked
+        qint64 memory = residentMemory(process);
+        if (memory >= 0 && !_baseMemory.contains(process))
+        {
+            _baseMemory[process] = memory;
+        }
+        if (memory >= 0 && ((_maximumMemory != 0 && memory > _maximumMemory) ||
+                            (_maximumMemoryGrowth != 0 && memory - _baseMemory[process] > _maximumMemoryGrowth)))
+        {
+            BAKERY_DEBUG(QString("Retiring worker of plugin '%1' because of memory usage").arg(pluginName));
+            retire(process);
+            return;
+        }
+    }
+    if (_idleWorkers[pluginName].size() >= poolSize(pluginName))
+    {
+        retire(process);
+        return;
+    }
+
+    process->write("reset \n");
+    _idleWorkers[pluginName].append(process);
+}
+
+void PluginProcessPool::clear()
+{
+    foreach (QList<QProcess *> idle, _idleWorkers)
+    {
+        foreach (QProcess *process, idle)
+        {
+            retire(process);
+        }
+    }
+    _idleWorkers.clear();
+}
+
+void PluginProcessPool::setPoolSize(qint32 size) { _poolSize = qMax(size, 0); }
+
+void PluginProcessPool::setPoolSize(QString pluginName, qint32 size)
+{
+    if (size < 0)
+    {
+        _poolSizes.remove(pluginName);
+    }
+    else
+    {
+        _poolSizes[pluginName] = size;
+    }
+}
+
+qint32 PluginProcessPool::poolSize(QString pluginName) const { return _poolSizes.value(pluginName, _poolSize); }
+
+void PluginProcessPool::setMaximumJobs(qint32 jobs) { _maximumJobs = qMax(jobs, 0); }
+
+qint32 PluginProcessPool::maximumJobs() const { return _maximumJobs; }
+
+void PluginProcessPool::setMaximumMemory(qint64 bytes) { _maximumMemory = qMax(bytes, Q_INT64_C(0)); }
+
+qint64 PluginProcessPool::maximumMemory() const { return _maximumMemory; }
+
+void PluginProcessPool::setMaximumMemoryGrowth(qint64 bytes) { _maximumMemoryGrowth = qMax(bytes, Q_INT64_C(0)); }
+
+qint64 PluginProcessPool::maximumMemoryGrowth() const { return _maximumMemoryGrowth; }
+
+void PluginProcessPool::retire(QProcess *process)
+{
+    _jobs.remove(process);
+    _baseMemory.remove(process);
+    if (process->state() == QProcess::NotRunning)
+    {
+        process->deleteLater();
+        return;
+    }
+
+    // Plugins quit when their standard input is closed
+    connect(process, SIGNAL(finished(int)), process, SLOT(deleteLater()));
+    process->closeWriteChannel();
+    QTimer::singleShot(2000, process, SLOT(kill()));
+}
+
+qint64 PluginProcessPool::residentMemory(QProcess *process)
+{
+#ifdef Q_OS_UNIX
+    QFile statm(QString("/proc/%1/statm").arg(process->processId()));
+    if (!statm.open(QFile::ReadOnly))
+    {
+        return -1;
+    }
+    QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() < 2)
+    {
+        return -1;
+    }
+    bool ok;
+    qint64 pages = fields[1].toLongLong(&ok);
+    if (!ok)
+    {
+        return -1;
+    }
+    return pages * sysconf(_SC_PAGESIZE);
+#else
+    Q_UNUSED(process);
+    return -1;
+#endif
+}
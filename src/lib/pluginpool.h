@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAKERY_PLUGINPOOL_H
+#define BAKERY_PLUGINPOOL_H
+
+#include "global.h"
+
+#include <QObject>
+#include <QProcess>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+/*!
+ * \brief Pool of persistent plugin processes.
+ *
+ * Instead of starting a new process for every job, plugin processes are put into persistent mode (command "persistent") and accept
+ * several "bake_sheets" commands one after another. Between two jobs the command "reset" is sent. Workers are retired after a given
+ * number of jobs or if their resident memory exceeds a given limit. Retired workers are asked to quit by closing their standard input.
+ */
+class BAKERYSHARED_EXPORT PluginProcessPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief Constructor.
+     * \param parent QObject parent.
+     */
+    explicit PluginProcessPool(QObject *parent = 0);
+
+    /*!
+     * \brief Destructor. Retires all idle workers.
+     */
+    ~PluginProcessPool();
+
+    /*!
+     * \brief Returns an idle worker for the given plugin or starts a new one. The worker is owned by the pool.
+     * \param pluginName Name of the plugin.
+     * \param pluginPath Path to the plugin executable.
+     * \return Worker process or NULL if no worker could be started.
+     */
+    QProcess *acquire(QString pluginName, QString pluginPath);
+
+    /*!
+     * \brief Returns a worker to the pool after a job is finished.
+     *
+     * The worker is retired if it is not running any more, if it has reached the maximum number of jobs or memory or if the pool of the
+     * plugin is full. Otherwise it is reset and kept for the next job.
+     *
+     * \param pluginName Name of the plugin.
+     * \param process Worker process returned by acquire(QString, QString).
+     */
+    void release(QString pluginName, QProcess *process);
+
+    /*!
+     * \brief Retires all idle workers.
+     */
+    void clear();
+
+    /*!
+     * \brief Sets the number of idle workers kept per plugin for plugins without an individual pool size.
+     * \param size Number of workers.
+     */
+    void setPoolSize(qint32 size);
+
+    /*!
+     * \brief Sets the number of idle workers kept for a single plugin.
+     * \param pluginName Name of the plugin.
+     * \param size Number of workers. If negative, the default pool size is used.
+     */
+    void setPoolSize(QString pluginName, qint32 size);
+
+    /*!
+     * \brief Returns the number of idle workers kept for a plugin.
+     * \param pluginName Name of the plugin. If empty, the default pool size is returned.
+     * \return Number of workers.
+     */
+    qint32 poolSize(QString pluginName = QString()) const;
+
+    /*!
+     * \brief Sets the number of jobs after which a worker is retired.
+     * \param jobs Number of jobs. If set to 0 workers are never retired because of the number of jobs.
+     */
+    void setMaximumJobs(qint32 jobs);
+
+    /*!
+     * \brief Returns the number of jobs after which a worker is retired.
+     * \return Number of jobs.
+     */
+    qint32 maximumJobs() const;
+
+    /*!
+     * \brief Sets the resident memory above which a worker is retired after its job.
+     *
+     * This is a hard cap independent of the plugin. Use setMaximumMemoryGrowth(qint64) to recycle leaking workers. Memory is only
+     * checked on systems providing /proc.
+     *
+     * \param bytes Memory in bytes. If set to 0 memory is not checked.
+     */
+    void setMaximumMemory(qint64 bytes);
+
+    /*!
+     * \brief Returns the resident memory above which a worker is retired after its job.
+     * \return Memory in bytes.
+     */
+    qint64 maximumMemory() const;
+
+    /*!
+     * \brief Sets by how much the resident memory of a worker may grow before it is retired after its job.
+     *
+     * The growth is measured against the resident memory after the first job of the worker, so leaking workers are recycled
+     * independent of how much memory the plugin needs for a single job. Memory is only checked on systems providing /proc.
+     *
+     * \param bytes Memory in bytes. If set to 0 the growth is not checked.
+     */
+    void setMaximumMemoryGrowth(qint64 bytes);
+
+    /*!
+     * \brief Returns by how much the resident memory of a worker may grow before it is retired after its job.
+     * \return Memory in bytes.
+     */
+    qint64 maximumMemoryGrowth() const;
+
+private:
+    /*!
+     * \brief Idle workers of each plugin.
+     */
+    QHash<QString, QList<QProcess *>> _idleWorkers;
+
+    /*!
+     * \brief Number of finished jobs of each worker.
+     */
+    QHash<QProcess *, qint32> _jobs;
+
+    /*!
+     * \brief Resident memory of each worker after its first job.
+     */
+    QHash<QProcess *, qint64> _baseMemory;
+
+    /*!
+     * \brief Individual pool sizes.
+     */
+    QHash<QString, qint32> _poolSizes;
+
+    /*!
+     * \brief Default pool size.
+     */
+    qint32 _poolSize;
+
+    /*!
+     * \brief Maximum number of jobs per worker.
+     */
+    qint32 _maximumJobs;
+
+    /*!
+     * \brief Maximum resident memory per worker.
+     */
+    qint64 _maximumMemory;
+
+    /*!
+     * \brief Maximum growth of the resident memory per worker.
+     */
+    qint64 _maximumMemoryGrowth;
+
+    /*!
+     * \brief Asks a worker to quit and deletes it once it has finished.
+     * \param process Worker.
+     */
+    void retire(QProcess *process);
+
+    /*!
+     * \brief Returns the resident memory of a process.
+     * \param process Process.
+     * \return Memory in bytes or -1 if not available.
+     */
+    static qint64 residentMemory(QProcess *process);
+};
+
+#endif // BAKERY_PLUGINPOOL_H
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pluginportfolio.h"
+#include "plugins.h"
+
+#include <QStringList>
+#include <QThread>
+#include <algorithm>
+
+/*!
+ * \brief Compares two scores under an objective (see ScoredOutput).
+ * \param score Primary score.
+ * \param secondaryScore Secondary score.
+ * \param otherScore Primary score to compare against.
+ * \param otherSecondaryScore Secondary score to compare against.
+ * \return true if the first score is better.
+ */
+static bool isBetterScore(qreal score, qreal secondaryScore, qreal otherScore, qreal otherSecondaryScore)
+{
+    return score > otherScore || (score == otherScore && secondaryScore > otherSecondaryScore);
+}
+
+PluginPortfolio::PluginPortfolio(QObject *parent)
+    : QObject(parent), _plugins(), _cores(qMax(QThread::idealThreadCount(), 1)), _stallTime(0), _timeLimit(0), _start(0), _timer(this)
+{
+    _timer.setInterval(200);
+    connect(&_timer, SIGNAL(timeout()), this, SLOT(timeout()));
+}
+
+void PluginPortfolio::setCores(qint32 cores) { _cores = qMax(cores, 1); }
+
+qint32 PluginPortfolio::cores() const { return _cores; }
+
+void PluginPortfolio::setStallTime(qint64 msec) { _stallTime = qMax(msec, Q_INT64_C(0)); }
+
+qint64 PluginPortfolio::stallTime() const { return _stallTime; }
+
+void PluginPortfolio::start(qint32 timeLimit)
+{
+    _plugins.clear();
+    _timeLimit = timeLimit;
+    _start = PluginDeadline::now();
+    _timer.start();
+}
+
+void PluginPortfolio::stop() { _timer.stop(); }
+
+void PluginPortfolio::pluginStarted(QString pluginName, bool pausable, qint64 time)
+{
+    time = currentTime(time);
+    PluginState state;
+    state.started = time;
+    state.lastImprovement = time;
+    state.score = 0;
+    state.secondaryScore = 0;
+    state.pausable = pausable;
+    state.paused = false;
+    state.done = false;
+    _plugins[pluginName] = state;
+}
+
+void PluginPortfolio::pluginOutputUpdated(QString pluginName, const ScoredOutput &output, qint64 time)
+{
+    pluginOutputUpdated(pluginName, output.score(), output.secondaryScore(), time);
+}
+
+void PluginPortfolio::pluginOutputUpdated(QString pluginName, qreal score, qreal secondaryScore, qint64 time)
+{
+    if (!_plugins.contains(pluginName))
+    {
+        return;
+    }
+    time = currentTime(time);
+    PluginState &state = _plugins[pluginName];
+    if (state.trajectory.isEmpty() || isBetterScore(score, secondaryScore, state.score, state.secondaryScore))
+    {
+        state.score = score;
+        state.secondaryScore = secondaryScore;
+        state.lastImprovement = time;
+    }
+    state.trajectory << qMakePair(time, score);
+}
+
+void PluginPortfolio::pluginFinished(QString pluginName)
+{
+    if (_plugins.contains(pluginName))
+    {
+        _plugins[pluginName].done = true;
+        _plugins[pluginName].paused = false;
+    }
+}
+
+QList<QPair<qint64, qreal>> PluginPortfolio::trajectory(QString pluginName) const { return _plugins.value(pluginName).trajectory; }
+
+void PluginPortfolio::evaluate(qint64 time)
+{
+    time = currentTime(time);
+    qint64 stallTime = effectiveStallTime();
+    PluginState leader = PluginState();
+    foreach (const PluginState &state, _plugins)
+    {
+        if (isBetter(state, leader))
+        {
+            leader = state;
+        }
+    }
+
+    // Plugins are handled in a fixed order, so decisions do not depend on the layout of the hash
+    QStringList names = _plugins.keys();
+    std::sort(names.begin(), names.end());
+
+    // Plugins which stopped improving and can not catch up any more are not worth their CPU time
+    QStringList active;
+    QStringList paused;
+    foreach (QString pluginName, names)
+    {
+        PluginState &state = _plugins[pluginName];
+        if (state.done)
+        {
+            continue;
+        }
+        if (state.paused)
+        {
+            paused << pluginName;
+            continue;
+        }
+        // Plugins which have not sent a complete output yet are still building their first solution
+        if (!state.trajectory.isEmpty() && time - state.lastImprovement >= stallTime && isBetter(leader, state))
+        {
+            state.done = true;
+            emit terminateRequested(pluginName);
+            continue;
+        }
+        active << pluginName;
+    }
+
+    // Leading plugins get the cores if there are not enough for everybody
+    if (active.size() > _cores)
+    {
+        QStringList candidates;
+        foreach (QString pluginName, active)
+        {
+            if (_plugins[pluginName].pausable)
+            {
+                candidates << pluginName;
+            }
+        }
+        std::stable_sort(candidates.begin(), candidates.end(), [this](const QString &left, const QString &right) {
+            const PluginState &l = _plugins[left];
+            const PluginState &r = _plugins[right];
+            return isBetter(r, l) || (!isBetter(l, r) && l.lastImprovement < r.lastImprovement);
+        });
+        for (qint32 i_pause = 0; i_pause < active.size() - _cores && i_pause < candidates.size(); ++i_pause)
+        {
+            _plugins[candidates[i_pause]].paused = true;
+            emit pauseRequested(candidates[i_pause]);
+        }
+    }
+    else if (active.size() < _cores && !paused.isEmpty())
+    {
+        std::stable_sort(paused.begin(), paused.end(),
+                         [this](const QString &left, const QString &right) { return isBetter(_plugins[left], _plugins[right]); });
+        for (qint32 i_resume = 0; i_resume < _cores - active.size() && i_resume < paused.size(); ++i_resume)
+        {
+            // Time spent paused does not count as stalling
+            PluginState &state = _plugins[paused[i_resume]];
+            state.paused = false;
+            state.lastImprovement = time;
+            emit resumeRequested(paused[i_resume]);
+        }
+    }
+}
+
+bool PluginPortfolio::isBetter(const PluginState &left, const PluginState &right)
+{
+    if (left.trajectory.isEmpty())
+    {
+        return false;
+    }
+    if (right.trajectory.isEmpty())
+    {
+        return true;
+    }
+    return isBetterScore(left.score, left.secondaryScore, right.score, right.secondaryScore);
+}
+
+qint64 PluginPortfolio::currentTime(qint64 time) const { return time < 0 ? PluginDeadline::now() - _start : time; }
+
+qint64 PluginPortfolio::effectiveStallTime() const
+{
+    if (_stallTime != 0)
+    {
+        return _stallTime;
+    }
+    return qMax(qint64(_timeLimit) / 5, Q_INT64_C(1000));
+}
+
+void PluginPortfolio::timeout() { evaluate(); }
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAKERY_PLUGINPORTFOLIO_H
+#define BAKERY_PLUGINPORTFOLIO_H
+
+#include "global.h"
+#include "scoredoutput.h"
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QTimer>
+
+/*!
+ * \brief Distributes CPU time between the plugins of a job based on their score trajectories.
+ *
+ * The portfolio records the score of each complete output of a plugin under the objective of the job (see ScoredOutput). A plugin
+ * which has sent a complete output but has not improved for the stall time while another plugin has a better score is terminated early.
+ * If more plugins are running than cores are available, the plugins with the lowest scores are paused until a core becomes free.
+ * Decisions are made periodically and reported through signals; the owner of the runners acts on them.
+ */
+class BAKERYSHARED_EXPORT PluginPortfolio : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief Constructor.
+     * \param parent QObject parent.
+     */
+    explicit PluginPortfolio(QObject *parent = 0);
+
+    /*!
+     * \brief Sets the number of cores plugins may use at the same time. Default: QThread::idealThreadCount().
+     * \param cores Number of cores.
+     */
+    void setCores(qint32 cores);
+
+    /*!
+     * \brief Returns the number of cores plugins may use at the same time.
+     * \return Number of cores.
+     */
+    qint32 cores() const;
+
+    /*!
+     * \brief Sets the time without improvement after which a trailing plugin is terminated.
+     * \param msec Time in milliseconds. If set to 0 a fifth of the time limit is used, at least 1000 ms.
+     */
+    void setStallTime(qint64 msec);
+
+    /*!
+     * \brief Returns the time without improvement after which a trailing plugin is terminated.
+     * \return Time in milliseconds. 0 if derived from the time limit.
+     */
+    qint64 stallTime() const;
+
+    /*!
+     * \brief Clears all trajectories and starts periodic decisions.
+     * \param timeLimit Time limit of the job in milliseconds. 0 if there is none.
+     */
+    void start(qint32 timeLimit);
+
+    /*!
+     * \brief Stops periodic decisions.
+     */
+    void stop();
+
+    /*!
+     * \brief Records that a plugin has started.
+     * \param pluginName Name of the plugin.
+     * \param pausable True if the plugin can be paused.
+     * \param time Time in milliseconds since start(qint32). If negative, the current time is used.
+     */
+    void pluginStarted(QString pluginName, bool pausable, qint64 time = -1);
+
+    /*!
+     * \brief Records the score of a complete output.
+     * \param pluginName Name of the plugin.
+     * \param output Output scored under the objective of the job.
+     * \param time Time in milliseconds since start(qint32). If negative, the current time is used.
+     */
+    void pluginOutputUpdated(QString pluginName, const ScoredOutput &output, qint64 time = -1);
+
+    /*!
+     * \brief Records the score of a complete output.
+     * \param pluginName Name of the plugin.
+     * \param score Primary score (see ScoredOutput::score()). Higher is better.
+     * \param secondaryScore Score which decides between equal primary scores (see ScoredOutput::secondaryScore()).
+     * \param time Time in milliseconds since start(qint32). If negative, the current time is used.
+     */
+    void pluginOutputUpdated(QString pluginName, qreal score, qreal secondaryScore, qint64 time = -1);
+
+    /*!
+     * \brief Records that a plugin has finished. Its score still counts when other plugins are compared.
+     * \param pluginName Name of the plugin.
+     */
+    void pluginFinished(QString pluginName);
+
+    /*!
+     * \brief Returns the score trajectory of a plugin.
+     * \param pluginName Name of the plugin.
+     * \return Pairs of time in milliseconds since start(qint32) and primary score.
+     */
+    QList<QPair<qint64, qreal>> trajectory(QString pluginName) const;
+
+    /*!
+     * \brief Makes decisions for the current state. Is called periodically after start(qint32).
+     * \param time Time in milliseconds since start(qint32). If negative, the current time is used.
+     */
+    void evaluate(qint64 time = -1);
+
+signals:
+    /*!
+     * \brief Is emitted if a plugin should be paused.
+     * \param pluginName Name of the plugin.
+     */
+    void pauseRequested(QString pluginName);
+
+    /*!
+     * \brief Is emitted if a paused plugin should be resumed.
+     * \param pluginName Name of the plugin.
+     */
+    void resumeRequested(QString pluginName);
+
+    /*!
+     * \brief Is emitted if a plugin should be terminated.
+     * \param pluginName Name of the plugin.
+     */
+    void terminateRequested(QString pluginName);
+
+private:
+    /*!
+     * \brief State of a single plugin.
+     */
+    struct PluginState
+    {
+        /*!
+         * \brief Time the plugin was started.
+         */
+        qint64 started;
+
+        /*!
+         * \brief Time of the last improvement or of resuming the plugin.
+         */
+        qint64 lastImprovement;
+
+        /*!
+         * \brief Primary score of the best output so far.
+         */
+        qreal score;
+
+        /*!
+         * \brief Secondary score of the best output so far.
+         */
+        qreal secondaryScore;
+
+        /*!
+         * \brief True if the plugin can be paused.
+         */
+        bool pausable;
+
+        /*!
+         * \brief True if the plugin is paused.
+         */
+        bool paused;
+
+        /*!
+         * \brief True if the plugin is finished or has been asked to terminate.
+         */
+        bool done;
+
+        /*!
+         * \brief Score trajectory.
+         */
+        QList<QPair<qint64, qreal>> trajectory;
+    };
+
+    /*!
+     * \brief States of all plugins of the current job.
+     */
+    QHash<QString, PluginState> _plugins;
+
+    /*!
+     * \brief Number of cores.
+     */
+    qint32 _cores;
+
+    /*!
+     * \brief Configured stall time.
+     */
+    qint64 _stallTime;
+
+    /*!
+     * \brief Time limit of the current job.
+     */
+    qint32 _timeLimit;
+
+    /*!
+     * \brief Start of the current job on the monotonic clock (see PluginDeadline::now()).
+     */
+    qint64 _start;
+
+    /*!
+     * \brief Triggers evaluate(qint64).
+     */
+    QTimer _timer;
+
+    /*!
+     * \brief Returns if a plugin has a better score than another one. Plugins without a complete output have the lowest score.
+     * \param left State of the first plugin.
+     * \param right State of the second plugin.
+     * \return true if left is better than right.
+     */
+    static bool isBetter(const PluginState &left, const PluginState &right);
+
+    /*!
+     * \brief Returns the time since start(qint32) if time is negative.
+     * \param time Time in milliseconds.
+     * \return Time in milliseconds since start(qint32).
+     */
+    qint64 currentTime(qint64 time) const;
+
+    /*!
+     * \brief Returns the stall time used for the current job.
+     * \return Time in milliseconds.
+     */
+    qint64 effectiveStallTime() const;
+
+private slots:
+    /*!
+     * \brief Is called by _timer.
+     */
+    void timeout();
+};
+
+#endif // BAKERY_PLUGINPORTFOLIO_H
@@ -20,14 +20,53 @@
 #include "plugins.h"
 #include "bakery.h"
 #include "helpers.hpp"
+#include "pluginpool.h"
+#include "counters.h"
 
 #include <QTextStream>
 #include <QTimer>
 #include <QProcess>
 #include <QTemporaryFile>
 #include <QCoreApplication>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QDir>
+#include <cctype>
+#include <cstring>
 
-QTextStream &operator<<(QTextStream &stream, const PluginInput &input)
+#ifdef Q_OS_UNIX
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <sched.h>
+#endif
+
+const ShapeStock &PluginInput::stock() const { return _stock; }
+
+void PluginInput::setStock(const ShapeStock &stock) { _stock = stock; }
+
+void PluginInput::addShape(const Shape &shape, qint32 count) { _stock.add(shape, count); }
+
+PluginInput &PluginInput::operator<<(const Shape &shape)
+{
+    _stock.add(shape);
+    return *this;
+}
+
+qint32 PluginInput::shapeCount() const { return _stock.total(); }
+
+QList<Shape> PluginInput::shapes() const { return _stock.toList(); }
+
+void PluginInput::setShapes(const QList<Shape> &shapes) { _stock = ShapeStock(shapes); }
+
+QTextStream &operator<<(QTextStream &stream, const PluginInput &input) { return BakeryPlugins::writePluginInput(stream, input, false); }
+
+QTextStream &BakeryPlugins::writePluginInput(QTextStream &stream, const PluginInput &input, bool shapeStock)
 {
     if (Q_UNLIKELY(stream.status() != QTextStream::Ok))
     {
@@ -41,15 +80,45 @@ QTextStream &operator<<(QTextStream &stream, const PluginInput &input)
     stream << " ";
     stream << input.sheetWidth << " ";
     stream << input.sheetHeight << " ";
-    stream << input.shapes.size() << " ";
-    stream << "shapelist_begin"
-           << " ";
-    for (QList<Shape>::ConstIterator i_shapes = input.shapes.constBegin(); i_shapes != input.shapes.constEnd(); ++i_shapes)
+    const ShapeStock &stock = input.stock();
+    stream << stock.total() << " ";
+
+    // Types are written once together with their number of pieces
+    if (shapeStock && stock.total() > stock.types())
     {
-        stream << *i_shapes;
+        qint32 runs = 0;
+        for (qint32 i_type = 0; i_type < stock.types(); ++i_type)
+        {
+            runs += stock.count(i_type) > 0 ? 1 : 0;
+        }
+        stream << "shapestock_begin"
+               << " ";
+        stream << runs << " ";
+        for (qint32 i_type = 0; i_type < stock.types(); ++i_type)
+        {
+            if (stock.count(i_type) > 0)
+            {
+                stream << stock.count(i_type) << " ";
+                stream << stock.prototype(i_type);
+            }
+        }
+        stream << "shapestock_end"
+               << " ";
+    }
+    else
+    {
+        stream << "shapelist_begin"
+               << " ";
+        for (qint32 i_type = 0; i_type < stock.types(); ++i_type)
+        {
+            for (qint32 i_piece = 0; i_piece < stock.count(i_type); ++i_piece)
+            {
+                stream << stock.prototype(i_type);
+            }
+        }
+        stream << "shapelist_end"
+               << " ";
     }
-    stream << "shapelist_end"
-           << " ";
     stream << "plugininput_end"
            << " ";
     return stream;
@@ -122,34 +191,82 @@ QTextStream &operator>>(QTextStream &stream, PluginInput &input)
         return stream;
     }
 
-    // Shapes list initialiser
+    // Shapes list or stock initialiser
     stream >> inputString;
-    if (inputString != "shapelist_begin")
+    input.setStock(ShapeStock());
+    if (inputString == "shapestock_begin")
     {
-        BAKERY_CRITICAL("Can not find shape list (missing initializer)");
-        stream.setStatus(QTextStream::ReadCorruptData);
-        return stream;
-    }
+        // Runs of identical shapes
+        stream >> inputString;
+        qint32 numRuns = inputString.toInt(&ok);
+        if (Q_UNLIKELY(!ok || numRuns < 0))
+        {
+            BAKERY_CRITICAL("Can not read number of shape runs");
+            stream.setStatus(QTextStream::ReadCorruptData);
+            return stream;
+        }
+        for (qint32 i = 0; i < numRuns; ++i)
+        {
+            stream >> inputString;
+            qint32 run = inputString.toInt(&ok);
+            if (Q_UNLIKELY(!ok || run < 0 || run > numShapes - input.shapeCount()))
+            {
+                BAKERY_CRITICAL("Can not read length of shape run" << (i + 1));
+                stream.setStatus(QTextStream::ReadCorruptData);
+                return stream;
+            }
+            Shape shape;
+            stream >> shape;
+            if (stream.status() != QTextStream::Ok)
+            {
+                BAKERY_CRITICAL("Can not read shape run" << (i + 1));
+                return stream;
+            }
+            input.addShape(shape, run);
+        }
+        if (input.shapeCount() != numShapes)
+        {
+            BAKERY_CRITICAL("Number of shapes in shape stock does not match");
+            stream.setStatus(QTextStream::ReadCorruptData);
+            return stream;
+        }
 
-    // Read shapes
-    input.shapes.clear();
-    for (qint32 i = 0; i < numShapes; ++i)
-    {
-        Shape shape;
-        stream >> shape;
-        if (stream.status() != QTextStream::Ok)
+        // Shape stock finalizer
+        stream >> inputString;
+        if (inputString != "shapestock_end")
         {
-            BAKERY_CRITICAL("Can not read shape" << (i + 1));
+            BAKERY_CRITICAL("Can not find shape stock (missing finalizer)");
+            stream.setStatus(QTextStream::ReadCorruptData);
             return stream;
         }
-        input.shapes << shape;
     }
+    else if (inputString == "shapelist_begin")
+    {
+        // Read shapes
+        for (qint32 i = 0; i < numShapes; ++i)
+        {
+            Shape shape;
+            stream >> shape;
+            if (stream.status() != QTextStream::Ok)
+            {
+                BAKERY_CRITICAL("Can not read shape" << (i + 1));
+                return stream;
+            }
+            input.addShape(shape);
+        }
 
-    // Shapes list finalizer
-    stream >> inputString;
-    if (inputString != "shapelist_end")
+        // Shapes list finalizer
+        stream >> inputString;
+        if (inputString != "shapelist_end")
+        {
+            BAKERY_CRITICAL("Can not find shape list (missing finalizer)");
+            stream.setStatus(QTextStream::ReadCorruptData);
+            return stream;
+        }
+    }
+    else
     {
-        BAKERY_CRITICAL("Can not find shape list (missing finalizer)");
+        BAKERY_CRITICAL("Can not find shape list (missing initializer)");
         stream.setStatus(QTextStream::ReadCorruptData);
         return stream;
     }
@@ -279,6 +396,18 @@ QTextStream &operator<<(QTextStream &stream, const PluginMetadata &meta)
     BakeryHelpers::writeText(stream, meta.type);
     BakeryHelpers::writeText(stream, meta.author);
     BakeryHelpers::writeText(stream, meta.license);
+    if (!meta.capabilities.isEmpty())
+    {
+        stream << "capabilities_begin"
+               << " ";
+        stream << meta.capabilities.size() << " ";
+        foreach (const QString &capability, meta.capabilities)
+        {
+            BakeryHelpers::writeText(stream, capability);
+        }
+        stream << "capabilities_end"
+               << " ";
+    }
     stream << "pluginmetadata_end"
            << " ";
 
@@ -341,8 +470,42 @@ QTextStream &operator>>(QTextStream &stream, PluginMetadata &meta)
         return stream;
     }
 
-    // PluginMetadata finalizer
+    // Capabilities are optional
+    meta.capabilities.clear();
     stream >> input;
+    if (input == "capabilities_begin")
+    {
+        stream >> input;
+        qint32 numCapabilities = input.toInt(&ok);
+        if (Q_UNLIKELY(!ok || numCapabilities < 0))
+        {
+            BAKERY_CRITICAL("Can not read number of capabilities");
+            stream.setStatus(QTextStream::ReadCorruptData);
+            return stream;
+        }
+        for (qint32 i = 0; i < numCapabilities; ++i)
+        {
+            meta.capabilities << BakeryHelpers::readText(stream, &ok);
+            if (Q_UNLIKELY(!ok))
+            {
+                BAKERY_CRITICAL("Can not read capability" << (i + 1));
+                stream.setStatus(QTextStream::ReadCorruptData);
+                return stream;
+            }
+        }
+
+        // Capabilities finalizer
+        stream >> input;
+        if (input != "capabilities_end")
+        {
+            BAKERY_CRITICAL("Can not find capabilities (missing finalizer)");
+            stream.setStatus(QTextStream::ReadCorruptData);
+            return stream;
+        }
+        stream >> input;
+    }
+
+    // PluginMetadata finalizer
     if (input != "pluginmetadata_end")
     {
         BAKERY_CRITICAL("Trying to deserialize a non-PluginMetadata into a PluginMetadata (missing finalizer)");
@@ -365,7 +528,7 @@ bool operator==(const PluginInput &left, const PluginInput &right)
         return false;
     }
 
-    return left.shapes == right.shapes;
+    return left.stock() == right.stock();
 }
 
 bool operator==(const PluginOutput &left, const PluginOutput &right) { return left.sheets == right.sheets; }
@@ -405,35 +568,388 @@ qreal BakeryPlugins::outputScore(const PluginOutput &output)
     return utilitization * 100 / output.sheets.size();
 }
 
+bool BakeryPlugins::deadlineReached(qreal fraction)
+{
+    PluginDeadline *deadline = PluginDeadline::current();
+    return deadline != NULL && deadline->reached(fraction);
+}
+
+qint64 BakeryPlugins::remainingTime()
+{
+    PluginDeadline *deadline = PluginDeadline::current();
+    return deadline != NULL ? deadline->remainingTime() : -1;
+}
+
+/*!
+ * \brief Thread budget of the job running in the current thread.
+ */
+static thread_local qint32 currentThreadBudget = 0;
+
+qint32 BakeryPlugins::threadBudget() { return currentThreadBudget > 0 ? currentThreadBudget : QThread::idealThreadCount(); }
+
+void BakeryPlugins::setThreadBudget(qint32 threads) { currentThreadBudget = qMax(threads, 0); }
+
+bool BakeryPlugins::setCpuAffinity(qint64 pid, const QList<qint32> &cpus, bool allThreads)
+{
+#ifdef Q_OS_LINUX
+    if (cpus.isEmpty())
+    {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    foreach (qint32 cpu, cpus)
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+
+    // sched_setaffinity only affects a single thread, threads which already exist have to be pinned one by one
+    QList<qint64> threads;
+    if (allThreads && pid != 0)
+    {
+        foreach (QString task, QDir(QString("/proc/%1/task").arg(pid)).entryList(QDir::Dirs | QDir::NoDotAndDotDot))
+        {
+            threads << task.toLongLong();
+        }
+    }
+    if (threads.isEmpty())
+    {
+        threads << pid;
+    }
+    bool result = true;
+    foreach (qint64 thread, threads)
+    {
+        if (sched_setaffinity(pid_t(thread), sizeof(set), &set) != 0)
+        {
+            BAKERY_DEBUG(QString("Could not set CPU affinity of %1: %2").arg(thread).arg(strerror(errno)));
+            result = false;
+        }
+    }
+    return result;
+#else
+    Q_UNUSED(pid);
+    Q_UNUSED(cpus);
+    Q_UNUSED(allThreads);
+    return false;
+#endif
+}
+
+QString BakeryPlugins::uniqueSharedMemoryKey()
+{
+    static QAtomicInt counter(0);
+    return QString("bakery_%1_%2").arg(QCoreApplication::applicationPid()).arg(counter.fetchAndAddOrdered(1));
+}
+
+bool BakeryPlugins::writeSharedMemory(QSharedMemory *segment, const QByteArray &data)
+{
+    qint64 length = data.size();
+    if (segment->data() == NULL || qint64(sizeof(length)) + length > segment->size())
+    {
+        return false;
+    }
+    BakeryCounters::increment(BakeryCounters::BytesSerialized, quint64(length));
+    segment->lock();
+    char *target = static_cast<char *>(segment->data());
+    memcpy(target, &length, sizeof(length));
+    memcpy(target + sizeof(length), data.constData(), length);
+    segment->unlock();
+    return true;
+}
+
+QByteArray BakeryPlugins::readSharedMemory(QSharedMemory *segment, bool *ok)
+{
+    if (ok != NULL)
+    {
+        *ok = false;
+    }
+    if (segment->constData() == NULL || segment->size() < qint32(sizeof(qint64)))
+    {
+        return QByteArray();
+    }
+    segment->lock();
+    const char *source = static_cast<const char *>(segment->constData());
+    qint64 length;
+    memcpy(&length, source, sizeof(length));
+    QByteArray data;
+    if (length >= 0 && qint64(sizeof(length)) + length <= segment->size())
+    {
+        data = QByteArray(source + sizeof(length), length);
+        if (ok != NULL)
+        {
+            *ok = true;
+        }
+    }
+    segment->unlock();
+    return data;
+}
+
 bool operator<(const PluginOutput &left, const PluginOutput &right)
 {
-    return BakeryPlugins::outputScore(left) <= BakeryPlugins::outputScore(right);
+    return BakeryPlugins::outputScore(left) < BakeryPlugins::outputScore(right);
 }
 
-StandardInputReader::StandardInputReader(QObject *parent) : QThread(parent) {}
+/*!
+ * \brief Checks if a line only consists of whitespace.
+ * \param data Line data.
+ * \param size Line length.
+ * \return true if the line is blank.
+ */
+static bool isBlank(const char *data, qint32 size)
+{
+    for (qint32 i = 0; i < size; ++i)
+    {
+        if (!isspace((unsigned char)data[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+StandardInputReader::StandardInputReader(QObject *parent) : QThread(parent)
+{
+#ifdef Q_OS_UNIX
+    if (::pipe(_wakeUpPipe) != 0)
+    {
+        BAKERY_WARNING("Could not create wake up pipe");
+        _wakeUpPipe[0] = -1;
+        _wakeUpPipe[1] = -1;
+    }
+#endif
+}
+
+StandardInputReader::~StandardInputReader()
+{
+    stop();
+#ifdef Q_OS_UNIX
+    if (_wakeUpPipe[0] != -1)
+    {
+        ::close(_wakeUpPipe[0]);
+        ::close(_wakeUpPipe[1]);
+    }
+#endif
+}
 
 void StandardInputReader::run()
 {
+    QByteArray buffer;
+
+#ifdef Q_OS_UNIX
+    QByteArray chunk(64 * 1024, Qt::Uninitialized);
+    while (!isInterruptionRequested())
+    {
+        // Sleep until there is input or stop() is called
+        struct pollfd descriptors[2];
+        descriptors[0].fd = STDIN_FILENO;
+        descriptors[0].events = POLLIN;
+        descriptors[0].revents = 0;
+        descriptors[1].fd = _wakeUpPipe[0];
+        descriptors[1].events = POLLIN;
+        descriptors[1].revents = 0;
+        if (::poll(descriptors, _wakeUpPipe[0] != -1 ? 2 : 1, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            BAKERY_CRITICAL("Polling standard input failed");
+            break;
+        }
+        if (descriptors[1].revents != 0 || isInterruptionRequested())
+        {
+            return;
+        }
+        if (descriptors[0].revents == 0)
+        {
+            continue;
+        }
+
+        ssize_t bytesRead = ::read(STDIN_FILENO, chunk.data(), chunk.size());
+        if (bytesRead < 0 && (errno == EINTR || errno == EAGAIN))
+        {
+            continue;
+        }
+        if (bytesRead <= 0)
+        {
+            // End of file (or unrecoverable error)
+            break;
+        }
+
+        // Split lines; only the newly read part has to be searched for line breaks
+        qint32 searchFrom = buffer.size();
+        buffer.append(chunk.constData(), bytesRead);
+        qint32 lineStart = 0;
+        qint32 lineEnd;
+        while ((lineEnd = buffer.indexOf('\n', searchFrom)) != -1)
+        {
+            if (!isBlank(buffer.constData() + lineStart, lineEnd - lineStart))
+            {
+                emit read(buffer.mid(lineStart, lineEnd - lineStart));
+            }
+            lineStart = lineEnd + 1;
+            searchFrom = lineStart;
+        }
+        buffer.remove(0, lineStart);
+    }
+#else
     QFile standardInputFile;
     standardInputFile.open(stdin, QFile::ReadOnly);
-    forever
+    while (!isInterruptionRequested())
     {
+        // readLine() blocks until a line is available and only returns empty data on end of file or error
         QByteArray data = standardInputFile.readLine();
-        emit read(data);
+        if (data.isEmpty())
+        {
+            break;
+        }
+        if (!data.endsWith('\n'))
+        {
+            buffer.append(data);
+            continue;
+        }
+        data.chop(1);
+        buffer.append(data);
+        if (!isBlank(buffer.constData(), buffer.size()))
+        {
+            emit read(buffer);
+        }
+        buffer.clear();
+    }
+#endif
+
+    // A command that is not terminated by a line break is still delivered
+    if (!isBlank(buffer.constData(), buffer.size()))
+    {
+        emit read(buffer);
     }
+    emit endOfInput();
 }
 
-PluginWrapper::PluginWrapper(QObject *instance, QObject *parent) : QObject(parent), _instance(instance), _standardInputReader(this)
+void StandardInputReader::stop()
 {
+    if (!isRunning())
+    {
+        return;
+    }
+    requestInterruption();
+#ifdef Q_OS_UNIX
+    char wakeUp = 0;
+    if (_wakeUpPipe[1] != -1 && ::write(_wakeUpPipe[1], &wakeUp, 1) == 1)
+    {
+        wait();
+        return;
+    }
+
+    // Without the pipe the blocking read can not be interrupted either
+    terminate();
+    wait();
+#else
+    // The blocking read can not be interrupted portably
+    terminate();
+    wait();
+#endif
+}
+
+/*!
+ * \brief Deadline of the job running in the current thread.
+ */
+static thread_local PluginDeadline *currentDeadline = NULL;
+
+PluginDeadline::PluginDeadline() : _start(0), _deadline(0) {}
+
+void PluginDeadline::set(qint64 deadline)
+{
+    _start.storeRelease(now());
+    _deadline.storeRelease(deadline);
+}
+
+void PluginDeadline::tighten(qint64 deadline)
+{
+    qint64 current = _deadline.loadAcquire();
+    if (current == 0 || deadline < current)
+    {
+        set(deadline);
+    }
+}
+
+void PluginDeadline::clear() { _deadline.storeRelease(0); }
+
+qint64 PluginDeadline::deadline() const { return _deadline.loadAcquire(); }
+
+bool PluginDeadline::reached(qreal fraction) const
+{
+    qint64 deadline = _deadline.loadAcquire();
+    if (deadline == 0)
+    {
+        return false;
+    }
+    qint64 start = _start.loadAcquire();
+    return now() >= start + qint64((deadline - start) * fraction);
+}
+
+qint64 PluginDeadline::remainingTime() const
+{
+    qint64 deadline = _deadline.loadAcquire();
+    if (deadline == 0)
+    {
+        return -1;
+    }
+    return qMax(deadline - now(), Q_INT64_C(0));
+}
+
+qint64 PluginDeadline::now()
+{
+    QElapsedTimer timer;
+    timer.start();
+    return timer.msecsSinceReference();
+}
+
+PluginDeadline *PluginDeadline::current() { return currentDeadline; }
+
+void PluginDeadline::setCurrent(PluginDeadline *deadline) { currentDeadline = deadline; }
+
+PluginWrapper::PluginWrapper(QObject *instance, QObject *parent)
+    : QObject(parent), _instance(instance), _persistent(false), _outputSegment(), _deadline(), _standardInputReader(this)
+{
+    PluginDeadline::setCurrent(&_deadline);
     connect(this, SIGNAL(giveMetadata()), _instance, SLOT(giveMetadata()));
     connect(this, SIGNAL(bakeSheets(PluginInput)), _instance, SLOT(bakeSheets(PluginInput)));
     connect(this, SIGNAL(terminate(qint32)), _instance, SLOT(terminate(qint32)));
+    if (_instance->metaObject()->indexOfSlot("reset()") != -1)
+    {
+        connect(this, SIGNAL(reset()), _instance, SLOT(reset()));
+    }
+    connect(&_standardInputReader, SIGNAL(read(QByteArray)), this, SLOT(updateDeadline(QByteArray)), Qt::DirectConnection);
     connect(&_standardInputReader, SIGNAL(read(QByteArray)), this, SLOT(readFromStandardInput(QByteArray)));
+    connect(&_standardInputReader, SIGNAL(endOfInput()), this, SLOT(standardInputClosed()));
     connect(_instance, SIGNAL(metadataGiven(PluginMetadata)), this, SLOT(metadataGiven(PluginMetadata)));
     connect(_instance, SIGNAL(outputUpdated(PluginOutput)), this, SLOT(outputUpdated(PluginOutput)));
     connect(_instance, SIGNAL(finished(PluginOutput)), this, SLOT(finished(PluginOutput)));
 }
 
+/*!
+ * \brief Returns the value of a trailing job argument like "deadline 1234" of a bake_sheets command.
+ * \param data Command.
+ * \param name Name of the argument.
+ * \return Value or 0 if the argument is not present.
+ */
+static qint64 jobArgument(const QByteArray &data, const QByteArray &name)
+{
+    // The input itself may contain arbitrary tokens, only the part after it is searched
+    qint32 argumentsBegin = data.lastIndexOf("plugininput_end");
+    argumentsBegin = argumentsBegin == -1 ? data.indexOf(' ') : argumentsBegin;
+    QList<QByteArray> arguments = data.mid(argumentsBegin).simplified().split(' ');
+    qint32 index = arguments.indexOf(name);
+    if (index != -1 && index + 1 < arguments.size())
+    {
+        return arguments[index + 1].toLongLong();
+    }
+    return 0;
+}
+
 void PluginWrapper::run()
 {
     _standardOutputFile.open(stdout, QFile::WriteOnly);
@@ -442,6 +958,7 @@ void PluginWrapper::run()
 
 bool PluginWrapper::writeToStandardOutput(QString data)
 {
+    BakeryCounters::increment(BakeryCounters::BytesSerialized, quint64(data.size() + 1));
     _standardOutputFile.write(QString(data + "\n").toLatin1().data());
     _standardOutputFile.flush();
     return _standardOutputFile.waitForBytesWritten(2000);
@@ -458,10 +975,28 @@ void PluginWrapper::readFromStandardInput(QByteArray data)
         emit giveMetadata();
         return;
     }
+    if (command == "enable_counters")
+    {
+        // Each job reports its own counters
+        BakeryCounters::reset();
+        BakeryCounters::setEnabled(true);
+        return;
+    }
+    if (command == "enable_trace")
+    {
+        // Each job reports its own events
+        BakeryTrace::reset();
+        BakeryTrace::setEnabled(true);
+        return;
+    }
     if (command == "bake_sheets")
     {
+        BakeryTrace::Span span("parse input", "protocol");
         PluginInput input;
         stream >> input;
+        span.setArgument("bytes", data.size());
+        span.end();
+        setThreadBudget(jobArgument(data, "threads"));
         emit bakeSheets(input);
         return;
     }
@@ -469,67 +1004,375 @@ void PluginWrapper::readFromStandardInput(QByteArray data)
     {
         int msec;
         stream >> msec;
+        if (BakeryTrace::isEnabled())
+        {
+            QVariantMap arguments;
+            arguments["timeout"] = msec;
+            BakeryTrace::instant("terminate", "protocol", arguments);
+        }
         emit terminate(msec);
         return;
     }
+    if (command == "bake_sheets_shm")
+    {
+        BakeryTrace::Span span("parse input", "protocol");
+        span.setArgument("sharedMemory", true);
+        QString inputKey;
+        QString outputKey;
+        stream >> inputKey >> outputKey;
+
+        // Input is read once, outputs are placed in the output segment until the job is finished
+        QSharedMemory inputSegment(inputKey);
+        if (!inputSegment.attach(QSharedMemory::ReadOnly))
+        {
+            BAKERY_CRITICAL(QString("Could not attach to input segment '%1'").arg(inputKey));
+            setThreadBudget(jobArgument(data, "threads"));
+            emit bakeSheets(PluginInput());
+            return;
+        }
+        QByteArray inputData = BakeryPlugins::readSharedMemory(&inputSegment);
+        inputSegment.detach();
+        _outputSegment.setKey(outputKey);
+        if (!_outputSegment.attach(QSharedMemory::ReadWrite))
+        {
+            BAKERY_WARNING(QString("Could not attach to output segment '%1'").arg(outputKey));
+        }
+
+        QTextStream inputStream(inputData);
+        PluginInput input;
+        inputStream >> input;
+        span.setArgument("bytes", inputData.size());
+        span.end();
+        setThreadBudget(jobArgument(data, "threads"));
+        emit bakeSheets(input);
+        return;
+    }
+    if (command == "persistent")
+    {
+        _persistent = true;
+        return;
+    }
+    if (command == "reset")
+    {
+        BakeryCounters::setEnabled(false);
+        BakeryTrace::setEnabled(false);
+        emit reset();
+        return;
+    }
+}
+
+void PluginWrapper::updateDeadline(QByteArray data)
+{
+    // Only the command and the trailing arguments are parsed, the input itself is left to the main thread
+    qint32 commandEnd = data.indexOf(' ');
+    QByteArray command = (commandEnd == -1 ? data : data.left(commandEnd)).trimmed();
+    if (command == "bake_sheets" || command == "bake_sheets_shm")
+    {
+        _deadline.set(jobArgument(data, "deadline"));
+    }
+    else if (command == "terminate")
+    {
+        bool ok;
+        qint64 msec = data.mid(commandEnd).trimmed().toLongLong(&ok);
+        if (ok)
+        {
+            _deadline.tighten(PluginDeadline::now() + msec);
+        }
+    }
+    else if (command == "reset")
+    {
+        _deadline.clear();
+    }
+}
+
+void PluginWrapper::setThreadBudget(qint32 threads)
+{
+    // Plugins using QtConcurrent respect the budget without knowing about it
+    BakeryPlugins::setThreadBudget(threads);
+    QThreadPool::globalInstance()->setMaxThreadCount(BakeryPlugins::threadBudget());
+}
+
+void PluginWrapper::standardInputClosed()
+{
+    // Nobody is listening any more - stop working instead of idling or computing forever
+    emit terminate(0);
+    QCoreApplication::exit();
 }
 
 void PluginWrapper::metadataGiven(PluginMetadata meta)
 {
+    // The wrapper reads every input encoding of this library
+    if (!meta.capabilities.contains("shapestock"))
+    {
+        meta.capabilities << "shapestock";
+    }
     QString data;
     QTextStream stream(&data);
     stream << meta;
     writeToStandardOutput(data);
-    QCoreApplication::exit();
+    if (!_persistent)
+    {
+        QCoreApplication::exit();
+    }
 }
 
-void PluginWrapper::outputUpdated(PluginOutput output)
+void PluginWrapper::writeOutput(const PluginOutput &output)
 {
+    BakeryTrace::Span span("write output", "protocol");
     QString data;
     QTextStream stream(&data);
     stream << output;
+    stream.flush();
+    span.setArgument("bytes", data.size());
+    if (_outputSegment.isAttached() && BakeryPlugins::writeSharedMemory(&_outputSegment, data.toLatin1()))
+    {
+        writeToStandardOutput("output_shm");
+        return;
+    }
     writeToStandardOutput(data);
 }
 
+void PluginWrapper::outputUpdated(PluginOutput output) { writeOutput(output); }
+
 void PluginWrapper::finished(PluginOutput output)
 {
-    QString data;
-    QTextStream stream(&data);
-    stream << output;
-    writeToStandardOutput(data);
+    writeOutput(output);
+    if (BakeryCounters::isEnabled())
+    {
+        writeToStandardOutput(BakeryCounters::serialize(BakeryCounters::values()));
+        BakeryCounters::setEnabled(false);
+    }
+    if (BakeryTrace::isEnabled())
+    {
+        writeToStandardOutput(BakeryTrace::serialize(BakeryTrace::takeEvents()));
+        BakeryTrace::setEnabled(false);
+    }
+    if (_outputSegment.isAttached())
+    {
+        _outputSegment.detach();
+    }
+    if (_persistent)
+    {
+        writeToStandardOutput("bake_finished");
+        return;
+    }
     QCoreApplication::exit();
 }
 
+AbstractPluginRunner::AbstractPluginRunner(QString pluginName, PluginInput pluginInput, QObject *parent)
+    : QObject(parent), _pluginName(pluginName), _pluginInput(pluginInput), _pluginOutput(), _deadline(0), _lastCompleteOutput(),
+      _threads(0), _cpus(), _countersEnabled(false), _counters()
+{
+}
+
+QString AbstractPluginRunner::pluginName() const { return _pluginName; }
+
+void AbstractPluginRunner::setDeadline(qint64 deadline) { _deadline = deadline; }
+
+void AbstractPluginRunner::setThreads(qint32 threads) { _threads = qMax(threads, 0); }
+
+void AbstractPluginRunner::setCpus(QList<qint32> cpus) { _cpus = cpus; }
+
+void AbstractPluginRunner::setCountersEnabled(bool enabled) { _countersEnabled = enabled; }
+
+QHash<QString, quint64> AbstractPluginRunner::counters() const { return _counters; }
+
+PluginInput AbstractPluginRunner::pluginInput() const { return _pluginInput; }
+
+bool AbstractPluginRunner::isPausable() const { return false; }
+
+bool AbstractPluginRunner::pause() { return false; }
+
+bool AbstractPluginRunner::resume() { return false; }
+
+/*!
+ * \brief Returns the number of shapes placed in a PluginOutput.
+ * \param output PluginOutput.
+ * \return Number of shapes.
+ */
+static qint32 shapeCount(const PluginOutput &output)
+{
+    qint32 count = 0;
+    foreach (const Sheet &sheet, output.sheets)
+    {
+        count += sheet.size();
+    }
+    return count;
+}
+
+void AbstractPluginRunner::updateOutput(const PluginOutput &output)
+{
+    _pluginOutput = output;
+    if (shapeCount(output) == _pluginInput.shapeCount())
+    {
+        _lastCompleteOutput = output;
+    }
+    emit outputUpdated(_pluginName, output);
+}
+
+PluginOutput AbstractPluginRunner::finalOutput() const
+{
+    if (shapeCount(_pluginOutput) != _pluginInput.shapeCount() && !_lastCompleteOutput.sheets.isEmpty())
+    {
+        return _lastCompleteOutput;
+    }
+    return _pluginOutput;
+}
+
 PluginRunner::PluginRunner(QString pluginName, QString pluginPath, PluginInput pluginInput, QObject *parent)
-    : QObject(parent), _pluginName(pluginName), _pluginPath(pluginPath), _pluginInput(pluginInput)
+    : AbstractPluginRunner(pluginName, pluginInput, parent), _pluginPath(pluginPath), _paused(false), _process(NULL), _pool(NULL),
+      _inputKey(), _outputCapacity(0), _shapeStock(false), _outputSegment(), _finished(false), _traceLane(0), _traceStart(0)
 {
-    connect(&_process, SIGNAL(readyReadStandardOutput()), this, SLOT(processReadyRead()));
-    connect(&_process, SIGNAL(finished(int)), this, SLOT(processFinished(int)));
 }
 
+PluginRunner::~PluginRunner()
+{
+    // A pooled process which is still working on this job can not be reused
+    if (_pool != NULL && _process != NULL)
+    {
+        disconnect(_process, 0, this, 0);
+        _process->kill();
+        _process->waitForFinished(1000);
+        _pool->release(_pluginName, _process);
+    }
+}
+
+void PluginRunner::setProcessPool(PluginProcessPool *pool) { _pool = pool; }
+
+void PluginRunner::setSharedMemory(QString inputKey, qint32 outputCapacity)
+{
+    _inputKey = inputKey;
+    _outputCapacity = outputCapacity;
+}
+
+void PluginRunner::setShapeStockEnabled(bool enabled) { _shapeStock = enabled; }
+
 bool PluginRunner::run()
 {
-    _process.start(_pluginPath);
-    if (!_process.waitForStarted(5000))
+    // Every run gets a lane of its own, so runs of the same plugin do not overlap in the timeline
+    _traceLane = BakeryTrace::isEnabled() ? BakeryTrace::newLane(_pluginName) : 0;
+    _traceStart = BakeryTrace::now();
+    if (_pool != NULL)
+    {
+        _process = _pool->acquire(_pluginName, _pluginPath);
+        if (_process == NULL)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        _process = new QProcess(this);
+        _process->start(_pluginPath);
+        if (!_process->waitForStarted(5000))
+        {
+            BAKERY_CRITICAL(QString("Plugin process '%1' failed to start").arg(_pluginPath));
+            return false;
+        }
+    }
+    connect(_process, SIGNAL(readyReadStandardOutput()), this, SLOT(processReadyRead()));
+    connect(_process, SIGNAL(finished(int)), this, SLOT(processFinished(int)));
+    if (!_cpus.isEmpty())
+    {
+        BakeryPlugins::setCpuAffinity(_process->processId(), _cpus, true);
+    }
+    if (_traceLane != 0)
+    {
+        QVariantMap arguments;
+        arguments["pooled"] = _pool != NULL;
+        BakeryTrace::complete("spawn", "plugin", _traceStart, arguments, _traceLane);
+        BakeryTrace::setProcessName(_process->processId(), _pluginName);
+    }
+    if (_countersEnabled && !write("enable_counters"))
+    {
+        return false;
+    }
+    if (_traceLane != 0 && !write("enable_trace"))
     {
-        BAKERY_CRITICAL(QString("Plugin process '%1' failed to start").arg(_pluginPath));
         return false;
     }
 
+    // Only small control messages are sent if shared memory can be used
+    if (!_inputKey.isEmpty())
+    {
+        _outputSegment.setKey(BakeryPlugins::uniqueSharedMemoryKey());
+        if (_outputSegment.create(_outputCapacity))
+        {
+            QString command = QString("bake_sheets_shm %1 %2 ").arg(_inputKey, _outputSegment.key());
+            if (_deadline != 0)
+            {
+                command += QString("deadline %1 ").arg(_deadline);
+            }
+            if (_threads != 0)
+            {
+                command += QString("threads %1 ").arg(_threads);
+            }
+            return writeInput(command);
+        }
+        BAKERY_WARNING(QString("Plugin '%1': could not create output segment (%2)").arg(_pluginName, _outputSegment.errorString()));
+    }
+
     QString data;
     QTextStream stream(&data);
-    stream << "bake_sheets " << _pluginInput;
-    return write(data);
+    stream << "bake_sheets ";
+    BakeryPlugins::writePluginInput(stream, _pluginInput, _shapeStock);
+    if (_deadline != 0)
+    {
+        stream << "deadline " << _deadline << " ";
+    }
+    if (_threads != 0)
+    {
+        stream << "threads " << _threads << " ";
+    }
+    stream.flush();
+    return writeInput(data);
+}
+
+bool PluginRunner::writeInput(QString data)
+{
+    qint64 start = BakeryTrace::now();
+    bool written = write(data);
+    if (_traceLane != 0)
+    {
+        QVariantMap arguments;
+        arguments["bytes"] = data.size() + 1;
+        arguments["sharedMemory"] = _outputSegment.isAttached();
+        BakeryTrace::complete("write input", "protocol", start, arguments, _traceLane);
+    }
+    return written;
 }
 
 bool PluginRunner::write(QString data)
 {
-    _process.write(QString(data + "\n").toLatin1().data());
-    return _process.waitForBytesWritten(2000);
+    if (_process == NULL)
+    {
+        return false;
+    }
+
+    // Large inputs need more than one write cycle
+    BakeryCounters::increment(BakeryCounters::BytesSerialized, quint64(data.size() + 1));
+    _process->write(QString(data + "\n").toLatin1());
+    while (_process->bytesToWrite() > 0)
+    {
+        if (!_process->waitForBytesWritten(2000))
+        {
+            BAKERY_CRITICAL(QString("Plugin '%1': failed to write to process").arg(_pluginName));
+            return false;
+        }
+    }
+    return true;
 }
 
 bool PluginRunner::terminate(int timeout)
 {
+    // A stopped process can not react to the command
+    resume();
+    if (_traceLane != 0)
+    {
+        QVariantMap arguments;
+        arguments["timeout"] = timeout;
+        BakeryTrace::instant("terminate", "plugin", arguments, _traceLane);
+    }
     if (!write(QString("terminate %1 ").arg(timeout)))
     {
         return false;
@@ -538,25 +1381,339 @@ bool PluginRunner::terminate(int timeout)
     return true;
 }
 
-void PluginRunner::kill() { _process.kill(); }
+bool PluginRunner::isPausable() const
+{
+#ifdef Q_OS_UNIX
+    return _process != NULL && _process->state() == QProcess::Running && !_outputSegment.isAttached();
+#else
+    return false;
+#endif
+}
+
+bool PluginRunner::pause()
+{
+#ifdef Q_OS_UNIX
+    if (_paused || !isPausable() || ::kill(pid_t(_process->processId()), SIGSTOP) != 0)
+    {
+        return false;
+    }
+    _paused = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool PluginRunner::resume()
+{
+#ifdef Q_OS_UNIX
+    if (!_paused || _process == NULL)
+    {
+        return false;
+    }
+    _paused = false;
+    return ::kill(pid_t(_process->processId()), SIGCONT) == 0;
+#else
+    return false;
+#endif
+}
+
+void PluginRunner::releaseProcess()
+{
+    if (_process == NULL)
+    {
+        return;
+    }
+    resume();
+    disconnect(_process, 0, this, 0);
+    if (_pool != NULL)
+    {
+        _pool->release(_pluginName, _process);
+    }
+    else
+    {
+        _process->deleteLater();
+    }
+    _process = NULL;
+}
+
+void PluginRunner::kill()
+{
+    if (_process != NULL)
+    {
+        // Capture outputs which have already been written before they are lost
+        _process->waitForReadyRead(0);
+        processReadyRead();
+    }
+    if (_process != NULL)
+    {
+        if (_traceLane != 0)
+        {
+            BakeryTrace::instant("kill", "plugin", QVariantMap(), _traceLane);
+        }
+        _process->kill();
+    }
+}
 
 void PluginRunner::processReadyRead()
 {
-    while (_process.canReadLine())
+    while (_process != NULL && _process->canReadLine())
     {
-        QByteArray buffer = _process.readLine();
+        qint64 start = BakeryTrace::now();
+        QByteArray buffer = _process->readLine();
+        if (_pool != NULL && buffer.trimmed() == "bake_finished")
+        {
+            releaseProcess();
+            _finished = true;
+            traceExit(0);
+            emit finished(0, _pluginName, _pluginInput, finalOutput());
+            return;
+        }
+        if (buffer.startsWith("counters_begin"))
+        {
+            bool ok;
+            _counters = BakeryCounters::deserialize(buffer, &ok);
+            if (!ok)
+            {
+                BAKERY_WARNING(QString("Plugin '%1': invalid counters received").arg(_pluginName));
+            }
+            continue;
+        }
+        if (buffer.startsWith("trace_begin"))
+        {
+            bool ok;
+            BakeryTrace::append(BakeryTrace::deserialize(buffer, &ok));
+            if (!ok)
+            {
+                BAKERY_WARNING(QString("Plugin '%1': invalid trace received").arg(_pluginName));
+            }
+            continue;
+        }
+        if (_outputSegment.isAttached() && buffer.trimmed() == "output_shm")
+        {
+            bool ok;
+            buffer = BakeryPlugins::readSharedMemory(&_outputSegment, &ok);
+            if (!ok)
+            {
+                BAKERY_CRITICAL(QString("Plugin '%1': invalid output segment").arg(_pluginName));
+                kill();
+                return;
+            }
+        }
         QTextStream stream(buffer);
         PluginOutput output;
         stream >> output;
         if (stream.status() != QTextStream::Ok)
         {
             BAKERY_CRITICAL(QString("Plugin '%1': invalid output received").arg(_pluginName));
-            kill();
+            _process->kill();
             return;
         }
-        _pluginOutput = output;
-        emit outputUpdated(_pluginName, output);
+        if (_traceLane != 0)
+        {
+            // Only reading and parsing is measured, validation is traced by the receiver
+            QVariantMap arguments;
+            arguments["bytes"] = buffer.size();
+            arguments["sheets"] = output.sheets.size();
+            BakeryTrace::complete("output update", "protocol", start, arguments, _traceLane);
+        }
+        updateOutput(output);
+    }
+}
+
+void PluginRunner::processFinished(int exitCode)
+{
+    if (_finished)
+    {
+        return;
+    }
+    processReadyRead();
+    if (_finished)
+    {
+        return;
     }
+    releaseProcess();
+    _finished = true;
+    traceExit(exitCode);
+    emit finished(exitCode, _pluginName, _pluginInput, finalOutput());
 }
 
-void PluginRunner::processFinished(int exitCode) { emit finished(exitCode, _pluginName, _pluginInput, _pluginOutput); }
+void PluginRunner::traceExit(int exitCode)
+{
+    if (_traceLane == 0)
+    {
+        return;
+    }
+    QVariantMap arguments;
+    arguments["exitCode"] = exitCode;
+    BakeryTrace::instant("exit", "plugin", arguments, _traceLane);
+    arguments["plugin"] = _pluginName;
+    BakeryTrace::complete("job", "plugin", _traceStart, arguments, _traceLane);
+}
+
+PluginLibraryRunner::PluginLibraryRunner(QString pluginName, PluginFactory *factory, PluginInput pluginInput, QObject *parent)
+    : AbstractPluginRunner(pluginName, pluginInput, parent), _factory(factory), _instance(NULL), _thread(NULL),
+      _instanceDeadline(NULL), _metadata(),
+      _metadataReceived(false), _finished(false)
+{
+    // Inputs and outputs are passed between threads
+    qRegisterMetaType<PluginInput>("PluginInput");
+    qRegisterMetaType<PluginOutput>("PluginOutput");
+}
+
+PluginLibraryRunner::~PluginLibraryRunner() { releaseInstance(); }
+
+bool PluginLibraryRunner::run()
+{
+    if (_factory == NULL)
+    {
+        BAKERY_CRITICAL(QString("Plugin '%1': no plugin factory available").arg(_pluginName));
+        return false;
+    }
+    if (_instance != NULL)
+    {
+        BAKERY_CRITICAL(QString("Plugin '%1': already running").arg(_pluginName));
+        return false;
+    }
+
+    _instance = _factory->createInstance();
+    if (_instance == NULL)
+    {
+        BAKERY_CRITICAL(QString("Plugin '%1': factory failed to create an instance").arg(_pluginName));
+        return false;
+    }
+    _thread = new QThread();
+    _instance->moveToThread(_thread);
+
+    // The deadline is owned by the worker thread because an abandoned instance may outlive the runner
+    PluginDeadline *deadline = new PluginDeadline();
+    deadline->set(_deadline);
+    _instanceDeadline = deadline;
+    qint32 threads = _threads;
+    QList<qint32> cpus = _cpus;
+    connect(_thread, &QThread::started, [deadline, threads, cpus]() {
+        PluginDeadline::setCurrent(deadline);
+        BakeryPlugins::setThreadBudget(threads);
+        if (!cpus.isEmpty())
+        {
+            BakeryPlugins::setCpuAffinity(0, cpus);
+        }
+    });
+    connect(_thread, &QThread::finished, [deadline]() {
+        PluginDeadline::setCurrent(NULL);
+        delete deadline;
+    });
+
+    // Instance and thread clean up after themselves, even if the runner is gone by then
+    connect(_thread, SIGNAL(finished()), _instance, SLOT(deleteLater()));
+    connect(_thread, SIGNAL(finished()), _thread, SLOT(deleteLater()));
+
+    connect(this, SIGNAL(bakeSheets(PluginInput)), _instance, SLOT(bakeSheets(PluginInput)));
+    connect(this, SIGNAL(terminateInstance(qint32)), _instance, SLOT(terminate(qint32)));
+    connect(_instance, SIGNAL(outputUpdated(PluginOutput)), this, SLOT(instanceOutputUpdated(PluginOutput)));
+    connect(_instance, SIGNAL(finished(PluginOutput)), this, SLOT(instanceFinished(PluginOutput)));
+
+    _thread->start();
+    emit bakeSheets(_pluginInput);
+    return true;
+}
+
+bool PluginLibraryRunner::terminate(int timeout)
+{
+    if (_instance == NULL)
+    {
+        return false;
+    }
+    _instanceDeadline->tighten(PluginDeadline::now() + timeout);
+    emit terminateInstance(timeout);
+    QTimer::singleShot(timeout, this, SLOT(kill()));
+    return true;
+}
+
+bool PluginLibraryRunner::queryMetadata(PluginMetadata &meta)
+{
+    if (_factory == NULL)
+    {
+        return false;
+    }
+
+    QObject *instance = _factory->createInstance();
+    if (instance == NULL)
+    {
+        return false;
+    }
+    _metadataReceived = false;
+    connect(instance, SIGNAL(metadataGiven(PluginMetadata)), this, SLOT(instanceMetadataGiven(PluginMetadata)), Qt::DirectConnection);
+    bool invoked = QMetaObject::invokeMethod(instance, "giveMetadata", Qt::DirectConnection);
+    delete instance;
+
+    if (!invoked || !_metadataReceived)
+    {
+        return false;
+    }
+    meta = _metadata;
+    return true;
+}
+
+void PluginLibraryRunner::releaseInstance()
+{
+    if (_instance == NULL)
+    {
+        return;
+    }
+    disconnect(_instance, 0, this, 0);
+    disconnect(this, 0, _instance, 0);
+    _instanceDeadline->set(PluginDeadline::now());
+    _thread->quit();
+    _instance = NULL;
+    _thread = NULL;
+    _instanceDeadline = NULL;
+}
+
+void PluginLibraryRunner::kill()
+{
+    if (_finished)
+    {
+        return;
+    }
+    if (_instance != NULL)
+    {
+        // Capture outputs which have already been sent before the instance is abandoned
+        QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+        if (_finished)
+        {
+            return;
+        }
+        QMetaObject::invokeMethod(_instance, "terminate", Qt::QueuedConnection, Q_ARG(int, 0));
+    }
+    releaseInstance();
+    _finished = true;
+    emit finished(-1, _pluginName, _pluginInput, finalOutput());
+}
+
+void PluginLibraryRunner::instanceMetadataGiven(PluginMetadata meta)
+{
+    _metadata = meta;
+    _metadataReceived = true;
+}
+
+void PluginLibraryRunner::instanceOutputUpdated(PluginOutput output)
+{
+    if (_finished)
+    {
+        return;
+    }
+    updateOutput(output);
+}
+
+void PluginLibraryRunner::instanceFinished(PluginOutput output)
+{
+    if (_finished)
+    {
+        return;
+    }
+    releaseInstance();
+    _pluginOutput = output;
+    _finished = true;
+    emit finished(0, _pluginName, _pluginInput, finalOutput());
+}
@@ -23,13 +23,21 @@
 #include "global.h"
 #include "shape.h"
 #include "sheet.h"
+#include "shapestock.h"
+#include "trace.h"
 
 #include <QList>
 #include <QString>
+#include <QStringList>
 #include <QFile>
 #include <QProcess>
 #include <QThread>
 #include <QCoreApplication>
+#include <QtPlugin>
+#include <QSharedMemory>
+#include <QAtomicInteger>
+
+class PluginProcessPool;
 
 /*!
  * \brief Contains all information required for plugins to process tasks.
@@ -47,17 +55,62 @@ struct BAKERYSHARED_EXPORT PluginInput
     qint32 sheetHeight;
 
     /*!
-     * \brief List of shapes.
+     * \brief PluginInput Constructor
+     */
+    PluginInput() : sheetWidth(0), sheetHeight(0), _stock() {}
+
+    /*!
+     * \brief Returns the shapes which have to be placed on sheets, grouped into types with the number of pieces of each type.
+     * \return Stock of shapes.
+     */
+    const ShapeStock &stock() const;
+
+    /*!
+     * \brief Replaces the shapes by the remaining pieces of a stock.
+     * \param stock Stock of shapes.
+     */
+    void setStock(const ShapeStock &stock);
+
+    /*!
+     * \brief Adds pieces of a shape. Shapes are grouped into types by name (see ShapeStock::add()).
+     * \param shape Shape.
+     * \param count Number of pieces.
+     */
+    void addShape(const Shape &shape, qint32 count = 1);
+
+    /*!
+     * \brief Adds a piece of a shape.
+     * \param shape Shape.
+     * \return Reference to this PluginInput.
+     */
+    PluginInput &operator<<(const Shape &shape);
+
+    /*!
+     * \brief Returns the number of pieces which have to be placed.
+     * \return Number of pieces.
+     */
+    qint32 shapeCount() const;
+
+    /*!
+     * \brief Returns all pieces as a flat list ordered by type. Compatibility adapter for code working on lists of shapes.
+     *
+     * The list is built on every call. Its entries are implicitly shared copies of the prototypes.
      *
-     * Each shape in this list has to be placed on a sheet. Identical shapes are contained as often in this list as they should be placed by
-     * the plugins.
+     * \return List of pieces.
      */
-    QList<Shape> shapes;
+    QList<Shape> shapes() const;
 
     /*!
-     * \brief PluginInput Constructor
+     * \brief Replaces the shapes by a flat list of pieces. Compatibility adapter for code working on lists of shapes.
+     * \param shapes List of pieces. Pieces are grouped into types by name.
      */
-    PluginInput() : sheetWidth(0), sheetHeight(0), shapes() {}
+    void setShapes(const QList<Shape> &shapes);
+
+private:
+    /*!
+     * \brief Shapes which have to be placed. Each type is stored once, so memory does not grow with the number of pieces.
+     */
+    ShapeStock _stock;
 };
 
 /*!
@@ -109,12 +162,22 @@ struct BAKERYSHARED_EXPORT PluginMetadata
      */
     QString license;
 
+    /*!
+     * \brief Protocol features supported by the plugin executable.
+     *
+     * Known capabilities are:
+     *  - shapestock: The plugin reads inputs encoded as shape stock. PluginWrapper adds this capability automatically.
+     *
+     * Capabilities describe how the host talks to the executable, so they are not part of the plugin identity.
+     */
+    QStringList capabilities;
+
     /*!
      * \brief PluginMetadata constructor
      *
      * This constructor sets all values to "<invalid>" or "<unknown>".
      */
-    PluginMetadata() : uniqueName("<invalid>"), type("<unknown>"), author("<unknown>"), license("<unknown>") {}
+    PluginMetadata() : uniqueName("<invalid>"), type("<unknown>"), author("<unknown>"), license("<unknown>"), capabilities() {}
 
     /*!
      * \brief PluginMetadata constructor.
@@ -127,7 +190,7 @@ struct BAKERYSHARED_EXPORT PluginMetadata
      * \param license_ License of plugin.
      */
     PluginMetadata(QString uniqueName_, QString type_, QString author_, QString license_)
-        : uniqueName(uniqueName_), type(type_), author(author_), license(license_)
+        : uniqueName(uniqueName_), type(type_), author(author_), license(license_), capabilities()
     {
     }
 };
@@ -137,25 +200,46 @@ struct BAKERYSHARED_EXPORT PluginMetadata
  */
 struct BAKERYSHARED_EXPORT RandomPluginInputParameters
 {
+    /*!
+     * \brief Methods to generate the polygons of the shapes.
+     */
+    enum PolygonMethod
+    {
+        /*!
+         * \brief Random points are appended as long as the polygon stays simple.
+         */
+        RejectionSampling,
+
+        /*!
+         * \brief Star-shaped polygons are constructed around a center. Fast for polygons with many vertices.
+         */
+        StarShaped,
+
+        /*!
+         * \brief Non-convex squares with dovetail tabs and blanks like jigsaw pieces. The number of points is ignored.
+         */
+        Jigsaw
+    };
+
     /*!
      * \brief Minimum sheet width.
      */
-    qint32 minSheetWidth;
+    qreal minSheetWidth;
 
     /*!
      * \brief Maximum sheet width.
      */
-    qint32 maxSheetWidth;
+    qreal maxSheetWidth;
 
     /*!
      * \brief Minimum sheet height.
      */
-    qint32 minSheetHeight;
+    qreal minSheetHeight;
 
     /*!
      * \brief Maximum sheet height.
      */
-    qint32 maxSheetHeight;
+    qreal maxSheetHeight;
 
     /*!
      * \brief Minimum number of shape types.
@@ -190,12 +274,12 @@ struct BAKERYSHARED_EXPORT RandomPluginInputParameters
     /*!
      * \brief Minimum shape scale.
      */
-    qint32 minScale;
+    qreal minScale;
 
     /*!
      * \brief Maximum shape scale.
      */
-    qint32 maxScale;
+    qreal maxScale;
 
     /*!
      * \brief Minimum edge angle in degrees.
@@ -220,6 +304,21 @@ struct BAKERYSHARED_EXPORT RandomPluginInputParameters
      */
     qint32 seed;
 
+    /*!
+     * \brief Method to generate the polygons of the shapes.
+     */
+    PolygonMethod polygonMethod;
+
+    /*!
+     * \brief Minimum ratio of width to height of the shapes. Only used if maxAspectRatio is greater than zero.
+     */
+    qreal minAspectRatio;
+
+    /*!
+     * \brief Maximum ratio of width to height of the shapes. If zero, width and height are scaled independently.
+     */
+    qreal maxAspectRatio;
+
     // Default values
     RandomPluginInputParameters()
     {
@@ -239,11 +338,17 @@ struct BAKERYSHARED_EXPORT RandomPluginInputParameters
         minSheets = 5;
         maxSheets = 5;
         seed = -1;
+        polygonMethod = RejectionSampling;
+        minAspectRatio = 0;
+        maxAspectRatio = 0;
     }
 };
 
 /*!
  * \brief Non-blocking standard input reader.
+ *
+ * Standard input is read in large chunks on a separate thread which sleeps while no data is available. The chunks are split into lines
+ * by the reader itself, so the plugin is only woken up once per complete command.
  */
 class BAKERYSHARED_EXPORT StandardInputReader : public QThread
 {
@@ -257,16 +362,121 @@ public:
     explicit StandardInputReader(QObject *parent = 0);
 
     /*!
-     * \brief Indefinately reads lines from standard input and emits read() when a line has been read.
+     * \brief Destructor. Stops the reader thread.
+     */
+    ~StandardInputReader();
+
+    /*!
+     * \brief Reads standard input until it is closed or stop() is called and emits read() for every complete, non-empty line.
      */
     void run();
 
+    /*!
+     * \brief Wakes up the reader thread, makes run() return and waits for the thread to finish.
+     */
+    void stop();
+
+private:
+#ifdef Q_OS_UNIX
+    /*!
+     * \brief Self-pipe used by stop() to wake up the reader thread while it is waiting for input.
+     */
+    int _wakeUpPipe[2];
+#endif
+
 signals:
     /*!
      * \brief Is emitted when a line has been read.
-     * \param data Byte representation of the read line.
+     * \param data Byte representation of the read line (without the line break).
      */
     void read(QByteArray data);
+
+    /*!
+     * \brief Is emitted once when standard input has been closed.
+     */
+    void endOfInput();
+};
+
+/*!
+ * \brief Deadline of a plugin job.
+ *
+ * Deadlines are absolute points in time in milliseconds on the monotonic clock of QElapsedTimer (see
+ * QElapsedTimer::msecsSinceReference()), which is shared by all processes of a system. The deadline may be changed from any thread
+ * while the plugin is checking it. Plugins query the deadline of their current job through BakeryPlugins::deadlineReached() and
+ * BakeryPlugins::remainingTime() instead of polling the event loop.
+ */
+class BAKERYSHARED_EXPORT PluginDeadline
+{
+public:
+    /*!
+     * \brief Constructor. No deadline is set.
+     */
+    PluginDeadline();
+
+    /*!
+     * \brief Sets the deadline.
+     * \param deadline Absolute deadline in milliseconds. If 0, no deadline is set.
+     */
+    void set(qint64 deadline);
+
+    /*!
+     * \brief Sets the deadline if no deadline is set or the given deadline is earlier.
+     * \param deadline Absolute deadline in milliseconds.
+     */
+    void tighten(qint64 deadline);
+
+    /*!
+     * \brief Removes the deadline.
+     */
+    void clear();
+
+    /*!
+     * \brief Returns the deadline.
+     * \return Absolute deadline in milliseconds or 0 if no deadline is set.
+     */
+    qint64 deadline() const;
+
+    /*!
+     * \brief Returns if the given fraction of the time between setting the deadline and the deadline has passed.
+     * \param fraction Fraction of the time (1.0 is the deadline itself).
+     * \return true if a deadline is set and the time has passed.
+     */
+    bool reached(qreal fraction = 1.0) const;
+
+    /*!
+     * \brief Returns the time until the deadline.
+     * \return Remaining time in milliseconds (at least 0) or -1 if no deadline is set.
+     */
+    qint64 remainingTime() const;
+
+    /*!
+     * \brief Returns the current time on the clock used for deadlines.
+     * \return Current time in milliseconds.
+     */
+    static qint64 now();
+
+    /*!
+     * \brief Returns the deadline of the job running in the calling thread.
+     * \return Deadline or NULL if none has been set for the calling thread.
+     */
+    static PluginDeadline *current();
+
+    /*!
+     * \brief Sets the deadline of the job running in the calling thread.
+     * \param deadline Deadline. Has to outlive the job.
+     */
+    static void setCurrent(PluginDeadline *deadline);
+
+private:
+    /*!
+     * \brief Time at which the deadline was set.
+     */
+    QAtomicInteger<qint64> _start;
+
+    /*!
+     * \brief Absolute deadline or 0.
+     */
+    QAtomicInteger<qint64> _deadline;
 };
 
 /*!
@@ -274,6 +484,9 @@ signals:
  *
  * Plugins are required to implement the slots giveMetadata(), bakeSheets(PluginInput) and terminate(qint32)
  * and emit metadataGiven(PluginMetadata), outputUpdated(PluginOutput) and finished(PluginOutput).
+ *
+ * Plugins which can be run as persistent process (see PluginProcessPool) additionally implement the slot reset(), which restores the
+ * state of a freshly constructed instance.
  */
 class BAKERYSHARED_EXPORT PluginWrapper : public QObject
 {
@@ -293,6 +506,21 @@ private:
      */
     QObject *_instance;
 
+    /*!
+     * \brief If true the process keeps running after a job is finished. Is set by the command "persistent".
+     */
+    bool _persistent;
+
+    /*!
+     * \brief Output segment of the current job if the input was received through shared memory (command "bake_sheets_shm").
+     */
+    QSharedMemory _outputSegment;
+
+    /*!
+     * \brief Deadline of the current job. Is updated by the standard input reader thread, so plugins see it while they are working.
+     */
+    PluginDeadline _deadline;
+
     /*!
      * \brief Used to receive commands.
      */
@@ -310,6 +538,19 @@ private:
      */
     bool writeToStandardOutput(QString data);
 
+    /*!
+     * \brief Sends an output to the host. The output is placed in the output segment if it is attached and large enough, otherwise it
+     * is written to standard output.
+     * \param output PluginOutput.
+     */
+    void writeOutput(const PluginOutput &output);
+
+    /*!
+     * \brief Sets the thread budget of the current job. The global QThreadPool is limited to the budget as well.
+     * \param threads Number of threads. If 0, all available threads may be used.
+     */
+    void setThreadBudget(qint32 threads);
+
 signals:
     /*!
      * \brief Is emitted when the command "give_metadata" is received via standard input.
@@ -326,6 +567,11 @@ signals:
      */
     void terminate(qint32 msec);
 
+    /*!
+     * \brief Is emitted when the command "reset" is received via standard input.
+     */
+    void reset();
+
 public slots:
     /*!
      * \brief Starts the plugin wrapper main loop by opening the standard output file and starting the standard input reader.
@@ -339,6 +585,20 @@ private slots:
      */
     void readFromStandardInput(QByteArray data);
 
+    /*!
+     * \brief Updates the deadline according to the commands "bake_sheets", "bake_sheets_shm", "terminate" and "reset".
+     *
+     * Is called directly in the standard input reader thread before the command is processed by the main thread.
+     *
+     * \param data Data from standard input reader.
+     */
+    void updateDeadline(QByteArray data);
+
+    /*!
+     * \brief Is called when standard input has been closed, i.e. the host is gone. Terminates the plugin and exits the main loop.
+     */
+    void standardInputClosed();
+
     /*!
      * \brief Writes metadata provided by plugins to standard output.
      * Plugins are required to emit the corresponding signal metadataGiven(PluginMetadata).
@@ -354,7 +614,8 @@ private slots:
     void outputUpdated(PluginOutput output);
 
     /*!
-     * \brief Writes metadata provided by plugins to standard output and exits the main loop.
+     * \brief Writes the final output provided by plugins to standard output and exits the main loop. In persistent mode the line
+     * "bake_finished" is written instead of exiting.
      * Plugins are required to emit the corresponding signal finished(PluginOutput).
      * \param output PluginOutput.
      */
@@ -362,52 +623,139 @@ private slots:
 };
 
 /*!
- * \brief Signal-emitting convenience plugin runner.
+ * \brief Interface of in-process plugins.
+ *
+ * The same plugin classes which are used in plugin executables can be built as shared libraries (see BAKERY_PLUGIN_LIBRARY). Those
+ * libraries export a factory implementing this interface which is loaded through QPluginLoader. Instances created by the factory have to
+ * provide the same slots and signals as described in PluginWrapper.
  */
-class BAKERYSHARED_EXPORT PluginRunner : public QObject
+class PluginFactory
+{
+public:
+    /*!
+     * \brief Destructor.
+     */
+    virtual ~PluginFactory() {}
+
+    /*!
+     * \brief Creates a new plugin instance. The caller takes ownership of the instance.
+     * \return New plugin instance.
+     */
+    virtual QObject *createInstance() = 0;
+};
+
+#define PluginFactory_iid "org.bakery.PluginFactory/1.0"
+Q_DECLARE_INTERFACE(PluginFactory, PluginFactory_iid)
+
+/*!
+ * \brief Base class of all plugin runners. A plugin runner runs a single plugin on a single PluginInput.
+ */
+class BAKERYSHARED_EXPORT AbstractPluginRunner : public QObject
 {
     Q_OBJECT
 public:
     /*!
      * \brief Constructor.
      * \param pluginName Name of the plugin.
-     * \param pluginPath Path to the plugin executable.
      * \param pluginInput Input to be processed.
      * \param parent QObject parent.
      */
-    explicit PluginRunner(QString pluginName = QString(), QString pluginPath = QString(), PluginInput pluginInput = PluginInput(),
-                          QObject *parent = 0);
+    explicit AbstractPluginRunner(QString pluginName = QString(), PluginInput pluginInput = PluginInput(), QObject *parent = 0);
 
     /*!
-     * \brief Starts the plugin process and sends the command "bake_sheets" to the plugin via standard output.
+     * \brief Starts processing the input.
      * \return true if successful.
      */
-    bool run();
+    virtual bool run() = 0;
 
     /*!
-     * \brief Writes a Latin-1 representation of the given string to the plugin's standard input channel.
-     * \param data String.
+     * \brief Asks the plugin to terminate. The plugin gets killed if it has not finished after the given timeout.
+     * \param timeout Timeout in milliseconds.
      * \return true if successful.
      */
-    bool write(QString data);
+    virtual bool terminate(int timeout) = 0;
 
     /*!
-     * \brief Sends the "terminate" command to the plugin.
-     * \param timeout Timeout in milliseconds.
+     * \brief Returns whether the plugin can be paused. The default implementation returns false.
+     * \return true if pause() is supported.
+     */
+    virtual bool isPausable() const;
+
+    /*!
+     * \brief Stops the plugin from using CPU time until resume() is called. The default implementation does nothing.
      * \return true if successful.
      */
-    bool terminate(int timeout);
+    virtual bool pause();
 
-private:
     /*!
-     * \brief Name of the plugin. Required to be unique.
+     * \brief Continues a paused plugin. The default implementation does nothing.
+     * \return true if successful.
      */
-    QString _pluginName;
+    virtual bool resume();
 
     /*!
-     * \brief Path to the plugin executable.
+     * \brief Returns the name of the plugin.
+     * \return Name of the plugin.
      */
-    QString _pluginPath;
+    QString pluginName() const;
+
+    /*!
+     * \brief Sets the deadline which is passed to the plugin when run() is called.
+     * \param deadline Absolute deadline in milliseconds (see PluginDeadline). If 0, no deadline is passed.
+     */
+    void setDeadline(qint64 deadline);
+
+    /*!
+     * \brief Sets the number of threads the plugin may use. It is passed to the plugin when run() is called.
+     * \param threads Number of threads. If 0, no thread budget is passed.
+     */
+    void setThreads(qint32 threads);
+
+    /*!
+     * \brief Sets the CPUs the plugin is pinned to when run() is called. Only supported on Linux.
+     * \param cpus CPU numbers. If empty, the plugin is not pinned.
+     */
+    void setCpus(QList<qint32> cpus);
+
+    /*!
+     * \brief Sets whether the plugin is asked to report its performance counters when run() is called.
+     * \param enabled True if counters should be reported.
+     */
+    void setCountersEnabled(bool enabled);
+
+    /*!
+     * \brief Returns the performance counters reported by the plugin.
+     * \return Counter values by name. Empty if none were reported.
+     */
+    QHash<QString, quint64> counters() const;
+
+    /*!
+     * \brief Returns the input processed by the plugin.
+     * \return PluginInput.
+     */
+    PluginInput pluginInput() const;
+
+protected:
+    /*!
+     * \brief Stores a new output of the plugin and emits outputUpdated(QString, PluginOutput).
+     * \param output New output.
+     */
+    void updateOutput(const PluginOutput &output);
+
+    /*!
+     * \brief Returns the output which is reported when the plugin has finished.
+     *
+     * This is the last output of the plugin, unless it was stopped while working on an incomplete output. In this case the last complete
+     * output is used.
+     *
+     * \return Final output.
+     */
+    PluginOutput finalOutput() const;
+
+    /*!
+     * \brief Name of the plugin. Required to be unique.
+     */
+    QString _pluginName;
 
     /*!
      * \brief PluginInput used for processing.
@@ -420,9 +768,34 @@ private:
     PluginOutput _pluginOutput;
 
     /*!
-     * \brief Plugin process.
+     * \brief Deadline passed to the plugin. 0 if none.
+     */
+    qint64 _deadline;
+
+    /*!
+     * \brief Last output which contains as many shapes as the input.
+     */
+    PluginOutput _lastCompleteOutput;
+
+    /*!
+     * \brief Number of threads the plugin may use. 0 if not restricted.
+     */
+    qint32 _threads;
+
+    /*!
+     * \brief CPUs the plugin is pinned to. Empty if not pinned.
+     */
+    QList<qint32> _cpus;
+
+    /*!
+     * \brief True if the plugin is asked to report its performance counters.
+     */
+    bool _countersEnabled;
+
+    /*!
+     * \brief Performance counters reported by the plugin.
      */
-    QProcess _process;
+    QHash<QString, quint64> _counters;
 
 signals:
     /*!
@@ -434,22 +807,195 @@ signals:
 
     /*!
      * \brief Is emitted when a plugin has finished working.
-     * \param exitCode The plugin process' exit code.
+     * \param exitCode The plugin's exit code.
      * \param pluginName Name of the plugin.
      * \param input Processed input (for GUI convenience).
      * \param output Final output.
      */
     void finished(int exitCode, QString pluginName, PluginInput input, PluginOutput output);
 
-private slots:
+public slots:
+    /*!
+     * \brief Stops the plugin immediately.
+     */
+    virtual void kill() = 0;
+};
+
+/*!
+ * \brief Signal-emitting convenience plugin runner. Runs plugin executables in a separate process.
+ */
+class BAKERYSHARED_EXPORT PluginRunner : public AbstractPluginRunner
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief Constructor.
+     * \param pluginName Name of the plugin.
+     * \param pluginPath Path to the plugin executable.
+     * \param pluginInput Input to be processed.
+     * \param parent QObject parent.
+     */
+    explicit PluginRunner(QString pluginName = QString(), QString pluginPath = QString(), PluginInput pluginInput = PluginInput(),
+                          QObject *parent = 0);
+
+    /*!
+     * \brief Destructor. Kills the plugin process if it is still running a job.
+     */
+    ~PluginRunner();
+
+    /*!
+     * \brief Sets the pool from which a persistent plugin process is taken. If no pool is set, a new process is started.
+     * \param pool Process pool.
+     */
+    void setProcessPool(PluginProcessPool *pool);
+
+    /*!
+     * \brief Transfers input and outputs through shared memory instead of the standard channels.
+     *
+     * The serialized input has to be placed in the given segment by the caller (see BakeryPlugins::writeSharedMemory()). The runner
+     * creates a segment of the given capacity for the outputs. If this fails, the standard channels are used.
+     *
+     * \param inputKey Key of the input segment.
+     * \param outputCapacity Capacity of the output segment in bytes.
+     */
+    void setSharedMemory(QString inputKey, qint32 outputCapacity);
+
+    /*!
+     * \brief Sets if the input is sent as shape stock. Only plugins with the capability "shapestock" can read this encoding.
+     *
+     * If shared memory is used, the caller has to place the input in the matching encoding.
+     *
+     * \param enabled true to send the input as shape stock.
+     * \sa BakeryPlugins::writePluginInput()
+     */
+    void setShapeStockEnabled(bool enabled = true);
+
+    /*!
+     * \brief Starts the plugin process and sends the command "bake_sheets" to the plugin via standard output.
+     * \return true if successful.
+     */
+    bool run();
+
+    /*!
+     * \brief Writes a Latin-1 representation of the given string to the plugin's standard input channel.
+     * \param data String.
+     * \return true if all data was written.
+     */
+    bool write(QString data);
+
+    /*!
+     * \brief Sends the "terminate" command to the plugin. A paused plugin is resumed first.
+     * \param timeout Timeout in milliseconds.
+     * \return true if successful.
+     */
+    bool terminate(int timeout);
+
+    /*!
+     * \brief Returns whether the plugin can be paused. Processes can be paused on Unix systems while they are running.
+     *
+     * Processes using a shared memory output segment are never paused: a process stopped while it holds the lock of the segment would
+     * block the host as soon as it reads the segment.
+     *
+     * \return true if pause() is supported.
+     */
+    bool isPausable() const;
+
+    /*!
+     * \brief Stops the plugin process with SIGSTOP.
+     * \return true if successful.
+     */
+    bool pause();
+
+    /*!
+     * \brief Continues the plugin process with SIGCONT.
+     * \return true if successful.
+     */
+    bool resume();
+
+private:
+    /*!
+     * \brief Path to the plugin executable.
+     */
+    QString _pluginPath;
+
+    /*!
+     * \brief true if the process has been stopped by pause().
+     */
+    bool _paused;
+
+    /*!
+     * \brief Plugin process. Is NULL before run() and after a pooled process has been returned to the pool.
+     */
+    QProcess *_process;
+
+    /*!
+     * \brief Pool of persistent plugin processes. May be NULL.
+     */
+    PluginProcessPool *_pool;
+
+    /*!
+     * \brief Key of the input segment. Empty if shared memory is not used.
+     */
+    QString _inputKey;
+
+    /*!
+     * \brief Capacity of the output segment.
+     */
+    qint32 _outputCapacity;
+
+    /*!
+     * \brief true if the input is sent as shape stock.
+     */
+    bool _shapeStock;
+
+    /*!
+     * \brief Segment in which the plugin places its outputs.
+     */
+    QSharedMemory _outputSegment;
+
+    /*!
+     * \brief true if finished(int, QString, PluginInput, PluginOutput) was emitted.
+     */
+    bool _finished;
+
+    /*!
+     * \brief Lane of the plugin in the trace. 0 if tracing was disabled when run() was called.
+     */
+    qint64 _traceLane;
+
+    /*!
+     * \brief Time at which run() was called (see BakeryTrace::now()).
+     */
+    qint64 _traceStart;
+
+    /*!
+     * \brief Disconnects the process and returns it to the pool.
+     */
+    void releaseProcess();
+
+    /*!
+     * \brief Writes the bake command like write(QString) and records it in the trace.
+     * \param data Bake command.
+     * \return true if all data was written.
+     */
+    bool writeInput(QString data);
+
+    /*!
+     * \brief Records the end of the job in the trace.
+     * \param exitCode Exit code reported by finished(int, QString, PluginInput, PluginOutput).
+     */
+    void traceExit(int exitCode);
+
+public slots:
     /*!
      * \brief Kills the process.
      */
     void kill();
 
+private slots:
     /*!
      * \brief Reads lines from the process standard output channel, parses them and emits outputUpdated(QString,
-     * PluginOutput) if applicable.
+     * PluginOutput) if applicable. For pooled processes the line "bake_finished" finishes the job.
      */
     void processReadyRead();
 
@@ -460,7 +1006,137 @@ private slots:
     void processFinished(int exitCode);
 };
 
-// Convenience plugin main function macro.
+/*!
+ * \brief Plugin runner for in-process plugins.
+ *
+ * The plugin instance is created by a PluginFactory and runs on its own worker thread. The input is handed over without serialization
+ * (PluginInput is implicitly shared) and outputs are delivered back through queued signals.
+ */
+class BAKERYSHARED_EXPORT PluginLibraryRunner : public AbstractPluginRunner
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief Constructor.
+     * \param pluginName Name of the plugin.
+     * \param factory Factory of the plugin library.
+     * \param pluginInput Input to be processed.
+     * \param parent QObject parent.
+     */
+    explicit PluginLibraryRunner(QString pluginName = QString(), PluginFactory *factory = 0, PluginInput pluginInput = PluginInput(),
+                                 QObject *parent = 0);
+
+    /*!
+     * \brief Destructor. A plugin which is still running is abandoned and cleans up after itself when finished.
+     */
+    ~PluginLibraryRunner();
+
+    /*!
+     * \brief Creates a plugin instance, moves it to a worker thread and starts processing the input.
+     * \return true if successful.
+     */
+    bool run();
+
+    /*!
+     * \brief Calls the terminate slot of the plugin instance.
+     * \param timeout Timeout in milliseconds.
+     * \return true if successful.
+     */
+    bool terminate(int timeout);
+
+    /*!
+     * \brief Queries the metadata of the plugin. The instance used for this is created and destroyed in the calling thread.
+     * \param meta Will be set to the metadata of the plugin.
+     * \return true if successful.
+     */
+    bool queryMetadata(PluginMetadata &meta);
+
+private:
+    /*!
+     * \brief Factory of the plugin library.
+     */
+    PluginFactory *_factory;
+
+    /*!
+     * \brief Running plugin instance. Lives in _thread.
+     */
+    QObject *_instance;
+
+    /*!
+     * \brief Worker thread of the plugin instance.
+     */
+    QThread *_thread;
+
+    /*!
+     * \brief Deadline of the plugin instance. Is owned by _thread.
+     */
+    PluginDeadline *_instanceDeadline;
+
+    /*!
+     * \brief Metadata received in queryMetadata(PluginMetadata &).
+     */
+    PluginMetadata _metadata;
+
+    /*!
+     * \brief true if metadata was received in queryMetadata(PluginMetadata &).
+     */
+    bool _metadataReceived;
+
+    /*!
+     * \brief true if finished(int, QString, PluginInput, PluginOutput) was emitted.
+     */
+    bool _finished;
+
+    /*!
+     * \brief Stops the worker thread once the plugin instance returns and disconnects it from the runner.
+     */
+    void releaseInstance();
+
+signals:
+    /*!
+     * \brief Is connected to the bakeSheets slot of the plugin instance.
+     * \param input PluginInput.
+     */
+    void bakeSheets(PluginInput input);
+
+    /*!
+     * \brief Is connected to the terminate slot of the plugin instance.
+     * \param msec Timeout in milliseconds.
+     */
+    void terminateInstance(qint32 msec);
+
+public slots:
+    /*!
+     * \brief Abandons the plugin instance and emits finished(int, QString, PluginInput, PluginOutput) with the last output.
+     *
+     * Threads can not be killed safely. The instance is told to terminate immediately and cleans up after itself when it returns.
+     */
+    void kill();
+
+private slots:
+    /*!
+     * \brief Stores metadata provided by the plugin instance.
+     * \param meta Metadata.
+     */
+    void instanceMetadataGiven(PluginMetadata meta);
+
+    /*!
+     * \brief Emits outputUpdated(QString, PluginOutput).
+     * \param output PluginOutput.
+     */
+    void instanceOutputUpdated(PluginOutput output);
+
+    /*!
+     * \brief Emits finished(int, QString, PluginInput, PluginOutput).
+     * \param output PluginOutput.
+     */
+    void instanceFinished(PluginOutput output);
+};
+
+// Convenience plugin main function macro. Plugin libraries are loaded through their PluginFactory and have no main function.
+#ifdef BAKERY_PLUGIN_LIBRARY
+#define BAKERY_PLUGIN_MAIN(className)
+#else
 #define BAKERY_PLUGIN_MAIN(className)                                                                                                      \
     int main(int argc, char *argv[])                                                                                                       \
     {                                                                                                                                      \
@@ -470,6 +1146,7 @@ private slots:
         wrapper.run();                                                                                                                     \
         return application.exec();                                                                                                         \
     }
+#endif
 
 // Convenience plugin log text stream macro.
 #define LOG_TEXT_STREAM(fileName)                                                                                                          \
@@ -479,7 +1156,7 @@ private slots:
 
 /*!
  * \relates PluginInput
- * \brief Operator overloading to send a PluginInput object to a text stream.
+ * \brief Operator overloading to send a PluginInput object to a text stream. Every piece is written on its own.
  * \param stream Target text stream.
  * \param input PluginInput to send.
  * \return Reference to text stream.
@@ -547,7 +1224,7 @@ BAKERYSHARED_EXPORT QTextStream &operator>>(QTextStream &stream, PluginMetadata
  * Two PluginInput objects are considered equal if all of the following conditions are met:
  *  - PluginInput::sheetWidth is equal.
  *  - PluginInput::sheetHeight is equal.
- *  - PluginInput::shapes is equal.
+ *  - PluginInput::stock() is equal, i.e. the same number of pieces of the same types in the same type order.
  *
  * \param left Left side of comparison.
  * \param right Right side of comparison.
@@ -578,6 +1255,8 @@ BAKERYSHARED_EXPORT bool operator==(const PluginOutput &left, const PluginOutput
  *  - PluginMetadata::type is equal.
  *  - PluginMetadata::license is equal.
  *
+ * PluginMetadata::capabilities are not compared, as an executable and a library of the same plugin differ in them.
+ *
  * \param left Left side of comparison.
  * \param right Right side of comparison.
  * \return true if both are equal.
@@ -586,10 +1265,13 @@ BAKERYSHARED_EXPORT bool operator==(const PluginMetadata &left, const PluginMeta
 
 /*!
  * \relates PluginOutput
- * \brief Same as BakeryPlugins::outputScore(left) <= BakeryPlugins::outputScore(right).
+ * \brief Same as BakeryPlugins::outputScore(left) < BakeryPlugins::outputScore(right).
+ *
+ * Both scores are computed on every call. Use ScoredOutput to compare outputs repeatedly, e.g. when sorting.
+ *
  * \param left First PluginOutput.
  * \param right Second PluginOutput.
- * \return
+ * \return true if left has a lower score.
  */
 BAKERYSHARED_EXPORT bool operator<(const PluginOutput &left, const PluginOutput &right);
 
@@ -623,6 +1305,19 @@ inline bool operator!=(const PluginOutput &left, const PluginOutput &right) { re
  */
 inline bool operator!=(const PluginMetadata &left, const PluginMetadata &right) { return !(left == right); }
 
+/*!
+ * \brief Span of a plugin's own work, e.g. the placement of a sheet or shape, which is shown in the trace of the host.
+ *
+ * The span covers its scope. Spans are only recorded while the host traces the job, otherwise they cost a relaxed load:
+ * \code
+ * PluginSpan span("place shape");
+ * span.setArgument("shape", shape.name());
+ * \endcode
+ *
+ * \sa BakeryTrace::Span
+ */
+typedef BakeryTrace::Span PluginSpan;
+
 namespace BakeryPlugins
 {
 /*!
@@ -632,6 +1327,80 @@ namespace BakeryPlugins
  * \return Score.
  */
 BAKERYSHARED_EXPORT qreal outputScore(const PluginOutput &output);
+
+/*!
+ * \brief Sends a PluginInput object to a text stream.
+ *
+ * By default the input is written as a list containing every piece. Identical pieces can be written once together with their number
+ * (shape stock) instead. Only plugins with the capability "shapestock" can read this encoding.
+ *
+ * \param stream Target text stream.
+ * \param input PluginInput to send.
+ * \param shapeStock If true, the input is written as shape stock if it contains identical pieces.
+ * \return Reference to text stream.
+ * \sa operator<<(QTextStream &stream, const PluginInput &input)
+ */
+BAKERYSHARED_EXPORT QTextStream &writePluginInput(QTextStream &stream, const PluginInput &input, bool shapeStock);
+
+/*!
+ * \brief Returns a key for a new shared memory segment which is unique within the system.
+ * \return Key.
+ */
+BAKERYSHARED_EXPORT QString uniqueSharedMemoryKey();
+
+/*!
+ * \brief Returns if the deadline of the current job has been reached. This is cheap enough to be called in inner loops.
+ * \param fraction Fraction of the time between receiving the deadline and the deadline (1.0 is the deadline itself).
+ * \return true if the deadline has been reached. Always false if the current job has no deadline.
+ * \sa PluginDeadline::current()
+ */
+BAKERYSHARED_EXPORT bool deadlineReached(qreal fraction = 1.0);
+
+/*!
+ * \brief Returns the time until the deadline of the current job.
+ * \return Remaining time in milliseconds (at least 0) or -1 if the current job has no deadline.
+ */
+BAKERYSHARED_EXPORT qint64 remainingTime();
+
+/*!
+ * \brief Returns the number of threads the current job may use.
+ * \return Thread budget passed by the host or QThread::idealThreadCount() if none was passed.
+ */
+BAKERYSHARED_EXPORT qint32 threadBudget();
+
+/*!
+ * \brief Sets the number of threads the job running in the calling thread may use.
+ * \param threads Number of threads. If 0, the budget is reset.
+ */
+BAKERYSHARED_EXPORT void setThreadBudget(qint32 threads);
+
+/*!
+ * \brief Pins threads to the given CPUs. Only supported on Linux.
+ * \param pid Process or thread id. If 0, the calling thread is pinned.
+ * \param cpus CPU numbers.
+ * \param allThreads If true, all threads of the process are pinned.
+ * \return true if successful.
+ */
+BAKERYSHARED_EXPORT bool setCpuAffinity(qint64 pid, const QList<qint32> &cpus, bool allThreads = false);
+
+/*!
+ * \brief Writes data to an attached shared memory segment.
+ *
+ * The segment starts with the length of the data (qint64), followed by the data.
+ *
+ * \param segment Attached segment.
+ * \param data Data.
+ * \return true if the data fits into the segment.
+ */
+BAKERYSHARED_EXPORT bool writeSharedMemory(QSharedMemory *segment, const QByteArray &data);
+
+/*!
+ * \brief Reads data written by writeSharedMemory(QSharedMemory *, const QByteArray &) from an attached shared memory segment.
+ * \param segment Attached segment.
+ * \param ok Will be set to true if no errors occur. Will be ignored if set to NULL.
+ * \return Data.
+ */
+BAKERYSHARED_EXPORT QByteArray readSharedMemory(QSharedMemory *segment, bool *ok = NULL);
 }
 
 #endif // BAKERY_PLUGINS_H
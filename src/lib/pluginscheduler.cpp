@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pluginscheduler.h"
+#include "plugins.h"
+
+#include <QThread>
+
+PluginScheduler::PluginScheduler(QObject *parent)
+    : QObject(parent), _queue(), _running(), _cpuLoad(qMax(QThread::idealThreadCount(), 1), 0), _maximumConcurrent(0),
+      _threadsPerPlugin(0), _pluginThreads(), _cpuAffinity(false)
+{
+}
+
+void PluginScheduler::enqueue(AbstractPluginRunner *runner)
+{
+    if (runner == NULL || _queue.contains(runner) || _running.contains(runner))
+    {
+        return;
+    }
+    _queue.append(runner);
+    startQueued();
+}
+
+bool PluginScheduler::dequeue(AbstractPluginRunner *runner) { return _queue.removeAll(runner) > 0; }
+
+void PluginScheduler::release(AbstractPluginRunner *runner)
+{
+    if (dequeue(runner) || !_running.contains(runner))
+    {
+        return;
+    }
+    foreach (qint32 cpu, _running.take(runner))
+    {
+        --_cpuLoad[cpu];
+    }
+    startQueued();
+}
+
+bool PluginScheduler::isQueued(AbstractPluginRunner *runner) const { return _queue.contains(runner); }
+
+qint32 PluginScheduler::running() const { return _running.size(); }
+
+qint32 PluginScheduler::queued() const { return _queue.size(); }
+
+void PluginScheduler::setMaximumConcurrent(qint32 maximum)
+{
+    _maximumConcurrent = qMax(maximum, 0);
+    startQueued();
+}
+
+qint32 PluginScheduler::maximumConcurrent() const { return _maximumConcurrent; }
+
+void PluginScheduler::setThreadsPerPlugin(qint32 threads) { _threadsPerPlugin = qMax(threads, 0); }
+
+void PluginScheduler::setThreadsPerPlugin(QString pluginName, qint32 threads)
+{
+    if (threads < 0)
+    {
+        _pluginThreads.remove(pluginName);
+    }
+    else
+    {
+        _pluginThreads[pluginName] = threads;
+    }
+}
+
+qint32 PluginScheduler::threadsPerPlugin(QString pluginName) const { return _pluginThreads.value(pluginName, _threadsPerPlugin); }
+
+void PluginScheduler::setCpuAffinityEnabled(bool enabled) { _cpuAffinity = enabled; }
+
+bool PluginScheduler::isCpuAffinityEnabled() const { return _cpuAffinity; }
+
+void PluginScheduler::startQueued()
+{
+    while (!_queue.isEmpty() && (_maximumConcurrent == 0 || _running.size() < _maximumConcurrent))
+    {
+        AbstractPluginRunner *runner = _queue.takeFirst();
+        qint32 threads = threadsPerPlugin(runner->pluginName());
+        QList<qint32> cpus;
+        if (_cpuAffinity)
+        {
+            cpus = allocateCpus(qMax(threads, 1));
+        }
+        _running[runner] = cpus;
+        runner->setThreads(threads);
+        runner->setCpus(cpus);
+
+        // The receiver might release the runner right away if it fails to start, which modifies the queue
+        emit runnerReady(runner);
+    }
+}
+
+QList<qint32> PluginScheduler::allocateCpus(qint32 count)
+{
+    QList<qint32> cpus;
+    count = qMin(count, _cpuLoad.size());
+    for (qint32 i_cpu = 0; i_cpu < count; ++i_cpu)
+    {
+        qint32 best = -1;
+        for (qint32 i_candidate = 0; i_candidate < _cpuLoad.size(); ++i_candidate)
+        {
+            if (!cpus.contains(i_candidate) && (best == -1 || _cpuLoad[i_candidate] < _cpuLoad[best]))
+            {
+                best = i_candidate;
+            }
+        }
+        cpus << best;
+        ++_cpuLoad[best];
+    }
+    return cpus;
+}
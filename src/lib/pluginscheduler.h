@@ -0,0 +1,194 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAKERY_PLUGINSCHEDULER_H
+#define BAKERY_PLUGINSCHEDULER_H
+
+#include "global.h"
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QString>
+
+class AbstractPluginRunner;
+
+/*!
+ * \brief Limits the number of plugins running at the same time.
+ *
+ * Runners are queued with enqueue(AbstractPluginRunner *). As soon as a slot is free, the runner is assigned a thread budget and - if
+ * CPU affinity is enabled - a set of CPUs and runnerReady(AbstractPluginRunner *) is emitted. The owner of the runner is expected to
+ * start it and to call release(AbstractPluginRunner *) once it has finished. A single scheduler may be shared by several Bakery instances,
+ * so the limit applies to all of them.
+ */
+class BAKERYSHARED_EXPORT PluginScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief Constructor.
+     * \param parent QObject parent.
+     */
+    explicit PluginScheduler(QObject *parent = 0);
+
+    /*!
+     * \brief Queues a runner. If a slot is free, runnerReady(AbstractPluginRunner *) is emitted before this method returns.
+     * \param runner Runner. The scheduler does not take ownership.
+     */
+    void enqueue(AbstractPluginRunner *runner);
+
+    /*!
+     * \brief Removes a runner which has not been started yet from the queue.
+     * \param runner Runner.
+     * \return true if the runner was queued.
+     */
+    bool dequeue(AbstractPluginRunner *runner);
+
+    /*!
+     * \brief Frees the slot of a finished runner and starts the next queued runner. Queued runners are removed from the queue.
+     * \param runner Runner.
+     */
+    void release(AbstractPluginRunner *runner);
+
+    /*!
+     * \brief Returns whether a runner is waiting for a free slot.
+     * \param runner Runner.
+     * \return true if queued.
+     */
+    bool isQueued(AbstractPluginRunner *runner) const;
+
+    /*!
+     * \brief Returns the number of running plugins.
+     * \return Number of running plugins.
+     */
+    qint32 running() const;
+
+    /*!
+     * \brief Returns the number of queued plugins.
+     * \return Number of queued plugins.
+     */
+    qint32 queued() const;
+
+    /*!
+     * \brief Sets the maximum number of plugins running at the same time.
+     * \param maximum Number of plugins. If set to 0 the number is not limited.
+     */
+    void setMaximumConcurrent(qint32 maximum);
+
+    /*!
+     * \brief Returns the maximum number of plugins running at the same time.
+     * \return Number of plugins. 0 if not limited.
+     */
+    qint32 maximumConcurrent() const;
+
+    /*!
+     * \brief Sets the number of threads each plugin may use for plugins without an individual thread budget.
+     * \param threads Number of threads. If set to 0 no budget is passed to plugins.
+     */
+    void setThreadsPerPlugin(qint32 threads);
+
+    /*!
+     * \brief Sets the number of threads a single plugin may use.
+     * \param pluginName Name of the plugin.
+     * \param threads Number of threads. If negative, the default budget is used.
+     */
+    void setThreadsPerPlugin(QString pluginName, qint32 threads);
+
+    /*!
+     * \brief Returns the number of threads a plugin may use.
+     * \param pluginName Name of the plugin. If empty, the default budget is returned.
+     * \return Number of threads. 0 if no budget is passed.
+     */
+    qint32 threadsPerPlugin(QString pluginName = QString()) const;
+
+    /*!
+     * \brief Sets whether plugins are pinned to CPUs. Only supported on Linux.
+     *
+     * Each plugin gets as many CPUs as its thread budget (at least one). The least used CPUs are chosen, so plugins only share CPUs if
+     * there are more threads than CPUs.
+     *
+     * \param enabled If true, plugins are pinned.
+     */
+    void setCpuAffinityEnabled(bool enabled);
+
+    /*!
+     * \brief Returns whether plugins are pinned to CPUs.
+     * \return true if plugins are pinned.
+     */
+    bool isCpuAffinityEnabled() const;
+
+signals:
+    /*!
+     * \brief Is emitted when a queued runner may be started. Thread budget and CPUs are already set.
+     * \param runner Runner.
+     */
+    void runnerReady(AbstractPluginRunner *runner);
+
+private:
+    /*!
+     * \brief Runners waiting for a free slot.
+     */
+    QList<AbstractPluginRunner *> _queue;
+
+    /*!
+     * \brief Running runners and the CPUs assigned to them.
+     */
+    QHash<AbstractPluginRunner *, QList<qint32>> _running;
+
+    /*!
+     * \brief Number of plugins pinned to each CPU.
+     */
+    QVector<qint32> _cpuLoad;
+
+    /*!
+     * \brief Maximum number of plugins running at the same time.
+     */
+    qint32 _maximumConcurrent;
+
+    /*!
+     * \brief Default thread budget.
+     */
+    qint32 _threadsPerPlugin;
+
+    /*!
+     * \brief Individual thread budgets.
+     */
+    QHash<QString, qint32> _pluginThreads;
+
+    /*!
+     * \brief If true, plugins are pinned to CPUs.
+     */
+    bool _cpuAffinity;
+
+    /*!
+     * \brief Starts queued runners while slots are free.
+     */
+    void startQueued();
+
+    /*!
+     * \brief Chooses the least used CPUs.
+     * \param count Number of CPUs.
+     * \return CPU numbers.
+     */
+    QList<qint32> allocateCpus(qint32 count);
+};
+
+#endif // BAKERY_PLUGINSCHEDULER_H
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "resultcache.h"
+#include "bakery.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTextStream>
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <utime.h>
+#endif
+
+ResultCache::ResultCache(QObject *parent)
+    : QObject(parent), _directory(QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).absoluteFilePath("results")),
+      _maximumSize(Q_INT64_C(256) * 1024 * 1024), _binaryHashes()
+{
+}
+
+void ResultCache::setDirectory(QString path) { _directory = path; }
+
+QString ResultCache::directory() const { return _directory; }
+
+void ResultCache::setMaximumSize(qint64 bytes)
+{
+    _maximumSize = qMax(bytes, Q_INT64_C(0));
+    evict();
+}
+
+qint64 ResultCache::maximumSize() const { return _maximumSize; }
+
+QByteArray ResultCache::inputHash(const PluginInput &input)
+{
+    // Plugins may place shapes in any order, so the order of the input does not matter for the result
+    QStringList shapes;
+    const ShapeStock &stock = input.stock();
+    for (qint32 i_type = 0; i_type < stock.types(); ++i_type)
+    {
+        QString data;
+        QTextStream stream(&data);
+        stream << stock.prototype(i_type);
+        stream.flush();
+        for (qint32 i_piece = 0; i_piece < stock.count(i_type); ++i_piece)
+        {
+            shapes << data;
+        }
+    }
+    std::sort(shapes.begin(), shapes.end());
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QString("%1 %2 %3 ").arg(BAKERY_PRECISION).arg(input.sheetWidth).arg(input.sheetHeight).toLatin1());
+    foreach (QString shape, shapes)
+    {
+        hash.addData(shape.toLatin1());
+    }
+    return hash.result();
+}
+
+QByteArray ResultCache::binaryHash(QString path)
+{
+    QFileInfo info(path);
+    QString stamp = QString("%1 %2").arg(info.size()).arg(info.lastModified().toMSecsSinceEpoch());
+    if (_binaryHashes.contains(path) && _binaryHashes[path].first == stamp)
+    {
+        return _binaryHashes[path].second;
+    }
+
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly))
+    {
+        return QByteArray();
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!hash.addData(&file))
+    {
+        return QByteArray();
+    }
+    _binaryHashes[path] = qMakePair(stamp, hash.result());
+    return _binaryHashes[path].second;
+}
+
+QString ResultCache::key(QByteArray inputHash, QString pluginName, QString pluginPath, qint32 timeLimit, ScoredOutput::Objective objective,
+                         qreal simplificationTolerance)
+{
+    QByteArray pluginHash = binaryHash(pluginPath);
+    if (pluginHash.isEmpty())
+    {
+        return QString();
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(inputHash);
+    hash.addData(pluginName.toUtf8());
+    hash.addData(pluginHash);
+    hash.addData(QByteArray::number(timeLimit));
+    hash.addData(QByteArray::number(qint32(objective)));
+    hash.addData(QByteArray::number(simplificationTolerance, 'g', 17));
+    return QString(hash.result().toHex());
+}
+
+bool ResultCache::lookup(QString key, const PluginInput &input, PluginOutput &output)
+{
+    if (key.isEmpty())
+    {
+        return false;
+    }
+    QFile file(entryPath(key));
+    if (!file.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+    QTextStream stream(&file);
+    PluginOutput cached;
+    stream >> cached;
+    bool valid = stream.status() == QTextStream::Ok && !cached.sheets.isEmpty() && Bakery::isOutputValidForInput(input, cached);
+    file.close();
+    if (!valid)
+    {
+        BAKERY_WARNING(QString("Removing invalid result cache entry '%1'").arg(key));
+        QFile::remove(entryPath(key));
+        return false;
+    }
+
+#ifdef Q_OS_UNIX
+    // The modification time tells eviction when an entry was used last
+    utime(QFile::encodeName(entryPath(key)).constData(), NULL);
+#endif
+    output = cached;
+    return true;
+}
+
+bool ResultCache::store(QString key, const PluginOutput &output)
+{
+    if (key.isEmpty() || !QDir().mkpath(_directory))
+    {
+        return false;
+    }
+
+    QSaveFile file(entryPath(key));
+    if (!file.open(QFile::WriteOnly))
+    {
+        BAKERY_WARNING(QString("Failed to open result cache entry '%1'").arg(file.fileName()));
+        return false;
+    }
+    QTextStream stream(&file);
+    stream << output;
+    stream.flush();
+    if (stream.status() != QTextStream::Ok || !file.commit())
+    {
+        BAKERY_WARNING(QString("Failed to write result cache entry '%1'").arg(file.fileName()));
+        return false;
+    }
+    evict();
+    return true;
+}
+
+void ResultCache::clear()
+{
+    QDir directory(_directory);
+    foreach (QString fileName, directory.entryList(QStringList() << "*.txt", QDir::Files))
+    {
+        directory.remove(fileName);
+    }
+}
+
+qint64 ResultCache::size() const
+{
+    qint64 size = 0;
+    foreach (QFileInfo info, QDir(_directory).entryInfoList(QStringList() << "*.txt", QDir::Files))
+    {
+        size += info.size();
+    }
+    return size;
+}
+
+QString ResultCache::entryPath(QString key) const { return QDir(_directory).absoluteFilePath(key + ".txt"); }
+
+void ResultCache::evict()
+{
+    if (_maximumSize == 0)
+    {
+        return;
+    }
+    QFileInfoList entries = QDir(_directory).entryInfoList(QStringList() << "*.txt", QDir::Files, QDir::Time | QDir::Reversed);
+    qint64 size = 0;
+    foreach (QFileInfo info, entries)
+    {
+        size += info.size();
+    }
+    for (QFileInfoList::ConstIterator i_entry = entries.constBegin(); size > _maximumSize && i_entry != entries.constEnd(); ++i_entry)
+    {
+        if (QFile::remove(i_entry->absoluteFilePath()))
+        {
+            size -= i_entry->size();
+        }
+    }
+}
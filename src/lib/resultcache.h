@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAKERY_RESULTCACHE_H
+#define BAKERY_RESULTCACHE_H
+
+#include "global.h"
+#include "plugins.h"
+#include "scoredoutput.h"
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QPair>
+#include <QString>
+
+/*!
+ * \brief On-disk cache of plugin outputs.
+ *
+ * Entries are addressed by a key built from a canonical hash of the PluginInput, the plugin name, a hash of the plugin binary, the time
+ * limit, the objective and the simplification tolerance. Each entry is stored in a file of its own in the cache directory. If the total
+ * size of all entries exceeds the maximum size, the least recently used entries are removed.
+ */
+class BAKERYSHARED_EXPORT ResultCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    /*!
+     * \brief Constructor.
+     * \param parent QObject parent.
+     */
+    explicit ResultCache(QObject *parent = 0);
+
+    /*!
+     * \brief Sets the directory in which entries are stored. By default QStandardPaths::CacheLocation/results is used.
+     * \param path Path to directory. Will be created if it does not exist.
+     */
+    void setDirectory(QString path);
+
+    /*!
+     * \brief Returns the directory in which entries are stored.
+     * \return Path to directory.
+     */
+    QString directory() const;
+
+    /*!
+     * \brief Sets the maximum size of all entries. Default: 256 MiB.
+     * \param bytes Size in bytes. If set to 0 the size is not limited.
+     */
+    void setMaximumSize(qint64 bytes);
+
+    /*!
+     * \brief Returns the maximum size of all entries.
+     * \return Size in bytes.
+     */
+    qint64 maximumSize() const;
+
+    /*!
+     * \brief Returns a canonical hash of a PluginInput. The hash does not depend on the order of the shapes.
+     * \param input PluginInput.
+     * \return SHA1 hash.
+     */
+    static QByteArray inputHash(const PluginInput &input);
+
+    /*!
+     * \brief Returns a hash of the contents of a plugin binary. Hashes are kept in memory as long as size and modification time of the
+     * file do not change.
+     * \param path Path to plugin executable or library.
+     * \return SHA1 hash or an empty QByteArray if the file can not be read.
+     */
+    QByteArray binaryHash(QString path);
+
+    /*!
+     * \brief Returns the key of an entry.
+     * \param inputHash Hash of the input (see inputHash(const PluginInput &)).
+     * \param pluginName Name of the plugin.
+     * \param pluginPath Path to the plugin binary.
+     * \param timeLimit Time limit in milliseconds.
+     * \param objective Objective the plugin was run with.
+     * \param simplificationTolerance Tolerance the shapes were simplified with before they were passed to the plugin.
+     * \return Key or an empty string if the plugin binary can not be read.
+     */
+    QString key(QByteArray inputHash, QString pluginName, QString pluginPath, qint32 timeLimit, ScoredOutput::Objective objective,
+                qreal simplificationTolerance);
+
+    /*!
+     * \brief Looks up an entry. Entries which are not valid for the input are removed.
+     * \param key Key of the entry.
+     * \param input PluginInput the entry was computed for.
+     * \param output Will be set to the cached output.
+     * \return true if a valid entry was found.
+     */
+    bool lookup(QString key, const PluginInput &input, PluginOutput &output);
+
+    /*!
+     * \brief Stores an entry and evicts old entries if the maximum size is exceeded.
+     * \param key Key of the entry.
+     * \param output PluginOutput.
+     * \return true if successful.
+     */
+    bool store(QString key, const PluginOutput &output);
+
+    /*!
+     * \brief Removes all entries.
+     */
+    void clear();
+
+    /*!
+     * \brief Returns the total size of all entries.
+     * \return Size in bytes.
+     */
+    qint64 size() const;
+
+private:
+    /*!
+     * \brief Cache directory.
+     */
+    QString _directory;
+
+    /*!
+     * \brief Maximum size of all entries.
+     */
+    qint64 _maximumSize;
+
+    /*!
+     * \brief Hashes of plugin binaries by path together with the size and modification time they were computed for.
+     */
+    QHash<QString, QPair<QString, QByteArray>> _binaryHashes;
+
+    /*!
+     * \brief Returns the path of the file containing an entry.
+     * \param key Key of the entry.
+     * \return Path to file.
+     */
+    QString entryPath(QString key) const;
+
+    /*!
+     * \brief Removes the least recently used entries until the maximum size is not exceeded.
+     */
+    void evict();
+};
+
+#endif // BAKERY_RESULTCACHE_H
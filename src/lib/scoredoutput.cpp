@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "scoredoutput.h"
+#include "helpers.hpp"
+
+ScoredOutput::ScoredOutput() : _output(), _objective(AverageUtilization), _score(0.0), _secondaryScore(0.0) {}
+
+ScoredOutput::ScoredOutput(const PluginOutput &output, Objective objective)
+    : _output(output), _objective(objective), _score(0.0), _secondaryScore(0.0)
+{
+    if (output.sheets.isEmpty())
+    {
+        return;
+    }
+
+    switch (objective)
+    {
+    case AverageUtilization:
+        _score = BakeryPlugins::outputScore(output);
+        break;
+    case SheetsThenUtilization:
+        _score = -output.sheets.size();
+        foreach (const Sheet &sheet, output.sheets)
+        {
+            qreal utilitization = sheet.utilitization();
+            _secondaryScore += utilitization * utilitization;
+        }
+        _secondaryScore = _secondaryScore * 100 / output.sheets.size();
+        break;
+    case Density:
+        foreach (const Sheet &sheet, output.sheets)
+        {
+            _score += sheet.density();
+        }
+        _score = _score * 100 / (output.sheets.size() * output.sheets.size());
+        break;
+    }
+}
+
+const PluginOutput &ScoredOutput::output() const { return _output; }
+
+ScoredOutput::Objective ScoredOutput::objective() const { return _objective; }
+
+qreal ScoredOutput::score() const { return _score; }
+
+qreal ScoredOutput::secondaryScore() const { return _secondaryScore; }
+
+qint32 ScoredOutput::best(const QList<PluginOutput> &outputs, Objective objective)
+{
+    qint32 bestIndex = -1;
+    ScoredOutput best;
+    for (qint32 i_output = 0; i_output < outputs.size(); ++i_output)
+    {
+        ScoredOutput candidate(outputs[i_output], objective);
+        if (bestIndex == -1 || best < candidate)
+        {
+            bestIndex = i_output;
+            best = candidate;
+        }
+    }
+    return bestIndex;
+}
+
+QString ScoredOutput::objectiveName(Objective objective)
+{
+    switch (objective)
+    {
+    case AverageUtilization:
+        return "utilization";
+    case SheetsThenUtilization:
+        return "sheets";
+    case Density:
+        return "density";
+    }
+    return QString();
+}
+
+ScoredOutput::Objective ScoredOutput::objectiveFromName(QString name, bool *ok)
+{
+    foreach (Objective objective, QList<Objective>() << AverageUtilization << SheetsThenUtilization << Density)
+    {
+        if (objectiveName(objective) == name)
+        {
+            BakeryHelpers::setBool(ok, true);
+            return objective;
+        }
+    }
+    BakeryHelpers::setBool(ok, false);
+    return AverageUtilization;
+}
+
+QStringList ScoredOutput::objectiveNames()
+{
+    return QStringList() << objectiveName(AverageUtilization) << objectiveName(SheetsThenUtilization) << objectiveName(Density);
+}
+
+bool operator<(const ScoredOutput &left, const ScoredOutput &right)
+{
+    return left.score() < right.score() || (left.score() == right.score() && left.secondaryScore() < right.secondaryScore());
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAKERY_SCOREDOUTPUT_H
+#define BAKERY_SCOREDOUTPUT_H
+
+#include "global.h"
+#include "plugins.h"
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+/*!
+ * \brief A PluginOutput together with its score under an objective.
+ *
+ * The score is computed once on construction, so comparing ScoredOutput objects is cheap. Comparisons are a strict weak ordering and
+ * can be used with std::sort. Outputs scored under different objectives must not be compared.
+ */
+class BAKERYSHARED_EXPORT ScoredOutput
+{
+public:
+    /*!
+     * \brief Objectives to rank outputs by.
+     */
+    enum Objective
+    {
+        /*!
+         * \brief Higher average utilization of the sheets is better (see BakeryPlugins::outputScore(const PluginOutput &)).
+         */
+        AverageUtilization,
+
+        /*!
+         * \brief Fewer sheets are better. Among outputs with the same number of sheets, higher mean squared utilization is better, i.e.
+         * the shapes are concentrated on few sheets and the emptiest sheet is as empty as possible.
+         */
+        SheetsThenUtilization,
+
+        /*!
+         * \brief Higher arithmeticMean([sheet densities]) / [number of sheets] is better.
+         * \sa Sheet::density()
+         */
+        Density
+    };
+
+    /*!
+     * \brief Constructor. Creates an empty output with score 0.
+     */
+    ScoredOutput();
+
+    /*!
+     * \brief Constructor. Scores the output.
+     * \param output PluginOutput.
+     * \param objective Objective to score by.
+     */
+    explicit ScoredOutput(const PluginOutput &output, Objective objective = AverageUtilization);
+
+    /*!
+     * \brief Returns the output.
+     * \return PluginOutput.
+     */
+    const PluginOutput &output() const;
+
+    /*!
+     * \brief Returns the objective the output was scored by.
+     * \return Objective.
+     */
+    Objective objective() const;
+
+    /*!
+     * \brief Returns the primary score. Higher is better.
+     *
+     * For SheetsThenUtilization this is the negated number of sheets.
+     *
+     * \return Score.
+     */
+    qreal score() const;
+
+    /*!
+     * \brief Returns the score which decides between outputs with the same primary score. Higher is better.
+     * \return Score. 0 if the objective has no secondary score.
+     */
+    qreal secondaryScore() const;
+
+    /*!
+     * \brief Returns the output with the best score. Each output is scored once.
+     * \param outputs List of outputs.
+     * \param objective Objective to score by.
+     * \return Index of the best output. The first one wins ties. -1 if the list is empty.
+     */
+    static qint32 best(const QList<PluginOutput> &outputs, Objective objective = AverageUtilization);
+
+    /*!
+     * \brief Returns the name of an objective as used on the command line.
+     * \param objective Objective.
+     * \return Name.
+     */
+    static QString objectiveName(Objective objective);
+
+    /*!
+     * \brief Returns the objective with the given name.
+     * \param name Name as returned by objectiveName(Objective).
+     * \param ok Is set to false if no objective has that name.
+     * \return Objective. AverageUtilization if the name is unknown.
+     */
+    static Objective objectiveFromName(QString name, bool *ok = 0);
+
+    /*!
+     * \brief Returns the names of all objectives.
+     * \return List of names.
+     */
+    static QStringList objectiveNames();
+
+private:
+    /*!
+     * \brief Scored output.
+     */
+    PluginOutput _output;
+
+    /*!
+     * \brief Objective.
+     */
+    Objective _objective;
+
+    /*!
+     * \brief Primary score.
+     */
+    qreal _score;
+
+    /*!
+     * \brief Secondary score.
+     */
+    qreal _secondaryScore;
+};
+
+/*!
+ * \relates ScoredOutput
+ * \brief Operator to compare two ScoredOutput objects.
+ * \param left Left side of comparison.
+ * \param right Right side of comparison.
+ * \return true if left has a lower primary score, or the same primary score and a lower secondary score.
+ */
+BAKERYSHARED_EXPORT bool operator<(const ScoredOutput &left, const ScoredOutput &right);
+
+#endif // BAKERY_SCOREDOUTPUT_H
@@ -20,6 +20,7 @@
 #include "shape.h"
 
 #include "helpers.hpp"
+#include "counters.h"
 
 #include <QTransform>
 
@@ -27,6 +28,7 @@ Shape::Shape(QString name) : _name(name), _simple(true), _updateMetrics(true) {}
 
 Shape::Shape(const Shape &other) : QPolygon(other)
 {
+    BakeryCounters::increment(BakeryCounters::ShapeCopies);
     _name = other._name;
     _simple = other._simple;
     _edges = other._edges;
@@ -72,6 +74,7 @@ void Shape::updateMetrics()
     {
         return;
     }
+    BakeryCounters::increment(BakeryCounters::UpdateMetrics);
 
     // Edges, signed area, inner distances and centroid
     qint64 cx = 0, cy = 0;
@@ -232,11 +235,14 @@ bool Shape::intersects(const Shape &other) const
 {
     // Polygons do not intersect if their bounding rectangles do not intersect.
     // This is a cost-effective pre-test
+    BakeryCounters::increment(BakeryCounters::ShapeIntersects);
     if (boundingRect().intersected(other.boundingRect()).size().isEmpty())
     {
+        BakeryCounters::increment(BakeryCounters::BoundingBoxRejects);
         return false;
     }
 
+    BakeryCounters::increment(BakeryCounters::ExactTests);
     return intersected(other).size() > 0;
 }
 
@@ -372,7 +378,7 @@ Shape::Unique Shape::reduceToUnique(const QList<Shape> &shapes)
     Unique unique;
     for (QList<Shape>::ConstIterator i_shape = shapes.begin(); i_shape != shapes.end(); ++i_shape)
     {
-        if (!unique.names.contains(i_shape->name()))
+        if (!unique.amounts.contains(i_shape->name()))
         {
             unique.shapes << *i_shape;
             unique.names << i_shape->name();
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "shapestock.h"
+
+ShapeStock::ShapeStock() : _prototypes(), _counts(), _indices(), _total(0) {}
+
+ShapeStock::ShapeStock(const QList<Shape> &shapes) : _prototypes(), _counts(), _indices(), _total(0)
+{
+    foreach (const Shape &shape, shapes)
+    {
+        add(shape);
+    }
+}
+
+void ShapeStock::add(const Shape &prototype, qint32 count)
+{
+    if (count < 0)
+    {
+        BAKERY_WARNING("Negative number of pieces");
+        return;
+    }
+    QHash<QString, qint32>::ConstIterator i_index = _indices.constFind(prototype.name());
+    if (i_index != _indices.constEnd())
+    {
+        // Pieces are identified by name only, so a different geometry would silently be replaced by the one of the existing type
+        if ((QPolygon)prototype != (QPolygon)_prototypes[i_index.value()])
+        {
+            BAKERY_WARNING(QString("Shape '%1' differs from the existing type of the same name").arg(prototype.name()));
+            return;
+        }
+        _counts[i_index.value()] += count;
+    }
+    else
+    {
+        _indices[prototype.name()] = _prototypes.size();
+        _prototypes << prototype;
+        _counts << count;
+    }
+    _total += count;
+}
+
+qint32 ShapeStock::types() const { return _prototypes.size(); }
+
+const Shape &ShapeStock::prototype(qint32 type) const { return _prototypes[type]; }
+
+QList<Shape> ShapeStock::prototypes() const { return _prototypes; }
+
+qint32 ShapeStock::count(qint32 type) const { return _counts.value(type, 0); }
+
+qint32 ShapeStock::count(const QString &name) const { return count(indexOf(name)); }
+
+qint32 ShapeStock::indexOf(const QString &name) const { return _indices.value(name, -1); }
+
+qint32 ShapeStock::total() const { return _total; }
+
+bool ShapeStock::isEmpty() const { return _total == 0; }
+
+bool ShapeStock::take(qint32 type)
+{
+    if (type < 0 || type >= _counts.size() || _counts[type] == 0)
+    {
+        return false;
+    }
+    --_counts[type];
+    --_total;
+    return true;
+}
+
+bool ShapeStock::take(const QString &name) { return take(indexOf(name)); }
+
+qint32 ShapeStock::typeOfPiece(qint32 piece) const
+{
+    if (piece < 0)
+    {
+        return -1;
+    }
+    for (qint32 i_type = 0; i_type < _counts.size(); ++i_type)
+    {
+        if (piece < _counts[i_type])
+        {
+            return i_type;
+        }
+        piece -= _counts[i_type];
+    }
+    return -1;
+}
+
+QList<Shape> ShapeStock::toList() const
+{
+    QList<Shape> shapes;
+    shapes.reserve(_total);
+    for (qint32 i_type = 0; i_type < _prototypes.size(); ++i_type)
+    {
+        for (qint32 i_piece = 0; i_piece < _counts[i_type]; ++i_piece)
+        {
+            shapes << _prototypes[i_type];
+        }
+    }
+    return shapes;
+}
+
+bool operator==(const ShapeStock &left, const ShapeStock &right)
+{
+    return left._total == right._total && left._counts == right._counts && left._prototypes == right._prototypes;
+}
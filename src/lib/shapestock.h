@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAKERY_SHAPESTOCK_H
+#define BAKERY_SHAPESTOCK_H
+
+#include "global.h"
+#include "shape.h"
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+/*!
+ * \brief Stock of shapes stored as prototypes with the number of remaining pieces.
+ *
+ * Pieces of the same type share one prototype, so a large order needs memory proportional to the number of types instead of the number
+ * of pieces. Types are identified by the name of their prototype. Taking a piece only decrements a counter; types keep their index even if
+ * no piece is left.
+ */
+class BAKERYSHARED_EXPORT ShapeStock
+{
+public:
+    /*!
+     * \brief Constructor. Creates an empty stock.
+     */
+    ShapeStock();
+
+    /*!
+     * \brief Constructor. Groups a flat list of pieces by name.
+     * \param shapes List of pieces. The first piece of each name becomes the prototype of its type. See add(const Shape &, qint32).
+     */
+    explicit ShapeStock(const QList<Shape> &shapes);
+
+    /*!
+     * \brief Adds pieces. If a type with the name of the prototype exists, only its count is increased.
+     *
+     * Pieces are identified by their name. If the geometry of the prototype differs from the existing type of the same name, a warning
+     * is emitted and no pieces are added.
+     *
+     * \param prototype Prototype of the pieces.
+     * \param count Number of pieces.
+     */
+    void add(const Shape &prototype, qint32 count = 1);
+
+    /*!
+     * \brief Returns the number of types, including types without remaining pieces.
+     * \return Number of types.
+     */
+    qint32 types() const;
+
+    /*!
+     * \brief Returns the prototype of a type.
+     * \param type Index of the type.
+     * \return Prototype.
+     */
+    const Shape &prototype(qint32 type) const;
+
+    /*!
+     * \brief Returns the prototypes of all types.
+     * \return List of prototypes.
+     */
+    QList<Shape> prototypes() const;
+
+    /*!
+     * \brief Returns the number of remaining pieces of a type.
+     * \param type Index of the type.
+     * \return Number of pieces.
+     */
+    qint32 count(qint32 type) const;
+
+    /*!
+     * \brief Returns the number of remaining pieces of a type.
+     * \param name Name of the type.
+     * \return Number of pieces. 0 if there is no such type.
+     */
+    qint32 count(const QString &name) const;
+
+    /*!
+     * \brief Returns the index of a type.
+     * \param name Name of the type.
+     * \return Index. -1 if there is no such type.
+     */
+    qint32 indexOf(const QString &name) const;
+
+    /*!
+     * \brief Returns the number of remaining pieces of all types.
+     * \return Number of pieces.
+     */
+    qint32 total() const;
+
+    /*!
+     * \brief Returns whether no pieces are left.
+     * \return true if empty.
+     */
+    bool isEmpty() const;
+
+    /*!
+     * \brief Takes a piece of a type.
+     * \param type Index of the type.
+     * \return false if no piece of the type is left.
+     */
+    bool take(qint32 type);
+
+    /*!
+     * \brief Takes a piece of a type.
+     * \param name Name of the type.
+     * \return false if no piece of the type is left.
+     */
+    bool take(const QString &name);
+
+    /*!
+     * \brief Returns the type of a remaining piece, counting the pieces in order of their types.
+     *
+     * Choosing the piece uniformly at random selects each remaining piece with the same probability, like choosing an element of a
+     * flat list.
+     *
+     * \param piece Index of the piece between 0 and total() - 1.
+     * \return Index of the type. -1 if piece is out of range.
+     */
+    qint32 typeOfPiece(qint32 piece) const;
+
+    /*!
+     * \brief Returns the remaining pieces as a flat list, e.g. for plugins working on PluginInput::shapes().
+     *
+     * The pieces are implicitly shared copies of the prototypes.
+     *
+     * \return List of pieces ordered by type.
+     */
+    QList<Shape> toList() const;
+
+private:
+    /*!
+     * \brief Prototypes of all types.
+     */
+    QList<Shape> _prototypes;
+
+    /*!
+     * \brief Number of remaining pieces by type.
+     */
+    QList<qint32> _counts;
+
+    /*!
+     * \brief Index of each type by name.
+     */
+    QHash<QString, qint32> _indices;
+
+    /*!
+     * \brief Number of remaining pieces.
+     */
+    qint32 _total;
+
+    friend BAKERYSHARED_EXPORT bool operator==(const ShapeStock &left, const ShapeStock &right);
+};
+
+/*!
+ * \relates ShapeStock
+ * \brief Operator to compare stocks. They are considered to be equal if and only if their types have equal prototypes and numbers of
+ * remaining pieces in the same order.
+ * \param left First stock.
+ * \param right Second stock.
+ * \return true if the stocks are equal.
+ */
+BAKERYSHARED_EXPORT bool operator==(const ShapeStock &left, const ShapeStock &right);
+
+/*!
+ * \relates ShapeStock
+ * \brief Inequality operator for stocks.
+ * \param left First stock.
+ * \param right Second stock.
+ * \return true if the stocks are not equal.
+ */
+inline bool operator!=(const ShapeStock &left, const ShapeStock &right) { return !(left == right); }
+
+#endif // BAKERY_SHAPESTOCK_H
@@ -20,6 +20,7 @@
 #include "sheet.h"
 
 #include "helpers.hpp"
+#include "counters.h"
 #include "math.h"
 
 Sheet::Sheet() : _width(1), _height(1), _bounds(QRect(QPoint(0, 0), QPoint(1, 1))) {}
@@ -67,6 +68,7 @@ bool Sheet::isValid() const
 
 bool Sheet::mayPlace(Shape &shape) const
 {
+    BakeryCounters::increment(BakeryCounters::SheetMayPlace);
     Sheet copy(*this);
     copy << shape;
     return copy.isValid();
@@ -0,0 +1,543 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "simplifier.h"
+#include "helpers.hpp"
+#include "sheet.h"
+
+#include <QtCore/qmath.h>
+#include <QHash>
+#include <QLineF>
+#include <QTransform>
+#include <QVector>
+#include <limits>
+
+// Maximum distance between a simplified shape fitted onto its placement and the placement. Plugins round each coordinate after rotating
+static const qreal MAXIMUM_RESIDUAL = 16.0;
+
+/*!
+ * \brief Returns the cross product of origin->first and origin->second.
+ * \param origin Common origin.
+ * \param first End of first vector.
+ * \param second End of second vector.
+ * \return Cross product.
+ */
+static qint64 cross(QPoint origin, QPoint first, QPoint second)
+{
+    return qint64(first.x() - origin.x()) * (second.y() - origin.y()) - qint64(first.y() - origin.y()) * (second.x() - origin.x());
+}
+
+/*!
+ * \brief Returns the dot product of origin->first and origin->second.
+ * \param origin Common origin.
+ * \param first End of first vector.
+ * \param second End of second vector.
+ * \return Dot product.
+ */
+static qint64 dot(QPoint origin, QPoint first, QPoint second)
+{
+    return qint64(first.x() - origin.x()) * (second.x() - origin.x()) + qint64(first.y() - origin.y()) * (second.y() - origin.y());
+}
+
+/*!
+ * \brief Returns the sign of a number.
+ * \param value Number.
+ * \return -1, 0 or 1.
+ */
+static qint32 sign(qint64 value) { return value > 0 ? 1 : (value < 0 ? -1 : 0); }
+
+/*!
+ * \brief Returns a hash key of a point.
+ * \param point Point.
+ * \return Key.
+ */
+static qint64 pointKey(QPoint point) { return (qint64(point.x()) << 32) | quint32(point.y()); }
+
+/*!
+ * \brief Returns true if point lies on the segment from start to end.
+ * \param start Start of the segment.
+ * \param end End of the segment.
+ * \param point Point.
+ * \return true if point lies on the segment.
+ */
+static bool onSegment(QPoint start, QPoint end, QPoint point)
+{
+    return cross(start, end, point) == 0 && qMin(start.x(), end.x()) <= point.x() && point.x() <= qMax(start.x(), end.x()) &&
+           qMin(start.y(), end.y()) <= point.y() && point.y() <= qMax(start.y(), end.y());
+}
+
+/*!
+ * \brief Returns true if two segments have at least one point in common.
+ * \param a Start of the first segment.
+ * \param b End of the first segment.
+ * \param c Start of the second segment.
+ * \param d End of the second segment.
+ * \return true if the segments intersect or touch.
+ */
+static bool segmentsIntersect(QPoint a, QPoint b, QPoint c, QPoint d)
+{
+    qint32 d1 = sign(cross(c, d, a));
+    qint32 d2 = sign(cross(c, d, b));
+    qint32 d3 = sign(cross(a, b, c));
+    qint32 d4 = sign(cross(a, b, d));
+    if (d1 * d2 < 0 && d3 * d4 < 0)
+    {
+        return true;
+    }
+    return (d1 == 0 && onSegment(c, d, a)) || (d2 == 0 && onSegment(c, d, b)) || (d3 == 0 && onSegment(a, b, c)) ||
+           (d4 == 0 && onSegment(a, b, d));
+}
+
+/*!
+ * \brief Returns the distance between a point and a line segment.
+ * \param point Point.
+ * \param start Start of the segment.
+ * \param end End of the segment.
+ * \return Distance.
+ */
+static qreal distanceToSegment(QPointF point, QPointF start, QPointF end)
+{
+    QPointF direction = end - start;
+    qreal lengthSquared = QPointF::dotProduct(direction, direction);
+    qreal t = 0.0;
+    if (lengthSquared > 0.0)
+    {
+        t = qBound(qreal(0.0), QPointF::dotProduct(point - start, direction) / lengthSquared, qreal(1.0));
+    }
+    QPointF difference = point - (start + t * direction);
+    return qSqrt(QPointF::dotProduct(difference, difference));
+}
+
+/*!
+ * \brief Returns true if an edge of a ring intersects any edge of the ring which is not adjacent to it, or folds back onto an adjacent
+ * edge.
+ * \param ring Ring, not closed.
+ * \param edge Index of the edge, which starts at ring[edge].
+ * \return true if the ring is not simple at the edge.
+ */
+static bool edgeIntersectsRing(const QVector<QPoint> &ring, qint32 edge)
+{
+    qint32 size = ring.size();
+    qint32 next = (edge + 1) % size;
+    QPoint start = ring[edge];
+    QPoint end = ring[next];
+    QPoint before = ring[(edge + size - 1) % size];
+    QPoint after = ring[(next + 1) % size];
+    if ((cross(start, before, end) == 0 && dot(start, before, end) > 0) || (cross(end, start, after) == 0 && dot(end, start, after) > 0))
+    {
+        return true;
+    }
+
+    for (qint32 i_edge = 0; i_edge < size; ++i_edge)
+    {
+        qint32 i_next = (i_edge + 1) % size;
+        if (i_edge == edge || i_edge == next || i_next == edge)
+        {
+            continue;
+        }
+        if (segmentsIntersect(start, end, ring[i_edge], ring[i_next]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+ * \brief Returns the largest distance of the original vertices from first to last (cyclic, inclusive) to a polyline.
+ * \param original Original ring.
+ * \param first Index of the first original vertex.
+ * \param last Index of the last original vertex.
+ * \param polyline Polyline.
+ * \return Distance.
+ */
+static qreal deviation(const QVector<QPoint> &original, qint32 first, qint32 last, const QVector<QPoint> &polyline)
+{
+    qreal maximum = 0.0;
+    for (qint32 i_point = first;; i_point = (i_point + 1) % original.size())
+    {
+        qreal distance = std::numeric_limits<qreal>::max();
+        for (qint32 i_segment = 0; i_segment + 1 < polyline.size(); ++i_segment)
+        {
+            distance = qMin(distance, distanceToSegment(original[i_point], polyline[i_segment], polyline[i_segment + 1]));
+        }
+        maximum = qMax(maximum, distance);
+        if (i_point == last)
+        {
+            break;
+        }
+    }
+    return maximum;
+}
+
+/*!
+ * \brief Returns the distance between a point and the original outline from first to last (cyclic).
+ * \param original Original ring.
+ * \param first Index of the first original vertex.
+ * \param last Index of the last original vertex.
+ * \param point Point.
+ * \return Distance.
+ */
+static qreal distanceToOutline(const QVector<QPoint> &original, qint32 first, qint32 last, QPointF point)
+{
+    qreal distance = std::numeric_limits<qreal>::max();
+    for (qint32 i_point = first; i_point != last; i_point = (i_point + 1) % original.size())
+    {
+        distance = qMin(distance, distanceToSegment(point, original[i_point], original[(i_point + 1) % original.size()]));
+    }
+    return distance;
+}
+
+/*!
+ * \brief Returns the corner replacing the convex vertices b and c, which is the intersection of the lines through a, b and c, d rounded to
+ * the grid such that b and c stay covered.
+ * \param a Vertex before b.
+ * \param b First convex vertex.
+ * \param c Second convex vertex.
+ * \param d Vertex after c.
+ * \param orientation Orientation of the ring.
+ * \param corner Corner.
+ * \return true if the lines meet beyond b and c and a suitable grid point exists.
+ */
+static bool outerCorner(QPoint a, QPoint b, QPoint c, QPoint d, qint32 orientation, QPoint &corner)
+{
+    QPointF r = QPointF(b - a);
+    QPointF q = QPointF(c - d);
+    QPointF w = QPointF(c - b);
+    qreal denominator = r.x() * q.y() - r.y() * q.x();
+    if (qAbs(denominator) < 1e-9)
+    {
+        return false;
+    }
+    qreal t = (w.x() * q.y() - w.y() * q.x()) / denominator;
+    qreal u = (w.x() * r.y() - w.y() * r.x()) / denominator;
+    if (t < 0.0 || u < 0.0)
+    {
+        return false;
+    }
+
+    QPointF exact = QPointF(b) + t * r;
+    if (qAbs(exact.x()) > std::numeric_limits<qint32>::max() / 2 || qAbs(exact.y()) > std::numeric_limits<qint32>::max() / 2)
+    {
+        return false;
+    }
+    bool found = false;
+    qreal best = 0.0;
+    for (qint32 i_x = qFloor(exact.x()); i_x <= qCeil(exact.x()); ++i_x)
+    {
+        for (qint32 i_y = qFloor(exact.y()); i_y <= qCeil(exact.y()); ++i_y)
+        {
+            QPoint candidate(i_x, i_y);
+            if (orientation * sign(cross(a, candidate, b)) < 0 || orientation * sign(cross(candidate, d, c)) < 0 ||
+                orientation * sign(cross(b, c, candidate)) > 0)
+            {
+                continue;
+            }
+            qreal distance = QLineF(exact, QPointF(candidate)).length();
+            if (!found || distance < best)
+            {
+                found = true;
+                best = distance;
+                corner = candidate;
+            }
+        }
+    }
+    return found;
+}
+
+/*!
+ * \brief Returns true if a point lies inside or on the boundary of a polygon.
+ * \param polygon Closed polygon.
+ * \param point Point.
+ * \return true if the point is covered.
+ */
+static bool covers(const QPolygon &polygon, QPoint point)
+{
+    for (qint32 i_point = 0; i_point + 1 < polygon.size(); ++i_point)
+    {
+        if (onSegment(polygon[i_point], polygon[i_point + 1], point))
+        {
+            return true;
+        }
+    }
+    return polygon.containsPoint(point, Qt::OddEvenFill);
+}
+
+Shape BakerySimplifier::simplify(const Shape &shape, qint32 tolerance)
+{
+    QVector<QPoint> original(shape);
+    if (shape.isClosed() && !original.isEmpty())
+    {
+        original.removeLast();
+    }
+    if (original.size() < 4 || tolerance <= 0)
+    {
+        return shape;
+    }
+
+    qint64 area = 0;
+    for (qint32 i_point = 0; i_point < original.size(); ++i_point)
+    {
+        area += cross(QPoint(0, 0), original[i_point], original[(i_point + 1) % original.size()]);
+    }
+    qint32 orientation = sign(area);
+    if (orientation == 0)
+    {
+        return shape;
+    }
+
+    // Each vertex remembers the original vertex it started from, so the original outline it replaces is known
+    QVector<QPoint> ring = original;
+    QVector<qint32> anchors(ring.size());
+    for (qint32 i_point = 0; i_point < anchors.size(); ++i_point)
+    {
+        anchors[i_point] = i_point;
+    }
+
+    bool changed = true;
+    while (changed && ring.size() > 3)
+    {
+        changed = false;
+        for (qint32 i_point = 0; i_point < ring.size() && ring.size() > 3; ++i_point)
+        {
+            qint32 size = ring.size();
+            qint32 previous = (i_point + size - 1) % size;
+            qint32 next = (i_point + 1) % size;
+            QPoint a = ring[previous];
+            QPoint b = ring[i_point];
+            QPoint c = ring[next];
+            qint64 turn = orientation * cross(a, b, c);
+
+            // Removing a reflex or collinear vertex
+            if (turn < 0 || (turn == 0 && dot(b, a, c) <= 0))
+            {
+                if (deviation(original, anchors[previous], anchors[next], QVector<QPoint>() << a << c) <= tolerance)
+                {
+                    QVector<QPoint> candidate = ring;
+                    candidate.remove(i_point);
+                    if (!edgeIntersectsRing(candidate, (i_point + size - 2) % (size - 1)))
+                    {
+                        ring = candidate;
+                        anchors.remove(i_point);
+                        changed = true;
+                        --i_point;
+                        continue;
+                    }
+                }
+            }
+
+            // Replacing two convex vertices by the corner of their outer edges
+            qint32 after = (next + 1) % size;
+            QPoint d = ring[after];
+            QPoint corner;
+            if (turn > 0 && orientation * cross(b, c, d) > 0 && outerCorner(a, b, c, d, orientation, corner) &&
+                deviation(original, anchors[previous], anchors[after], QVector<QPoint>() << a << corner << d) <= tolerance &&
+                distanceToOutline(original, anchors[previous], anchors[after], QPointF(corner)) <= tolerance)
+            {
+                QVector<QPoint> candidate = ring;
+                candidate[i_point] = corner;
+                candidate.remove(next);
+                qint32 position = next > i_point ? i_point : i_point - 1;
+                if (!edgeIntersectsRing(candidate, (position + size - 2) % (size - 1)) && !edgeIntersectsRing(candidate, position))
+                {
+                    ring = candidate;
+                    anchors.remove(next);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    if (ring.size() == original.size())
+    {
+        return shape;
+    }
+    Shape simplified(shape.name());
+    simplified.setUpdateMetrics(false);
+    foreach (const QPoint &point, ring)
+    {
+        simplified << point;
+    }
+    simplified.ensureClosed();
+    simplified.setUpdateMetrics(true);
+    return simplified;
+}
+
+PluginInput BakerySimplifier::simplify(const PluginInput &input, qreal tolerance)
+{
+    PluginInput simplified(input);
+    qint32 precise = BakeryHelpers::qrealPrecise(tolerance);
+    const ShapeStock &stock = input.stock();
+    ShapeStock simplifiedStock;
+    for (qint32 i_type = 0; i_type < stock.types(); ++i_type)
+    {
+        simplifiedStock.add(simplify(stock.prototype(i_type), precise), stock.count(i_type));
+    }
+    simplified.setStock(simplifiedStock);
+    return simplified;
+}
+
+Shape BakerySimplifier::restore(const Shape &original, const Shape &simplified, const Shape &placed)
+{
+    if (simplified.size() != placed.size() || simplified.size() == original.size() || simplified.isEmpty())
+    {
+        return placed;
+    }
+    qint32 size = simplified.isClosed() ? simplified.size() - 1 : simplified.size();
+
+    // Least squares fit of a rotation (Kabsch) after moving both centroids to the origin, with and without mirroring
+    QPointF simplifiedCenter;
+    QPointF placedCenter;
+    for (qint32 i_point = 0; i_point < size; ++i_point)
+    {
+        simplifiedCenter += QPointF(simplified[i_point]);
+        placedCenter += QPointF(placed[i_point]);
+    }
+    simplifiedCenter /= size;
+    placedCenter /= size;
+
+    QTransform best;
+    qreal bestResidual = std::numeric_limits<qreal>::max();
+    for (qint32 i_mirror = 0; i_mirror < 2; ++i_mirror)
+    {
+        qreal mirror = i_mirror == 0 ? 1.0 : -1.0;
+        qreal dotSum = 0.0;
+        qreal crossSum = 0.0;
+        for (qint32 i_point = 0; i_point < size; ++i_point)
+        {
+            QPointF p = QPointF(simplified[i_point]) - simplifiedCenter;
+            p.setX(mirror * p.x());
+            QPointF q = QPointF(placed[i_point]) - placedCenter;
+            dotSum += p.x() * q.x() + p.y() * q.y();
+            crossSum += p.x() * q.y() - p.y() * q.x();
+        }
+        QTransform transform;
+        transform.translate(placedCenter.x(), placedCenter.y());
+        transform.rotateRadians(qAtan2(crossSum, dotSum));
+        transform.scale(mirror, 1.0);
+        transform.translate(-simplifiedCenter.x(), -simplifiedCenter.y());
+
+        qreal residual = 0.0;
+        for (qint32 i_point = 0; i_point < size; ++i_point)
+        {
+            residual = qMax(residual, QLineF(transform.map(QPointF(simplified[i_point])), QPointF(placed[i_point])).length());
+        }
+        if (residual < bestResidual)
+        {
+            bestResidual = residual;
+            best = transform;
+        }
+    }
+    if (bestResidual > MAXIMUM_RESIDUAL)
+    {
+        return placed;
+    }
+
+    QHash<qint64, qint32> kept;
+    for (qint32 i_point = 0; i_point < size; ++i_point)
+    {
+        kept[pointKey(simplified[i_point])] = i_point;
+    }
+
+    Shape restored(original.name());
+    restored.setUpdateMetrics(false);
+    qint32 originalSize = original.isClosed() ? original.size() - 1 : original.size();
+    for (qint32 i_point = 0; i_point < originalSize; ++i_point)
+    {
+        QHash<qint64, qint32>::ConstIterator i_kept = kept.constFind(pointKey(original[i_point]));
+        if (i_kept != kept.constEnd())
+        {
+            restored << placed[i_kept.value()];
+            continue;
+        }
+
+        // Rounding may move a vertex on the outline of the placement outside of it
+        QPointF mapped = best.map(QPointF(original[i_point]));
+        QPoint rounded = mapped.toPoint();
+        if (!covers(placed, rounded))
+        {
+            bool found = false;
+            qreal bestDistance = std::numeric_limits<qreal>::max();
+            QPoint nearest;
+            for (qint32 i_x = -1; i_x <= 1; ++i_x)
+            {
+                for (qint32 i_y = -1; i_y <= 1; ++i_y)
+                {
+                    QPoint candidate = rounded + QPoint(i_x, i_y);
+                    qreal distance = QLineF(mapped, QPointF(candidate)).length();
+                    if (distance < bestDistance && covers(placed, candidate))
+                    {
+                        found = true;
+                        bestDistance = distance;
+                        nearest = candidate;
+                    }
+                }
+            }
+            if (!found)
+            {
+                return placed;
+            }
+            rounded = nearest;
+        }
+        restored << rounded;
+    }
+    restored.ensureClosed();
+    restored.setUpdateMetrics(true);
+    return restored;
+}
+
+PluginOutput BakerySimplifier::restore(const PluginOutput &output, const PluginInput &original, const PluginInput &simplified)
+{
+    QHash<QString, Shape> originalShapes;
+    foreach (const Shape &shape, original.stock().prototypes())
+    {
+        originalShapes.insert(shape.name(), shape);
+    }
+    QHash<QString, Shape> simplifiedShapes;
+    foreach (const Shape &shape, simplified.stock().prototypes())
+    {
+        simplifiedShapes.insert(shape.name(), shape);
+    }
+
+    PluginOutput restored;
+    foreach (Sheet sheet, output.sheets)
+    {
+        Sheet restoredSheet(sheet.width(), sheet.height());
+        foreach (const Shape &shape, sheet.shapes())
+        {
+            if (originalShapes.contains(shape.name()) && simplifiedShapes.contains(shape.name()))
+            {
+                restoredSheet << restore(originalShapes[shape.name()], simplifiedShapes[shape.name()], shape);
+            }
+            else
+            {
+                restoredSheet << shape;
+            }
+        }
+
+        // The simplified shapes contain the original shapes, so their placement is a valid fallback
+        if (!restoredSheet.isValid())
+        {
+            BAKERY_WARNING(QString("Restored sheet %1 is invalid, keeping the simplified shapes").arg(restored.sheets.size() + 1));
+            restoredSheet = sheet;
+        }
+        restored.sheets << restoredSheet;
+    }
+    return restored;
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAKERY_SIMPLIFIER_H
+#define BAKERY_SIMPLIFIER_H
+
+#include "global.h"
+#include "plugins.h"
+#include "shape.h"
+
+/*!
+ * \brief Conservative simplification of input shapes.
+ *
+ * Simplified shapes contain the original shapes, so a valid packing of the simplified shapes is also valid for the original ones.
+ * Vertices are removed in two ways, both of which only enlarge the shape:
+ *  - A reflex or collinear vertex is removed by connecting its neighbours directly.
+ *  - Two neighbouring convex vertices are replaced by the intersection of the lines through their outer edges.
+ *
+ * Each step is only taken if every original vertex stays within the tolerance of the simplified outline, the new vertex stays within the
+ * tolerance of the original outline, and the shape stays simple.
+ *
+ * Plugins pack the simplified shapes. Afterwards restore() fits the rigid transformation which maps each simplified shape onto its
+ * placement and applies it to the original shape.
+ */
+namespace BakerySimplifier
+{
+/*!
+ * \brief Simplifies a shape.
+ * \param shape Closed shape.
+ * \param tolerance Maximum distance between original and simplified outline in the coordinates of the shape.
+ * \return Simplified closed shape with the same name. The shape itself if it can not be simplified.
+ */
+BAKERYSHARED_EXPORT Shape simplify(const Shape &shape, qint32 tolerance);
+
+/*!
+ * \brief Simplifies all shapes of an input. Each prototype is only simplified once.
+ * \param input PluginInput.
+ * \param tolerance Maximum distance between original and simplified outline.
+ * \return PluginInput containing the simplified shapes.
+ */
+BAKERYSHARED_EXPORT PluginInput simplify(const PluginInput &input, qreal tolerance);
+
+/*!
+ * \brief Restores the original geometry of a placed simplified shape.
+ *
+ * Vertices which were kept by the simplification are copied from the placement. All other vertices are mapped by the rigid transformation
+ * (possibly mirrored) fitted between the simplified shape and its placement. If a mapped vertex is not covered by the placement even after
+ * moving it to a neighbouring point, or no transformation fits, the placement is returned unchanged.
+ *
+ * \param original Original shape.
+ * \param simplified Simplified shape, see simplify().
+ * \param placed Simplified shape as placed by a plugin.
+ * \return Original shape at the placement. Covered by placed.
+ */
+BAKERYSHARED_EXPORT Shape restore(const Shape &original, const Shape &simplified, const Shape &placed);
+
+/*!
+ * \brief Restores the original geometry of all shapes of an output.
+ *
+ * Each restored sheet is validated. A sheet which is not valid after restoring, e.g. because of rounding, keeps the placement of the
+ * simplified shapes.
+ *
+ * \param output Output of a plugin for the simplified input.
+ * \param original Original input.
+ * \param simplified Simplified input, see simplify().
+ * \return Output containing the original shapes.
+ */
+BAKERYSHARED_EXPORT PluginOutput restore(const PluginOutput &output, const PluginInput &original, const PluginInput &simplified);
+}
+
+#endif // BAKERY_SIMPLIFIER_H
@@ -0,0 +1,922 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "svgimport.h"
+
+#include <QtCore/qmath.h>
+#include <QList>
+#include <QVector>
+#include <algorithm>
+
+// Added to curved outlines so truncation to BAKERY_PRECISION can not move a vertex inside of the curve
+static const qreal MARGIN = 2.0 / BAKERY_PRECISION;
+
+// Upper limit of segments used for a single curve
+static const qint32 MAXIMUM_SEGMENTS = 1 << 16;
+
+// Upper limit of subdivisions of a single bezier curve
+static const qint32 MAXIMUM_DEPTH = 16;
+
+// Number of times the tolerance of a path is doubled to meet the vertex budget
+static const qint32 MAXIMUM_ATTEMPTS = 20;
+
+/*!
+ * \brief Returns the number of tangent segments needed to circumscribe an arc.
+ *
+ * A segment covering the angle a of a circle with radius r deviates at most r / cos(a / 2) - r from the circle.
+ *
+ * \param angle Angle of the arc.
+ * \param radius Radius of the arc.
+ * \param tolerance Maximum deviation.
+ * \return Number of segments.
+ */
+static qint32 arcSegments(qreal angle, qreal radius, qreal tolerance)
+{
+    qreal maximumAngle = 2.0 * qAcos(radius / (radius + tolerance));
+    if (maximumAngle <= 0.0)
+    {
+        return MAXIMUM_SEGMENTS;
+    }
+    return qint32(qMin(qreal(MAXIMUM_SEGMENTS), qCeil(angle / maximumAngle)));
+}
+
+/*!
+ * \brief Returns the distance between a point and a line segment.
+ * \param point Point.
+ * \param start Start of the segment.
+ * \param end End of the segment.
+ * \return Distance.
+ */
+static qreal distanceToSegment(QPointF point, QPointF start, QPointF end)
+{
+    QPointF direction = end - start;
+    qreal lengthSquared = QPointF::dotProduct(direction, direction);
+    qreal t = 0.0;
+    if (lengthSquared > 0.0)
+    {
+        t = qBound(qreal(0.0), QPointF::dotProduct(point - start, direction) / lengthSquared, qreal(1.0));
+    }
+    QPointF difference = point - (start + t * direction);
+    return qSqrt(QPointF::dotProduct(difference, difference));
+}
+
+/*!
+ * \brief Returns the signed area of a polygon.
+ * \param polygon Polygon, not closed.
+ * \return Area, positive for counter clockwise orientation in a y-up coordinate system.
+ */
+static qreal signedArea(const QVector<QPointF> &polygon)
+{
+    qreal area = 0.0;
+    for (qint32 i_point = 0; i_point < polygon.size(); ++i_point)
+    {
+        const QPointF &current = polygon[i_point];
+        const QPointF &next = polygon[(i_point + 1) % polygon.size()];
+        area += current.x() * next.y() - next.x() * current.y();
+    }
+    return area / 2.0;
+}
+
+/*!
+ * \brief Returns the cross product of two vectors.
+ * \param first First vector.
+ * \param second Second vector.
+ * \return Cross product.
+ */
+static qreal cross(QPointF first, QPointF second)
+{
+    return first.x() * second.y() - first.y() * second.x();
+}
+
+/*!
+ * \brief Orders points lexicographically.
+ * \param first First point.
+ * \param second Second point.
+ * \return true if first is smaller than second.
+ */
+static bool lessThan(const QPointF &first, const QPointF &second)
+{
+    return first.x() < second.x() || (first.x() == second.x() && first.y() < second.y());
+}
+
+/*!
+ * \brief Returns the convex hull of some points (monotone chain).
+ * \param points Points.
+ * \return Convex hull, not closed.
+ */
+static QVector<QPointF> convexHull(QVector<QPointF> points)
+{
+    std::sort(points.begin(), points.end(), lessThan);
+    if (points.size() < 3)
+    {
+        return points;
+    }
+
+    QVector<QPointF> hull(2 * points.size());
+    qint32 size = 0;
+    for (qint32 i_point = 0; i_point < points.size(); ++i_point)
+    {
+        while (size >= 2 && cross(hull[size - 1] - hull[size - 2], points[i_point] - hull[size - 2]) <= 0.0)
+        {
+            --size;
+        }
+        hull[size++] = points[i_point];
+    }
+    for (qint32 i_point = points.size() - 2, lower = size + 1; i_point >= 0; --i_point)
+    {
+        while (size >= lower && cross(hull[size - 1] - hull[size - 2], points[i_point] - hull[size - 2]) <= 0.0)
+        {
+            --size;
+        }
+        hull[size++] = points[i_point];
+    }
+    hull.resize(size - 1);
+    return hull;
+}
+
+/*!
+ * \brief Moves all edges of a simple polygon outwards and connects them at the intersections of neighbouring edges.
+ *
+ * The result contains every point with a distance of at most distance to the polygon. If moving the edges inverts one of them (because
+ * an edge is shorter than the offset at a reflex vertex), the convex hull of the moved vertices is returned instead.
+ *
+ * \param polygon Polygon, not closed and without duplicate neighbouring points.
+ * \param distance Offset.
+ * \return Offset polygon, not closed.
+ */
+static QVector<QPointF> offsetPolygon(const QVector<QPointF> &polygon, qreal distance)
+{
+    if (distance <= 0.0)
+    {
+        return polygon;
+    }
+
+    qreal orientation = signedArea(polygon) > 0.0 ? 1.0 : -1.0;
+    qint32 size = polygon.size();
+    QVector<QPointF> directions(size);
+    QVector<QPointF> normals(size);
+    for (qint32 i_edge = 0; i_edge < size; ++i_edge)
+    {
+        QPointF direction = polygon[(i_edge + 1) % size] - polygon[i_edge];
+        direction /= qSqrt(QPointF::dotProduct(direction, direction));
+        directions[i_edge] = direction;
+        normals[i_edge] = orientation * QPointF(direction.y(), -direction.x());
+    }
+
+    QVector<QPointF> result;
+    result.reserve(size);
+    bool inverted = false;
+    for (qint32 i_point = 0; i_point < size; ++i_point)
+    {
+        qint32 previous = (i_point + size - 1) % size;
+        qreal sine = cross(directions[previous], directions[i_point]);
+        const QPointF &vertex = polygon[i_point];
+        if (qAbs(sine) < 1e-9)
+        {
+            if (QPointF::dotProduct(directions[previous], directions[i_point]) > 0.0)
+            {
+                result << vertex + distance * normals[i_point];
+            }
+            else
+            {
+                // Spike, cap it with a square
+                result << vertex + distance * (normals[previous] + directions[previous]);
+                result << vertex + distance * (normals[i_point] + directions[previous]);
+            }
+            continue;
+        }
+
+        QPointF difference = distance * (normals[i_point] - normals[previous]);
+        qreal along = cross(difference, directions[i_point]) / sine;
+        QPointF corner = vertex + distance * normals[previous] + along * directions[previous];
+        if (!result.isEmpty() && QPointF::dotProduct(corner - result.last(), directions[previous]) < 0.0)
+        {
+            inverted = true;
+        }
+        result << corner;
+    }
+    if (!result.isEmpty() && QPointF::dotProduct(result.first() - result.last(), directions[size - 1]) < 0.0)
+    {
+        inverted = true;
+    }
+
+    if (inverted)
+    {
+        return convexHull(result);
+    }
+    return result;
+}
+
+/*!
+ * \brief Flattens a cubic bezier curve by recursive subdivision.
+ *
+ * A piece is accepted once its control points are within tolerance of its chord. Since the curve lies inside of the convex hull of its
+ * control points, it is within tolerance of the chord as well.
+ *
+ * \param p0 Start point.
+ * \param p1 First control point.
+ * \param p2 Second control point.
+ * \param p3 End point.
+ * \param tolerance Tolerance.
+ * \param depth Recursion depth.
+ * \param polygon All chord end points are appended to this polygon.
+ * \return Maximum distance between the curve and the chords.
+ */
+static qreal flattenCubic(QPointF p0, QPointF p1, QPointF p2, QPointF p3, qreal tolerance, qint32 depth, QVector<QPointF> &polygon)
+{
+    qreal deviation = qMax(distanceToSegment(p1, p0, p3), distanceToSegment(p2, p0, p3));
+    if (deviation <= tolerance || depth >= MAXIMUM_DEPTH)
+    {
+        polygon << p3;
+        return deviation;
+    }
+
+    QPointF p01 = (p0 + p1) / 2.0;
+    QPointF p12 = (p1 + p2) / 2.0;
+    QPointF p23 = (p2 + p3) / 2.0;
+    QPointF p012 = (p01 + p12) / 2.0;
+    QPointF p123 = (p12 + p23) / 2.0;
+    QPointF middle = (p012 + p123) / 2.0;
+    qreal first = flattenCubic(p0, p01, p012, middle, tolerance, depth + 1, polygon);
+    return qMax(first, flattenCubic(middle, p123, p23, p3, tolerance, depth + 1, polygon));
+}
+
+/*!
+ * \brief Subpath of a SVG path. All segments are stored as cubic bezier curves, so points holds the start point followed by three points
+ * per segment.
+ */
+struct Subpath
+{
+    /*!
+     * \brief Start point and control points of all segments.
+     */
+    QVector<QPointF> points;
+
+    /*!
+     * \brief True if any segment is not a straight line.
+     */
+    bool curved;
+
+    Subpath() : curved(false) {}
+};
+
+/*!
+ * \brief Appends a straight line to a subpath.
+ * \param subpath Subpath.
+ * \param end End point.
+ */
+static void appendLine(Subpath &subpath, QPointF end)
+{
+    QPointF start = subpath.points.last();
+    subpath.points << start << end << end;
+}
+
+/*!
+ * \brief Appends a cubic bezier curve to a subpath.
+ * \param subpath Subpath.
+ * \param first First control point.
+ * \param second Second control point.
+ * \param end End point.
+ */
+static void appendCubic(Subpath &subpath, QPointF first, QPointF second, QPointF end)
+{
+    subpath.points << first << second << end;
+    subpath.curved = true;
+}
+
+/*!
+ * \brief Maps a point of the unit circle onto a rotated ellipse.
+ * \param center Center of the ellipse.
+ * \param rx Radius in x direction.
+ * \param ry Radius in y direction.
+ * \param cosPhi Cosine of the rotation.
+ * \param sinPhi Sine of the rotation.
+ * \param point Point relative to the unit circle.
+ * \return Mapped point.
+ */
+static QPointF ellipsePoint(QPointF center, qreal rx, qreal ry, qreal cosPhi, qreal sinPhi, QPointF point)
+{
+    return QPointF(center.x() + rx * point.x() * cosPhi - ry * point.y() * sinPhi,
+                   center.y() + rx * point.x() * sinPhi + ry * point.y() * cosPhi);
+}
+
+/*!
+ * \brief Appends an elliptical arc to a subpath. The arc is approximated by cubic bezier curves of at most 90 degrees.
+ *
+ * See section F.6.5 of the SVG 1.1 specification for the conversion from endpoint to center parameterization.
+ *
+ * \param subpath Subpath.
+ * \param rx Radius in x direction.
+ * \param ry Radius in y direction.
+ * \param rotation Rotation of the x axis in degrees.
+ * \param largeArc Large arc flag.
+ * \param sweep Sweep flag.
+ * \param end End point.
+ * \return Maximum distance between the arc and its bezier curves.
+ */
+static qreal appendArc(Subpath &subpath, qreal rx, qreal ry, qreal rotation, bool largeArc, bool sweep, QPointF end)
+{
+    QPointF start = subpath.points.last();
+    if (start == end)
+    {
+        return 0.0;
+    }
+    rx = qAbs(rx);
+    ry = qAbs(ry);
+    if (rx == 0.0 || ry == 0.0)
+    {
+        appendLine(subpath, end);
+        return 0.0;
+    }
+
+    qreal phi = qDegreesToRadians(rotation);
+    qreal cosPhi = qCos(phi);
+    qreal sinPhi = qSin(phi);
+    QPointF half = (start - end) / 2.0;
+    qreal x1 = cosPhi * half.x() + sinPhi * half.y();
+    qreal y1 = -sinPhi * half.x() + cosPhi * half.y();
+
+    qreal lambda = (x1 * x1) / (rx * rx) + (y1 * y1) / (ry * ry);
+    if (lambda > 1.0)
+    {
+        rx *= qSqrt(lambda);
+        ry *= qSqrt(lambda);
+    }
+
+    qreal numerator = rx * rx * ry * ry - rx * rx * y1 * y1 - ry * ry * x1 * x1;
+    qreal denominator = rx * rx * y1 * y1 + ry * ry * x1 * x1;
+    qreal coefficient = qSqrt(qMax(qreal(0.0), numerator / denominator));
+    if (largeArc == sweep)
+    {
+        coefficient = -coefficient;
+    }
+    qreal cx1 = coefficient * rx * y1 / ry;
+    qreal cy1 = -coefficient * ry * x1 / rx;
+    QPointF center(cosPhi * cx1 - sinPhi * cy1 + (start.x() + end.x()) / 2.0, sinPhi * cx1 + cosPhi * cy1 + (start.y() + end.y()) / 2.0);
+
+    qreal startAngle = qAtan2((y1 - cy1) / ry, (x1 - cx1) / rx);
+    qreal delta = qAtan2((-y1 - cy1) / ry, (-x1 - cx1) / rx) - startAngle;
+    if (!sweep && delta > 0.0)
+    {
+        delta -= 2.0 * M_PI;
+    }
+    else if (sweep && delta < 0.0)
+    {
+        delta += 2.0 * M_PI;
+    }
+
+    qint32 segments = qMax(1, qCeil(qAbs(delta) / (M_PI / 2.0) - 1e-9));
+    qreal step = delta / segments;
+    qreal k = 4.0 / 3.0 * qTan(step / 4.0);
+    for (qint32 i_segment = 0; i_segment < segments; ++i_segment)
+    {
+        qreal a1 = startAngle + i_segment * step;
+        qreal a2 = a1 + step;
+        QPointF first(qCos(a1) - k * qSin(a1), qSin(a1) + k * qCos(a1));
+        QPointF second(qCos(a2) + k * qSin(a2), qSin(a2) - k * qCos(a2));
+        QPointF target = i_segment == segments - 1 ? end : ellipsePoint(center, rx, ry, cosPhi, sinPhi, QPointF(qCos(a2), qSin(a2)));
+        appendCubic(subpath, ellipsePoint(center, rx, ry, cosPhi, sinPhi, first), ellipsePoint(center, rx, ry, cosPhi, sinPhi, second),
+                    target);
+    }
+
+    // A cubic bezier curve deviates less than 2.8e-4 * r from a circular arc of up to 90 degrees
+    return 3e-4 * qMax(rx, ry);
+}
+
+/*!
+ * \brief Skips white space and at most one comma.
+ * \param current Current position.
+ * \param end End of data.
+ */
+static void skipSeparators(const QChar *&current, const QChar *end)
+{
+    while (current < end && current->isSpace())
+    {
+        ++current;
+    }
+    if (current < end && *current == QLatin1Char(','))
+    {
+        ++current;
+        while (current < end && current->isSpace())
+        {
+            ++current;
+        }
+    }
+}
+
+/*!
+ * \brief Reads a number. Following the SVG grammar numbers do not need to be separated if the next number starts with a sign or a second
+ * decimal point.
+ * \param current Current position.
+ * \param end End of data.
+ * \param number Parsed number.
+ * \return true if successful.
+ */
+static bool readNumber(const QChar *&current, const QChar *end, qreal &number)
+{
+    skipSeparators(current, end);
+    const QChar *begin = current;
+    if (current < end && (*current == QLatin1Char('-') || *current == QLatin1Char('+')))
+    {
+        ++current;
+    }
+    bool digits = false;
+    while (current < end && current->isDigit())
+    {
+        ++current;
+        digits = true;
+    }
+    if (current < end && *current == QLatin1Char('.'))
+    {
+        ++current;
+        while (current < end && current->isDigit())
+        {
+            ++current;
+            digits = true;
+        }
+    }
+    if (!digits)
+    {
+        current = begin;
+        return false;
+    }
+    if (current < end && (*current == QLatin1Char('e') || *current == QLatin1Char('E')))
+    {
+        const QChar *exponent = current++;
+        if (current < end && (*current == QLatin1Char('-') || *current == QLatin1Char('+')))
+        {
+            ++current;
+        }
+        if (current < end && current->isDigit())
+        {
+            while (current < end && current->isDigit())
+            {
+                ++current;
+            }
+        }
+        else
+        {
+            current = exponent;
+        }
+    }
+
+    bool ok;
+    number = QString(begin, current - begin).toDouble(&ok);
+    return ok;
+}
+
+/*!
+ * \brief Reads an arc flag, which consists of a single character.
+ * \param current Current position.
+ * \param end End of data.
+ * \param flag Parsed flag.
+ * \return true if successful.
+ */
+static bool readFlag(const QChar *&current, const QChar *end, bool &flag)
+{
+    skipSeparators(current, end);
+    if (current < end && (*current == QLatin1Char('0') || *current == QLatin1Char('1')))
+    {
+        flag = *current == QLatin1Char('1');
+        ++current;
+        return true;
+    }
+    return false;
+}
+
+/*!
+ * \brief Reads a coordinate pair.
+ * \param current Current position.
+ * \param end End of data.
+ * \param base Added to the coordinates (current point for relative commands).
+ * \param point Parsed point.
+ * \return true if successful.
+ */
+static bool readPoint(const QChar *&current, const QChar *end, QPointF base, QPointF &point)
+{
+    qreal x;
+    qreal y;
+    if (!readNumber(current, end, x) || !readNumber(current, end, y))
+    {
+        return false;
+    }
+    point = base + QPointF(x, y);
+    return true;
+}
+
+/*!
+ * \brief Parses SVG path data into subpaths.
+ * \param data Path data.
+ * \param subpaths Parsed subpaths.
+ * \param arcError Maximum deviation of the approximation of arcs.
+ * \return true if successful.
+ */
+static bool parsePath(const QString &data, QList<Subpath> &subpaths, qreal &arcError)
+{
+    const QChar *current = data.constData();
+    const QChar *end = current + data.size();
+    Subpath subpath;
+    QPointF point;
+    QPointF start;
+    QPointF cubicControl;
+    QPointF quadraticControl;
+    QChar command;
+    bool started = false;
+    arcError = 0.0;
+
+    skipSeparators(current, end);
+    while (current < end)
+    {
+        if (current->isLetter())
+        {
+            command = *current++;
+        }
+        else if (command.isNull() || command.toUpper() == QLatin1Char('Z'))
+        {
+            return false;
+        }
+        else if (command == QLatin1Char('M'))
+        {
+            // Implicit repetition of moveto is lineto
+            command = QLatin1Char('L');
+        }
+        else if (command == QLatin1Char('m'))
+        {
+            command = QLatin1Char('l');
+        }
+
+        QChar upper = command.toUpper();
+        QPointF base = command.isLower() ? point : QPointF(0.0, 0.0);
+        if (!started && upper != QLatin1Char('M'))
+        {
+            return false;
+        }
+        if (upper != QLatin1Char('M') && upper != QLatin1Char('Z') && subpath.points.isEmpty())
+        {
+            // Drawing after closepath starts a new subpath at the start of the last one
+            subpath.points << point;
+        }
+
+        QPointF first;
+        QPointF second;
+        QPointF target;
+        qreal value;
+        switch (upper.toLatin1())
+        {
+        case 'M':
+            if (!readPoint(current, end, base, target))
+            {
+                return false;
+            }
+            if (subpath.points.size() > 1)
+            {
+                subpaths << subpath;
+            }
+            subpath = Subpath();
+            subpath.points << target;
+            point = start = target;
+            started = true;
+            break;
+
+        case 'L':
+            if (!readPoint(current, end, base, target))
+            {
+                return false;
+            }
+            appendLine(subpath, target);
+            point = target;
+            break;
+
+        case 'H':
+            if (!readNumber(current, end, value))
+            {
+                return false;
+            }
+            point.setX(base.x() + value);
+            appendLine(subpath, point);
+            break;
+
+        case 'V':
+            if (!readNumber(current, end, value))
+            {
+                return false;
+            }
+            point.setY(base.y() + value);
+            appendLine(subpath, point);
+            break;
+
+        case 'C':
+        case 'S':
+            if (upper == QLatin1Char('C'))
+            {
+                if (!readPoint(current, end, base, first))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                first = point + (point - cubicControl);
+            }
+            if (!readPoint(current, end, base, second) || !readPoint(current, end, base, target))
+            {
+                return false;
+            }
+            appendCubic(subpath, first, second, target);
+            cubicControl = second;
+            point = target;
+            break;
+
+        case 'Q':
+        case 'T':
+        {
+            QPointF control;
+            if (upper == QLatin1Char('Q'))
+            {
+                if (!readPoint(current, end, base, control))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                control = point + (point - quadraticControl);
+            }
+            if (!readPoint(current, end, base, target))
+            {
+                return false;
+            }
+            appendCubic(subpath, point + 2.0 / 3.0 * (control - point), target + 2.0 / 3.0 * (control - target), target);
+            quadraticControl = control;
+            point = target;
+        }
+        break;
+
+        case 'A':
+        {
+            qreal rx;
+            qreal ry;
+            qreal rotation;
+            bool largeArc;
+            bool sweep;
+            if (!readNumber(current, end, rx) || !readNumber(current, end, ry) || !readNumber(current, end, rotation)
+                || !readFlag(current, end, largeArc) || !readFlag(current, end, sweep) || !readPoint(current, end, base, target))
+            {
+                return false;
+            }
+            arcError = qMax(arcError, appendArc(subpath, rx, ry, rotation, largeArc, sweep, target));
+            point = target;
+        }
+        break;
+
+        case 'Z':
+            if (subpath.points.last() != start)
+            {
+                appendLine(subpath, start);
+            }
+            if (subpath.points.size() > 1)
+            {
+                subpaths << subpath;
+            }
+            subpath = Subpath();
+            point = start;
+            break;
+
+        default:
+            return false;
+        }
+
+        // Smooth curves only reflect control points of the same kind of curve
+        if (upper != QLatin1Char('C') && upper != QLatin1Char('S'))
+        {
+            cubicControl = point;
+        }
+        if (upper != QLatin1Char('Q') && upper != QLatin1Char('T'))
+        {
+            quadraticControl = point;
+        }
+
+        skipSeparators(current, end);
+    }
+
+    if (subpath.points.size() > 1)
+    {
+        subpaths << subpath;
+    }
+    return true;
+}
+
+/*!
+ * \brief Approximates all subpaths with a given tolerance and combines them into a single polygon.
+ * \param subpaths Subpaths.
+ * \param tolerance Tolerance used for flattening.
+ * \param arcError Maximum deviation of the approximation of arcs.
+ * \return Conservative polygon, not closed.
+ */
+static QVector<QPointF> approximatePath(const QList<Subpath> &subpaths, qreal tolerance, qreal arcError)
+{
+    QList<QVector<QPointF>> polygons;
+    foreach (const Subpath &subpath, subpaths)
+    {
+        QVector<QPointF> flattened;
+        flattened << subpath.points.first();
+        qreal deviation = 0.0;
+        for (qint32 i_point = 1; i_point + 2 < subpath.points.size(); i_point += 3)
+        {
+            deviation = qMax(deviation, flattenCubic(subpath.points[i_point - 1], subpath.points[i_point], subpath.points[i_point + 1],
+                                                     subpath.points[i_point + 2], tolerance, 0, flattened));
+        }
+
+        QVector<QPointF> polygon;
+        foreach (const QPointF &point, flattened)
+        {
+            if (polygon.isEmpty() || polygon.last() != point)
+            {
+                polygon << point;
+            }
+        }
+        while (polygon.size() > 1 && polygon.first() == polygon.last())
+        {
+            polygon.removeLast();
+        }
+        if (polygon.size() < 3 || signedArea(polygon) == 0.0)
+        {
+            continue;
+        }
+
+        polygons << (subpath.curved ? offsetPolygon(polygon, deviation + arcError + MARGIN) : polygon);
+    }
+
+    // Subpaths inside of other subpaths are holes, filling them is conservative
+    QList<QVector<QPointF>> outer;
+    for (qint32 i_polygon = 0; i_polygon < polygons.size(); ++i_polygon)
+    {
+        bool contained = false;
+        for (qint32 i_other = 0; i_other < polygons.size() && !contained; ++i_other)
+        {
+            if (i_other == i_polygon)
+            {
+                continue;
+            }
+            QPolygonF other(polygons[i_other]);
+            contained = true;
+            foreach (const QPointF &point, polygons[i_polygon])
+            {
+                if (!other.containsPoint(point, Qt::OddEvenFill))
+                {
+                    contained = false;
+                    break;
+                }
+            }
+            // Identical subpaths contain each other, keep the first one
+            if (contained && i_other > i_polygon && polygons[i_other] == polygons[i_polygon])
+            {
+                contained = false;
+            }
+        }
+        if (!contained)
+        {
+            outer << polygons[i_polygon];
+        }
+    }
+
+    if (outer.isEmpty())
+    {
+        return QVector<QPointF>();
+    }
+    if (outer.size() == 1)
+    {
+        return outer.first();
+    }
+
+    QVector<QPointF> points;
+    foreach (const QVector<QPointF> &polygon, outer)
+    {
+        points << polygon;
+    }
+    return convexHull(points);
+}
+
+QPolygonF BakerySVGImport::ellipse(QPointF center, qreal rx, qreal ry, const SVGImportParameters &parameters)
+{
+    qint32 segments = parameters.maximumVertices > 0 ? parameters.maximumVertices : MAXIMUM_SEGMENTS;
+    if (parameters.tolerance > 0.0)
+    {
+        segments = qMin(segments, arcSegments(2.0 * M_PI, qMax(rx, ry), parameters.tolerance));
+    }
+    segments = qMax(3, segments);
+
+    // The polygon circumscribes the unit circle, scaling it keeps it tangent to the ellipse
+    qreal radius = 1.0 / qCos(M_PI / segments);
+    rx += MARGIN;
+    ry += MARGIN;
+    QPolygonF polygon;
+    polygon.reserve(segments);
+    for (qint32 i_segment = 0; i_segment < segments; ++i_segment)
+    {
+        qreal angle = 2.0 * M_PI * (i_segment + 0.5) / segments;
+        polygon << center + QPointF(rx * radius * qCos(angle), ry * radius * qSin(angle));
+    }
+    return polygon;
+}
+
+QPolygonF BakerySVGImport::roundedRect(QRectF rect, qreal rx, qreal ry, const SVGImportParameters &parameters)
+{
+    if (rx <= 0.0 || ry <= 0.0)
+    {
+        return QPolygonF() << rect.topLeft() << rect.topRight() << rect.bottomRight() << rect.bottomLeft();
+    }
+
+    qint32 segments = parameters.maximumVertices > 0 ? qMax(1, parameters.maximumVertices / 4) : MAXIMUM_SEGMENTS;
+    if (parameters.tolerance > 0.0)
+    {
+        segments = qMin(segments, arcSegments(M_PI / 2.0, qMax(rx, ry), parameters.tolerance));
+    }
+    segments = qMax(1, segments);
+
+    // Each corner is circumscribed by tangent segments. The first and last tangent are the straight edges of the rect
+    qreal step = M_PI / 2.0 / segments;
+    qreal radius = 1.0 / qCos(step / 2.0);
+    QPointF centers[4] = {QPointF(rect.right() - rx, rect.top() + ry), QPointF(rect.right() - rx, rect.bottom() - ry),
+                          QPointF(rect.left() + rx, rect.bottom() - ry), QPointF(rect.left() + rx, rect.top() + ry)};
+    rx += MARGIN;
+    ry += MARGIN;
+    QPolygonF polygon;
+    polygon.reserve(4 * segments);
+    for (qint32 i_corner = 0; i_corner < 4; ++i_corner)
+    {
+        qreal startAngle = -M_PI / 2.0 + i_corner * M_PI / 2.0;
+        for (qint32 i_segment = 0; i_segment < segments; ++i_segment)
+        {
+            qreal angle = startAngle + (i_segment + 0.5) * step;
+            polygon << centers[i_corner] + QPointF(rx * radius * qCos(angle), ry * radius * qSin(angle));
+        }
+    }
+    return polygon;
+}
+
+QPolygonF BakerySVGImport::path(const QString &data, const SVGImportParameters &parameters, bool *ok)
+{
+    QList<Subpath> subpaths;
+    qreal arcError;
+    if (!parsePath(data, subpaths, arcError))
+    {
+        if (ok != NULL)
+        {
+            *ok = false;
+        }
+        return QPolygonF();
+    }
+    if (ok != NULL)
+    {
+        *ok = true;
+    }
+    if (subpaths.isEmpty())
+    {
+        return QPolygonF();
+    }
+
+    qreal tolerance = parameters.tolerance;
+    if (tolerance <= 0.0)
+    {
+        QRectF bounds = QPolygonF(subpaths.first().points).boundingRect();
+        foreach (const Subpath &subpath, subpaths)
+        {
+            bounds |= QPolygonF(subpath.points).boundingRect();
+        }
+        tolerance = qMax(0.001 * qMax(bounds.width(), bounds.height()), MARGIN);
+    }
+
+    QVector<QPointF> polygon = approximatePath(subpaths, tolerance, arcError);
+    for (qint32 i_attempt = 0; parameters.maximumVertices > 0 && polygon.size() > parameters.maximumVertices; ++i_attempt)
+    {
+        if (i_attempt == MAXIMUM_ATTEMPTS)
+        {
+            polygon = convexHull(polygon);
+            if (polygon.size() > parameters.maximumVertices)
+            {
+                BAKERY_WARNING("Path needs" << polygon.size() << "vertices, budget is" << parameters.maximumVertices);
+            }
+            break;
+        }
+        tolerance *= 2.0;
+        polygon = approximatePath(subpaths, tolerance, arcError);
+    }
+    return QPolygonF(polygon);
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAKERY_SVGIMPORT_H
+#define BAKERY_SVGIMPORT_H
+
+#include "global.h"
+
+#include <QPolygonF>
+#include <QRectF>
+#include <QString>
+
+/*!
+ * \brief Struct to store parameters for the import of curved SVG elements (see Bakery::loadFromSVG()).
+ *
+ * If both values are 0, circles, ellipses and rounded rects are flattened like QPainterPath::toFillPolygon() does. Otherwise all curves
+ * are replaced by polygons which contain them (conservative outer approximation), so a valid packing of the polygons is also a valid
+ * packing of the original shapes.
+ */
+struct BAKERYSHARED_EXPORT SVGImportParameters
+{
+    /*!
+     * \brief Maximum distance between a curve and its approximating polygon in SVG units. 0 chooses the tolerance automatically.
+     */
+    qreal tolerance;
+
+    /*!
+     * \brief Maximum number of vertices per curved shape. 0 for no limit.
+     *
+     * If a shape does not fit into the budget the tolerance is increased until it does.
+     */
+    qint32 maximumVertices;
+
+    // Default values
+    SVGImportParameters()
+    {
+        tolerance = 0.0;
+        maximumVertices = 0;
+    }
+
+    /*!
+     * \brief Returns true if the curves are approximated conservatively.
+     * \return true if either tolerance or maximumVertices is set.
+     */
+    bool isConservative() const { return tolerance > 0.0 || maximumVertices > 0; }
+};
+
+/*!
+ * \brief Conservative polygon approximations of SVG curves.
+ *
+ * All polygons returned contain the curve they approximate. An additional margin is added to curved outlines so the polygons stay
+ * conservative after their coordinates are truncated by BakeryHelpers::qPointPrecise().
+ */
+namespace BakerySVGImport
+{
+/*!
+ * \brief Returns a polygon containing an axis-aligned ellipse.
+ * \param center Center of the ellipse.
+ * \param rx Radius in x direction.
+ * \param ry Radius in y direction.
+ * \param parameters Import parameters.
+ * \return Polygon circumscribing the ellipse.
+ */
+BAKERYSHARED_EXPORT QPolygonF ellipse(QPointF center, qreal rx, qreal ry, const SVGImportParameters &parameters);
+
+/*!
+ * \brief Returns a polygon containing a rect with rounded corners.
+ * \param rect Rect.
+ * \param rx Corner radius in x direction.
+ * \param ry Corner radius in y direction.
+ * \param parameters Import parameters.
+ * \return Polygon circumscribing the rounded rect.
+ */
+BAKERYSHARED_EXPORT QPolygonF roundedRect(QRectF rect, qreal rx, qreal ry, const SVGImportParameters &parameters);
+
+/*!
+ * \brief Returns a polygon containing the area described by SVG path data.
+ *
+ * The path data is parsed in a single pass. All commands of SVG 1.1 are supported. Subpaths inside of other subpaths are treated as holes
+ * and filled. If disjoint subpaths remain, their convex hull is returned.
+ *
+ * If parameters.tolerance is 0, a tolerance of 0.1% of the size of the path is used.
+ *
+ * \param data Content of the d attribute.
+ * \param parameters Import parameters.
+ * \param ok Will be set to true if the path data could be parsed. Will be ignored if set to NULL.
+ * \return Polygon containing the path. Empty if the path encloses no area.
+ */
+BAKERYSHARED_EXPORT QPolygonF path(const QString &data, const SVGImportParameters &parameters, bool *ok = NULL);
+}
+
+#endif // BAKERY_SVGIMPORT_H
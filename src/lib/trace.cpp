@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <chrono>
+
+QAtomicInt BakeryTrace::enabledFlag(0);
+
+/*!
+ * \brief Protects recordedEvents, processNames and laneNames.
+ */
+static QMutex traceMutex;
+
+/*!
+ * \brief Events recorded by this process or appended from plugin processes.
+ */
+static QList<BakeryTrace::Event> recordedEvents;
+
+/*!
+ * \brief Names of processes by process id.
+ */
+static QHash<qint64, QString> processNames;
+
+/*!
+ * \brief Names of the lanes of this process by id.
+ */
+static QHash<qint64, QString> laneNames;
+
+/*!
+ * \brief Last id given to a thread or lane.
+ */
+static QAtomicInt lastThread(0);
+
+BakeryTrace::Event::Event() : name(), category(), phase('i'), timestamp(0), duration(0), process(0), thread(0), arguments() {}
+
+void BakeryTrace::setEnabled(bool enabled) { enabledFlag.store(enabled ? 1 : 0); }
+
+qint64 BakeryTrace::now()
+{
+    // steady_clock is the monotonic clock of the system, like the clock of PluginDeadline
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+qint64 BakeryTrace::currentThread()
+{
+    static thread_local qint64 thread = lastThread.fetchAndAddRelaxed(1) + 1;
+    return thread;
+}
+
+qint64 BakeryTrace::newLane(const QString &name)
+{
+    qint64 lane = lastThread.fetchAndAddRelaxed(1) + 1;
+    QMutexLocker locker(&traceMutex);
+    laneNames[lane] = name;
+    return lane;
+}
+
+void BakeryTrace::setProcessName(qint64 process, const QString &name)
+{
+    QMutexLocker locker(&traceMutex);
+    processNames[process] = name;
+}
+
+/*!
+ * \brief Records an event of the calling process.
+ * \param event Event. The process is set by this function, a thread of 0 is replaced by the calling thread.
+ */
+static void record(BakeryTrace::Event &event)
+{
+    event.process = QCoreApplication::applicationPid();
+    if (event.thread == 0)
+    {
+        event.thread = BakeryTrace::currentThread();
+    }
+    QMutexLocker locker(&traceMutex);
+    recordedEvents << event;
+}
+
+void BakeryTrace::complete(const QString &name, const QString &category, qint64 start, const QVariantMap &arguments, qint64 thread)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+    Event event;
+    event.name = name;
+    event.category = category;
+    event.phase = 'X';
+    event.timestamp = start;
+    event.duration = now() - start;
+    event.thread = thread;
+    event.arguments = arguments;
+    record(event);
+}
+
+void BakeryTrace::instant(const QString &name, const QString &category, const QVariantMap &arguments, qint64 thread)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+    Event event;
+    event.name = name;
+    event.category = category;
+    event.phase = 'i';
+    event.timestamp = now();
+    event.thread = thread;
+    event.arguments = arguments;
+    record(event);
+}
+
+void BakeryTrace::append(const QList<Event> &events)
+{
+    QMutexLocker locker(&traceMutex);
+    recordedEvents << events;
+}
+
+QList<BakeryTrace::Event> BakeryTrace::events()
+{
+    QMutexLocker locker(&traceMutex);
+    return recordedEvents;
+}
+
+QList<BakeryTrace::Event> BakeryTrace::takeEvents()
+{
+    QMutexLocker locker(&traceMutex);
+    QList<Event> events = recordedEvents;
+    recordedEvents.clear();
+    return events;
+}
+
+void BakeryTrace::reset()
+{
+    QMutexLocker locker(&traceMutex);
+    recordedEvents.clear();
+    processNames.clear();
+    laneNames.clear();
+}
+
+/*!
+ * \brief Converts an event to an object of the trace event format.
+ * \param event Event.
+ * \return JSON object.
+ */
+static QJsonObject toJson(const BakeryTrace::Event &event)
+{
+    QJsonObject object;
+    object["name"] = event.name;
+    object["cat"] = event.category;
+    object["ph"] = QString(QChar(event.phase));
+    object["ts"] = double(event.timestamp);
+    if (event.phase == 'X')
+    {
+        object["dur"] = double(event.duration);
+    }
+    else
+    {
+        // Instant events only mark their thread
+        object["s"] = QString("t");
+    }
+    object["pid"] = double(event.process);
+    object["tid"] = double(event.thread);
+    if (!event.arguments.isEmpty())
+    {
+        object["args"] = QJsonObject::fromVariantMap(event.arguments);
+    }
+    return object;
+}
+
+/*!
+ * \brief Converts an object of the trace event format to an event.
+ * \param object JSON object.
+ * \param event Resulting event.
+ * \return true if the object is a valid span or instant event.
+ */
+static bool fromJson(const QJsonObject &object, BakeryTrace::Event &event)
+{
+    QString phase = object["ph"].toString();
+    if (!object["name"].isString() || (phase != "X" && phase != "i") || !object["ts"].isDouble() || !object["pid"].isDouble() ||
+        !object["tid"].isDouble())
+    {
+        return false;
+    }
+    event.name = object["name"].toString();
+    event.category = object["cat"].toString();
+    event.phase = phase.at(0).toLatin1();
+    event.timestamp = qint64(object["ts"].toDouble());
+    event.duration = qint64(object["dur"].toDouble());
+    event.process = qint64(object["pid"].toDouble());
+    event.thread = qint64(object["tid"].toDouble());
+    event.arguments = object["args"].toObject().toVariantMap();
+    return true;
+}
+
+QString BakeryTrace::serialize(const QList<Event> &events)
+{
+    QJsonArray array;
+    foreach (const Event &event, events)
+    {
+        array << toJson(event);
+    }
+    return QString("trace_begin %1 trace_end ").arg(QString::fromUtf8(QJsonDocument(array).toJson(QJsonDocument::Compact)));
+}
+
+QList<BakeryTrace::Event> BakeryTrace::deserialize(const QByteArray &data, bool *ok)
+{
+    if (ok != NULL)
+    {
+        *ok = false;
+    }
+
+    QByteArray trimmed = data.trimmed();
+    if (!trimmed.startsWith("trace_begin ") || !trimmed.endsWith(" trace_end"))
+    {
+        BAKERY_WARNING("Invalid trace");
+        return QList<Event>();
+    }
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(trimmed.mid(12, trimmed.size() - 22), &error);
+    if (error.error != QJsonParseError::NoError || !document.isArray())
+    {
+        BAKERY_WARNING(QString("Invalid trace events: %1").arg(error.errorString()));
+        return QList<Event>();
+    }
+
+    QList<Event> events;
+    foreach (const QJsonValue &value, document.array())
+    {
+        Event event;
+        if (!fromJson(value.toObject(), event))
+        {
+            BAKERY_WARNING("Invalid trace event");
+            return QList<Event>();
+        }
+        events << event;
+    }
+
+    if (ok != NULL)
+    {
+        *ok = true;
+    }
+    return events;
+}
+
+/*!
+ * \brief Creates a metadata event naming a process or thread.
+ * \param type "process_name" or "thread_name".
+ * \param process Process id.
+ * \param thread Thread id. Ignored for processes.
+ * \param name Name.
+ * \return JSON object.
+ */
+static QJsonObject nameEvent(const QString &type, qint64 process, qint64 thread, const QString &name)
+{
+    QJsonObject object;
+    object["name"] = type;
+    object["ph"] = QString("M");
+    object["pid"] = double(process);
+    object["tid"] = double(thread);
+    QJsonObject arguments;
+    arguments["name"] = name;
+    object["args"] = arguments;
+    return object;
+}
+
+bool BakeryTrace::writeChromeTrace(QIODevice *device)
+{
+    QJsonArray array;
+    {
+        QMutexLocker locker(&traceMutex);
+        qint64 process = QCoreApplication::applicationPid();
+        if (!processNames.contains(process))
+        {
+            array << nameEvent("process_name", process, 0, QCoreApplication::applicationName());
+        }
+        for (QHash<qint64, QString>::ConstIterator i_name = processNames.constBegin(); i_name != processNames.constEnd(); ++i_name)
+        {
+            array << nameEvent("process_name", i_name.key(), 0, i_name.value());
+        }
+        for (QHash<qint64, QString>::ConstIterator i_name = laneNames.constBegin(); i_name != laneNames.constEnd(); ++i_name)
+        {
+            array << nameEvent("thread_name", process, i_name.key(), i_name.value());
+        }
+        foreach (const Event &event, recordedEvents)
+        {
+            array << toJson(event);
+        }
+    }
+
+    QJsonObject trace;
+    trace["traceEvents"] = array;
+    trace["displayTimeUnit"] = QString("ms");
+    QByteArray data = QJsonDocument(trace).toJson(QJsonDocument::Compact);
+    return device->write(data) == data.size();
+}
+
+BakeryTrace::Span::Span(const char *name, const char *category)
+    : _name(name), _category(category), _start(isEnabled() ? now() : -1), _arguments()
+{
+}
+
+BakeryTrace::Span::~Span() { end(); }
+
+void BakeryTrace::Span::setArgument(const QString &key, const QVariant &value)
+{
+    if (_start != -1)
+    {
+        _arguments[key] = value;
+    }
+}
+
+void BakeryTrace::Span::end()
+{
+    if (_start == -1)
+    {
+        return;
+    }
+    complete(QString::fromLatin1(_name), QString::fromLatin1(_category), _start, _arguments);
+    _start = -1;
+}
@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAKERY_TRACE_H
+#define BAKERY_TRACE_H
+
+#include "global.h"
+
+#include <QAtomicInt>
+#include <QIODevice>
+#include <QList>
+#include <QString>
+#include <QVariant>
+#include <QVariantMap>
+
+/*!
+ * \brief Timeline of the host and its plugins which can be viewed as Chrome trace (chrome://tracing, Perfetto).
+ *
+ * Tracing is disabled by default. Then recording only costs a relaxed load of a flag. Timestamps are taken in microseconds from the
+ * monotonic clock, which is shared by all processes of a system, so events of plugin processes fit into the timeline of the host.
+ *
+ * Plugin processes record while the host has sent the command "enable_trace" and report their events of a job after its final output
+ * (see FORMAT.txt). The host adds them to its own events.
+ */
+namespace BakeryTrace
+{
+/*!
+ * \brief Single event of the timeline.
+ */
+struct BAKERYSHARED_EXPORT Event
+{
+    /*!
+     * \brief Constructor.
+     */
+    Event();
+
+    /*!
+     * \brief Name of the event.
+     */
+    QString name;
+
+    /*!
+     * \brief Category of the event, e.g. "plugin" or "protocol".
+     */
+    QString category;
+
+    /*!
+     * \brief Phase as used by the trace event format. 'X' for spans, 'i' for instant events.
+     */
+    char phase;
+
+    /*!
+     * \brief Start of the event in microseconds (see now()).
+     */
+    qint64 timestamp;
+
+    /*!
+     * \brief Duration of a span in microseconds. 0 for instant events.
+     */
+    qint64 duration;
+
+    /*!
+     * \brief Id of the process which recorded the event.
+     */
+    qint64 process;
+
+    /*!
+     * \brief Id of the thread or lane (see newLane()) the event belongs to.
+     */
+    qint64 thread;
+
+    /*!
+     * \brief Additional values shown with the event. Values have to be convertible to JSON.
+     */
+    QVariantMap arguments;
+};
+
+/*!
+ * \brief Flag checked by isEnabled(). Use setEnabled() to change it.
+ */
+extern BAKERYSHARED_EXPORT QAtomicInt enabledFlag;
+
+/*!
+ * \brief Returns whether events are recorded.
+ * \return true if enabled.
+ */
+inline bool isEnabled() { return Q_UNLIKELY(enabledFlag.load() != 0); }
+
+/*!
+ * \brief Enables or disables recording in all threads. Recorded events are kept.
+ * \param enabled If true, events are recorded.
+ */
+BAKERYSHARED_EXPORT void setEnabled(bool enabled);
+
+/*!
+ * \brief Returns the current time of the clock used for events.
+ * \return Current time in microseconds.
+ */
+BAKERYSHARED_EXPORT qint64 now();
+
+/*!
+ * \brief Returns the id of the calling thread as used for events. Ids are small numbers which are unique within the process.
+ * \return Thread id.
+ */
+BAKERYSHARED_EXPORT qint64 currentThread();
+
+/*!
+ * \brief Creates a lane, i.e. a row of the timeline which does not belong to a thread, e.g. one for every plugin run by the host.
+ * \param name Name shown for the lane.
+ * \return Id to be passed as thread to complete() and instant().
+ */
+BAKERYSHARED_EXPORT qint64 newLane(const QString &name);
+
+/*!
+ * \brief Sets the name shown for a process.
+ * \param process Process id.
+ * \param name Name.
+ */
+BAKERYSHARED_EXPORT void setProcessName(qint64 process, const QString &name);
+
+/*!
+ * \brief Records a span which started at the given time and ends now. Does nothing if recording is disabled.
+ * \param name Name of the span.
+ * \param category Category of the span.
+ * \param start Start of the span (see now()).
+ * \param arguments Additional values.
+ * \param thread Thread or lane of the span. If 0, the calling thread is used.
+ */
+BAKERYSHARED_EXPORT void complete(const QString &name, const QString &category, qint64 start,
+                                  const QVariantMap &arguments = QVariantMap(), qint64 thread = 0);
+
+/*!
+ * \brief Records an instant event. Does nothing if recording is disabled.
+ * \param name Name of the event.
+ * \param category Category of the event.
+ * \param arguments Additional values.
+ * \param thread Thread or lane of the event. If 0, the calling thread is used.
+ */
+BAKERYSHARED_EXPORT void instant(const QString &name, const QString &category, const QVariantMap &arguments = QVariantMap(),
+                                 qint64 thread = 0);
+
+/*!
+ * \brief Adds events recorded elsewhere, e.g. by a plugin process.
+ * \param events Events.
+ */
+BAKERYSHARED_EXPORT void append(const QList<Event> &events);
+
+/*!
+ * \brief Returns all recorded events.
+ * \return Events in order of recording.
+ */
+BAKERYSHARED_EXPORT QList<Event> events();
+
+/*!
+ * \brief Returns all recorded events and removes them.
+ * \return Events in order of recording.
+ */
+BAKERYSHARED_EXPORT QList<Event> takeEvents();
+
+/*!
+ * \brief Removes all recorded events and names of processes and lanes.
+ */
+BAKERYSHARED_EXPORT void reset();
+
+/*!
+ * \brief Serializes events as "trace_begin [events] trace_end", where [events] is a JSON array on a single line.
+ * \param events Events.
+ * \return Serialized events.
+ */
+BAKERYSHARED_EXPORT QString serialize(const QList<Event> &events);
+
+/*!
+ * \brief Reads events written by serialize().
+ * \param data Serialized events.
+ * \param ok Will be set to true if no errors occur. Will be ignored if set to NULL.
+ * \return Events.
+ */
+BAKERYSHARED_EXPORT QList<Event> deserialize(const QByteArray &data, bool *ok = NULL);
+
+/*!
+ * \brief Writes all recorded events in the Chrome trace event format (JSON object format).
+ * \param device Opened device.
+ * \return true if successful.
+ */
+BAKERYSHARED_EXPORT bool writeChromeTrace(QIODevice *device);
+
+/*!
+ * \brief Records the time between its construction and its destruction as span of the calling thread.
+ *
+ * Nothing is recorded if recording was disabled at construction. Names are literals, so an inactive span does not allocate.
+ */
+class BAKERYSHARED_EXPORT Span
+{
+public:
+    /*!
+     * \brief Constructor. Starts the span.
+     * \param name Name of the span.
+     * \param category Category of the span.
+     */
+    explicit Span(const char *name, const char *category = "plugin");
+
+    /*!
+     * \brief Destructor. Ends the span unless end() has been called.
+     */
+    ~Span();
+
+    /*!
+     * \brief Sets an additional value shown with the span. Does nothing if the span is inactive.
+     * \param key Name of the value.
+     * \param value Value. Has to be convertible to JSON.
+     */
+    void setArgument(const QString &key, const QVariant &value);
+
+    /*!
+     * \brief Ends the span before its destruction.
+     */
+    void end();
+
+private:
+    Q_DISABLE_COPY(Span)
+
+    /*!
+     * \brief Name of the span.
+     */
+    const char *_name;
+
+    /*!
+     * \brief Category of the span.
+     */
+    const char *_category;
+
+    /*!
+     * \brief Start of the span. -1 if the span is inactive or has ended.
+     */
+    qint64 _start;
+
+    /*!
+     * \brief Additional values.
+     */
+    QVariantMap _arguments;
+};
+}
+
+#endif // BAKERY_TRACE_H
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "validator.h"
+
+OutputValidator::OutputValidator()
+    : _sheetWidth(0), _sheetHeight(0), _totalShapes(0), _available(), _used(), _placed(0), _excess(0), _current(),
+      _objective(ScoredOutput::AverageUtilization), _best(), _hasBest(false), _error(), _checkedShapes(0)
+{
+}
+
+OutputValidator::OutputValidator(const PluginInput &input, ScoredOutput::Objective objective)
+    : _sheetWidth(input.sheetWidth), _sheetHeight(input.sheetHeight), _totalShapes(input.shapeCount()), _available(), _used(), _placed(0),
+      _excess(0), _current(), _objective(objective), _best(), _hasBest(false), _error(), _checkedShapes(0)
+{
+    const ShapeStock &stock = input.stock();
+    for (qint32 i_type = 0; i_type < stock.types(); ++i_type)
+    {
+        _available[stock.prototype(i_type).name()] += stock.count(i_type);
+    }
+}
+
+bool OutputValidator::update(const PluginOutput &output)
+{
+    QHash<QString, qint32> used = _used;
+    qint32 placed = _placed;
+    qint32 excess = _excess;
+    qint64 checkedShapes = 0;
+
+    for (qint32 i_sheet = 0; i_sheet < qMax(output.sheets.size(), _current.sheets.size()); ++i_sheet)
+    {
+        QList<Shape> oldShapes;
+        if (i_sheet < _current.sheets.size())
+        {
+            Sheet oldSheet = _current.sheets[i_sheet];
+            oldShapes = oldSheet.shapes();
+        }
+        QList<Shape> newShapes;
+        QRect bounds;
+        if (i_sheet < output.sheets.size())
+        {
+            Sheet newSheet = output.sheets[i_sheet];
+            if (newSheet.width() != _sheetWidth || newSheet.height() != _sheetHeight)
+            {
+                _error = QString("Sheet %1 has size %2x%3 instead of %4x%5")
+                             .arg(i_sheet)
+                             .arg(newSheet.width())
+                             .arg(newSheet.height())
+                             .arg(_sheetWidth)
+                             .arg(_sheetHeight);
+                return false;
+            }
+            newShapes = newSheet.shapes();
+            bounds = newSheet.boundingRect();
+        }
+
+        // Shapes in front of the first change have already been checked against each other
+        qint32 unchanged = 0;
+        while (unchanged < oldShapes.size() && unchanged < newShapes.size() && oldShapes[unchanged] == newShapes[unchanged])
+        {
+            ++unchanged;
+        }
+
+        for (qint32 i_shape = unchanged; i_shape < oldShapes.size(); ++i_shape)
+        {
+            qint32 &count = used[oldShapes[i_shape].name()];
+            if (count > _available.value(oldShapes[i_shape].name()))
+            {
+                --excess;
+            }
+            --count;
+            --placed;
+        }
+
+        for (qint32 i_shape = unchanged; i_shape < newShapes.size(); ++i_shape)
+        {
+            const Shape &shape = newShapes[i_shape];
+            ++checkedShapes;
+            if (!bounds.contains(shape.boundingRect()))
+            {
+                _error = QString("Shape '%1' exceeds sheet %2").arg(shape.name()).arg(i_sheet);
+                return false;
+            }
+            for (qint32 i_other = 0; i_other < i_shape; ++i_other)
+            {
+                if (shape.intersects(newShapes[i_other]))
+                {
+                    _error = QString("Shape '%1' intersects shape '%2' on sheet %3")
+                                 .arg(shape.name())
+                                 .arg(newShapes[i_other].name())
+                                 .arg(i_sheet);
+                    return false;
+                }
+            }
+            qint32 &count = used[shape.name()];
+            ++count;
+            if (count > _available.value(shape.name()))
+            {
+                ++excess;
+            }
+            ++placed;
+        }
+    }
+
+    _checkedShapes += checkedShapes;
+    if (excess > 0)
+    {
+        _error = QString("Output contains %1 shape(s) which are not part of the input").arg(excess);
+        return false;
+    }
+
+    _used = used;
+    _placed = placed;
+    _excess = excess;
+    _current = output;
+    _error.clear();
+    if (isComplete())
+    {
+        ScoredOutput scored(output, _objective);
+        if (!_hasBest || !(scored < _best))
+        {
+            _best = scored;
+            _hasBest = true;
+        }
+    }
+    return true;
+}
+
+bool OutputValidator::isComplete() const { return _placed == _totalShapes && _excess == 0; }
+
+bool OutputValidator::hasCompleteOutput() const { return _hasBest; }
+
+PluginOutput OutputValidator::currentOutput() const { return _current; }
+
+PluginOutput OutputValidator::bestOutput() const { return _best.output(); }
+
+QString OutputValidator::error() const { return _error; }
+
+qint64 OutputValidator::checkedShapes() const { return _checkedShapes; }
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2015,2016 Philipp Naumann
+ * Copyright (C) 2015,2016 Marcus Soll
+ * This file is part of Bakery.
+ *
+ * Bakery is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Bakery is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Bakery.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BAKERY_VALIDATOR_H
+#define BAKERY_VALIDATOR_H
+
+#include "global.h"
+#include "plugins.h"
+#include "scoredoutput.h"
+#include "shape.h"
+#include "sheet.h"
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+/*!
+ * \brief Validates the outputs of a plugin incrementally while they arrive.
+ *
+ * Plugins report their whole output with every update, but usually only add shapes to the sheets they are working on. The validator
+ * remembers the last accepted output and only checks the shapes following the unchanged beginning of each sheet: each of them has to lie
+ * inside the sheet and must not intersect any shape placed before it on the same sheet. The shapes of the input are accounted in a
+ * multiset, so an update is complete exactly if all shapes are placed and none is used too often.
+ *
+ * A rejected update does not change the state, so the next update is compared against the last accepted one. The best complete output
+ * accepted so far is kept as a snapshot which is always valid.
+ */
+class BAKERYSHARED_EXPORT OutputValidator
+{
+public:
+    /*!
+     * \brief Constructor. Creates a validator for an empty input.
+     */
+    OutputValidator();
+
+    /*!
+     * \brief Constructor.
+     * \param input PluginInput the outputs are validated against.
+     * \param objective Objective to choose the best output by.
+     */
+    explicit OutputValidator(const PluginInput &input, ScoredOutput::Objective objective = ScoredOutput::AverageUtilization);
+
+    /*!
+     * \brief Validates an output and accepts it if it is valid.
+     * \param output Complete or partial output.
+     * \return true if the output is valid (though it might not contain all shapes yet).
+     */
+    bool update(const PluginOutput &output);
+
+    /*!
+     * \brief Returns whether the last accepted output contains all shapes of the input.
+     * \return true if complete.
+     */
+    bool isComplete() const;
+
+    /*!
+     * \brief Returns whether a complete output has been accepted.
+     * \return true if bestOutput() is a complete and valid output.
+     */
+    bool hasCompleteOutput() const;
+
+    /*!
+     * \brief Returns the last accepted output.
+     * \return Valid output, possibly partial.
+     */
+    PluginOutput currentOutput() const;
+
+    /*!
+     * \brief Returns the complete output with the best score accepted so far. Later outputs win ties.
+     * \return Valid output. Empty if hasCompleteOutput() is false.
+     */
+    PluginOutput bestOutput() const;
+
+    /*!
+     * \brief Returns the reason the last output was rejected.
+     * \return Error message. Empty if the last output was accepted.
+     */
+    QString error() const;
+
+    /*!
+     * \brief Returns the number of shapes which have been checked so far.
+     * \return Number of shapes.
+     */
+    qint64 checkedShapes() const;
+
+private:
+    /*!
+     * \brief Width of the sheets.
+     */
+    qint32 _sheetWidth;
+
+    /*!
+     * \brief Height of the sheets.
+     */
+    qint32 _sheetHeight;
+
+    /*!
+     * \brief Number of shapes in the input.
+     */
+    qint32 _totalShapes;
+
+    /*!
+     * \brief Number of shapes of the input by name.
+     */
+    QHash<QString, qint32> _available;
+
+    /*!
+     * \brief Number of shapes placed in the last accepted output by name.
+     */
+    QHash<QString, qint32> _used;
+
+    /*!
+     * \brief Number of shapes placed in the last accepted output.
+     */
+    qint32 _placed;
+
+    /*!
+     * \brief Number of shapes placed in the last accepted output which are not part of the input or exceed its count.
+     */
+    qint32 _excess;
+
+    /*!
+     * \brief Last accepted output.
+     */
+    PluginOutput _current;
+
+    /*!
+     * \brief Objective to choose the best output by.
+     */
+    ScoredOutput::Objective _objective;
+
+    /*!
+     * \brief Best complete output.
+     */
+    ScoredOutput _best;
+
+    /*!
+     * \brief True if _best is set.
+     */
+    bool _hasBest;
+
+    /*!
+     * \brief Reason the last output was rejected.
+     */
+    QString _error;
+
+    /*!
+     * \brief Number of shapes checked.
+     */
+    qint64 _checkedShapes;
+};
+
+#endif // BAKERY_VALIDATOR_H
@@ -175,7 +175,7 @@ bool EdgeMatcherPlugin::placeFirstShape(Sheet &sheet, Shape &shape)
     return false;
 }
 
-EdgeMatcherPlugin::EdgeMatcherPlugin(QObject *parent) : QObject(parent), _terminated(false) {}
+EdgeMatcherPlugin::EdgeMatcherPlugin(QObject *parent) : QObject(parent) {}
 
 void EdgeMatcherPlugin::giveMetadata()
 {
@@ -195,33 +195,34 @@ void EdgeMatcherPlugin::bakeSheets(PluginInput input)
     Shape newShape;
 
     // Sort shapes
-    std::sort(input.shapes.begin(), input.shapes.end(), Shape::lessThanByAreaDesc);
+    QList<Shape> shapes = input.shapes();
+    std::sort(shapes.begin(), shapes.end(), Shape::lessThanByAreaDesc);
     QSet<QString> nameSet;
 
-    newShape = Shape(input.shapes[0]);
+    newShape = Shape(shapes[0]);
     if (!placeFirstShape(currentSheet, newShape))
     {
         emit finished(output);
         return;
     }
-    input.shapes.removeAt(0);
+    shapes.removeAt(0);
     output.sheets << currentSheet;
     emit outputUpdated(output);
 
-    while (!input.shapes.isEmpty())
+    while (!shapes.isEmpty())
     {
-        if (i >= input.shapes.size())
+        if (i >= shapes.size())
         {
             // Restart from the beginning on new sheet
             currentSheet = Sheet(input.sheetWidth, input.sheetHeight);
 
-            newShape = Shape(input.shapes[0]);
+            newShape = Shape(shapes[0]);
             if (!placeFirstShape(currentSheet, newShape))
             {
                 emit finished(output);
                 return;
             }
-            input.shapes.removeAt(0);
+            shapes.removeAt(0);
 
             output.sheets << currentSheet;
             emit outputUpdated(output);
@@ -229,7 +230,7 @@ void EdgeMatcherPlugin::bakeSheets(PluginInput input)
             i = 0;
             nameSet.clear();
 
-            if (input.shapes.isEmpty())
+            if (shapes.isEmpty())
             {
                 emit finished(output);
                 return;
@@ -239,26 +240,25 @@ void EdgeMatcherPlugin::bakeSheets(PluginInput input)
         Shape match;
         bool foundMatch = false;
 
-        match = matchEdge(output.sheets.last(), input.shapes[i], foundMatch);
+        match = matchEdge(output.sheets.last(), shapes[i], foundMatch);
 
         if (foundMatch)
         {
             output.sheets.last() << match;
-            input.shapes.removeAt(i);
+            shapes.removeAt(i);
             emit outputUpdated(output);
         }
         else
         {
             // Skip identical Shapes
-            nameSet << input.shapes[i].name();
+            nameSet << shapes[i].name();
             do
             {
                 ++i;
-            } while (i < input.shapes.length() && nameSet.contains(input.shapes[i].name()));
+            } while (i < shapes.length() && nameSet.contains(shapes[i].name()));
         }
 
-        QCoreApplication::processEvents();
-        if (_terminated)
+        if (BakeryPlugins::deadlineReached())
         {
             emit finished(output);
             return;
@@ -268,8 +268,8 @@ void EdgeMatcherPlugin::bakeSheets(PluginInput input)
     emit finished(output);
 }
 
-void EdgeMatcherPlugin::terminate(int msecs) { QTimer::singleShot(msecs, this, SLOT(terminated(int))); }
+void EdgeMatcherPlugin::terminate(int) {}
 
-void EdgeMatcherPlugin::terminated() { _terminated = true; }
+void EdgeMatcherPlugin::reset() {}
 
 BAKERY_PLUGIN_MAIN(EdgeMatcherPlugin)
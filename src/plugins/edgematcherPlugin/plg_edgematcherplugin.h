@@ -23,7 +23,6 @@
 #include <plugins.h>
 
 #include <QObject>
-#include <QTimer>
 
 /*!
  * \brief EdgeMatcher plugin.
@@ -56,12 +55,6 @@ public:
      */
     explicit EdgeMatcherPlugin(QObject *parent = 0);
 
-private:
-    /*!
-     * \brief Set to true if EdgeMatcher should terminate.
-     */
-    bool _terminated;
-
 signals:
     /*!
      * \brief Is emitted when giveMetadata() is called according to specification.
@@ -84,12 +77,6 @@ signals:
      */
     void finished(PluginOutput output);
 
-private slots:
-    /*!
-     * \brief Used by terminate().
-     */
-    void terminated();
-
 public slots:
     /*!
      * \brief Emits metadataGiven().
@@ -103,10 +90,35 @@ public slots:
     void bakeSheets(PluginInput input);
 
     /*!
-     * \brief Sets _terminated to true with a delay of msec milliseconds.
+     * \brief Does nothing, since bakeSheets(PluginInput) does not return to the event loop before it is finished. The "terminate"
+     * command tightens the deadline of the current job instead (see PluginDeadline::tighten(qint64)), which is the only stop signal.
      * \param msec Milliseconds.
      */
     void terminate(int msec);
+
+    /*!
+     * \brief Resets the plugin state between two jobs of a persistent plugin process. The plugin keeps no state between jobs.
+     */
+    void reset();
+};
+
+#ifdef BAKERY_PLUGIN_LIBRARY
+/*!
+ * \brief Factory of the in-process edge matcher plugin.
+ */
+class EdgeMatcherPluginFactory : public QObject, public PluginFactory
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID "org.bakery.PluginFactory/1.0")
+    Q_INTERFACES(PluginFactory)
+
+public:
+    /*!
+     * \brief Creates a new EdgeMatcherPlugin instance.
+     * \return New instance.
+     */
+    QObject *createInstance() { return new EdgeMatcherPlugin(); }
 };
+#endif
 
 #endif // EDGEMATCHERPLUGIN_H
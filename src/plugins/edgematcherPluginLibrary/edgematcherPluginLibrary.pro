@@ -0,0 +1,10 @@
+!include(../../../bakery_plugin_libraries.pri) {
+    error( "Could not include ../../../bakery_plugin_libraries.pri!" )
+}
+
+TARGET = plg_edgematcherplugin
+
+SOURCES += \
+    ../edgematcherPlugin/plg_edgematcherplugin.cpp
+HEADERS += \
+    ../edgematcherPlugin/plg_edgematcherplugin.h
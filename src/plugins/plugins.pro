@@ -1,3 +1,4 @@
 TEMPLATE = subdirs
 
-SUBDIRS = typewriterPlugin edgematcherPlugin shapeShakerPlugin
+SUBDIRS = typewriterPlugin edgematcherPlugin shapeShakerPlugin \
+    typewriterPluginLibrary edgematcherPluginLibrary shapeShakerPluginLibrary
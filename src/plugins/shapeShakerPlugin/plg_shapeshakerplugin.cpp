@@ -23,9 +23,7 @@
 #include "math.h"
 #include <algorithm>
 
-#include <QSet>
-
-static std::mt19937 rnd;
+static thread_local std::mt19937 rnd;
 
 qreal ShapeShakerPlugin::getRandomValue(qreal min, qreal max)
 {
@@ -127,7 +125,7 @@ void ShapeShakerPlugin::applyGravity(qint32 rounds, Sheet &sheet)
     }
 }
 
-ShapeShakerPlugin::ShapeShakerPlugin(QObject *parent) : QObject(parent), _terminated(false) {}
+ShapeShakerPlugin::ShapeShakerPlugin(QObject *parent) : QObject(parent) {}
 
 ShapeShakerPlugin::~ShapeShakerPlugin() {}
 
@@ -145,25 +143,28 @@ void ShapeShakerPlugin::bakeSheets(PluginInput input)
 {
     PluginOutput output;
     Sheet currentSheet(input.sheetWidth, input.sheetHeight);
+    ShapeStock stock = input.stock();
 
     // Initial
     bool placed;
 
     // Iterations
-    while (!input.shapes.empty())
+    while (!stock.isEmpty())
     {
         for (qint32 i = 0; i < 10; ++i)
         {
             do
             {
-                qint32 randomShapeNumber = getRandomValue(0, input.shapes.size() - 1);
-                placed = placeShape(currentSheet, input.shapes[randomShapeNumber]);
+                // Each remaining piece is equally likely
+                qint32 randomType = stock.typeOfPiece(qint32(getRandomValue(0, stock.total() - 1)));
+                Shape shape = stock.prototype(randomType);
+                placed = placeShape(currentSheet, shape);
                 if (placed)
                 {
-                    input.shapes.removeAt(randomShapeNumber);
+                    stock.take(randomType);
                 }
-            } while (placed && !input.shapes.empty());
-            if (input.shapes.empty())
+            } while (placed && !stock.isEmpty());
+            if (stock.isEmpty())
             {
                 break;
             }
@@ -172,23 +173,12 @@ void ShapeShakerPlugin::bakeSheets(PluginInput input)
         }
 
         // Try one last time to place shapes - this time we want to try each type of shape
-        QSet<QString> nonFitting;
-        QList<Shape>::Iterator iterator = input.shapes.begin();
-        while (iterator != input.shapes.end())
+        for (qint32 i_type = 0; i_type < stock.types(); ++i_type)
         {
-            if (nonFitting.contains(iterator->name()))
-            {
-                ++iterator;
-                continue;
-            }
-            if (placeShape(currentSheet, *iterator))
-            {
-                iterator = input.shapes.erase(iterator);
-            }
-            else
+            Shape shape = stock.prototype(i_type);
+            while (stock.count(i_type) > 0 && placeShape(currentSheet, shape))
             {
-                nonFitting << iterator->name();
-                ++iterator;
+                stock.take(i_type);
             }
         }
 
@@ -206,8 +196,7 @@ void ShapeShakerPlugin::bakeSheets(PluginInput input)
         emit outputUpdated(output);
         currentSheet = Sheet(input.sheetWidth, input.sheetHeight);
 
-        QCoreApplication::processEvents();
-        if (_terminated)
+        if (BakeryPlugins::deadlineReached())
         {
             emit finished(output);
             return;
@@ -217,8 +206,8 @@ void ShapeShakerPlugin::bakeSheets(PluginInput input)
     emit finished(output);
 }
 
-void ShapeShakerPlugin::terminate(int msecs) { QTimer::singleShot(msecs, this, SLOT(terminated(int))); }
+void ShapeShakerPlugin::terminate(int) {}
 
-void ShapeShakerPlugin::terminated() { _terminated = true; }
+void ShapeShakerPlugin::reset() {}
 
 BAKERY_PLUGIN_MAIN(ShapeShakerPlugin)
@@ -0,0 +1,10 @@
+!include(../../../bakery_plugin_libraries.pri) {
+    error( "Could not include ../../../bakery_plugin_libraries.pri!" )
+}
+
+TARGET = plg_shapeshakerplugin
+
+SOURCES += \
+    ../shapeShakerPlugin/plg_shapeshakerplugin.cpp
+HEADERS += \
+    ../shapeShakerPlugin/plg_shapeshakerplugin.h
@@ -20,10 +20,11 @@
 #include "plg_typewriterplugin.h"
 
 #include "../lib/helpers.hpp"
+#include "../lib/scoredoutput.h"
 
-#include <QTimer>
+#include <QSet>
 
-TypewriterPlugin::TypewriterPlugin(QObject *parent) : QObject(parent), _terminated(false) {}
+TypewriterPlugin::TypewriterPlugin(QObject *parent) : QObject(parent), _outputs() {}
 
 qint32 TypewriterPlugin::computeResolution(const QList<Shape> &shapes, const QList<qreal> &angles)
 {
@@ -96,45 +97,51 @@ qreal TypewriterPlugin::convexHullUtilitization(const Sheet &sheet)
 
 void TypewriterPlugin::typewrite(PluginInput input, qreal (*metric)(const Sheet &), int maximumSuperiors)
 {
-    if (_terminated)
+    if (isTerminated())
     {
         return;
     }
+    PluginSpan typewriteSpan("typewrite");
+    typewriteSpan.setArgument("superiors", maximumSuperiors);
 
     PluginOutput output;
 
-    // Unique
-    Shape::Unique unique = Shape::reduceToUnique(input.shapes);
+    // Types
+    QList<Shape> prototypes = input.stock().prototypes();
 
-    // Sort and normalize
-    std::sort(input.shapes.begin(), input.shapes.end(), Shape::lessThanByAreaDesc);
-    for (QList<Shape>::Iterator i_shape = input.shapes.begin(); i_shape != input.shapes.end(); ++i_shape)
+    // Sort and normalize the pieces, which are worked off one by one
+    QList<Shape> shapes = input.shapes();
+    std::sort(shapes.begin(), shapes.end(), Shape::lessThanByAreaDesc);
+    for (QList<Shape>::Iterator i_shape = shapes.begin(); i_shape != shapes.end(); ++i_shape)
     {
         i_shape->normalize();
     }
 
     // Angles and resolution
-    QList<qreal> angles = computeAngles(input.sheetWidth, input.sheetHeight, unique.shapes);
-    qint32 resolution = computeResolution(unique.shapes, angles);
+    QList<qreal> angles = computeAngles(input.sheetWidth, input.sheetHeight, prototypes);
+    qint32 resolution = computeResolution(prototypes, angles);
 
     QList<Shape> failed;
-    QList<QString> failedNames;
+    QSet<QString> failedNames;
     output.sheets << Sheet(input.sheetWidth, input.sheetHeight);
-    while (!input.shapes.isEmpty() && !_terminated)
+    while (!shapes.isEmpty() && !isTerminated())
     {
-        Shape shape = input.shapes.takeFirst();
+        Shape shape = shapes.takeFirst();
+        PluginSpan span("place shape");
+        span.setArgument("shape", shape.name());
         QPoint anchor = shape.boundingRect().center();
         Sheet bestSheet;
         qreal highestSheetScore = -1;
         qint32 superiors = maximumSuperiors;
         if (!failedNames.contains(shape.name()))
         {
-            for (QList<qreal>::Iterator i_angle = angles.begin(); i_angle != angles.end() && superiors > 0 && !_terminated; i_angle++)
+            for (QList<qreal>::Iterator i_angle = angles.begin(); i_angle != angles.end() && superiors > 0 && !isTerminated();
+                 i_angle++)
             {
                 Shape rotatedShape = shape.rotated(anchor, *i_angle);
-                for (qint32 y = 0; y < input.sheetHeight && superiors > 0 && !_terminated; y += resolution)
+                for (qint32 y = 0; y < input.sheetHeight && superiors > 0 && !isTerminated(); y += resolution)
                 {
-                    for (qint32 x = 0; x < input.sheetWidth && superiors > 0 && !_terminated; x += resolution)
+                    for (qint32 x = 0; x < input.sheetWidth && superiors > 0 && !isTerminated(); x += resolution)
                     {
                         Sheet candidateSheet(output.sheets.last());
                         rotatedShape.moveTo(x, y);
@@ -149,11 +156,12 @@ void TypewriterPlugin::typewrite(PluginInput input, qreal (*metric)(const Sheet
                                 --superiors;
                             }
                         }
-                        QCoreApplication::processEvents();
                     }
                 }
             }
         }
+        span.setArgument("placed", highestSheetScore != -1);
+        span.end();
         if (highestSheetScore == -1)
         {
             failed << shape;
@@ -169,18 +177,18 @@ void TypewriterPlugin::typewrite(PluginInput input, qreal (*metric)(const Sheet
             output.sheets.removeLast();
             break;
         }
-        if (input.shapes.isEmpty() && !failed.isEmpty())
+        if (shapes.isEmpty() && !failed.isEmpty())
         {
             output.sheets << Sheet(input.sheetWidth, input.sheetHeight);
             emit outputUpdated(output);
 
-            input.shapes << failed;
+            shapes << failed;
             failed.clear();
             failedNames.clear();
         }
     }
 
-    if (!_terminated)
+    if (!isTerminated())
     {
         _outputs << output;
     }
@@ -198,8 +206,7 @@ void TypewriterPlugin::bakeSheets(PluginInput input)
 
     if (!_outputs.isEmpty())
     {
-        std::sort(_outputs.begin(), _outputs.end());
-        emit finished(_outputs.last());
+        emit finished(_outputs[ScoredOutput::best(_outputs)]);
     }
     else
     {
@@ -207,8 +214,10 @@ void TypewriterPlugin::bakeSheets(PluginInput input)
     }
 }
 
-void TypewriterPlugin::terminate(int msecs) { QTimer::singleShot(msecs / 2, this, SLOT(terminated())); }
+void TypewriterPlugin::terminate(int) {}
 
-void TypewriterPlugin::terminated() { _terminated = true; }
+void TypewriterPlugin::reset() { _outputs.clear(); }
+
+bool TypewriterPlugin::isTerminated() const { return BakeryPlugins::deadlineReached(0.5); }
 
 BAKERY_PLUGIN_MAIN(TypewriterPlugin)
@@ -45,9 +45,10 @@ private:
     QList<PluginOutput> _outputs;
 
     /*!
-     * \brief Is set when the "terminate" command is received after a delay equal to half the given time.
+     * \brief Returns true if half of the time until the deadline has passed.
+     * \return true if the plugin should stop working.
      */
-    bool _terminated;
+    bool isTerminated() const;
 
     /*!
      * \brief Computes the resolution.
@@ -124,16 +125,35 @@ public slots:
     void bakeSheets(PluginInput input);
 
     /*!
-     * \brief Sets _terminated to true with a delay of (msecs / 2) milliseconds.
+     * \brief Does nothing, since bakeSheets(PluginInput) does not return to the event loop before it is finished. The "terminate"
+     * command tightens the deadline of the current job instead (see PluginDeadline::tighten(qint64)), which is the only stop signal.
      * \param msecs Milliseconds.
      */
     void terminate(int msecs);
 
-private slots:
     /*!
-     * \brief Used by terminate().
+     * \brief Resets the plugin state between two jobs of a persistent plugin process.
      */
-    void terminated();
+    void reset();
 };
 
+#ifdef BAKERY_PLUGIN_LIBRARY
+/*!
+ * \brief Factory of the in-process typewriter plugin.
+ */
+class TypewriterPluginFactory : public QObject, public PluginFactory
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID "org.bakery.PluginFactory/1.0")
+    Q_INTERFACES(PluginFactory)
+
+public:
+    /*!
+     * \brief Creates a new TypewriterPlugin instance.
+     * \return New instance.
+     */
+    QObject *createInstance() { return new TypewriterPlugin(); }
+};
+#endif
+
 #endif // TYPEWRITERPLUGIN_H
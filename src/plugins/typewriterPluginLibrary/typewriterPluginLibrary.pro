@@ -0,0 +1,10 @@
+!include(../../../bakery_plugin_libraries.pri) {
+    error( "Could not include ../../../bakery_plugin_libraries.pri!" )
+}
+
+TARGET = plg_typewriterplugin
+
+SOURCES += \
+    ../typewriterPlugin/plg_typewriterplugin.cpp
+HEADERS += \
+    ../typewriterPlugin/plg_typewriterplugin.h
@@ -27,6 +27,11 @@
 #include <QBuffer>
 #include <QPainterPath>
 #include <QTimer>
+#include <QTemporaryDir>
+#include <QTextCodec>
+#include <cctype>
+#include <algorithm>
+#include <limits>
 
 // Convenience
 typedef QPoint P;
@@ -48,19 +53,44 @@ private Q_SLOTS:
     void initTestCase();
     void loadDevice_data();
     void loadDevice();
+    void loadDeviceTransports_data();
+    void loadDeviceTransports();
     void saveDevice_data();
     void saveDevice();
     void saveDeviceInput_data();
     void saveDeviceInput();
     void constructorPluginLoading();
+    void jobPluginSharing();
+    void cachedPluginLoading();
+    void resultCache();
     void bakeSheetsfromInput_data();
     void bakeSheetsfromInput();
+    void bakeSheetsAsync();
     void bakeSheetsfromFile_data();
     void bakeSheetsfromFile();
     void loadSVG_data();
     void loadSVG();
+    void loadSVGConservative_data();
+    void loadSVGConservative();
+    void saveSVG_data();
+    void saveSVG();
+    void formatPrecise_data();
+    void formatPrecise();
     void isOutputValidForInput_data();
     void isOutputValidForInput();
+    void outputValidator_data();
+    void outputValidator();
+    void outputValidatorIncremental();
+    void lowerBounds_data();
+    void lowerBounds();
+    void simplifier();
+    void randomInputs_data();
+    void randomInputs();
+    void randomProfiles_data();
+    void randomProfiles();
+
+private:
+    QTemporaryDir _metadataCacheDir;
 };
 
 TestBakery::TestBakery() {}
@@ -71,6 +101,10 @@ void TestBakery::initTestCase()
     // want to test invalid files the warning and debug messages are suppressed
     // to make the test output more readable
     qInstallMessageHandler(emptyMessageHandler);
+
+    // The tests neither read nor write the plugin metadata cache of the user
+    QVERIFY(_metadataCacheDir.isValid());
+    Bakery::setMetadataCacheFile(QDir(_metadataCacheDir.path()).absoluteFilePath("plugin_metadata.ini"));
 }
 
 void TestBakery::loadDevice_data()
@@ -92,11 +126,11 @@ void TestBakery::loadDevice_data()
         triangle << P(V(0), V(0)) << P(V(0), V(1.5)) << P(V(1.5), V(1.5));
         triangle.ensureClosed();
 
-        input.shapes.append(square);
-        input.shapes.append(square);
-        input.shapes.append(square);
-        input.shapes.append(triangle);
-        input.shapes.append(triangle);
+        input << square;
+        input << square;
+        input << square;
+        input << triangle;
+        input << triangle;
 
         QTest::newRow("Valid file") << ":/testBakery/inputFiles/valid.txt" << input << true;
     }
@@ -114,11 +148,11 @@ void TestBakery::loadDevice_data()
         triangle << P(V(0), V(0)) << P(V(0), V(-1.5)) << P(V(-1.5), V(-1.5));
         triangle.ensureClosed();
 
-        input.shapes.append(square);
-        input.shapes.append(square);
-        input.shapes.append(square);
-        input.shapes.append(triangle);
-        input.shapes.append(triangle);
+        input << square;
+        input << square;
+        input << square;
+        input << triangle;
+        input << triangle;
 
         QTest::newRow("Valid file negative") << ":/testBakery/inputFiles/validNegative.txt" << input << true;
     }
@@ -136,11 +170,11 @@ void TestBakery::loadDevice_data()
         triangle << P(V(0), V(0)) << P(V(0), V(1.5)) << P(V(1.5), V(1.5));
         triangle.ensureClosed();
 
-        input.shapes.append(square);
-        input.shapes.append(square);
-        input.shapes.append(square);
-        input.shapes.append(triangle);
-        input.shapes.append(triangle);
+        input << square;
+        input << square;
+        input << square;
+        input << triangle;
+        input << triangle;
 
         QTest::newRow("Valid file with spaces in shape name") << ":/testBakery/inputFiles/validSpaces.txt" << input << true;
     }
@@ -158,11 +192,11 @@ void TestBakery::loadDevice_data()
         triangle << P(V(0), V(0)) << P(V(0), V(1.5)) << P(V(1.5), V(1.5));
         triangle.ensureClosed();
 
-        input.shapes.append(square);
-        input.shapes.append(square);
-        input.shapes.append(square);
-        input.shapes.append(triangle);
-        input.shapes.append(triangle);
+        input << square;
+        input << square;
+        input << square;
+        input << triangle;
+        input << triangle;
 
         QTest::newRow("Valid file") << ":/testBakery/inputFiles/validWithEmptyLine.txt" << input << true;
     }
@@ -178,12 +212,56 @@ void TestBakery::loadDevice_data()
             square << P(V(0), V(0)) << P(V(0), V(1.5)) << P(V(1.5), V(1.5)) << P(V(1.5), V(0));
             square.ensureClosed();
 
-            input.shapes << square;
+            input << square;
         }
 
         QTest::newRow("Huge file") << ":/testBakery/inputFiles/hugeFile.txt" << input << true;
     }
 
+    {
+        PluginInput input;
+        input.sheetWidth = V(3.5);
+        input.sheetHeight = V(3);
+
+        Shape square("Quadrat");
+        square << P(V(0), V(0)) << P(V(0), V(1.5)) << P(V(1.5), V(1.5)) << P(V(1.5), V(0));
+        square.ensureClosed();
+
+        Shape triangle("Dreieck");
+        triangle << P(V(0), V(0)) << P(V(0), V(1.5)) << P(V(1.5), V(1.5));
+        triangle.ensureClosed();
+
+        input << square;
+        input << square;
+        input << square;
+        input << triangle;
+        input << triangle;
+
+        QTest::newRow("Numbers which are not plain decimals") << ":/testBakery/inputFiles/validSlowTokens.txt" << input << true;
+    }
+
+    {
+        PluginInput input;
+        input.sheetWidth = V(3.5);
+        input.sheetHeight = V(3);
+
+        Shape square(QTextCodec::codecForLocale()->toUnicode("Quadr\xc3\xa4t"));
+        square << P(V(0), V(0)) << P(V(0), V(1.5)) << P(V(1.5), V(1.5)) << P(V(1.5), V(0));
+        square.ensureClosed();
+
+        Shape triangle("Dreieck");
+        triangle << P(V(0), V(0)) << P(V(0), V(1.5)) << P(V(1.5), V(1.5));
+        triangle.ensureClosed();
+
+        input << square;
+        input << square;
+        input << square;
+        input << triangle;
+        input << triangle;
+
+        QTest::newRow("Non-ASCII shape name") << ":/testBakery/inputFiles/validNonAsciiName.txt" << input << true;
+    }
+
     QTest::newRow("Non-existent file") << ":/testBakery/inputFiles/THISFILEREALLYEXISTS.txt" << PluginInput() << false;
     QTest::newRow("Missing number of shapes") << ":/testBakery/inputFiles/missingNumShapes.txt" << PluginInput() << false;
     QTest::newRow("Misssing point in shape") << ":/testBakery/inputFiles/missingPoint.txt" << PluginInput() << false;
@@ -193,6 +271,8 @@ void TestBakery::loadDevice_data()
     QTest::newRow("Wrong number of shapes (too high)") << ":/testBakery/inputFiles/numberShapesTooHigh.txt" << PluginInput() << false;
     QTest::newRow("Completely broken") << ":/testBakery/inputFiles/completelyBroken.txt" << PluginInput() << false;
     QTest::newRow("Unique name used multiple times") << ":/testBakery/inputFiles/doubleName.txt" << PluginInput() << false;
+    QTest::newRow("Number out of range") << ":/testBakery/inputFiles/overflowToken.txt" << PluginInput() << false;
+    QTest::newRow("Non-ASCII character in number") << ":/testBakery/inputFiles/nonAsciiNumber.txt" << PluginInput() << false;
 }
 
 void TestBakery::loadDevice()
@@ -211,6 +291,71 @@ void TestBakery::loadDevice()
     QCOMPARE(input, created);
 }
 
+void TestBakery::loadDeviceTransports_data()
+{
+    // Reuse data
+    loadDevice_data();
+}
+
+void TestBakery::loadDeviceTransports()
+{
+    QFETCH(QString, path);
+    QFETCH(PluginInput, input);
+    QFETCH(bool, ok);
+
+    bool testOk;
+    QFile resource(path);
+    if (!resource.open(QFile::ReadOnly))
+    {
+        QVERIFY(!ok);
+        return;
+    }
+    QByteArray data = resource.readAll();
+
+    // Read from memory
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::ReadOnly);
+    QCOMPARE(Bakery::loadFromDevice(&buffer, &testOk), input);
+    QCOMPARE(testOk, ok);
+
+    // Mapped from disk
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(QDir(dir.path()).absoluteFilePath("input.txt"));
+    QVERIFY(file.open(QFile::WriteOnly));
+    file.write(data);
+    file.close();
+    QVERIFY(file.open(QFile::ReadOnly));
+    QCOMPARE(Bakery::loadFromDevice(&file, &testOk), input);
+    QCOMPARE(testOk, ok);
+
+    // Parsed by the QTextStream fallback: the fast parser hands over as soon as it finds non-ASCII characters outside of names, while
+    // QTextStream takes a no-break space between the sheet width and height as whitespace
+    QTextCodec *codec = QTextCodec::codecForLocale();
+    QByteArray space = codec->fromUnicode(QString(QChar(0x00A0)));
+    if (!space.isEmpty() && uchar(space[0]) >= 0x80 && codec->toUnicode(space) == QString(QChar(0x00A0)))
+    {
+        QByteArray decoded = data;
+        qint32 i_separator = 0;
+        while (i_separator < decoded.size() && isspace(uchar(decoded[i_separator])))
+        {
+            ++i_separator;
+        }
+        while (i_separator < decoded.size() && !isspace(uchar(decoded[i_separator])))
+        {
+            ++i_separator;
+        }
+        if (i_separator < decoded.size())
+        {
+            decoded.replace(i_separator, 1, space);
+        }
+        QBuffer decodedBuffer(&decoded);
+        decodedBuffer.open(QIODevice::ReadOnly);
+        QCOMPARE(Bakery::loadFromDevice(&decodedBuffer, &testOk), input);
+        QCOMPARE(testOk, ok);
+    }
+}
+
 void TestBakery::saveDevice_data()
 {
     QTest::addColumn<QString>("path");
@@ -308,7 +453,7 @@ void TestBakery::saveDeviceInput_data()
         shape << P(V(0), V(0)) << P(V(0), V(0.5)) << P(V(0.5), V(0.5)) << P(V(0.5), V(0));
         shape.ensureClosed();
 
-        input.shapes << shape << shape << shape;
+        input << shape << shape << shape;
 
         QTest::newRow("One shape type") << ":/testBakery/inputFiles/taskOneType.txt" << input;
     }
@@ -326,7 +471,7 @@ void TestBakery::saveDeviceInput_data()
         shape2 << P(V(0), V(0)) << P(V(0), V(0.5)) << P(V(0.5), V(0.5)) << P(V(0.5), V(0));
         shape2.ensureClosed();
 
-        input.shapes << shape << shape << shape << shape2;
+        input << shape << shape << shape << shape2;
 
         QTest::newRow("Two shape types") << ":/testBakery/inputFiles/taskTwoType.txt" << input;
     }
@@ -381,6 +526,164 @@ void TestBakery::constructorPluginLoading()
     QVERIFY(bakery.getAllPlugins().size() != 0);
 }
 
+void TestBakery::jobPluginSharing()
+{
+    Bakery bakery;
+    bakery.setTimeLimit(5000);
+    bakery.setPluginEnabled(bakery.getAllPlugins().first(), false);
+
+    QScopedPointer<Bakery> job(bakery.createJob());
+    QCOMPARE(job->getAllPlugins().size(), bakery.getAllPlugins().size());
+    QCOMPARE(job->getEnabledPlugins(), bakery.getEnabledPlugins());
+    QCOMPARE(job->getTimeLimit(), 5000);
+    QCOMPARE(job->scheduler(), bakery.scheduler());
+    QCOMPARE(job->processPool(), bakery.processPool());
+
+    // Settings are copied, not shared
+    job->setTimeLimit(1000);
+    QCOMPARE(bakery.getTimeLimit(), 5000);
+
+#ifdef Q_OS_UNIX
+    // Disabling the worker pool of a job keeps the idle workers of the shared pool
+    QProcess *worker = bakery.processPool()->acquire("cat", "/bin/cat");
+    QVERIFY(worker != NULL);
+    bakery.processPool()->release("cat", worker);
+    job->setWorkerPoolEnabled(false);
+    QCOMPARE(bakery.processPool()->acquire("cat", "/bin/cat"), worker);
+    bakery.processPool()->release("cat", worker);
+
+    // Disabling it in the prototype retires them
+    bakery.setWorkerPoolEnabled(false);
+    QProcess *newWorker = bakery.processPool()->acquire("cat", "/bin/cat");
+    QVERIFY(newWorker != NULL);
+    QVERIFY(newWorker != worker);
+    bakery.processPool()->release("cat", newWorker);
+#endif
+}
+
+void TestBakery::cachedPluginLoading()
+{
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+    QString previousCacheFile = Bakery::metadataCacheFile();
+    Bakery::setMetadataCacheFile(QDir(cacheDir.path()).absoluteFilePath("plugin_metadata.ini"));
+
+    // First instance probes the plugins, second instance uses the cache
+    Bakery probingBakery;
+    QVERIFY(QFile::exists(Bakery::metadataCacheFile()));
+    Bakery cachedBakery;
+    Bakery::setMetadataCacheFile(previousCacheFile);
+
+    QList<QString> probedPlugins = probingBakery.getAllPlugins();
+    QList<QString> cachedPlugins = cachedBakery.getAllPlugins();
+    std::sort(probedPlugins.begin(), probedPlugins.end());
+    std::sort(cachedPlugins.begin(), cachedPlugins.end());
+    QCOMPARE(cachedPlugins, probedPlugins);
+    foreach (QString pluginName, probedPlugins)
+    {
+        QCOMPARE(cachedBakery.getPluginMetadata(pluginName), probingBakery.getPluginMetadata(pluginName));
+        QCOMPARE(cachedBakery.getPluginMetadata(pluginName).capabilities, probingBakery.getPluginMetadata(pluginName).capabilities);
+    }
+
+#ifdef Q_OS_UNIX
+    // A plugin found in the cache is not started at all. The plugin records each start in a marker file.
+    QTemporaryDir pluginDir;
+    QVERIFY(pluginDir.isValid());
+    QString marker = QDir(cacheDir.path()).absoluteFilePath("probes.txt");
+    PluginMetadata meta;
+    meta.uniqueName = "probe";
+    meta.type = "test";
+    meta.author = "Bakery";
+    meta.license = "LGPL";
+    meta.capabilities << "probe";
+    QString serialized;
+    QTextStream stream(&serialized);
+    stream << meta;
+    stream.flush();
+
+    QFile script(QDir(pluginDir.path()).absoluteFilePath("probe"));
+    QVERIFY(script.open(QFile::WriteOnly));
+    script.write(QString("#!/bin/sh\necho started >> '%1'\nread command\necho '%2'\n").arg(marker, serialized).toUtf8());
+    script.close();
+    QVERIFY(script.setPermissions(script.permissions() | QFile::ExeOwner));
+
+    Bakery::setMetadataCacheFile(QDir(cacheDir.path()).absoluteFilePath("plugin_metadata.ini"));
+    Bakery probingScriptBakery(0, QDir(pluginDir.path()));
+    Bakery cachedScriptBakery(0, QDir(pluginDir.path()));
+    Bakery::setMetadataCacheFile(previousCacheFile);
+    QCOMPARE(probingScriptBakery.getPluginMetadata("probe"), meta);
+    QCOMPARE(cachedScriptBakery.getPluginMetadata("probe"), meta);
+    QCOMPARE(cachedScriptBakery.getPluginMetadata("probe").capabilities, meta.capabilities);
+
+    QFile markerFile(marker);
+    QVERIFY(markerFile.open(QFile::ReadOnly));
+    QCOMPARE(markerFile.readAll().count('\n'), 1);
+#endif
+}
+
+void TestBakery::resultCache()
+{
+    QTemporaryDir cacheDir;
+    QVERIFY(cacheDir.isValid());
+    ResultCache cache;
+    cache.setDirectory(cacheDir.path());
+
+    Shape first("first");
+    first << P(V(0), V(0)) << P(V(0), V(0.5)) << P(V(0.5), V(0.5));
+    first.ensureClosed();
+    Shape second("second");
+    second << P(V(0), V(0)) << P(V(0), V(0.2)) << P(V(0.2), V(0.2));
+    second.ensureClosed();
+
+    PluginInput input;
+    input.sheetWidth = V(1);
+    input.sheetHeight = V(1);
+    input << first << second;
+    PluginInput reordered = input;
+    reordered.setStock(ShapeStock());
+    reordered << second << first;
+    QCOMPARE(ResultCache::inputHash(input), ResultCache::inputHash(reordered));
+
+    PluginInput other = input;
+    other.sheetWidth = V(2);
+    QVERIFY(ResultCache::inputHash(input) != ResultCache::inputHash(other));
+
+    // The key depends on the plugin binary, the time limit, the objective and the simplification tolerance
+    QString binary = QDir(cacheDir.path()).absoluteFilePath("plugin");
+    QFile binaryFile(binary);
+    QVERIFY(binaryFile.open(QFile::WriteOnly));
+    binaryFile.write("plugin");
+    binaryFile.close();
+    ScoredOutput::Objective objective = ScoredOutput::AverageUtilization;
+    QString key = cache.key(ResultCache::inputHash(input), "plugin", binary, 1000, objective, 0.0);
+    QVERIFY(!key.isEmpty());
+    QCOMPARE(cache.key(ResultCache::inputHash(input), "plugin", binary, 1000, objective, 0.0), key);
+    QVERIFY(key != cache.key(ResultCache::inputHash(input), "plugin", binary, 2000, objective, 0.0));
+    QVERIFY(key != cache.key(ResultCache::inputHash(input), "plugin", binary, 1000, ScoredOutput::SheetsThenUtilization, 0.0));
+    QVERIFY(key != cache.key(ResultCache::inputHash(input), "plugin", binary, 1000, objective, 0.5));
+    QVERIFY(cache.key(ResultCache::inputHash(input), "plugin", binary + "_missing", 1000, objective, 0.0).isEmpty());
+
+    PluginOutput output;
+    QVERIFY(!cache.lookup(key, input, output));
+
+    Sheet sheet(V(1), V(1));
+    sheet << first << second;
+    PluginOutput stored;
+    stored.sheets << sheet;
+    QVERIFY(cache.store(key, stored));
+    QVERIFY(cache.lookup(key, reordered, output));
+    QCOMPARE(output.sheets.size(), 1);
+
+    // Entries not matching the input are removed
+    QVERIFY(!cache.lookup(key, other, output));
+    QVERIFY(!cache.lookup(key, input, output));
+
+    // Size bound
+    QVERIFY(cache.store(key, stored));
+    cache.setMaximumSize(1);
+    QCOMPARE(cache.size(), Q_INT64_C(0));
+}
+
 void TestBakery::bakeSheetsfromInput_data()
 {
     QTest::addColumn<PluginInput>("input");
@@ -398,11 +701,11 @@ void TestBakery::bakeSheetsfromInput_data()
         triangle << P(V(0), V(0)) << P(V(0), V(1.5)) << P(V(1.5), V(1.5));
         triangle.ensureClosed();
 
-        input.shapes.append(square);
-        input.shapes.append(square);
-        input.shapes.append(square);
-        input.shapes.append(triangle);
-        input.shapes.append(triangle);
+        input << square;
+        input << square;
+        input << square;
+        input << triangle;
+        input << triangle;
 
         QTest::newRow("Different shapes") << input;
     }
@@ -417,7 +720,7 @@ void TestBakery::bakeSheetsfromInput_data()
 
         for (qint32 i = 0; i < 50; ++i)
         {
-            input.shapes << small;
+            input << small;
         }
 
         QTest::newRow("Many small shapes") << input;
@@ -437,6 +740,30 @@ void TestBakery::bakeSheetsfromInput()
     QVERIFY2(output.sheets.size() != 0, "No sheets returned");
 }
 
+void TestBakery::bakeSheetsAsync()
+{
+    Bakery bakery;
+    bakery.setTimeLimit(10000);
+
+    PluginInput input;
+    input.sheetWidth = V(3.5);
+    input.sheetHeight = V(3);
+    Shape square("square");
+    square << P(V(0), V(0)) << P(V(0), V(1.5)) << P(V(1.5), V(1.5)) << P(V(1.5), V(0));
+    square.ensureClosed();
+    input << square << square << square;
+
+    // Results are reported through the event loop of this thread
+    QFuture<QHash<QString, PluginOutput>> future = bakery.computeAllOutputsAsync(input);
+    QTRY_VERIFY_WITH_TIMEOUT(future.isFinished(), 20000);
+    QHash<QString, PluginOutput> outputs = future.result();
+    QVERIFY2(!outputs.isEmpty(), "No outputs returned");
+    foreach (PluginOutput output, outputs)
+    {
+        QVERIFY(Bakery::isOutputValidForInput(input, output));
+    }
+}
+
 void TestBakery::bakeSheetsfromFile_data()
 {
     QTest::addColumn<QString>("path");
@@ -477,10 +804,10 @@ void TestBakery::loadSVG_data()
         shape1.ensureClosed();
 
         Shape shape2("shape2");
-        shape2 << P(V(-0.5), V(0)) << P(V(0), V(0)) << P(V(0), V(1)) << P(V(-0.5), V(1));
+        shape2 << P(V(-0.5), V(0)) << P(V(0.5), V(0)) << P(V(0.5), V(0.5)) << P(V(-0.5), V(0.5));
         shape2.ensureClosed();
 
-        input.shapes << shape1 << shape2;
+        input << shape1 << shape2;
 
         QTest::newRow("<rect>") << ":/testBakery/inputFiles/rect.svg" << input << true;
     }
@@ -498,7 +825,7 @@ void TestBakery::loadSVG_data()
         shape2 << P(V(-0.5), V(0)) << P(V(-0.5), V(1)) << P(V(0), V(1)) << P(V(0), V(0));
         shape2.ensureClosed();
 
-        input.shapes << shape1 << shape2;
+        input << shape1 << shape2;
 
         QTest::newRow("<polygon>") << ":/testBakery/inputFiles/polygon.svg" << input << true;
     }
@@ -510,9 +837,9 @@ void TestBakery::loadSVG_data()
 
         QPainterPath p;
 
-        p.addEllipse(1, 1, 2, 2);
+        p.addEllipse(QPointF(1, 1), 2, 2);
         QPolygonF polyf = p.toFillPolygon();
-        Shape shape1;
+        Shape shape1("shape1");
         foreach (QPointF p, polyf)
         {
             shape1 << BakeryHelpers::qPointPrecise(p);
@@ -520,16 +847,16 @@ void TestBakery::loadSVG_data()
         shape1.ensureClosed();
 
         p = QPainterPath();
-        p.addEllipse(1, 1, 1, 1.5);
+        p.addEllipse(QPointF(1, 2), 1, 1.5);
         polyf = p.toFillPolygon();
-        Shape shape2;
+        Shape shape2("shape2");
         foreach (QPointF p, polyf)
         {
             shape2 << BakeryHelpers::qPointPrecise(p);
         }
         shape2.ensureClosed();
 
-        input.shapes << shape1 << shape2;
+        input << shape1 << shape2;
 
         QTest::newRow("<circle>/<ellipse>") << ":/testBakery/inputFiles/ellipse.svg" << input << true;
     }
@@ -543,7 +870,7 @@ void TestBakery::loadSVG_data()
 
         p.addRoundedRect(0, 0, 1, 1, 0.5, 0.5);
         QPolygonF polyf = p.toFillPolygon();
-        Shape shape1;
+        Shape shape1("shape1");
         foreach (QPointF p, polyf)
         {
             shape1 << BakeryHelpers::qPointPrecise(p);
@@ -551,16 +878,16 @@ void TestBakery::loadSVG_data()
         shape1.ensureClosed();
 
         p = QPainterPath();
-        p.addRoundedRect(1.1, 1.2, 1.3, 1.4, 0.2, 0.3);
+        p.addRoundedRect(1.1, 1.2, 1.4, 1.3, 0.2, 0.3);
         polyf = p.toFillPolygon();
-        Shape shape2;
+        Shape shape2("shape2");
         foreach (QPointF p, polyf)
         {
             shape2 << BakeryHelpers::qPointPrecise(p);
         }
         shape2.ensureClosed();
 
-        input.shapes << shape1 << shape1 << shape1 << shape1 << shape2;
+        input << shape1 << shape1 << shape1 << shape1 << shape2;
 
         QTest::newRow("<rect> with rounded corners") << ":/testBakery/inputFiles/rectRound.svg" << input << true;
     }
@@ -576,7 +903,7 @@ void TestBakery::loadSVG_data()
 
         for (qint32 i = 0; i < 100; ++i)
         {
-            input.shapes << rect;
+            input << rect;
         }
 
         QTest::newRow("Huge file") << ":/testBakery/inputFiles/hugeFile.svg" << input << true;
@@ -601,17 +928,183 @@ void TestBakery::loadSVG()
     QCOMPARE(ok, testOk);
     QCOMPARE(input.sheetHeight, created.sheetHeight);
     QCOMPARE(input.sheetWidth, created.sheetWidth);
-    QCOMPARE(input.shapes.size(), created.shapes.size());
+    QCOMPARE(input.shapeCount(), created.shapeCount());
 
     QSet<QString> nameSet;
+    QList<Shape> inputShapes = input.shapes();
+    QList<Shape> createdShapes = created.shapes();
 
-    for (QList<Shape>::Iterator i = input.shapes.begin(), c = created.shapes.begin(); i != input.shapes.end(); ++i, ++c)
+    for (QList<Shape>::Iterator i = inputShapes.begin(), c = createdShapes.begin(); i != inputShapes.end(); ++i, ++c)
     {
         // The name is not important - just compare the points and ensure each name is unique
         QCOMPARE((QPolygon)*i, (QPolygon)*c);
         nameSet << c->name();
     }
-    QVERIFY2(nameSet.size() == created.shapes.size(), "Not all shapes have unique name");
+    QVERIFY2(nameSet.size() == created.shapeCount(), "Not all shapes have unique name");
+}
+
+void TestBakery::loadSVGConservative_data()
+{
+    QTest::addColumn<qreal>("tolerance");
+    QTest::addColumn<qint32>("maximumVertices");
+
+    QTest::newRow("Tolerance") << 0.01 << 0;
+    QTest::newRow("Tolerance and budget") << 0.01 << 32;
+    QTest::newRow("Small budget") << 0.0 << 8;
+}
+
+void TestBakery::loadSVGConservative()
+{
+    QFETCH(qreal, tolerance);
+    QFETCH(qint32, maximumVertices);
+
+    SVGImportParameters parameters;
+    parameters.tolerance = tolerance;
+    parameters.maximumVertices = maximumVertices;
+
+    // Points on the curves of ellipse.svg and path.svg
+    QList<QList<QPointF>> curves;
+    QList<QPointF> circle;
+    QList<QPointF> ellipse;
+    QList<QPointF> path;
+    for (qint32 i = 0; i <= 360; ++i)
+    {
+        qreal angle = qDegreesToRadians(qreal(i));
+        circle << QPointF(1.0 + 2.0 * qCos(angle), 1.0 + 2.0 * qSin(angle));
+        ellipse << QPointF(1.0 + qCos(angle), 2.0 + 1.5 * qSin(angle));
+
+        qreal t = i / 360.0;
+        path << (1 - t) * (1 - t) * QPointF(2, 0) + 2 * t * (1 - t) * QPointF(3, 1) + t * t * QPointF(2, 2);
+        path << (1 - t) * (1 - t) * (1 - t) * QPointF(2, 2) + 3 * t * (1 - t) * (1 - t) * QPointF(1.5, 3)
+                    + 3 * t * t * (1 - t) * QPointF(0.5, 3) + t * t * t * QPointF(0, 2);
+        path << QPointF(-qSin(angle / 2.0), 1.0 - qCos(angle / 2.0));
+    }
+    curves << circle << ellipse << path;
+
+    QList<Shape> shapes;
+    foreach (QString fileName, QStringList() << ":/testBakery/inputFiles/ellipse.svg" << ":/testBakery/inputFiles/path.svg")
+    {
+        bool ok;
+        QFile file(fileName);
+        file.open(QFile::ReadOnly);
+        shapes << Bakery::loadFromSVG(&file, &ok, parameters).shapes();
+        QVERIFY(ok);
+    }
+    QCOMPARE(shapes.size(), 4);
+
+    for (qint32 i_curve = 0; i_curve < curves.size(); ++i_curve)
+    {
+        if (maximumVertices > 0)
+        {
+            // Shapes are closed, so the first point is repeated
+            QVERIFY(shapes[i_curve].size() <= maximumVertices + 1);
+        }
+        foreach (const QPointF &point, curves[i_curve])
+        {
+            QVERIFY2(shapes[i_curve].containsPoint(BakeryHelpers::qPointPrecise(point), Qt::OddEvenFill), "Curve not contained");
+        }
+    }
+
+    // Straight paths are exact and holes are filled
+    Shape square;
+    square << P(V(0), V(0)) << P(V(1), V(0)) << P(V(1), V(1)) << P(V(0), V(1));
+    square.ensureClosed();
+    QCOMPARE((QPolygon)shapes[3], (QPolygon)square);
+
+    // The default import flattens the same curves
+    QFile defaultFile(":/testBakery/inputFiles/ellipse.svg");
+    defaultFile.open(QFile::ReadOnly);
+    QList<Shape> defaultShapes = Bakery::loadFromSVG(&defaultFile).shapes();
+    QCOMPARE(defaultShapes.size(), 2);
+    for (qint32 i_shape = 0; i_shape < defaultShapes.size(); ++i_shape)
+    {
+        // Allow for rounding to BAKERY_PRECISION
+        QRect conservativeBounds = shapes[i_shape].boundingRect().adjusted(-1, -1, 1, 1);
+        QRect defaultBounds = defaultShapes[i_shape].boundingRect();
+        QVERIFY2(conservativeBounds.contains(defaultBounds), "Default import differs from conservative import");
+        QVERIFY(qAbs(conservativeBounds.center().x() - defaultBounds.center().x()) <= V(0.01));
+        QVERIFY(qAbs(conservativeBounds.center().y() - defaultBounds.center().y()) <= V(0.01));
+    }
+
+    bool ok;
+    QBuffer buffer;
+    buffer.setData("<svg width=\"1\" height=\"1\"><path d=\"M 0 0 L 1 # 1\" /></svg>");
+    buffer.open(QBuffer::ReadOnly);
+    Bakery::loadFromSVG(&buffer, &ok, parameters);
+    QVERIFY(!ok);
+}
+
+void TestBakery::saveSVG_data()
+{
+    QTest::addColumn<bool>("autoFormatting");
+
+    QTest::newRow("Indented") << true;
+    QTest::newRow("Compact") << false;
+}
+
+void TestBakery::saveSVG()
+{
+    QFETCH(bool, autoFormatting);
+
+    PluginOutput output;
+    for (qint32 i = 0; i < 5; ++i)
+    {
+        Shape shape(QString("shape%1").arg(i));
+        shape << P(V(0.25 * i), V(0)) << P(V(1.125), V(0.5)) << P(V(0.5), V(-1.5));
+        shape.ensureClosed();
+        Sheet sheet(V(2), V(2));
+        sheet << shape << shape;
+        output.sheets << sheet;
+    }
+
+    // Sheets are written in parallel, each file has to contain its own sheet
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(Bakery::saveAsSVG(output, QDir(dir.path()), "sheet", autoFormatting));
+    for (qint32 i = 0; i < output.sheets.size(); ++i)
+    {
+        QFile file(QDir(dir.path()).absoluteFilePath(QString("sheet-%1.svg").arg(i + 1)));
+        QVERIFY(file.open(QFile::ReadOnly));
+        QCOMPARE(file.readAll().contains("\n    <polygon"), autoFormatting);
+        file.seek(0);
+
+        bool ok;
+        PluginInput loaded = Bakery::loadFromSVG(&file, &ok);
+        QVERIFY(ok);
+        QCOMPARE(loaded.shapeCount(), output.sheets[i].size());
+        foreach (const Shape &shape, loaded.shapes())
+        {
+            QCOMPARE((QPolygon)shape, (QPolygon)output.sheets[i].shapes().first());
+        }
+    }
+}
+
+void TestBakery::formatPrecise_data()
+{
+    QTest::addColumn<qint64>("value");
+    QTest::addColumn<QByteArray>("text");
+
+    QTest::newRow("Zero") << qint64(0) << QByteArray("0");
+    QTest::newRow("Integer") << qint64(V(42)) << QByteArray("42");
+    QTest::newRow("Fraction") << qint64(V(1.5)) << QByteArray("1.5");
+    QTest::newRow("Small fraction") << qint64(1) << QByteArray("0.00001");
+    QTest::newRow("Negative") << qint64(V(-0.25)) << QByteArray("-0.25");
+    QTest::newRow("Seven digits") << qint64(12345678) << QByteArray("123.45678");
+    QTest::newRow("Large") << qint64(std::numeric_limits<qint32>::max()) << QByteArray("21474.83647");
+    QTest::newRow("Minimum") << std::numeric_limits<qint64>::min() << QByteArray("-92233720368547.75808");
+}
+
+void TestBakery::formatPrecise()
+{
+    QFETCH(qint64, value);
+    QFETCH(QByteArray, text);
+
+    char buffer[32];
+    QCOMPARE(QByteArray(buffer, BakeryHelpers::formatPrecise(value, buffer)), text);
+
+    QByteArray appended("x");
+    BakeryHelpers::appendPrecise(appended, value);
+    QCOMPARE(appended, QByteArray("x") + text);
 }
 
 void TestBakery::isOutputValidForInput_data()
@@ -641,7 +1134,7 @@ void TestBakery::isOutputValidForInput_data()
         s << P(V(0), V(0)) << P(V(0), V(0.1)) << P(V(0.1), V(0.1));
         s.ensureClosed();
 
-        input.shapes << s << s << s;
+        input << s << s << s;
 
         Sheet sheet(V(1), V(1));
         sheet << s;
@@ -662,7 +1155,7 @@ void TestBakery::isOutputValidForInput_data()
         s << P(V(0), V(0)) << P(V(0), V(0.1)) << P(V(0.1), V(0.1));
         s.ensureClosed();
 
-        input.shapes << s << s << s;
+        input << s << s << s;
 
         s.moveTo(50, 50);
         Sheet sheet(V(1), V(1));
@@ -684,7 +1177,7 @@ void TestBakery::isOutputValidForInput_data()
         s << P(V(0), V(0)) << P(V(0), V(0.1)) << P(V(0.1), V(0.1));
         s.ensureClosed();
 
-        input.shapes << s << s << s;
+        input << s << s << s;
 
         s.rotate(P(2, 2), 0.5);
         s.moveTo(50, 50);
@@ -711,7 +1204,7 @@ void TestBakery::isOutputValidForInput_data()
         s2 << P(V(0), V(0)) << P(V(0), V(0.3)) << P(V(0.3), V(0.3));
         s2.ensureClosed();
 
-        input.shapes << s1 << s1 << s1 << s2 << s2;
+        input << s1 << s1 << s1 << s2 << s2;
 
         Sheet sheet1(V(1.5), V(1));
         sheet1 << s1;
@@ -735,7 +1228,7 @@ void TestBakery::isOutputValidForInput_data()
         s << P(V(0), V(0)) << P(V(0), V(0.1)) << P(V(0.1), V(0.1));
         s.ensureClosed();
 
-        input.shapes << s << s << s;
+        input << s << s << s;
 
         Sheet sheet(V(3), V(3));
         sheet << s;
@@ -760,7 +1253,7 @@ void TestBakery::isOutputValidForInput_data()
         s << P(V(0), V(0)) << P(V(0), V(0.1)) << P(V(0.1), V(0.1));
         s.ensureClosed();
 
-        input.shapes << s << s;
+        input << s << s;
 
         Sheet sheet(V(1), V(1));
         sheet << s;
@@ -781,7 +1274,7 @@ void TestBakery::isOutputValidForInput_data()
         s << P(V(0), V(0)) << P(V(0), V(0.1)) << P(V(0.1), V(0.1));
         s.ensureClosed();
 
-        input.shapes << s << s << s << s;
+        input << s << s << s << s;
 
         Sheet sheet(V(1), V(1));
         sheet << s;
@@ -802,7 +1295,7 @@ void TestBakery::isOutputValidForInput_data()
         s << P(V(0), V(0)) << P(V(0), V(0.1)) << P(V(0.1), V(0.1));
         s.ensureClosed();
 
-        input.shapes << s << s << s;
+        input << s << s << s;
 
         s = Shape("shapeNEW");
         s << P(V(0), V(0)) << P(V(0), V(0.1)) << P(V(0.1), V(0.1)) << P(V(0.1), V(0));
@@ -827,7 +1320,7 @@ void TestBakery::isOutputValidForInput_data()
         shape << P(V(0), V(0)) << P(V(0), V(0.1)) << P(V(0.1), V(0.1));
         shape.ensureClosed();
 
-        input.shapes << shape << shape << shape;
+        input << shape << shape << shape;
 
         Sheet sheet(V(1.5), V(1));
         sheet << shape;
@@ -848,7 +1341,7 @@ void TestBakery::isOutputValidForInput_data()
         s << P(V(0), V(0)) << P(V(0), V(0.1)) << P(V(0.1), V(0.1));
         s.ensureClosed();
 
-        input.shapes << s << s << s;
+        input << s << s << s;
 
         Sheet sheet(V(3), V(3));
         sheet << s;
@@ -871,7 +1364,7 @@ void TestBakery::isOutputValidForInput_data()
         s << P(V(0), V(0)) << P(V(0), V(0.1)) << P(V(0.1), V(0.1));
         s.ensureClosed();
 
-        input.shapes << s << s << s;
+        input << s << s << s;
 
         Sheet sheet(V(3), V(3));
         sheet << s;
@@ -894,6 +1387,288 @@ void TestBakery::isOutputValidForInput()
     QCOMPARE(Bakery::isOutputValidForInput(input, output), equal);
 }
 
+void TestBakery::outputValidator_data() { isOutputValidForInput_data(); }
+
+void TestBakery::outputValidator()
+{
+    QFETCH(PluginInput, input);
+    QFETCH(PluginOutput, output);
+    QFETCH(bool, equal);
+
+    OutputValidator validator(input);
+    QCOMPARE(validator.update(output) && validator.isComplete(), equal);
+    QCOMPARE(validator.hasCompleteOutput(), equal);
+}
+
+void TestBakery::outputValidatorIncremental()
+{
+    PluginInput input;
+    input.sheetHeight = V(1);
+    input.sheetWidth = V(1);
+
+    Shape s("shape");
+    s << P(V(0), V(0)) << P(V(0), V(0.1)) << P(V(0.1), V(0.1));
+    s.ensureClosed();
+    input << s << s << s;
+
+    OutputValidator validator(input);
+
+    // Shapes are added one after another
+    PluginOutput output;
+    Sheet sheet(V(1), V(1));
+    sheet << s;
+    output.sheets << sheet;
+    QVERIFY(validator.update(output));
+    QVERIFY(!validator.isComplete());
+    Shape moved = s;
+    moved.moveTo(V(0.5), V(0.5));
+    output.sheets[0] << moved;
+    QVERIFY(validator.update(output));
+    QCOMPARE(validator.checkedShapes(), qint64(2));
+    Sheet second(V(1), V(1));
+    second << s;
+    output.sheets << second;
+    QVERIFY(validator.update(output));
+    QVERIFY(validator.isComplete());
+    QCOMPARE(validator.checkedShapes(), qint64(3));
+    PluginOutput best = output;
+
+    // Overlapping shapes are rejected without changing the state
+    PluginOutput overlapping = output;
+    overlapping.sheets.removeLast();
+    overlapping.sheets[0] << s;
+    QVERIFY(!validator.update(overlapping));
+    QVERIFY(!validator.error().isEmpty());
+    QVERIFY(validator.isComplete());
+    QCOMPARE(validator.currentOutput().sheets.size(), 2);
+
+    // Shapes which are not part of the input are rejected
+    PluginOutput unknown = output;
+    Shape other = moved;
+    other.setName("other");
+    unknown.sheets[1] << other;
+    QVERIFY(!validator.update(unknown));
+
+    // Partial outputs are valid but do not replace the best output
+    PluginOutput partial = output;
+    partial.sheets.removeLast();
+    QVERIFY(validator.update(partial));
+    QVERIFY(!validator.isComplete());
+    QVERIFY(validator.hasCompleteOutput());
+    QCOMPARE(validator.bestOutput().sheets.size(), best.sheets.size());
+
+    // A better complete output replaces the best output
+    Shape right = s;
+    right.moveTo(V(0.5), V(0));
+    partial.sheets[0] << right;
+    QVERIFY(validator.update(partial));
+    QVERIFY(validator.isComplete());
+    QCOMPARE(validator.bestOutput().sheets.size(), 1);
+}
+
+void TestBakery::lowerBounds_data()
+{
+    QTest::addColumn<PluginInput>("input");
+    QTest::addColumn<qint32>("areaBound");
+    QTest::addColumn<qint32>("largeItemBound");
+
+    PluginInput input;
+    input.sheetWidth = V(1);
+    input.sheetHeight = V(1);
+    QTest::newRow("No shapes") << input << 0 << 0;
+
+    {
+        Shape small("small");
+        small << P(V(0), V(0)) << P(V(0), V(0.5)) << P(V(0.5), V(0.5)) << P(V(0.5), V(0));
+        small.ensureClosed();
+        PluginInput smallInput = input;
+        smallInput << small << small << small << small << small;
+        QTest::newRow("Small shapes") << smallInput << 2 << 1;
+    }
+
+    {
+        Shape large("large");
+        large << P(V(0), V(0)) << P(V(0), V(0.8)) << P(V(0.8), V(0.8)) << P(V(0.8), V(0));
+        large.ensureClosed();
+        Shape small("small");
+        small << P(V(0), V(0)) << P(V(0), V(0.1)) << P(V(0.1), V(0.1)) << P(V(0.1), V(0));
+        small.ensureClosed();
+        PluginInput largeInput = input;
+        largeInput << large << small << large << large;
+        QTest::newRow("Large shapes") << largeInput << 2 << 3;
+    }
+}
+
+void TestBakery::lowerBounds()
+{
+    QFETCH(PluginInput, input);
+    QFETCH(qint32, areaBound);
+    QFETCH(qint32, largeItemBound);
+
+    QCOMPARE(BakeryBounds::areaBound(input), areaBound);
+    QCOMPARE(BakeryBounds::largeItemBound(input), largeItemBound);
+    QCOMPARE(BakeryBounds::lowerBound(input), qMax(areaBound, largeItemBound));
+}
+
+void TestBakery::simplifier()
+{
+    Shape circle("circle");
+    for (qint32 i = 0; i < 100; ++i)
+    {
+        qreal angle = 2 * M_PI * i / 100;
+        circle << P(V(1 + qCos(angle)), V(1 + qSin(angle)));
+    }
+    circle.ensureClosed();
+    QPoint center(V(1), V(1));
+
+    // Simplified shapes contain the original shape
+    Shape simplified = BakerySimplifier::simplify(circle, V(0.01));
+    QCOMPARE(simplified.name(), circle.name());
+    QVERIFY(simplified.size() < circle.size());
+    QVERIFY(simplified.isClosed());
+    QVERIFY(simplified.isSimple());
+    QVERIFY(simplified.area() >= circle.area());
+    foreach (const QPoint &point, circle)
+    {
+        QVERIFY(simplified.containsPoint(center + (point - center) * 0.999, Qt::OddEvenFill));
+    }
+    QCOMPARE(BakerySimplifier::simplify(circle, 0), circle);
+
+    // Collinear and reflex vertices are removed
+    Shape notched("notched");
+    notched << P(V(0), V(0)) << P(V(0.5), V(0)) << P(V(1), V(0)) << P(V(1), V(1)) << P(V(0.5), V(0.999)) << P(V(0), V(1));
+    notched.ensureClosed();
+    QCOMPARE(BakerySimplifier::simplify(notched, V(0.01)).size(), 5);
+    QCOMPARE(BakerySimplifier::simplify(notched, V(0.0001)).size(), 6);
+
+    // The original shape is restored at the placement of the simplified shape
+    qreal angle = M_PI / 3;
+    Shape placed = simplified.rotated(QPoint(0, 0), angle);
+    QPoint offset = QPoint(V(2), V(2)) - placed.position();
+    placed.moveTo(V(2), V(2));
+    Shape restored = BakerySimplifier::restore(circle, simplified, placed);
+    QCOMPARE(restored.name(), circle.name());
+    QCOMPARE(restored.size(), circle.size());
+    QTransform transform;
+    transform.translate(offset.x(), offset.y());
+    transform.rotateRadians(angle);
+    for (qint32 i = 0; i < circle.size(); ++i)
+    {
+        QVERIFY(QLineF(transform.map(QPointF(circle[i])), QPointF(restored[i])).length() <= 4.0);
+        QVERIFY(placed.containsPoint(placed.centroid() + (restored[i] - placed.centroid()) * 0.999, Qt::OddEvenFill));
+    }
+
+    // Outputs
+    PluginInput input;
+    input.sheetWidth = V(4);
+    input.sheetHeight = V(4);
+    input << circle << circle;
+    PluginInput simplifiedInput = BakerySimplifier::simplify(input, 0.01);
+    QCOMPARE(simplifiedInput.sheetWidth, input.sheetWidth);
+    QCOMPARE(simplifiedInput.shapeCount(), 2);
+    QCOMPARE(simplifiedInput.stock().prototype(0), simplified);
+
+    PluginOutput output;
+    Sheet sheet(V(4), V(4));
+    sheet << placed;
+    output.sheets << sheet;
+    PluginOutput restoredOutput = BakerySimplifier::restore(output, input, simplifiedInput);
+    QCOMPARE(restoredOutput.sheets.size(), 1);
+    QCOMPARE(restoredOutput.sheets[0].shapes().first(), restored);
+
+    // Invalid restored sheets keep the simplified placement
+    PluginOutput invalidOutput;
+    Sheet smallSheet(V(1), V(1));
+    smallSheet << placed;
+    invalidOutput.sheets << smallSheet;
+    restoredOutput = BakerySimplifier::restore(invalidOutput, input, simplifiedInput);
+    QCOMPARE(restoredOutput.sheets.size(), 1);
+    QCOMPARE(restoredOutput.sheets[0].shapes().first(), placed);
+}
+
+void TestBakery::randomInputs_data()
+{
+    QTest::addColumn<int>("polygonMethod");
+    QTest::addColumn<qint32>("minPoints");
+    QTest::addColumn<qint32>("maxPoints");
+
+    QTest::newRow("Rejection sampling") << int(RandomPluginInputParameters::RejectionSampling) << 3 << 8;
+    QTest::newRow("Star-shaped") << int(RandomPluginInputParameters::StarShaped) << 3 << 8;
+    QTest::newRow("Star-shaped, many vertices") << int(RandomPluginInputParameters::StarShaped) << 100 << 250;
+}
+
+void TestBakery::randomInputs()
+{
+    QFETCH(int, polygonMethod);
+    QFETCH(qint32, minPoints);
+    QFETCH(qint32, maxPoints);
+
+    RandomPluginInputParameters parameters;
+    parameters.polygonMethod = RandomPluginInputParameters::PolygonMethod(polygonMethod);
+    parameters.minPoints = minPoints;
+    parameters.maxPoints = maxPoints;
+
+    QList<qint32> seeds;
+    seeds << 0 << 1 << 2 << 3 << 42;
+    QList<PluginInput> inputs = Bakery::randomInputs(parameters, seeds);
+    QCOMPARE(inputs.size(), seeds.size());
+
+    // Parallel generation has to give the same inputs as sequential generation
+    for (qint32 i = 0; i < seeds.size(); ++i)
+    {
+        parameters.seed = seeds[i];
+        QVERIFY(inputs[i] == Bakery::randomInput(parameters));
+        QVERIFY(inputs[i].shapeCount() > 0);
+        foreach (const Shape &shape, inputs[i].shapes())
+        {
+            QVERIFY(shape.isClosed());
+            QVERIFY(shape.isSimple());
+            QVERIFY(shape.size() >= minPoints + 1);
+            QVERIFY(shape.size() <= maxPoints + 1);
+        }
+    }
+    QVERIFY(!(inputs[0] == inputs[1]));
+}
+
+void TestBakery::randomProfiles_data()
+{
+    QTest::addColumn<QString>("profile");
+    QTest::addColumn<qint32>("minShapes");
+    QTest::addColumn<qint32>("minPoints");
+
+    QTest::newRow("Default") << "default" << 1 << 3;
+    QTest::newRow("Many pieces") << "many-pieces" << 10000 << 3;
+    QTest::newRow("High vertex") << "high-vertex" << 1 << 200;
+    QTest::newRow("Extreme aspect") << "extreme-aspect" << 1 << 3;
+    QTest::newRow("Many types") << "many-types" << 200 << 3;
+    QTest::newRow("Jigsaw") << "jigsaw" << 1 << 4;
+}
+
+void TestBakery::randomProfiles()
+{
+    QFETCH(QString, profile);
+    QFETCH(qint32, minShapes);
+    QFETCH(qint32, minPoints);
+
+    QVERIFY(Bakery::randomProfiles().contains(profile));
+    bool ok;
+    RandomPluginInputParameters parameters = Bakery::randomProfile(profile, &ok);
+    QVERIFY(ok);
+    parameters.seed = 7;
+
+    PluginInput input = Bakery::randomInput(parameters);
+    QVERIFY(input == Bakery::randomInput(parameters));
+    QVERIFY(input.shapeCount() >= minShapes);
+    foreach (const Shape &shape, input.shapes())
+    {
+        QVERIFY(shape.isSimple());
+        QVERIFY(shape.size() >= minPoints + 1);
+    }
+
+    Bakery::randomProfile("unknown", &ok);
+    QVERIFY(!ok);
+}
+
 QTEST_MAIN(TestBakery)
 
 #include "tst_testbakery.moc"
@@ -20,10 +20,14 @@
 #include <helpers.hpp>
 #include <bakery.h>
 #include <plugins.h>
+#include <scoredoutput.h>
+#include <counters.h>
+#include <trace.h>
 
 #include <QString>
 #include <QtTest>
 #include <QTimer>
+#include <QTemporaryDir>
 
 // Convenience
 #define V(x) BakeryHelpers::qrealPrecise(x)
@@ -46,6 +50,20 @@ private Q_SLOTS:
     void initTestCase();
     void testPlugin_data();
     void testPlugin();
+    void testWorkerPool_data();
+    void testWorkerPool();
+    void testSharedMemory_data();
+    void testSharedMemory();
+    void testSharedMemoryPortfolio();
+    void lowerBoundObjective_data();
+    void lowerBoundObjective();
+    void pluginDeadline();
+    void pluginScheduler();
+    void pluginPortfolio();
+    void scoredOutput();
+    void shapeStock();
+    void counters();
+    void trace();
     void pluginInputSerialization_data();
     void pluginInputSerialization();
     void pluginOutputSerialization_data();
@@ -58,6 +76,9 @@ private Q_SLOTS:
     void pluginOutputDeserialization();
     void pluginMetadataDeserialization_data();
     void pluginMetadataDeserialization();
+
+private:
+    QTemporaryDir _metadataCacheDir;
 };
 
 TestPlugins::TestPlugins() {}
@@ -68,11 +89,16 @@ void TestPlugins::initTestCase()
     // want to test invalid files the warning and debug messages are suppressed
     // to make the test output more readable
     qInstallMessageHandler(emptyMessageHandler);
+
+    // The tests neither read nor write the plugin metadata cache of the user
+    QVERIFY(_metadataCacheDir.isValid());
+    Bakery::setMetadataCacheFile(QDir(_metadataCacheDir.path()).absoluteFilePath("plugin_metadata.ini"));
 }
 void TestPlugins::testPlugin_data()
 {
     QTest::addColumn<QString>("pluginName");
     QTest::addColumn<QString>("fileName");
+    QTest::addColumn<bool>("inProcess");
     Bakery bakery;
     QList<QString> files;
 
@@ -87,7 +113,8 @@ void TestPlugins::testPlugin_data()
     {
         foreach (QString s, bakery.getAllPlugins())
         {
-            QTest::newRow(QString("%1: '%2'").arg(s).arg(file).toLatin1()) << s << file;
+            QTest::newRow(QString("%1: '%2'").arg(s).arg(file).toLatin1()) << s << file << false;
+            QTest::newRow(QString("%1 (in-process): '%2'").arg(s).arg(file).toLatin1()) << s << file << true;
         }
     }
 }
@@ -96,12 +123,17 @@ void TestPlugins::testPlugin()
 {
     QFETCH(QString, pluginName);
     QFETCH(QString, fileName);
+    QFETCH(bool, inProcess);
 
     Bakery bakery;
     bakery.setAllPluginsEnabled(false);
     bakery.setPluginEnabled(pluginName);
+    bakery.setInProcessEnabled(inProcess);
     bakery.setTimeLimit(120 * 1000);
 
+    // Without a library the plugin would silently run as process
+    QVERIFY2(!inProcess || !bakery.pluginLibraryPath(pluginName).isEmpty(), "Plugin library not loaded");
+
     QFile file(fileName);
     file.open(QIODevice::ReadOnly);
 
@@ -115,16 +147,542 @@ void TestPlugins::testPlugin()
     QVERIFY2(Bakery::isOutputValidForInput(input, output), "Input does not match output");
 }
 
+void TestPlugins::testWorkerPool_data()
+{
+    QTest::addColumn<QString>("pluginName");
+    Bakery bakery;
+
+    foreach (QString s, bakery.getAllPlugins())
+    {
+        QTest::newRow(s.toLatin1()) << s;
+    }
+}
+
+void TestPlugins::testWorkerPool()
+{
+    QFETCH(QString, pluginName);
+
+    Bakery bakery;
+    bakery.setAllPluginsEnabled(false);
+    bakery.setPluginEnabled(pluginName);
+    bakery.setWorkerPoolEnabled();
+    bakery.processPool()->setMaximumJobs(2);
+    bakery.processPool()->setMaximumMemoryGrowth(Q_INT64_C(256) * 1024 * 1024);
+    bakery.setTimeLimit(120 * 1000);
+
+    QList<QString> files;
+    files << ":/testPlugins/inputFiles/valid.txt";
+    files << ":/testPlugins/inputFiles/hasToTurn.txt";
+    files << ":/testPlugins/inputFiles/valid.txt";
+
+    // Second job reuses the worker, third job needs a new one
+    foreach (QString fileName, files)
+    {
+        QFile file(fileName);
+        file.open(QIODevice::ReadOnly);
+
+        bool ok;
+        PluginInput input = bakery.loadFromDevice(&file, &ok);
+        QVERIFY2(ok, "Error while loading file");
+
+        PluginOutput output = bakery.computeBestOutput(input, &ok);
+        QVERIFY2(ok, "Error while processing");
+        QVERIFY2(output.sheets.size() != 0, "No sheets returned");
+        QVERIFY2(Bakery::isOutputValidForInput(input, output), "Input does not match output");
+    }
+}
+
+void TestPlugins::testSharedMemory_data()
+{
+    QTest::addColumn<QString>("pluginName");
+    QTest::addColumn<QString>("fileName");
+    Bakery bakery;
+    QList<QString> files;
+
+    files << ":/testPlugins/inputFiles/valid.txt";
+    files << ":/testPlugins/inputFiles/manyMixed.txt";
+
+    foreach (QString file, files)
+    {
+        foreach (QString s, bakery.getAllPlugins())
+        {
+            QTest::newRow(QString("%1: '%2'").arg(s).arg(file).toLatin1()) << s << file;
+        }
+    }
+}
+
+void TestPlugins::testSharedMemory()
+{
+    QFETCH(QString, pluginName);
+    QFETCH(QString, fileName);
+
+    Bakery bakery;
+    bakery.setAllPluginsEnabled(false);
+    bakery.setPluginEnabled(pluginName);
+    bakery.setSharedMemoryEnabled();
+    bakery.setTimeLimit(120 * 1000);
+
+    QFile file(fileName);
+    file.open(QIODevice::ReadOnly);
+
+    bool ok;
+    PluginInput input = bakery.loadFromDevice(&file, &ok);
+    QVERIFY2(ok, "Error while loading file");
+
+    PluginOutput output = bakery.computeBestOutput(input, &ok);
+    QVERIFY2(ok, "Error while processing");
+    QVERIFY2(output.sheets.size() != 0, "No sheets returned");
+    QVERIFY2(Bakery::isOutputValidForInput(input, output), "Input does not match output");
+}
+
+void TestPlugins::testSharedMemoryPortfolio()
+{
+    // More plugins than cores, so the portfolio would pause plugins writing to their output segments
+    Bakery bakery;
+    bakery.setSharedMemoryEnabled();
+    bakery.setPortfolioEnabled();
+    bakery.portfolio()->setCores(1);
+    bakery.portfolio()->setStallTime(100);
+    bakery.setTimeLimit(10 * 1000);
+    QSignalSpy pauseSpy(bakery.portfolio(), SIGNAL(pauseRequested(QString)));
+
+    QFile file(":/testPlugins/inputFiles/manyMixed.txt");
+    file.open(QIODevice::ReadOnly);
+
+    bool ok;
+    PluginInput input = bakery.loadFromDevice(&file, &ok);
+    QVERIFY2(ok, "Error while loading file");
+
+    PluginOutput output = bakery.computeBestOutput(input, &ok);
+    QVERIFY2(ok, "Error while processing");
+    QVERIFY2(Bakery::isOutputValidForInput(input, output), "Input does not match output");
+    QCOMPARE(pauseSpy.count(), 0);
+}
+
+void TestPlugins::lowerBoundObjective_data()
+{
+    QTest::addColumn<int>("objective");
+    QTest::addColumn<bool>("stopped");
+
+    QTest::newRow("AverageUtilization") << int(ScoredOutput::AverageUtilization) << true;
+    QTest::newRow("SheetsThenUtilization") << int(ScoredOutput::SheetsThenUtilization) << false;
+    QTest::newRow("Density") << int(ScoredOutput::Density) << false;
+}
+
+void TestPlugins::lowerBoundObjective()
+{
+    QFETCH(int, objective);
+    QFETCH(bool, stopped);
+
+    // With a large slack every complete output reaches the lower bound
+    Bakery bakery;
+    bakery.setObjective(ScoredOutput::Objective(objective));
+    bakery.setStopAtLowerBoundEnabled();
+    bakery.setLowerBoundSlack(1000);
+    QSignalSpy spy(&bakery, SIGNAL(lowerBoundReached(QString, qint32)));
+
+    QFile file(":/testPlugins/inputFiles/valid.txt");
+    file.open(QIODevice::ReadOnly);
+
+    bool ok;
+    PluginInput input = bakery.loadFromDevice(&file, &ok);
+    QVERIFY2(ok, "Error while loading file");
+
+    PluginOutput output = bakery.computeBestOutput(input, &ok);
+    QVERIFY2(ok, "Error while processing");
+    QVERIFY2(Bakery::isOutputValidForInput(input, output), "Input does not match output");
+    QCOMPARE(spy.count() == 1, stopped);
+}
+
+void TestPlugins::pluginDeadline()
+{
+    PluginDeadline deadline;
+    QVERIFY(!deadline.reached());
+    QCOMPARE(deadline.remainingTime(), Q_INT64_C(-1));
+
+    deadline.set(PluginDeadline::now() + 60000);
+    QVERIFY(!deadline.reached());
+    QVERIFY(deadline.remainingTime() > 0);
+
+    // Only earlier deadlines are accepted
+    deadline.tighten(PluginDeadline::now() + 120000);
+    QVERIFY(deadline.remainingTime() <= 60000);
+    deadline.tighten(PluginDeadline::now() - 1);
+    QVERIFY(deadline.reached());
+    QCOMPARE(deadline.remainingTime(), Q_INT64_C(0));
+
+    deadline.clear();
+    QVERIFY(!deadline.reached());
+
+    // Deadline of the current thread
+    QVERIFY(!BakeryPlugins::deadlineReached());
+    PluginDeadline::setCurrent(&deadline);
+    deadline.set(PluginDeadline::now() - 1);
+    QVERIFY(BakeryPlugins::deadlineReached());
+    PluginDeadline::setCurrent(NULL);
+    QVERIFY(!BakeryPlugins::deadlineReached());
+}
+
+void TestPlugins::pluginScheduler()
+{
+    PluginScheduler scheduler;
+    scheduler.setMaximumConcurrent(2);
+    scheduler.setThreadsPerPlugin(2);
+    scheduler.setThreadsPerPlugin("single", 1);
+    scheduler.setCpuAffinityEnabled(true);
+    QSignalSpy spy(&scheduler, SIGNAL(runnerReady(AbstractPluginRunner *)));
+
+    PluginRunner first("first", "", PluginInput());
+    PluginRunner second("single", "", PluginInput());
+    PluginRunner third("third", "", PluginInput());
+    scheduler.enqueue(&first);
+    scheduler.enqueue(&second);
+    scheduler.enqueue(&third);
+    QCOMPARE(spy.count(), 2);
+    QCOMPARE(scheduler.running(), 2);
+    QVERIFY(scheduler.isQueued(&third));
+    QCOMPARE(scheduler.threadsPerPlugin("first"), 2);
+    QCOMPARE(scheduler.threadsPerPlugin("single"), 1);
+
+    // Queued runners start as soon as a slot is free
+    scheduler.release(&first);
+    QCOMPARE(spy.count(), 3);
+    QCOMPARE(spy.last().at(0).value<AbstractPluginRunner *>(), static_cast<AbstractPluginRunner *>(&third));
+    QVERIFY(!scheduler.isQueued(&third));
+
+    scheduler.release(&second);
+    scheduler.release(&third);
+    QCOMPARE(scheduler.running(), 0);
+    QCOMPARE(scheduler.queued(), 0);
+
+    // Thread budget of the current thread
+    BakeryPlugins::setThreadBudget(3);
+    QCOMPARE(BakeryPlugins::threadBudget(), 3);
+    BakeryPlugins::setThreadBudget(0);
+    QCOMPARE(BakeryPlugins::threadBudget(), QThread::idealThreadCount());
+}
+
+void TestPlugins::pluginPortfolio()
+{
+    PluginPortfolio portfolio;
+    portfolio.setCores(1);
+    portfolio.setStallTime(1000);
+    QSignalSpy pauseSpy(&portfolio, SIGNAL(pauseRequested(QString)));
+    QSignalSpy resumeSpy(&portfolio, SIGNAL(resumeRequested(QString)));
+    QSignalSpy terminateSpy(&portfolio, SIGNAL(terminateRequested(QString)));
+
+    // Decisions are only made when evaluate() is called explicitly
+    portfolio.start(0);
+    portfolio.stop();
+    portfolio.pluginStarted("leader", true, 0);
+    portfolio.pluginStarted("trailer", true, 0);
+    portfolio.pluginOutputUpdated("leader", 50, 0, 100);
+    portfolio.pluginOutputUpdated("trailer", 40, 0, 100);
+
+    // Only one core: the trailing plugin is paused
+    portfolio.evaluate(200);
+    QCOMPARE(pauseSpy.count(), 1);
+    QCOMPARE(pauseSpy.first().at(0).toString(), QString("trailer"));
+
+    // The leader is not terminated even if it stalls
+    portfolio.pluginOutputUpdated("leader", 60, 0, 300);
+    portfolio.evaluate(1500);
+    QCOMPARE(terminateSpy.count(), 0);
+    QCOMPARE(portfolio.trajectory("leader").size(), 2);
+
+    // A free core resumes the paused plugin, which is terminated once it stalls behind the leader
+    portfolio.pluginFinished("leader");
+    portfolio.evaluate(1600);
+    QCOMPARE(resumeSpy.count(), 1);
+    portfolio.evaluate(2000);
+    QCOMPARE(terminateSpy.count(), 0);
+    portfolio.evaluate(2700);
+    QCOMPARE(terminateSpy.count(), 1);
+    QCOMPARE(terminateSpy.first().at(0).toString(), QString("trailer"));
+
+    // Plugins without a complete output are not stalling, however long their first output takes
+    PluginPortfolio slowPortfolio;
+    slowPortfolio.setCores(4);
+    slowPortfolio.setStallTime(1000);
+    QSignalSpy slowTerminateSpy(&slowPortfolio, SIGNAL(terminateRequested(QString)));
+    slowPortfolio.start(0);
+    slowPortfolio.stop();
+    slowPortfolio.pluginStarted("fast", true, 0);
+    slowPortfolio.pluginStarted("slow", true, 0);
+    slowPortfolio.pluginOutputUpdated("fast", 50, 0, 100);
+    slowPortfolio.evaluate(5000);
+    QCOMPARE(slowTerminateSpy.count(), 0);
+    slowPortfolio.pluginOutputUpdated("slow", 40, 0, 5000);
+    slowPortfolio.evaluate(5500);
+    QCOMPARE(slowTerminateSpy.count(), 0);
+    slowPortfolio.evaluate(6000);
+    QCOMPARE(slowTerminateSpy.count(), 1);
+    QCOMPARE(slowTerminateSpy.first().at(0).toString(), QString("slow"));
+
+    // Scores follow the objective: with fewer sheets first the primary scores are negative and ties are decided by the secondary score
+    PluginPortfolio sheetsPortfolio;
+    sheetsPortfolio.setCores(4);
+    sheetsPortfolio.setStallTime(1000);
+    QSignalSpy sheetsTerminateSpy(&sheetsPortfolio, SIGNAL(terminateRequested(QString)));
+    sheetsPortfolio.start(0);
+    sheetsPortfolio.stop();
+    sheetsPortfolio.pluginStarted("concentrated", true, 0);
+    sheetsPortfolio.pluginStarted("spread", true, 0);
+    sheetsPortfolio.pluginOutputUpdated("concentrated", -2, 0.6, 100);
+    sheetsPortfolio.pluginOutputUpdated("spread", -3, 0.9, 100);
+    sheetsPortfolio.pluginOutputUpdated("spread", -2, 0.4, 200);
+    QCOMPARE(sheetsPortfolio.trajectory("spread").size(), 2);
+    sheetsPortfolio.evaluate(1200);
+    QCOMPARE(sheetsTerminateSpy.count(), 1);
+    QCOMPARE(sheetsTerminateSpy.first().at(0).toString(), QString("spread"));
+
+    // Scored outputs are compared the same way
+    Shape square("square");
+    square << P(0, 0) << P(0, 0.5) << P(0.5, 0.5) << P(0.5, 0);
+    square.ensureClosed();
+    Sheet sheet(V(1), V(1));
+    sheet << square;
+    PluginOutput output;
+    output.sheets << sheet;
+    PluginPortfolio scoredPortfolio;
+    scoredPortfolio.start(0);
+    scoredPortfolio.stop();
+    scoredPortfolio.pluginStarted("plugin", true, 0);
+    scoredPortfolio.pluginOutputUpdated("plugin", ScoredOutput(output, ScoredOutput::SheetsThenUtilization), 100);
+    QCOMPARE(scoredPortfolio.trajectory("plugin").size(), 1);
+    QCOMPARE(scoredPortfolio.trajectory("plugin").first().second, qreal(-1));
+}
+
+void TestPlugins::scoredOutput()
+{
+    Shape square("square");
+    square << P(0, 0) << P(0, 0.5) << P(0.5, 0.5) << P(0.5, 0);
+    square.ensureClosed();
+    Shape right = square;
+    right.moveTo(V(0.5), V(0));
+
+    // Two sheets with one square each, one sheet with two squares, two sheets with three squares
+    Sheet single(V(1), V(1));
+    single << square;
+    Sheet twice(V(1), V(1));
+    twice << square << right;
+    PluginOutput spread;
+    spread.sheets << single << single;
+    PluginOutput compact;
+    compact.sheets << twice;
+    PluginOutput uneven;
+    uneven.sheets << twice << single;
+
+    // Comparison is strict
+    ScoredOutput scoredSpread(spread);
+    QVERIFY(!(scoredSpread < scoredSpread));
+    QVERIFY(!(spread < spread));
+    QVERIFY(spread < compact);
+
+    // Average utilization
+    QVERIFY(ScoredOutput(spread) < ScoredOutput(uneven));
+    QVERIFY(ScoredOutput(uneven) < ScoredOutput(compact));
+    QCOMPARE(ScoredOutput::best(QList<PluginOutput>() << spread << compact << uneven), 1);
+
+    // Sheets first, then concentrated utilization
+    ScoredOutput::Objective sheets = ScoredOutput::SheetsThenUtilization;
+    QCOMPARE(ScoredOutput(spread, sheets).score(), ScoredOutput(uneven, sheets).score());
+    QVERIFY(ScoredOutput(spread, sheets) < ScoredOutput(uneven, sheets));
+    QVERIFY(ScoredOutput(uneven, sheets) < ScoredOutput(compact, sheets));
+    QCOMPARE(ScoredOutput::best(QList<PluginOutput>() << spread << uneven, sheets), 1);
+
+    // Density
+    QVERIFY(ScoredOutput(spread, ScoredOutput::Density) < ScoredOutput(compact, ScoredOutput::Density));
+
+    // Ties are won by the first output, empty lists have no best output
+    QCOMPARE(ScoredOutput::best(QList<PluginOutput>() << spread << spread), 0);
+    QCOMPARE(ScoredOutput::best(QList<PluginOutput>()), -1);
+
+    // Names
+    bool ok;
+    foreach (QString name, ScoredOutput::objectiveNames())
+    {
+        QCOMPARE(ScoredOutput::objectiveName(ScoredOutput::objectiveFromName(name, &ok)), name);
+        QVERIFY(ok);
+    }
+    ScoredOutput::objectiveFromName("unknown", &ok);
+    QVERIFY(!ok);
+}
+
+void TestPlugins::shapeStock()
+{
+    Shape square("square");
+    square << P(0, 0) << P(0, 1) << P(1, 1) << P(1, 0);
+    square.ensureClosed();
+    Shape triangle("triangle");
+    triangle << P(0, 0) << P(0, 1) << P(1, 1);
+    triangle.ensureClosed();
+
+    PluginInput input;
+    input << square << triangle << square << square;
+
+    ShapeStock stock = input.stock();
+    QCOMPARE(stock.types(), 2);
+    QCOMPARE(stock.total(), 4);
+    QCOMPARE(stock.prototype(0), square);
+    QCOMPARE(stock.count(0), 3);
+    QCOMPARE(stock.count("triangle"), 1);
+    QCOMPARE(stock.count("circle"), 0);
+    QCOMPARE(stock.indexOf("circle"), -1);
+
+    // Pieces are counted in order of their types
+    QCOMPARE(stock.typeOfPiece(0), 0);
+    QCOMPARE(stock.typeOfPiece(2), 0);
+    QCOMPARE(stock.typeOfPiece(3), 1);
+    QCOMPARE(stock.typeOfPiece(4), -1);
+
+    // Taking pieces
+    QVERIFY(stock.take("triangle"));
+    QVERIFY(!stock.take("triangle"));
+    QVERIFY(!stock.take("circle"));
+    QCOMPARE(stock.types(), 2);
+    QCOMPARE(stock.typeOfPiece(2), 0);
+    QCOMPARE(stock.typeOfPiece(3), -1);
+    QVERIFY(stock.take(0));
+    QCOMPARE(stock.total(), 2);
+    QVERIFY(!stock.isEmpty());
+
+    // Flat list adapter
+    stock.add(triangle, 2);
+    QCOMPARE(stock.toList(), QList<Shape>() << square << square << triangle << triangle);
+    input.setStock(stock);
+    QCOMPARE(input.shapeCount(), 4);
+    QVERIFY(stock.take(0) && stock.take(0) && stock.take(1) && stock.take(1));
+    QVERIFY(stock.isEmpty());
+
+    // A different shape with a known name is rejected instead of being merged
+    Shape impostor("square");
+    impostor << P(0, 0) << P(0, 2) << P(2, 2) << P(2, 0);
+    impostor.ensureClosed();
+    stock.add(impostor, 3);
+    QCOMPARE(stock.total(), 0);
+    QCOMPARE(stock.types(), 2);
+    QCOMPARE(stock.prototype(stock.indexOf("square")), square);
+    stock.add(square);
+    QCOMPARE(stock.count("square"), 1);
+}
+
+void TestPlugins::counters()
+{
+    Shape square("square");
+    square << P(0, 0) << P(0, 1) << P(1, 1) << P(1, 0);
+    square.ensureClosed();
+    Shape far(square);
+    far.translate(P(5, 5));
+    Shape overlapping(square);
+    overlapping.translate(P(0.5, 0.5));
+
+    // Disabled counters do not count
+    BakeryCounters::reset();
+    BakeryCounters::setEnabled(false);
+    square.intersects(far);
+    QCOMPARE(BakeryCounters::values()["shape_intersects"], quint64(0));
+
+    BakeryCounters::setEnabled(true);
+    QVERIFY(!square.intersects(far));
+    QVERIFY(square.intersects(overlapping));
+    BakeryCounters::setEnabled(false);
+    QHash<QString, quint64> values = BakeryCounters::values();
+    QCOMPARE(values.size(), qint32(BakeryCounters::CounterCount));
+    QCOMPARE(values["shape_intersects"], quint64(2));
+    QCOMPARE(values["bounding_box_rejects"], quint64(1));
+    QCOMPARE(values["exact_tests"], quint64(1));
+
+    // Serialization
+    bool ok;
+    QHash<QString, quint64> deserialized = BakeryCounters::deserialize(BakeryCounters::serialize(values).toLatin1(), &ok);
+    QVERIFY(ok);
+    QCOMPARE(deserialized, values);
+    BakeryCounters::deserialize("counters_begin 2 shape_intersects 1 counters_end ", &ok);
+    QVERIFY(!ok);
+    BakeryCounters::deserialize("counters_begin 1 shape_intersects many counters_end ", &ok);
+    QVERIFY(!ok);
+
+    BakeryCounters::reset();
+    QCOMPARE(BakeryCounters::values()["shape_intersects"], quint64(0));
+}
+
+void TestPlugins::trace()
+{
+    // Disabled tracing does not record
+    BakeryTrace::reset();
+    BakeryTrace::setEnabled(false);
+    {
+        PluginSpan span("disabled");
+        span.setArgument("shapes", 1);
+    }
+    QVERIFY(BakeryTrace::events().isEmpty());
+
+    BakeryTrace::setEnabled(true);
+    qint64 start = BakeryTrace::now();
+    {
+        PluginSpan span("place shape");
+        span.setArgument("shape", QString("square"));
+    }
+    qint64 lane = BakeryTrace::newLane("lane");
+    BakeryTrace::instant("exit", "plugin", QVariantMap(), lane);
+    BakeryTrace::setEnabled(false);
+    QList<BakeryTrace::Event> events = BakeryTrace::events();
+    QCOMPARE(events.size(), 2);
+    QCOMPARE(events[0].name, QString("place shape"));
+    QCOMPARE(events[0].category, QString("plugin"));
+    QCOMPARE(events[0].phase, 'X');
+    QVERIFY(events[0].timestamp >= start);
+    QVERIFY(events[0].duration >= 0);
+    QCOMPARE(events[0].thread, BakeryTrace::currentThread());
+    QCOMPARE(events[0].arguments["shape"].toString(), QString("square"));
+    QCOMPARE(events[1].phase, 'i');
+    QCOMPARE(events[1].thread, lane);
+
+    // Serialization
+    bool ok;
+    QString serialized = BakeryTrace::serialize(events);
+    QVERIFY(!serialized.contains('\n'));
+    QList<BakeryTrace::Event> deserialized = BakeryTrace::deserialize(serialized.toLatin1(), &ok);
+    QVERIFY(ok);
+    QCOMPARE(deserialized.size(), 2);
+    QCOMPARE(deserialized[0].name, events[0].name);
+    QCOMPARE(deserialized[0].timestamp, events[0].timestamp);
+    QCOMPARE(deserialized[0].duration, events[0].duration);
+    QCOMPARE(deserialized[0].process, events[0].process);
+    QCOMPARE(deserialized[0].arguments, events[0].arguments);
+    QCOMPARE(deserialized[1].phase, 'i');
+    BakeryTrace::deserialize("trace_begin {} trace_end ", &ok);
+    QVERIFY(!ok);
+    BakeryTrace::deserialize("trace_begin [{\"name\":\"x\"}] trace_end ", &ok);
+    QVERIFY(!ok);
+
+    // Chrome trace
+    QBuffer buffer;
+    buffer.open(QBuffer::WriteOnly);
+    QVERIFY(BakeryTrace::writeChromeTrace(&buffer));
+    QJsonDocument document = QJsonDocument::fromJson(buffer.data());
+    QVERIFY(document.isObject());
+    QJsonArray traceEvents = document.object()["traceEvents"].toArray();
+    QCOMPARE(traceEvents.size(), 4);
+    QCOMPARE(traceEvents.last().toObject()["ph"].toString(), QString("i"));
+
+    BakeryTrace::reset();
+    QVERIFY(BakeryTrace::events().isEmpty());
+}
+
 void TestPlugins::pluginInputSerialization_data()
 {
     QTest::addColumn<PluginInput>("input");
+    QTest::addColumn<bool>("shapeStock");
     QTest::addColumn<QString>("serialized");
 
     {
         PluginInput input;
         input.sheetWidth = V(1.5);
         input.sheetHeight = V(2.5);
-        QTest::newRow("Empty input") << input << "plugininput_begin 100000 150000 250000 0 shapelist_begin shapelist_end plugininput_end ";
+        QTest::newRow("Empty input") << input << false
+                                     << "plugininput_begin 100000 150000 250000 0 shapelist_begin shapelist_end plugininput_end ";
     }
 
     {
@@ -136,10 +694,16 @@ void TestPlugins::pluginInputSerialization_data()
         shape << P(0, 0) << P(0, 1) << P(1, 1) << P(1, 0);
         shape.ensureClosed();
 
-        input.shapes << shape;
+        input << shape;
 
-        QTest::newRow("1 shape") << input << "plugininput_begin 100000 150000 250000 1 shapelist_begin shape_begin text_begin shape "
-                                             "text_end 4 0 0 0 100000 100000 100000 100000 0 shape_end shapelist_end plugininput_end ";
+        QTest::newRow("1 shape") << input << false
+                                 << "plugininput_begin 100000 150000 250000 1 shapelist_begin shape_begin text_begin shape text_end 4 0 0 "
+                                    "0 100000 100000 100000 100000 0 shape_end shapelist_end plugininput_end ";
+
+        // Without identical pieces a list is written in any case
+        QTest::newRow("1 shape stock") << input << true
+                                       << "plugininput_begin 100000 150000 250000 1 shapelist_begin shape_begin text_begin shape text_end "
+                                          "4 0 0 0 100000 100000 100000 100000 0 shape_end shapelist_end plugininput_end ";
     }
 
     {
@@ -151,23 +715,65 @@ void TestPlugins::pluginInputSerialization_data()
         shape << P(0, 0) << P(0, 1) << P(1, 1) << P(1, 0);
         shape.ensureClosed();
 
-        input.shapes << shape << shape;
+        input << shape << shape;
+
+        QTest::newRow("2 shapes") << input << false
+                                  << "plugininput_begin 100000 150000 250000 2 shapelist_begin shape_begin text_begin shape text_end 4 0 "
+                                     "0 0 100000 100000 100000 100000 0 shape_end shape_begin text_begin shape text_end 4 0 0 0 100000 "
+                                     "100000 100000 100000 0 shape_end shapelist_end plugininput_end ";
 
-        QTest::newRow("2 shapes") << input << "plugininput_begin 100000 150000 250000 2 shapelist_begin shape_begin text_begin shape "
-                                              "text_end 4 0 0 0 100000 100000 100000 100000 0 shape_end shape_begin text_begin shape "
-                                              "text_end 4 0 0 0 100000 100000 100000 100000 0 shape_end shapelist_end plugininput_end ";
+        QTest::newRow("2 shapes stock") << input << true
+                                        << "plugininput_begin 100000 150000 250000 2 shapestock_begin 1 2 shape_begin text_begin shape "
+                                           "text_end 4 0 0 0 100000 100000 100000 100000 0 shape_end shapestock_end plugininput_end ";
+    }
+
+    {
+        PluginInput input;
+        input.sheetWidth = V(1.5);
+        input.sheetHeight = V(2.5);
+
+        Shape shape("shape");
+        shape << P(0, 0) << P(0, 1) << P(1, 1) << P(1, 0);
+        shape.ensureClosed();
+        Shape other("other");
+        other << P(0, 0) << P(0, 1) << P(1, 1);
+        other.ensureClosed();
+
+        input << shape << shape << other << shape;
+
+        QTest::newRow("Types") << input << false
+                               << "plugininput_begin 100000 150000 250000 4 shapelist_begin shape_begin text_begin shape text_end 4 0 0 0 "
+                                  "100000 100000 100000 100000 0 shape_end shape_begin text_begin shape text_end 4 0 0 0 100000 100000 "
+                                  "100000 100000 0 shape_end shape_begin text_begin shape text_end 4 0 0 0 100000 100000 100000 100000 0 "
+                                  "shape_end shape_begin text_begin other text_end 3 0 0 0 100000 100000 100000 shape_end shapelist_end "
+                                  "plugininput_end ";
+
+        QTest::newRow("Types stock") << input << true
+                                     << "plugininput_begin 100000 150000 250000 4 shapestock_begin 2 3 shape_begin text_begin shape "
+                                        "text_end 4 0 0 0 100000 100000 100000 100000 0 shape_end 1 shape_begin text_begin other text_end "
+                                        "3 0 0 0 100000 100000 100000 shape_end shapestock_end plugininput_end ";
     }
 }
 
 void TestPlugins::pluginInputSerialization()
 {
     QFETCH(PluginInput, input);
+    QFETCH(bool, shapeStock);
     QFETCH(QString, serialized);
 
     QString testString;
     QTextStream stream(&testString, QIODevice::WriteOnly);
-    stream << input;
+    BakeryPlugins::writePluginInput(stream, input, shapeStock);
     QCOMPARE(testString, serialized);
+
+    // The stream operator never writes a shape stock
+    if (!shapeStock)
+    {
+        QString streamString;
+        QTextStream operatorStream(&streamString, QIODevice::WriteOnly);
+        operatorStream << input;
+        QCOMPARE(streamString, serialized);
+    }
 }
 
 void TestPlugins::pluginOutputSerialization_data()
@@ -253,6 +859,22 @@ void TestPlugins::pluginMetadataSerialization_data()
         QTest::newRow("Metadata with spaces") << meta << "pluginmetadata_begin text_begin my name text_end text_begin my type text_end "
                                                          "text_begin my author text_end text_begin my license text_end pluginmetadata_end ";
     }
+
+    {
+        PluginMetadata meta;
+        meta.uniqueName = "myName";
+        meta.type = "myType";
+        meta.author = "myAuthor";
+        meta.license = "myLicense";
+        meta.capabilities << "shapestock"
+                          << "my capability";
+
+        QTest::newRow("Metadata with capabilities") << meta
+                                                    << "pluginmetadata_begin text_begin myName text_end text_begin myType text_end "
+                                                       "text_begin myAuthor text_end text_begin myLicense text_end capabilities_begin 2 "
+                                                       "text_begin shapestock text_end text_begin my capability text_end capabilities_end "
+                                                       "pluginmetadata_end ";
+    }
 }
 
 void TestPlugins::pluginMetadataSerialization()
@@ -270,6 +892,26 @@ void TestPlugins::pluginInputDeserialization_data()
 {
     // Reuse data
     pluginInputSerialization_data();
+
+    // Runs of the same type may be split up
+    PluginInput input;
+    input.sheetWidth = V(1.5);
+    input.sheetHeight = V(2.5);
+
+    Shape shape("shape");
+    shape << P(0, 0) << P(0, 1) << P(1, 1) << P(1, 0);
+    shape.ensureClosed();
+    Shape other("other");
+    other << P(0, 0) << P(0, 1) << P(1, 1);
+    other.ensureClosed();
+
+    input << shape << shape << other << shape;
+
+    QTest::newRow("Split runs") << input << true
+                                << "plugininput_begin 100000 150000 250000 4 shapestock_begin 3 2 shape_begin text_begin shape text_end 4 "
+                                   "0 0 0 100000 100000 100000 100000 0 shape_end 1 shape_begin text_begin other text_end 3 0 0 0 100000 "
+                                   "100000 100000 shape_end 1 shape_begin text_begin shape text_end 4 0 0 0 100000 100000 100000 100000 0 "
+                                   "shape_end shapestock_end plugininput_end ";
 }
 
 void TestPlugins::pluginInputDeserialization()
@@ -315,6 +957,7 @@ void TestPlugins::pluginMetadataDeserialization()
     PluginMetadata newMeta;
     stream >> newMeta;
     QCOMPARE(newMeta, meta);
+    QCOMPARE(newMeta.capabilities, meta.capabilities);
 }
 
 QTEST_MAIN(TestPlugins)